@@ -5,6 +5,9 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
 ../source/mqttsn_client.cpp \
+../source/mqttsn_log.cpp \
+../source/mqttsn_publish_aggregator.cpp \
+../source/mqttsn_publish_scheduler.cpp \
 ../source/mqttsn_serializer.cpp \
 ../source/openthread-mqttsn.cpp 
 
@@ -14,6 +17,9 @@ C_SRCS += \
 
 OBJS += \
 ./source/mqttsn_client.o \
+./source/mqttsn_log.o \
+./source/mqttsn_publish_aggregator.o \
+./source/mqttsn_publish_scheduler.o \
 ./source/mqttsn_serializer.o \
 ./source/mtb.o \
 ./source/openthread-mqttsn.o \
@@ -21,6 +27,9 @@ OBJS += \
 
 CPP_DEPS += \
 ./source/mqttsn_client.d \
+./source/mqttsn_log.d \
+./source/mqttsn_publish_aggregator.d \
+./source/mqttsn_publish_scheduler.d \
 ./source/mqttsn_serializer.d \
 ./source/openthread-mqttsn.d 
 
@@ -29,7 +29,13 @@
 #include <string.h>
 #include "mqttsn_client.hpp"
 #include "mqttsn_serializer.hpp"
-#include "fsl_debug_console.h"
+#include "mqttsn_log.hpp"
+#include "openthread/netdata.h"
+#include "openthread/thread.h"
+#include "openthread/platform/random.h"
+#include "openthread/platform/settings.h"
+#include "thread/mle_constants.hpp"
+#include "thread/thread_netif.hpp"
 
 /**
  * @file
@@ -38,1398 +44,3068 @@
  */
 
 /**
- * Maximal supported MQTT-SN message size in bytes.
+ * Maximal size in bytes of received MQTT-SN message other than PUBLISH. The longest one is REGISTER
+ * with topic name.
  *
  */
-#define MAX_PACKET_SIZE 255
+#define MAX_CONTROL_PACKET_SIZE 64
+
+/**
+ * Settings key of stored session binding. Topic records are stored under following key.
+ *
+ */
+#ifndef MQTTSN_SETTINGS_KEY_SESSION
+#define MQTTSN_SETTINGS_KEY_SESSION 0x8000
+#endif
+
+#define SETTINGS_KEY_TOPICS (MQTTSN_SETTINGS_KEY_SESSION + 1)
+
+// Topic record: two bytes topic ID, flags and topic name without null terminator
+#define TOPIC_RECORD_HEADER_SIZE 3
+#define TOPIC_RECORD_FLAG_REGISTERED 0x01
+#define TOPIC_RECORD_FLAG_SUBSCRIBED 0x02
+#define TOPIC_RECORD_QOS_SHIFT 2
+#define TOPIC_RECORD_QOS_MASK 0x03
+
+/**
+ * Thread Network Data service of MQTT-SN gateway is identified by enterprise number and service data.
+ *
+ */
+#ifndef MQTTSN_NETDATA_ENTERPRISE_NUMBER
+#define MQTTSN_NETDATA_ENTERPRISE_NUMBER 44970
+#endif
+
+#ifndef MQTTSN_NETDATA_SERVICE_DATA
+#define MQTTSN_NETDATA_SERVICE_DATA "mqtt-sn"
+#endif
+
+// Server data: gateway address, two bytes port and gateway ID
+#define NETDATA_SERVER_DATA_PORT_OFFSET 16
+#define NETDATA_SERVER_DATA_ID_OFFSET 18
+#define NETDATA_SERVER_DATA_LENGTH 19
 /**
  * Minimal MQTT-SN message size in bytes.
  *
  */
 #define MQTTSN_MIN_PACKET_LENGTH 2
+/**
+ * DUP flag bit in PUBLISH and SUBSCRIBE message flags field.
+ *
+ */
+#define MQTTSN_FLAG_DUP 0x80
 
 namespace ot {
 
 namespace Mqttsn {
-// TODO: Implement retransmission and DUP behavior
-// TODO: Implement OT logging
-
-template <typename CallbackType>
-MessageMetadata<CallbackType>::MessageMetadata()
-{
-    ;
-}
-
-template <typename CallbackType>
-MessageMetadata<CallbackType>::MessageMetadata(const Ip6::Address &aDestinationAddress, uint16_t aDestinationPort, uint16_t aMessageId, uint32_t aTimestamp, uint32_t aRetransmissionTimeout, CallbackType aCallback, void* aContext)
-    : mDestinationAddress(aDestinationAddress)
-    , mDestinationPort(aDestinationPort)
-    , mMessageId(aMessageId)
-    , mTimestamp(aTimestamp)
-    , mRetransmissionTimeout(aRetransmissionTimeout)
-    , mRetransmissionCount(0)
-    , mCallback(aCallback)
-    , mContext(aContext)
-{
-    ;
-}
 
-template <typename CallbackType>
-otError MessageMetadata<CallbackType>::AppendTo(Message &aMessage) const
+WaitingMessagesIndex::WaitingMessagesIndex()
+    : mSize(0)
 {
-    return aMessage.Append(this, sizeof(*this));
+    memset(mEntries, 0, sizeof(mEntries));
+    memset(mIdTable, 0, sizeof(mIdTable));
+    // Heap positions behind the heap size hold free slots
+    for (uint8_t i = 0; i < kMaxWaitingMessages; i++)
+    {
+        mHeap[i] = i;
+    }
 }
 
-template <typename CallbackType>
-uint16_t MessageMetadata<CallbackType>::ReadFrom(Message &aMessage)
+otError WaitingMessagesIndex::Add(uint32_t aDeadline, bool aHasDeadline, uint16_t aMessageId, Message &aMessage,
+    WaitingMessagesQueueBase &aQueue, uint8_t &aSlot)
 {
-    return aMessage.Read(aMessage.GetLength() - sizeof(*this), sizeof(*this), this);
-}
+    otError error = OT_ERROR_NONE;
+    uint8_t slot;
+
+    VerifyOrExit(mSize < kMaxWaitingMessages, error = OT_ERROR_NO_BUFS);
+    slot = mHeap[mSize];
+    mEntries[slot].mDeadline = aDeadline;
+    mEntries[slot].mHasDeadline = aHasDeadline;
+    mEntries[slot].mMessage = &aMessage;
+    mEntries[slot].mQueue = &aQueue;
+    mEntries[slot].mMessageId = aMessageId;
+    mEntries[slot].mHeapIndex = mSize;
+    mSize++;
+    SiftUp(mEntries[slot].mHeapIndex);
+    AddId(slot);
+    aSlot = slot;
 
-template <typename CallbackType>
-uint16_t MessageMetadata<CallbackType>::GetLength() const
-{
-    return sizeof(*this);
+exit:
+    return error;
 }
 
-template <typename CallbackType>
-WaitingMessagesQueue<CallbackType>::WaitingMessagesQueue(TimeoutCallbackFunc aTimeoutCallback, void* aTimeoutContext)
-    : mQueue()
-    , mTimeoutCallback(aTimeoutCallback)
-    , mTimeoutContext(aTimeoutContext)
+void WaitingMessagesIndex::Update(uint8_t aSlot, uint32_t aDeadline)
 {
-    ;
-}
+    VerifyOrExit(aSlot < kMaxWaitingMessages && mEntries[aSlot].mMessage != nullptr);
+    mEntries[aSlot].mDeadline = aDeadline;
+    SiftUp(mEntries[aSlot].mHeapIndex);
+    SiftDown(mEntries[aSlot].mHeapIndex);
 
-template <typename CallbackType>
-WaitingMessagesQueue<CallbackType>::~WaitingMessagesQueue(void)
-{
-    ForceTimeout();
+exit:
+    return;
 }
 
-template <typename CallbackType>
-otError WaitingMessagesQueue<CallbackType>::EnqueueCopy(const Message &aMessage, uint16_t aLength, const MessageMetadata<CallbackType> &aMetadata)
+void WaitingMessagesIndex::Remove(uint8_t aSlot)
 {
-    otError error = OT_ERROR_NONE;
-    Message *messageCopy = nullptr;
-
-    VerifyOrExit((messageCopy = aMessage.Clone(aLength)) != NULL, error = OT_ERROR_NO_BUFS);
-    SuccessOrExit(error = aMetadata.AppendTo(*messageCopy));
-    SuccessOrExit(error = mQueue.Enqueue(*messageCopy));
+    uint8_t index;
+
+    VerifyOrExit(aSlot < kMaxWaitingMessages && mEntries[aSlot].mMessage != nullptr);
+    RemoveId(aSlot);
+    index = mEntries[aSlot].mHeapIndex;
+    mEntries[aSlot].mMessage = nullptr;
+    mEntries[aSlot].mQueue = nullptr;
+    mSize--;
+    // Move the last entry to the released position, the slot goes to the free part of the array
+    if (index != mSize)
+    {
+        Swap(index, mSize);
+        SiftUp(index);
+        SiftDown(index);
+    }
 
 exit:
-    return error;
+    return;
 }
 
-template <typename CallbackType>
-otError WaitingMessagesQueue<CallbackType>::Dequeue(Message &aMessage)
+Message* WaitingMessagesIndex::Find(const WaitingMessagesQueueBase &aQueue, uint16_t aMessageId) const
 {
-    otError error = mQueue.Dequeue(aMessage);
-    aMessage.Free();
-    return error;
-}
+    uint8_t position = GetIdHome(aMessageId);
 
-template <typename CallbackType>
-Message* WaitingMessagesQueue<CallbackType>::Find(uint16_t aMessageId, MessageMetadata<CallbackType> &aMetadata)
-{
-    Message* message = mQueue.GetHead();
-    while (message)
+    // Table is never full so the probing always ends on empty position
+    while (mIdTable[position] != 0)
     {
-        aMetadata.ReadFrom(*message);
-        if (aMessageId == aMetadata.mMessageId)
+        const Entry &entry = mEntries[mIdTable[position] - 1];
+        if (entry.mMessageId == aMessageId && entry.mQueue == &aQueue)
         {
-            return message;
+            return entry.mMessage;
         }
-        message = message->GetNext();
+        position = (position + 1) & (kWaitingMessagesIdTableSize - 1);
     }
     return nullptr;
 }
 
-template <typename CallbackType>
-otError WaitingMessagesQueue<CallbackType>::HandleTimer()
+bool WaitingMessagesIndex::GetNextDeadline(uint32_t &aDeadline) const
 {
-    otError error = OT_ERROR_NONE;
-    Message* message = mQueue.GetHead();
-    while (message)
+    // Entries without deadline are at the bottom of the heap
+    if (mSize == 0 || !mEntries[mHeap[0]].mHasDeadline)
     {
-        Message* current = message;
-        message = message->GetNext();
-        MessageMetadata<CallbackType> metadata;
-        metadata.ReadFrom(*current);
-        // check if message timed out
-        if (metadata.mTimestamp + metadata.mRetransmissionTimeout <= TimerMilli::GetNow())
-        {
-            if (mTimeoutCallback)
-            {
-                // Invoke timeout callback
-                mTimeoutCallback(metadata, mTimeoutContext);
-            }
-            SuccessOrExit(error = Dequeue(*current));
-        }
+        return false;
     }
-exit:
-    return error;
+    aDeadline = mEntries[mHeap[0]].mDeadline;
+    return true;
 }
 
-template <typename CallbackType>
-void WaitingMessagesQueue<CallbackType>::ForceTimeout()
+void WaitingMessagesIndex::HandleExpired(uint32_t aNow)
 {
-    Message* message = mQueue.GetHead();
-    while (message)
+    // Each handler reschedules or removes the entry. Number of iterations is limited to avoid endless loop
+    // when the entry is rescheduled to already passed time.
+    for (uint8_t count = mSize; count > 0 && mSize > 0; count--)
     {
-        Message* current = message;
-        message = message->GetNext();
-        MessageMetadata<CallbackType> metadata;
-        metadata.ReadFrom(*current);
-        if (mTimeoutCallback)
+        Entry &entry = mEntries[mHeap[0]];
+        if (!entry.mHasDeadline || IsBefore(aNow, entry.mDeadline))
         {
-            mTimeoutCallback(metadata, mTimeoutContext);
+            break;
         }
-        Dequeue(*current);
+        entry.mQueue->HandleDeadline(*entry.mMessage);
     }
 }
 
-
-
-MqttsnClient::MqttsnClient(Instance& instance)
-    : InstanceLocator(instance)
-    , mSocket(GetInstance().GetThreadNetif().GetIp6().GetUdp())
-    , mConfig()
-    , mMessageId(1)
-    , mPingReqTime(0)
-    , mGwTimeout(0)
-    , mDisconnectRequested(false)
-    , mSleepRequested(false)
-    , mTimeoutRaised(false)
-    , mClientState(kStateDisconnected)
-    , mSubscribeQueue(HandleSubscribeTimeout, this)
-    , mRegisterQueue(HandleRegisterTimeout, this)
-    , mUnsubscribeQueue(HandleUnsubscribeTimeout, this)
-    , mPublishQos1Queue(HandlePublishQos1Timeout, this)
-    , mPublishQos2PublishQueue(HandlePublishQos2PublishTimeout, this)
-    , mPublishQos2PubrelQueue(HandlePublishQos2PubrelTimeout, this)
-    , mPublishQos2PubrecQueue(HandlePublishQos2PubrecTimeout, this)
-    , mConnectedCallback(nullptr)
-    , mConnectContext(nullptr)
-    , mPublishReceivedCallback(nullptr)
-    , mPublishReceivedContext(nullptr)
-    , mAdvertiseCallback(nullptr)
-    , mAdvertiseContext(nullptr)
-    , mSearchGwCallback(nullptr)
-    , mSearchGwContext(nullptr)
-    , mDisconnectedCallback(nullptr)
-    , mDisconnectedContext(nullptr)
-    , mRegisterReceivedCallback(nullptr)
-    , mRegisterReceivedContext(nullptr)
+void WaitingMessagesIndex::AddId(uint8_t aSlot)
 {
-    ;
-}
+    uint8_t position = GetIdHome(mEntries[aSlot].mMessageId);
 
-MqttsnClient::~MqttsnClient()
-{
-    mSocket.Close();
-    OnDisconnected();
+    while (mIdTable[position] != 0)
+    {
+        position = (position + 1) & (kWaitingMessagesIdTableSize - 1);
+    }
+    mIdTable[position] = aSlot + 1;
 }
 
-void MqttsnClient::HandleUdpReceive(void *aContext, otMessage *aMessage, const otMessageInfo *aMessageInfo)
+void WaitingMessagesIndex::RemoveId(uint8_t aSlot)
 {
-    MqttsnClient* client = static_cast<MqttsnClient*>(aContext);
-    Message &message = *static_cast<Message *>(aMessage);
-    const Ip6::MessageInfo &messageInfo = *static_cast<const Ip6::MessageInfo *>(aMessageInfo);
-
-    // Read message content
-    uint16_t offset = message.GetOffset();
-    uint16_t length = message.GetLength() - message.GetOffset();
-
-    unsigned char data[MAX_PACKET_SIZE];
-
-    if (length > MAX_PACKET_SIZE)
-    {
-        return;
-    }
+    const uint8_t mask = kWaitingMessagesIdTableSize - 1;
+    uint8_t position = GetIdHome(mEntries[aSlot].mMessageId);
+    uint8_t next;
 
-    if (!data)
+    while (mIdTable[position] != aSlot + 1)
     {
-        return;
+        position = (position + 1) & mask;
     }
-    message.Read(offset, length, data);
+    mIdTable[position] = 0;
 
-    // Dump packet
-    PRINTF("UDP message received:\r\n");
-    for (int32_t i = 0; i < length; i++)
+    // Shift following entries of the probe sequence back so that lookup does not stop on the released position
+    next = (position + 1) & mask;
+    while (mIdTable[next] != 0)
     {
-        if (i > 0)
+        uint8_t home = GetIdHome(mEntries[mIdTable[next] - 1].mMessageId);
+        if (((next - home) & mask) >= ((next - position) & mask))
         {
-            PRINTF(" ");
+            mIdTable[position] = mIdTable[next];
+            mIdTable[next] = 0;
+            position = next;
         }
-        PRINTF("%02X", data[i]);
+        next = (next + 1) & mask;
     }
-    PRINTF("\r\n");
+}
 
-    // Determine message type
-    MessageType messageType;
-    if (MessageBase::DeserializeMessageType(data, length, &messageType))
+bool WaitingMessagesIndex::IsEarlier(uint8_t aFirst, uint8_t aSecond) const
+{
+    const Entry &first = mEntries[mHeap[aFirst]];
+    const Entry &second = mEntries[mHeap[aSecond]];
+
+    if (!first.mHasDeadline)
     {
-        return;
+        return false;
     }
-    PRINTF("Message type: %d\r\n", messageType);
+    return !second.mHasDeadline || IsBefore(first.mDeadline, second.mDeadline);
+}
 
-    // TODO: Refactor switch to use separate handle functions
-    // Handle received message type
-    switch (messageType)
-    {
-    // CONACK message
-    case kTypeConnack:
+void WaitingMessagesIndex::Swap(uint8_t aFirst, uint8_t aSecond)
+{
+    uint8_t slot = mHeap[aFirst];
+    mHeap[aFirst] = mHeap[aSecond];
+    mHeap[aSecond] = slot;
+    mEntries[mHeap[aFirst]].mHeapIndex = aFirst;
+    mEntries[mHeap[aSecond]].mHeapIndex = aSecond;
+}
+
+void WaitingMessagesIndex::SiftUp(uint8_t aIndex)
+{
+    while (aIndex > 0)
     {
-        // Check source IPv6 address
-        if (!client->VerifyGatewayAddress(messageInfo))
-        {
-            break;
-        }
-        ConnackMessage connackMessage;
-        if (connackMessage.Deserialize(data, length) != OT_ERROR_NONE)
+        uint8_t parent = (aIndex - 1) / 2;
+        if (!IsEarlier(aIndex, parent))
         {
             break;
         }
-        client->mClientState = kStateActive;
-        client->mGwTimeout = 0;
-        if (client->mConnectedCallback)
-        {
-            client->mConnectedCallback(connackMessage.GetReturnCode(), client->mConnectContext);
-        }
+        Swap(aIndex, parent);
+        aIndex = parent;
     }
-        break;
-    // SUBACK message
-    case kTypeSuback:
+}
+
+void WaitingMessagesIndex::SiftDown(uint8_t aIndex)
+{
+    while (true)
     {
-        // Client must be in active state
-        if (client->mClientState != kStateActive)
+        uint8_t left = 2 * aIndex + 1;
+        uint8_t right = left + 1;
+        uint8_t smallest = aIndex;
+        if (left < mSize && IsEarlier(left, smallest))
         {
-            break;
+            smallest = left;
         }
-        // Check source IPv6 address
-        if (!client->VerifyGatewayAddress(messageInfo))
+        if (right < mSize && IsEarlier(right, smallest))
         {
-            break;
+            smallest = right;
         }
-        SubackMessage subackMessage;
-        if (subackMessage.Deserialize(data, length) != OT_ERROR_NONE)
+        if (smallest == aIndex)
         {
             break;
         }
+        Swap(aIndex, smallest);
+        aIndex = smallest;
+    }
+}
 
-        // Find waiting message with corresponding ID
-        MessageMetadata<SubscribeCallbackFunc> metadata;
-        Message* subscribeMessage = client->mSubscribeQueue.Find(subackMessage.GetMessageId(), metadata);
-        if (!subscribeMessage)
-        {
-            break;
-        }
-        // Invoke callback and dequeue message
-        if (metadata.mCallback)
-        {
-            metadata.mCallback(subackMessage.GetReturnCode(), subackMessage.GetTopicId(),
-                subackMessage.GetQos(), metadata.mContext);
-        }
-        client->mSubscribeQueue.Dequeue(*subscribeMessage);
+TopicRegistry::TopicRegistry()
+{
+    Clear();
+}
+
+TopicRegistry::Entry* TopicRegistry::Add(const char* aName)
+{
+    Entry* entry = Find(aName);
+    uint16_t length = strlen(aName) + 1;
+    uint32_t hash = Hash(aName);
+    uint8_t position = hash & (kTopicRegistryTableSize - 1);
+
+    VerifyOrExit(entry == nullptr);
+    VerifyOrExit(mCount < kMaxRegisteredTopics && mNamePoolLength + length <= kTopicRegistryNamePoolSize);
+
+    // Intern the name to the pool
+    entry = &mEntries[mCount];
+    memcpy(mNamePool + mNamePoolLength, aName, length);
+    entry->mName = mNamePool + mNamePoolLength;
+    entry->mHash = hash;
+    entry->mTopicId = 0;
+    entry->mState = Entry::kUnregistered;
+    entry->mSubscribed = false;
+    entry->mSubscribeQos = kQos0;
+    entry->mRestore = 0;
+    mNamePoolLength += length;
+    mCount++;
+
+    // Table is larger than the number of entries so there is always empty position
+    while (mNameTable[position] != 0)
+    {
+        position = (position + 1) & (kTopicRegistryTableSize - 1);
     }
-        break;
-    // PUBLISH message
-    case kTypePublish:
+    mNameTable[position] = mCount;
+
+exit:
+    return entry;
+}
+
+TopicRegistry::Entry* TopicRegistry::Find(const char* aName)
+{
+    uint32_t hash = Hash(aName);
+    uint8_t position = hash & (kTopicRegistryTableSize - 1);
+
+    while (mNameTable[position] != 0)
     {
-        // Client must be in active or awake state to receive published messages
-        if (client->mClientState != kStateActive && client->mClientState != kStateAwake)
-        {
-            break;
-        }
-        // Check source IPv6 address
-        if (!client->VerifyGatewayAddress(messageInfo))
-        {
-            break;
-        }
-        PublishMessage publishMessage;
-        if (publishMessage.Deserialize(data, length) != OT_ERROR_NONE)
+        Entry &entry = mEntries[mNameTable[position] - 1];
+        if (entry.mHash == hash && strcmp(entry.mName, aName) == 0)
         {
-            break;
+            return &entry;
         }
+        position = (position + 1) & (kTopicRegistryTableSize - 1);
+    }
+    return nullptr;
+}
 
-        // Filter duplicate QoS level 2 messages
-        if (publishMessage.GetQos() == kQos2)
+TopicRegistry::Entry* TopicRegistry::Find(TopicId aTopicId)
+{
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        if (mEntries[i].IsRegistered() && mEntries[i].mTopicId == aTopicId)
         {
-            MessageMetadata<void*> metadata;
-            Message* pubrecMessage = client->mPublishQos2PubrecQueue.Find(publishMessage.GetMessageId(), metadata);
-            if (pubrecMessage)
-            {
-                break;
-            }
+            return &mEntries[i];
         }
+    }
+    return nullptr;
+}
 
-        ReturnCode code = kCodeRejectedTopicId;
-        if (client->mPublishReceivedCallback)
+void TopicRegistry::CancelRegistrations()
+{
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        if (mEntries[i].IsRegistering())
         {
-            // Invoke callback
-            code = client->mPublishReceivedCallback(publishMessage.GetPayload(), publishMessage.GetPayloadLength(),
-                publishMessage.GetTopicIdType(), publishMessage.GetTopicId(), publishMessage.GetShortTopicName(),
-                client->mPublishReceivedContext);
+            mEntries[i].SetUnregistered();
         }
+    }
+}
 
-        // Handle QoS
-        if (publishMessage.GetQos() == kQos0 || publishMessage.GetQos() == kQosm1)
-        {
-            // On QoS level 0 or -1 do nothing
-            break;
-        }
-        else if (publishMessage.GetQos() == kQos1)
+void TopicRegistry::InvalidateSession()
+{
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        Entry &entry = mEntries[i];
+        if (entry.IsRegistered())
         {
-            // On QoS level 1  send PUBACK response
-            int32_t packetLength = -1;
-            Message* responseMessage = nullptr;
-            unsigned char buffer[MAX_PACKET_SIZE];
-            PubackMessage pubackMessage(code, publishMessage.GetTopicId(), publishMessage.GetMessageId());
-            if (pubackMessage.Serialize(buffer, MAX_PACKET_SIZE, &packetLength) != OT_ERROR_NONE)
-            {
-                break;
-            }
-            if (client->NewMessage(&responseMessage, buffer, packetLength) != OT_ERROR_NONE ||
-                client->SendMessage(*responseMessage) != OT_ERROR_NONE)
-            {
-                break;
-            }
+            entry.mRestore |= Entry::kRestoreRegistration;
         }
-        else if (publishMessage.GetQos() == kQos2)
+        if (entry.mSubscribed)
         {
-            // On QoS level 2 send PUBREC message and wait for PUBREL
-            int32_t packetLength = -1;
-            Message* responseMessage = nullptr;
-            unsigned char buffer[MAX_PACKET_SIZE];
-            PubrecMessage pubrecMessage(publishMessage.GetMessageId());
-            if (pubrecMessage.Serialize(buffer, MAX_PACKET_SIZE, &packetLength) != OT_ERROR_NONE)
-            {
-                break;
-            }
-            if (client->NewMessage(&responseMessage, buffer, packetLength) != OT_ERROR_NONE ||
-                client->SendMessage(*responseMessage) != OT_ERROR_NONE)
-            {
-                break;
-            }
-
-            // Add message to waiting queue, message with same messageId will not be processed until PUBREL message received
-            if (client->mPublishQos2PubrecQueue.EnqueueCopy(*responseMessage, responseMessage->GetLength(), MessageMetadata<void*>(
-                client->mConfig.GetAddress(), client->mConfig.GetPort(), publishMessage.GetMessageId(), TimerMilli::GetNow(),
-                client->mConfig.GetRetransmissionTimeout() * 1000, NULL, NULL)) != OT_ERROR_NONE)
-            {
-                break;
-            }
+            entry.mRestore |= Entry::kRestoreSubscription;
         }
+        entry.mTopicId = 0;
+        entry.mState = Entry::kUnregistered;
+        entry.mSubscribed = false;
     }
-        break;
-    // ADVERTISE message
-    case kTypeAdvertise:
+}
+
+void TopicRegistry::Clear()
+{
+    memset(mEntries, 0, sizeof(mEntries));
+    memset(mNameTable, 0, sizeof(mNameTable));
+    mNamePoolLength = 0;
+    mCount = 0;
+}
+
+uint32_t TopicRegistry::Hash(const char* aName)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*aName != '\0')
     {
-        AdvertiseMessage advertiseMessage;
-        if (advertiseMessage.Deserialize(data, length) != OT_ERROR_NONE)
-        {
-            break;
-        }
-        if (client->mAdvertiseCallback)
-        {
-            client->mAdvertiseCallback(messageInfo.GetPeerAddr(), advertiseMessage.GetGatewayId(),
-                advertiseMessage.GetDuration(), client->mAdvertiseContext);
-        }
+        hash = (hash ^ static_cast<uint8_t>(*aName++)) * 16777619u;
     }
-        break;
-    // GWINFO message
-    case kTypeGwInfo:
+    return hash;
+}
+
+SessionStore::SessionStore(otInstance* aInstance)
+    : mInstance(aInstance)
+    , mBinding()
+    , mBound(false)
+{
+    ;
+}
+
+otError SessionStore::Restore(const Binding &aBinding, TopicRegistry &aRegistry)
+{
+    otError error = OT_ERROR_NONE;
+    Binding stored;
+    uint16_t length = sizeof(stored);
+
+    mBound = false;
+    SuccessOrExit(error = otPlatSettingsGet(mInstance, MQTTSN_SETTINGS_KEY_SESSION, 0,
+        reinterpret_cast<uint8_t*>(&stored), &length));
+    VerifyOrExit(length == sizeof(stored) && memcmp(&aBinding, &stored, sizeof(stored)) == 0,
+        error = OT_ERROR_NOT_FOUND);
+    mBinding = aBinding;
+    mBound = true;
+
+    for (int index = 0; ; index++)
     {
-        GwInfoMessage gwInfoMessage;
-        if (gwInfoMessage.Deserialize(data, length) != OT_ERROR_NONE)
+        uint8_t record[TOPIC_RECORD_HEADER_SIZE + kMaxTopicNameLength + 1];
+        TopicRegistry::Entry* entry = nullptr;
+        uint8_t flags;
+
+        length = sizeof(record) - 1;
+        if (otPlatSettingsGet(mInstance, SETTINGS_KEY_TOPICS, index, record, &length) != OT_ERROR_NONE)
         {
             break;
         }
-        if (client->mSearchGwCallback)
+        if (length <= TOPIC_RECORD_HEADER_SIZE || length > sizeof(record) - 1)
         {
-            Ip6::Address address = (gwInfoMessage.GetHasAddress()) ? gwInfoMessage.GetAddress()
-                : messageInfo.GetPeerAddr();
-            client->mSearchGwCallback(address, gwInfoMessage.GetGatewayId(), client->mSearchGwContext);
+            continue;
         }
-    }
-        break;
-    // Regack message
-    case kTypeRegack:
-    {
-        // Client state must be active
-        if (client->mClientState != kStateActive)
+        record[length] = '\0';
+        VerifyOrExit((entry = aRegistry.Add(reinterpret_cast<const char*>(&record[TOPIC_RECORD_HEADER_SIZE])))
+            != nullptr, error = OT_ERROR_NO_BUFS);
+
+        flags = record[2];
+        if (flags & TOPIC_RECORD_FLAG_REGISTERED)
         {
-            break;
+            entry->SetRegistered(static_cast<TopicId>((record[0] << 8) | record[1]));
         }
-        // Check source IPv6 address
-        if (!client->VerifyGatewayAddress(messageInfo))
+        if (flags & TOPIC_RECORD_FLAG_SUBSCRIBED)
         {
-            break;
+            entry->SetSubscribed(static_cast<Qos>((flags >> TOPIC_RECORD_QOS_SHIFT) & TOPIC_RECORD_QOS_MASK));
         }
+    }
 
-        RegackMessage regackMessage;
-        if (regackMessage.Deserialize(data, length) != OT_ERROR_NONE)
-        {
-            break;
-        }
-        // Find waiting message with corresponding ID
-        MessageMetadata<RegisterCallbackFunc> metadata;
-        Message* registerMessage = client->mRegisterQueue.Find(regackMessage.GetMessageId(), metadata);
-        if (!registerMessage)
-        {
-            break;
-        }
-        // Invoke callback and dequeue message
-        if (metadata.mCallback)
-        {
-            metadata.mCallback(regackMessage.GetReturnCode(), regackMessage.GetTopicId(), metadata.mContext);
-        }
-        client->mRegisterQueue.Dequeue(*registerMessage);
+exit:
+    return error;
+}
+
+otError SessionStore::Save(const Binding &aBinding, const TopicRegistry::Entry &aEntry)
+{
+    otError error = OT_ERROR_NONE;
+    uint8_t record[TOPIC_RECORD_HEADER_SIZE + kMaxTopicNameLength];
+    uint8_t stored[TOPIC_RECORD_HEADER_SIZE + kMaxTopicNameLength];
+    uint16_t nameLength = strlen(aEntry.GetName());
+    uint16_t length = TOPIC_RECORD_HEADER_SIZE + nameLength;
+    uint16_t storedLength = 0;
+    uint8_t flags = 0;
+    int index;
+
+    VerifyOrExit(nameLength <= kMaxTopicNameLength, error = OT_ERROR_INVALID_ARGS);
+    SuccessOrExit(error = Bind(aBinding));
+
+    if (aEntry.IsRegistered())
+    {
+        flags |= TOPIC_RECORD_FLAG_REGISTERED;
     }
-        break;
-    // REGISTER message
-    case kTypeRegister:
+    if (aEntry.IsSubscribed())
+    {
+        flags |= TOPIC_RECORD_FLAG_SUBSCRIBED
+            | ((aEntry.GetSubscribeQos() & TOPIC_RECORD_QOS_MASK) << TOPIC_RECORD_QOS_SHIFT);
+    }
+    record[0] = static_cast<uint8_t>(aEntry.GetTopicId() >> 8);
+    record[1] = static_cast<uint8_t>(aEntry.GetTopicId() & 0xff);
+    record[2] = flags;
+    memcpy(&record[TOPIC_RECORD_HEADER_SIZE], aEntry.GetName(), nameLength);
+
+    // Unchanged record is not written again, for example when the same topic ID is restored
+    index = FindRecord(aEntry.GetName(), nameLength, stored, storedLength);
+    if (index >= 0)
+    {
+        VerifyOrExit(flags == 0 || storedLength != length || memcmp(record, stored, length) != 0);
+        SuccessOrExit(error = otPlatSettingsDelete(mInstance, SETTINGS_KEY_TOPICS, index));
+    }
+    if (flags != 0)
     {
-        int32_t packetLength = -1;
-        Message* responseMessage = nullptr;
-        unsigned char buffer[MAX_PACKET_SIZE];
+        SuccessOrExit(error = otPlatSettingsAdd(mInstance, SETTINGS_KEY_TOPICS, record, length));
+    }
 
-        // Client state must be active
-        if (client->mClientState != kStateActive)
-        {
-            break;
-        }
-        if (!client->VerifyGatewayAddress(messageInfo))
-        {
-            break;
-        }
+exit:
+    return error;
+}
 
-        RegisterMessage registerMessage;
-        if (registerMessage.Deserialize(data, length) != OT_ERROR_NONE)
-        {
-            break;
-        }
+void SessionStore::Delete()
+{
+    otPlatSettingsDelete(mInstance, MQTTSN_SETTINGS_KEY_SESSION, -1);
+    otPlatSettingsDelete(mInstance, SETTINGS_KEY_TOPICS, -1);
+    mBound = false;
+}
 
-        // Invoke register callback
-        ReturnCode code = kCodeRejectedTopicId;
-        if (client->mRegisterReceivedCallback)
-        {
-            code = client->mRegisterReceivedCallback(registerMessage.GetTopicId(), registerMessage.GetTopicName(), client->mRegisterReceivedContext);
-        }
+otError SessionStore::Bind(const Binding &aBinding)
+{
+    otError error = OT_ERROR_NONE;
+    Binding stored;
+    uint16_t length = sizeof(stored);
 
-        // Send REGACK response message
-        RegackMessage regackMessage(code, registerMessage.GetTopicId(), registerMessage.GetMessageId());
-        if (regackMessage.Serialize(buffer, MAX_PACKET_SIZE, &packetLength) != OT_ERROR_NONE)
-        {
-            break;
-        }
-        if (client->NewMessage(&responseMessage, buffer, packetLength) != OT_ERROR_NONE ||
-            client->SendMessage(*responseMessage) != OT_ERROR_NONE)
-        {
-            break;
-        }
+    VerifyOrExit(!mBound || memcmp(&mBinding, &aBinding, sizeof(aBinding)) != 0);
+
+    // Topic records of another client ID or gateway are dropped
+    if (otPlatSettingsGet(mInstance, MQTTSN_SETTINGS_KEY_SESSION, 0, reinterpret_cast<uint8_t*>(&stored), &length)
+        != OT_ERROR_NONE || length != sizeof(stored) || memcmp(&aBinding, &stored, sizeof(stored)) != 0)
+    {
+        otPlatSettingsDelete(mInstance, SETTINGS_KEY_TOPICS, -1);
+        SuccessOrExit(error = otPlatSettingsSet(mInstance, MQTTSN_SETTINGS_KEY_SESSION,
+            reinterpret_cast<const uint8_t*>(&aBinding), sizeof(aBinding)));
     }
-    // PUBACK message
-    case kTypePuback:
+    mBinding = aBinding;
+    mBound = true;
+
+exit:
+    return error;
+}
+
+int SessionStore::FindRecord(const char* aName, uint16_t aNameLength, uint8_t* aRecord, uint16_t &aLength)
+{
+    for (int index = 0; ; index++)
     {
-        // Client state must be active
-        if (client->mClientState != kStateActive)
+        aLength = TOPIC_RECORD_HEADER_SIZE + kMaxTopicNameLength;
+        if (otPlatSettingsGet(mInstance, SETTINGS_KEY_TOPICS, index, aRecord, &aLength) != OT_ERROR_NONE)
         {
             break;
         }
-        // Check source IPv6 address.
-        if (!client->VerifyGatewayAddress(messageInfo))
+        if (aLength == TOPIC_RECORD_HEADER_SIZE + aNameLength
+            && memcmp(&aRecord[TOPIC_RECORD_HEADER_SIZE], aName, aNameLength) == 0)
         {
-            break;
+            return index;
         }
+    }
+    return -1;
+}
+
+GatewayTable::GatewayTable()
+{
+    Clear();
+}
+
+GatewayTable::Entry* GatewayTable::Update(uint8_t aGatewayId, const Ip6::Address &aAddress, uint16_t aPort,
+    uint32_t aDuration, uint32_t aNow)
+{
+    Entry* entry = nullptr;
 
-        PubackMessage pubackMessage;
-        if (pubackMessage.Deserialize(data, length) != OT_ERROR_NONE)
+    for (uint8_t i = 0; i < mCount && entry == nullptr; i++)
+    {
+        if (mEntries[i].mGatewayId == aGatewayId)
         {
-            break;
+            entry = &mEntries[i];
         }
+    }
 
-        // Process QoS level 1 message
-        // Find message waiting for acknowledge
-        MessageMetadata<PublishCallbackFunc> metadata;
-        Message* publishMessage = client->mPublishQos1Queue.Find(pubackMessage.GetMessageId(), metadata);
-        if (publishMessage)
+    if (entry == nullptr)
+    {
+        if (mCount < kMaxGateways)
         {
-            // Invoke confirmation callback
-            if (metadata.mCallback)
-            {
-                metadata.mCallback(pubackMessage.GetReturnCode(), metadata.mContext);
-            }
-            // Dequeue waiting message
-            client->mPublishQos1Queue.Dequeue(*publishMessage);
-            break;
+            entry = &mEntries[mCount++];
         }
-        // May be QoS level 2 message error response
-        publishMessage = client->mPublishQos2PublishQueue.Find(pubackMessage.GetMessageId(), metadata);
-        if (publishMessage)
+        else
         {
-            // Invoke confirmation callback
-            if (metadata.mCallback)
+            // Replace failed or least recently heard gateway
+            entry = &mEntries[0];
+            for (uint8_t i = 1; i < mCount; i++)
             {
-                metadata.mCallback(pubackMessage.GetReturnCode(), metadata.mContext);
+                Entry &candidate = mEntries[i];
+                if ((candidate.mFailed && !entry->mFailed) || (candidate.mFailed == entry->mFailed
+                    && WaitingMessagesIndex::IsBefore(candidate.mLastSeen, entry->mLastSeen)))
+                {
+                    entry = &candidate;
+                }
             }
-            // Dequeue waiting message
-            client->mPublishQos2PublishQueue.Dequeue(*publishMessage);
-            break;
         }
-
-        // May be QoS level 0 message error response - it is not handled
+        entry->mGatewayId = aGatewayId;
+        entry->mDuration = 0;
+        entry->mRtt = 0;
+        entry->mProbeTime = 0;
     }
-        break;
-    // PUBREC message
-    case kTypePubrec:
+
+    entry->mAddress = aAddress;
+    entry->mPort = aPort;
+    if (aDuration != 0)
     {
-        int32_t packetLength = -1;
-        unsigned char buffer[MAX_PACKET_SIZE];
+        entry->mDuration = aDuration;
+    }
+    entry->mLastSeen = aNow;
+    entry->mFailed = false;
+    return entry;
+}
 
-        // Client state must be active
-        if (client->mClientState != kStateActive)
-        {
-            break;
-        }
-        // Check source IPv6 address
-        if (!client->VerifyGatewayAddress(messageInfo))
+GatewayTable::Entry* GatewayTable::Find(const Ip6::Address &aAddress, uint16_t aPort)
+{
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        if (mEntries[i].mAddress == aAddress && mEntries[i].mPort == aPort)
         {
-            break;
+            return &mEntries[i];
         }
+    }
+    return nullptr;
+}
 
-        PubrecMessage pubrecMessage;
-        if (pubrecMessage.Deserialize(data, length) != OT_ERROR_NONE)
-        {
-            break;
-        }
-        // Process QoS level 2 message
-        // Find message waiting for receive acknowledge
-        MessageMetadata<PublishCallbackFunc> metadata;
-        Message* publishMessage = client->mPublishQos2PublishQueue.Find(pubrecMessage.GetMessageId(), metadata);
-        if (!publishMessage)
-        {
-            break;
-        }
+void GatewayTable::AddRttSample(Entry &aEntry, uint32_t aRtt)
+{
+    // Weight 1/8 of new sample as smoothed RTT of the client
+    aEntry.mRtt = (aEntry.mRtt == 0) ? aRtt : (7 * aEntry.mRtt + aRtt) / 8;
+    aEntry.mRtt = OT_MAX(aEntry.mRtt, 1U);
+}
 
-        // Send PUBREL message
-        PubrelMessage pubrelMessage(metadata.mMessageId);
-        if (pubrelMessage.Serialize(buffer, MAX_PACKET_SIZE, &packetLength) != OT_ERROR_NONE)
-        {
-            break;
-        }
-        Message* responseMessage = nullptr;
-        if (client->NewMessage(&responseMessage, buffer, packetLength) != OT_ERROR_NONE ||
-            client->SendMessage(*responseMessage) != OT_ERROR_NONE)
-        {
-            break;
-        }
-        // Enqueue PUBREL message and wait for PUBCOMP
-        if (client->mPublishQos2PubrelQueue.EnqueueCopy(*responseMessage, responseMessage->GetLength(),
-            MessageMetadata<PublishCallbackFunc>(client->mConfig.GetAddress(), client->mConfig.GetPort(), metadata.mMessageId,
-                TimerMilli::GetNow(), client->mConfig.GetRetransmissionTimeout() * 1000, metadata.mCallback, client)) != OT_ERROR_NONE)
-        {
-            break;
-        }
+GatewayTable::Entry* GatewayTable::GetBest(uint32_t aNow)
+{
+    Entry* best = nullptr;
 
-        // Dequeue waiting PUBLISH message
-        client->mPublishQos2PublishQueue.Dequeue(*publishMessage);
-    }
-    // PUBREL message
-    case kTypePubrel:
+    for (uint8_t i = 0; i < mCount; i++)
     {
-        int32_t packetLength = -1;
-        unsigned char buffer[MAX_PACKET_SIZE];
-
-        // Client state must be active
-        if (client->mClientState != kStateActive)
+        Entry &entry = mEntries[i];
+        if (!IsAvailable(entry, aNow))
         {
-            break;
+            continue;
         }
-        // Check source IPv6 address
-        if (!client->VerifyGatewayAddress(messageInfo))
+        if (best == nullptr
+            || (entry.mRtt != 0 && (best->mRtt == 0 || entry.mRtt < best->mRtt))
+            || (entry.mRtt == 0 && best->mRtt == 0 && WaitingMessagesIndex::IsBefore(best->mLastSeen, entry.mLastSeen)))
         {
-            break;
+            best = &entry;
         }
+    }
+    return best;
+}
 
-        PubrelMessage pubrelMessage;
-        if (pubrelMessage.Deserialize(data, length) != OT_ERROR_NONE)
-        {
-            break;
-        }
-        // Process QoS level 2 PUBREL message
-        // Find PUBREC message waiting for receive acknowledge
-        MessageMetadata<void*> metadata;
-        Message* pubrecMessage = client->mPublishQos2PubrecQueue.Find(pubrelMessage.GetMessageId(), metadata);
-        if (!pubrecMessage)
-        {
-            break;
-        }
-        // Send PUBCOMP message
-        PubcompMessage pubcompMessage(metadata.mMessageId);
-        if (pubcompMessage.Serialize(buffer, MAX_PACKET_SIZE, &packetLength) != OT_ERROR_NONE)
-        {
-            break;
-        }
-        Message* responseMessage = nullptr;
-        if (client->NewMessage(&responseMessage, buffer, packetLength) != OT_ERROR_NONE ||
-            client->SendMessage(*responseMessage) != OT_ERROR_NONE)
-        {
-            break;
-        }
+void GatewayTable::Clear()
+{
+    memset(mEntries, 0, sizeof(mEntries));
+    mCount = 0;
+}
 
-        // Dequeue waiting message
-        client->mPublishQos2PubrecQueue.Dequeue(*pubrecMessage);
-    }
-    // PUBCOMP message
-    case kTypePubcomp:
+bool GatewayTable::IsAvailable(const Entry &aEntry, uint32_t aNow) const
+{
+    // Gateway learned only from GWINFO does not advertise its period and it does not expire
+    return !aEntry.mFailed && (aEntry.mDuration == 0
+        || aNow - aEntry.mLastSeen <= aEntry.mDuration * 1000 * kGatewayAdvertiseMissed);
+}
+
+template <typename CallbackType>
+MessageMetadata<CallbackType>::MessageMetadata()
+{
+    ;
+}
+
+template <typename CallbackType>
+MessageMetadata<CallbackType>::MessageMetadata(const Ip6::Address &aDestinationAddress, uint16_t aDestinationPort, uint16_t aMessageId, uint32_t aTimestamp, uint32_t aRetransmissionTimeout, uint8_t aRetransmissionCount, CallbackType aCallback, void* aContext)
+    : mDestinationAddress(aDestinationAddress)
+    , mDestinationPort(aDestinationPort)
+    , mMessageId(aMessageId)
+    , mTimestamp(aTimestamp)
+    , mRetransmissionTimeout(aRetransmissionTimeout)
+    , mRetransmissionCount(aRetransmissionCount)
+    , mIndexSlot(0)
+    , mRetransmitted(false)
+    , mCallback(aCallback)
+    , mContext(aContext)
+{
+    ;
+}
+
+template <typename CallbackType>
+otError MessageMetadata<CallbackType>::AppendTo(Message &aMessage) const
+{
+    return aMessage.Append(this, sizeof(*this));
+}
+
+template <typename CallbackType>
+uint16_t MessageMetadata<CallbackType>::ReadFrom(Message &aMessage)
+{
+    return aMessage.Read(aMessage.GetLength() - sizeof(*this), sizeof(*this), this);
+}
+
+template <typename CallbackType>
+int MessageMetadata<CallbackType>::UpdateIn(Message &aMessage) const
+{
+    return aMessage.Write(aMessage.GetLength() - sizeof(*this), sizeof(*this), this);
+}
+
+template <typename CallbackType>
+uint16_t MessageMetadata<CallbackType>::GetLength() const
+{
+    return sizeof(*this);
+}
+
+template <typename CallbackType>
+WaitingMessagesQueue<CallbackType>::WaitingMessagesQueue(TimeoutCallbackFunc aTimeoutCallback, void* aTimeoutContext, RetransmissionFunc aRetransmissionFunc, void* aRetransmissionContext, WaitingMessagesIndex &aWaitingMessagesIndex)
+    : mQueue()
+    , mCount(0)
+    , mTimeoutCallback(aTimeoutCallback)
+    , mTimeoutContext(aTimeoutContext)
+    , mRetransmissionFunc(aRetransmissionFunc)
+    , mRetransmissionContext(aRetransmissionContext)
+    , mWaitingMessagesIndex(aWaitingMessagesIndex)
+{
+    ;
+}
+
+template <typename CallbackType>
+WaitingMessagesQueue<CallbackType>::~WaitingMessagesQueue(void)
+{
+    ForceTimeout();
+}
+
+template <typename CallbackType>
+otError WaitingMessagesQueue<CallbackType>::Enqueue(Message &aMessage, const MessageMetadata<CallbackType> &aMetadata)
+{
+    otError error = OT_ERROR_NONE;
+    MessageMetadata<CallbackType> metadata = aMetadata;
+    uint16_t length = aMessage.GetLength();
+    bool indexed = false;
+
+    // Index message deadline and ID, the slot is stored in metadata for later removal
+    SuccessOrExit(error = mWaitingMessagesIndex.Add(metadata.mTimestamp + metadata.mRetransmissionTimeout,
+        metadata.mRetransmissionTimeout != 0, metadata.mMessageId, aMessage, *this, metadata.mIndexSlot));
+    indexed = true;
+    SuccessOrExit(error = metadata.AppendTo(aMessage));
+    SuccessOrExit(error = mQueue.Enqueue(aMessage));
+    mCount++;
+
+exit:
+    if (error != OT_ERROR_NONE)
     {
-        // Client state must be active
-        if (client->mClientState != kStateActive)
-        {
-            break;
-        }
-        // Check source IPv6 address
-        if (!client->VerifyGatewayAddress(messageInfo))
+        if (indexed)
         {
-            break;
+            mWaitingMessagesIndex.Remove(metadata.mIndexSlot);
         }
+        // Caller keeps the ownership, remove appended metadata
+        aMessage.SetLength(length);
+    }
+    return error;
+}
 
-        PubcompMessage pubcompMessage;
-        if (pubcompMessage.Deserialize(data, length) != OT_ERROR_NONE)
-        {
-            break;
-        }
-        // Process QoS level 2 PUBCOMP message
-        // Find PUBREL message waiting for receive acknowledge
-        MessageMetadata<PublishCallbackFunc> metadata;
-        Message* pubrelMessage = client->mPublishQos2PubrelQueue.Find(pubcompMessage.GetMessageId(), metadata);
-        if (!pubrelMessage)
-        {
-            break;
-        }
-        // Invoke confirmation callback
-        if (metadata.mCallback)
-        {
-            metadata.mCallback(kCodeAccepted, metadata.mContext);
-        }
-        // Dequeue waiting message
-        client->mPublishQos2PubrelQueue.Dequeue(*pubrelMessage);
+template <typename CallbackType>
+otError WaitingMessagesQueue<CallbackType>::Dequeue(Message &aMessage)
+{
+    otError error = OT_ERROR_NONE;
+    MessageMetadata<CallbackType> metadata;
+
+    SuccessOrExit(error = mQueue.Dequeue(aMessage));
+    mCount--;
+    metadata.ReadFrom(aMessage);
+    mWaitingMessagesIndex.Remove(metadata.mIndexSlot);
+    aMessage.Free();
+
+exit:
+    return error;
+}
+
+template <typename CallbackType>
+Message* WaitingMessagesQueue<CallbackType>::Find(uint16_t aMessageId, MessageMetadata<CallbackType> &aMetadata)
+{
+    Message* message = mWaitingMessagesIndex.Find(*this, aMessageId);
+    if (message)
+    {
+        aMetadata.ReadFrom(*message);
     }
-    // UNSUBACK message
-    case kTypeUnsuback:
+    return message;
+}
+
+template <typename CallbackType>
+void WaitingMessagesQueue<CallbackType>::HandleDeadline(Message &aMessage)
+{
+    MessageMetadata<CallbackType> metadata;
+    metadata.ReadFrom(aMessage);
+
+    if (metadata.mRetransmissionCount > 0 && mRetransmissionFunc)
     {
-        // Client state must be active
-        if (client->mClientState != kStateActive)
-        {
-            break;
-        }
-        // Check source IPv6 address
-        if (!client->VerifyGatewayAddress(messageInfo))
-        {
-            break;
-        }
+        // Retransmit message copy without metadata
+        Message* retransmission = aMessage.Clone(aMessage.GetLength() - metadata.GetLength());
 
-        UnsubackMessage unsubackMessage;
-        if (unsubackMessage.Deserialize(data, length) != OT_ERROR_NONE)
-        {
-            break;
-        }
-        // Find unsubscription message waiting for confirmation
-        MessageMetadata<UnsubscribeCallbackFunc> metadata;
-        Message* unsubscribeMessage = client->mUnsubscribeQueue.Find(unsubackMessage.GetMessageId(), metadata);
-        if (!unsubscribeMessage)
-        {
-            break;
-        }
-        // Invoke unsubscribe confirmation callback
-        if (metadata.mCallback)
+        // Update metadata and double the timeout (exponential backoff)
+        metadata.mRetransmissionCount--;
+        metadata.mRetransmitted = true;
+        metadata.mTimestamp = TimerMilli::GetNow();
+        metadata.mRetransmissionTimeout *= 2;
+        metadata.UpdateIn(aMessage);
+        mWaitingMessagesIndex.Update(metadata.mIndexSlot, metadata.mTimestamp + metadata.mRetransmissionTimeout);
+
+        // Message is not sent when there are no buffers, retransmission is counted anyway
+        if (retransmission)
         {
-            metadata.mCallback(kCodeAccepted, metadata.mContext);
+            mRetransmissionFunc(*retransmission, metadata.mDestinationAddress, metadata.mDestinationPort,
+                mRetransmissionContext);
         }
-        // Dequeue waiting message
-        client->mUnsubscribeQueue.Dequeue(*unsubscribeMessage);
     }
-        break;
-    // PINGREQ message
-    case kTypePingreq:
+    else
     {
-        Message* responseMessage = nullptr;
-        int32_t packetLength = -1;
-        unsigned char buffer[MAX_PACKET_SIZE];
-
-        // Client state must be active
-        if (client->mClientState != kStateActive)
-        {
-            break;
-        }
-
-        PingreqMessage pingreqMessage;
-        if (pingreqMessage.Deserialize(data, length) != OT_ERROR_NONE)
+        if (mTimeoutCallback)
         {
-            break;
+            // Invoke timeout callback
+            mTimeoutCallback(metadata, mTimeoutContext);
         }
+        Dequeue(aMessage);
+    }
+}
 
-        // Send PINGRESP message
-        PingrespMessage pingrespMessage;
-        if (pingrespMessage.Serialize(buffer, MAX_PACKET_SIZE, &packetLength) != OT_ERROR_NONE)
-        {
-            break;
-        }
-        if (client->NewMessage(&responseMessage, buffer, packetLength) != OT_ERROR_NONE ||
-            client->SendMessage(*responseMessage, messageInfo.GetPeerAddr(), client->mConfig.GetPort()) != OT_ERROR_NONE)
+template <typename CallbackType>
+void WaitingMessagesQueue<CallbackType>::ForceTimeout()
+{
+    Message* message = mQueue.GetHead();
+    while (message)
+    {
+        Message* current = message;
+        message = message->GetNext();
+        MessageMetadata<CallbackType> metadata;
+        metadata.ReadFrom(*current);
+        if (mTimeoutCallback)
         {
-            break;
+            mTimeoutCallback(metadata, mTimeoutContext);
         }
+        Dequeue(*current);
     }
-        break;
-    // PINGRESP message
-    case kTypePingresp:
+}
+
+MqttsnClient::MqttsnClient(Instance& instance)
+    : InstanceLocator(instance)
+    , mSocket(GetInstance().GetThreadNetif().GetIp6().GetUdp())
+    , mProcessTimer(instance, &MqttsnClient::HandleProcessTimer, this)
+    , mWaitingMessagesIndex()
+    , mConfig()
+    , mMessageId(1)
+    , mPingReqTime(0)
+    , mGwTimeout(0)
+    , mDisconnectRequested(false)
+    , mSleepRequested(false)
+    , mTimeoutRaised(false)
+    , mClientState(kStateDisconnected)
+    , mSubscribeQueue(HandleSubscribeTimeout, this, HandleRetransmission, this, mWaitingMessagesIndex)
+    , mRegisterQueue(HandleRegisterTimeout, this, HandleRetransmission, this, mWaitingMessagesIndex)
+    , mUnsubscribeQueue(HandleUnsubscribeTimeout, this, HandleRetransmission, this, mWaitingMessagesIndex)
+    , mPublishQos1Queue(HandlePublishQos1Timeout, this, HandleRetransmission, this, mWaitingMessagesIndex)
+    , mPublishQos2PublishQueue(HandlePublishQos2PublishTimeout, this, HandleRetransmission, this, mWaitingMessagesIndex)
+    , mPublishQos2PubrelQueue(HandlePublishQos2PubrelTimeout, this, HandleRetransmission, this, mWaitingMessagesIndex)
+    , mPublishQos2PubrecQueue(HandlePublishQos2PubrecTimeout, this, nullptr, nullptr, mWaitingMessagesIndex)
+    , mTopicRegistry()
+    , mSessionStore(&instance)
+    , mPendingPublishQueue()
+    , mPendingPublishCount(0)
+    , mConnectedCallback(nullptr)
+    , mConnectContext(nullptr)
+    , mPublishReceivedCallback(nullptr)
+    , mPublishReceivedContext(nullptr)
+    , mAdvertiseCallback(nullptr)
+    , mAdvertiseContext(nullptr)
+    , mSearchGwCallback(nullptr)
+    , mSearchGwContext(nullptr)
+    , mDisconnectedCallback(nullptr)
+    , mDisconnectedContext(nullptr)
+    , mRegisterReceivedCallback(nullptr)
+    , mRegisterReceivedContext(nullptr)
+    , mPublishWindowOpenedCallback(nullptr)
+    , mPublishWindowOpenedContext(nullptr)
+    , mPublishQos1WindowFull(false)
+    , mPublishQos2WindowFull(false)
+    , mCongestionWindow(kCongestionWindowInitial)
+    , mCongestionAckCount(0)
+    , mCongestionRecoveryEnd(0)
+    , mSmoothedRtt(0)
+    , mRttVariation(0)
+    , mRttSamples(0)
+    , mCongestionEvents(0)
+    , mCongestionRejections(0)
+    , mSessionRestoredCallback(nullptr)
+    , mSessionRestoredContext(nullptr)
+    , mConnectTime(0)
+    , mSessionRestoreTime(0)
+    , mSessionRestoreIndex(0)
+    , mSessionRestoreInFlight(0)
+    , mSessionRestoreMessages(0)
+    , mSessionRestoreActive(false)
+    , mSessionRestoreCode(kCodeAccepted)
+    , mBatch()
+    , mBatchActive(false)
+    , mGatewayTable()
+    , mGatewayFailover(false)
+    , mSearchGwPort(0)
+    , mSearchGwTime(0)
+    , mSearchGwRingAddress()
+    , mSearchGwRingDeadline(0)
+    , mSearchGwRingRadius(0)
+    , mSearchGwRingMaxRadius(0)
+    , mSearchGwRingActive(false)
+    , mSearchGwRingAnswered(false)
+    , mSearchGwFinishedCallback(nullptr)
+    , mSearchGwFinishedContext(nullptr)
+    , mLastSendTime(0)
+    , mFixedPingReqTime(0)
+    , mKeepAliveStartTime(0)
+    , mKeepAliveDuration(0)
+    , mPingreqSent(0)
+    , mPingreqFixed(0)
+    , mPingreqOutstanding(false)
+    , mReconnectDelay(0)
+    , mFailoverTime(0)
+    , mFailoverPending(false)
+    , mSlowPollPeriod(0)
+    , mFastPolling(false)
+{
+    ;
+}
+
+MqttsnClient::~MqttsnClient()
+{
+    mSocket.Close();
+    OnDisconnected();
+}
+
+// Bit mask of client states in which received message is processed
+#define MQTTSN_STATE_MASK(state) (1U << (state))
+#define MQTTSN_STATES_ANY (MQTTSN_STATE_MASK(kStateDisconnected) | MQTTSN_STATE_MASK(kStateActive) \
+    | MQTTSN_STATE_MASK(kStateAsleep) | MQTTSN_STATE_MASK(kStateAwake) | MQTTSN_STATE_MASK(kStateLost))
+
+// Dispatch table indexed by message type. Message types which are never sent by gateway have no handler.
+const MqttsnClient::MessageHandlerEntry MqttsnClient::sMessageHandlers[] =
+{
+    /* kTypeAdvertise     */ { MQTTSN_STATES_ANY, false, &MqttsnClient::HandleAdvertise },
+    /* kTypeSearchGw      */ { 0, false, nullptr },
+    /* kTypeGwInfo        */ { MQTTSN_STATES_ANY, false, &MqttsnClient::HandleGwInfo },
+    /* kTypeReserved1     */ { 0, false, nullptr },
+    /* kTypeConnect       */ { 0, false, nullptr },
+    /* kTypeConnack       */ { MQTTSN_STATES_ANY, true, &MqttsnClient::HandleConnack },
+    /* kTypeWillTopicReq  */ { 0, false, nullptr },
+    /* kTypeWillTopic     */ { 0, false, nullptr },
+    /* kTypeWillMsqReq    */ { 0, false, nullptr },
+    /* kTypeWillMsg       */ { 0, false, nullptr },
+    /* kTypeRegister      */ { MQTTSN_STATE_MASK(kStateActive), true, &MqttsnClient::HandleRegister },
+    /* kTypeRegack        */ { MQTTSN_STATE_MASK(kStateActive), true, &MqttsnClient::HandleRegack },
+    /* kTypePublish       */ { MQTTSN_STATE_MASK(kStateActive) | MQTTSN_STATE_MASK(kStateAwake), true,
+                                   &MqttsnClient::HandlePublish },
+    /* kTypePuback        */ { MQTTSN_STATE_MASK(kStateActive), true, &MqttsnClient::HandlePuback },
+    /* kTypePubcomp       */ { MQTTSN_STATE_MASK(kStateActive), true, &MqttsnClient::HandlePubcomp },
+    /* kTypePubrec        */ { MQTTSN_STATE_MASK(kStateActive), true, &MqttsnClient::HandlePubrec },
+    /* kTypePubrel        */ { MQTTSN_STATE_MASK(kStateActive), true, &MqttsnClient::HandlePubrel },
+    /* kTypeReserved2     */ { 0, false, nullptr },
+    /* kTypeSubscribe     */ { 0, false, nullptr },
+    /* kTypeSuback        */ { MQTTSN_STATE_MASK(kStateActive), true, &MqttsnClient::HandleSuback },
+    /* kTypeUnsubscribe   */ { 0, false, nullptr },
+    /* kTypeUnsuback      */ { MQTTSN_STATE_MASK(kStateActive), true, &MqttsnClient::HandleUnsuback },
+    /* kTypePingreq       */ { MQTTSN_STATE_MASK(kStateActive), false, &MqttsnClient::HandlePingreq },
+    /* kTypePingresp      */ { MQTTSN_STATES_ANY, false, &MqttsnClient::HandlePingresp },
+    /* kTypeDisconnect    */ { MQTTSN_STATES_ANY, true, &MqttsnClient::HandleDisconnect },
+    /* kTypeReserved3     */ { 0, false, nullptr },
+    /* kTypeWillTopicUpd  */ { 0, false, nullptr },
+    /* kTypeWillTopicResp */ { 0, false, nullptr },
+    /* kTypeWillMsqUpd    */ { 0, false, nullptr },
+    /* kTypeWillMsgResp   */ { 0, false, nullptr },
+};
+
+void MqttsnClient::HandleUdpReceive(void *aContext, otMessage *aMessage, const otMessageInfo *aMessageInfo)
+{
+    MqttsnClient* client = static_cast<MqttsnClient*>(aContext);
+    Message &message = *static_cast<Message *>(aMessage);
+    const Ip6::MessageInfo &messageInfo = *static_cast<const Ip6::MessageInfo *>(aMessageInfo);
+
+    uint16_t offset = message.GetOffset();
+    uint16_t length = message.GetLength() - message.GetOffset();
+    const MessageHandlerEntry *entry;
+
+    // Determine message type from the header in the message buffer
+    MessageType messageType;
+    if (MessageBase::DeserializeMessageType(message, &messageType))
+    {
+        return;
+    }
+    MQTTSN_LOG("UDP message received, type: %d, length: %u\r\n", messageType, length);
+
+    static_assert(sizeof(sMessageHandlers) / sizeof(sMessageHandlers[0]) == kTypeWillMsgResp + 1,
+        "Message handler table must have entry for each message type");
+
+    // Look up message handler and check that the message is acceptable in current state and from its source
+    if (messageType > kTypeWillMsgResp)
+    {
+        return;
+    }
+    entry = &sMessageHandlers[messageType];
+    if (entry->mHandler == nullptr || (entry->mAllowedStates & MQTTSN_STATE_MASK(client->mClientState)) == 0)
+    {
+        return;
+    }
+    if (entry->mVerifyGateway && !client->VerifyGatewayAddress(messageInfo))
+    {
+        return;
+    }
+
+    // PUBLISH message is deserialized in place and its payload is not copied. Other messages are short
+    // and they are read to the buffer for deserialization.
+    unsigned char data[MAX_CONTROL_PACKET_SIZE];
+    if (messageType != kTypePublish)
     {
-        // Check source IPv6 address
-        if (!client->VerifyGatewayAddress(messageInfo))
+        if (length > MAX_CONTROL_PACKET_SIZE)
         {
-            break;
+            return;
         }
-        PingrespMessage pingrespMessage;
-        if (pingrespMessage.Deserialize(data, length) != OT_ERROR_NONE)
+        message.Read(offset, length, data);
+    }
+
+    // Any valid message from connected gateway proves liveness, ADVERTISE is valid for its own duration
+    if ((client->*entry->mHandler)(messageInfo, message, data, length) == OT_ERROR_NONE
+        && messageType != kTypeAdvertise && client->VerifyGatewayAddress(messageInfo))
+    {
+        client->HandleGatewayActivity(client->GetKeepAliveInterval());
+    }
+
+    // Acknowledgement may free in-flight window
+    client->NotifyPublishWindow();
+
+    // Received message may change or cancel pending deadlines
+    client->UpdateProcessTimer();
+}
+
+otError MqttsnClient::HandleConnack(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    ConnackMessage connackMessage;
+
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = connackMessage.Deserialize(aData, aLength));
+
+    mClientState = kStateActive;
+    mGwTimeout = 0;
+    // Keepalive statistics compare PINGREQs with fixed schedule since CONNECT
+    mFixedPingReqTime = mConnectTime + mConfig.GetKeepAlive() * kKeepAlivePingTime;
+    mKeepAliveStartTime = TimerMilli::GetNow();
+    AddGatewayRttSample(mConfig.GetAddress(), mConfig.GetPort(), TimerMilli::GetNow() - mConnectTime);
+    if (mConnectedCallback)
+    {
+        mConnectedCallback(connackMessage.GetReturnCode(), mConnectContext);
+    }
+    if (connackMessage.GetReturnCode() == kCodeAccepted)
+    {
+        // Reconnect delay grows only while reconnection fails
+        mReconnectDelay = 0;
+    }
+    if (connackMessage.GetReturnCode() == kCodeAccepted && mConfig.GetRestoreSession())
+    {
+        StartSessionRestore();
+    }
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandleSuback(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    SubackMessage subackMessage;
+    MessageMetadata<SubscribeCallbackFunc> metadata;
+    Message* subscribeMessage = nullptr;
+
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = subackMessage.Deserialize(aData, aLength));
+
+    // Batch requests are not retained in waiting queue
+    VerifyOrExit(!HandleBatchAcknowledgement(subackMessage.GetMessageId(), subackMessage.GetReturnCode(),
+        subackMessage.GetTopicId(), subackMessage.GetQos()));
+
+    // Find waiting message with corresponding ID
+    subscribeMessage = mSubscribeQueue.Find(subackMessage.GetMessageId(), metadata);
+    VerifyOrExit(subscribeMessage != nullptr);
+    HandleAcknowledgement(metadata.mTimestamp, metadata.mRetransmitted, subackMessage.GetReturnCode());
+
+    // Remember accepted subscription of long topic name, its topic ID is zero for wildcard topics
+    if (subackMessage.GetReturnCode() == kCodeAccepted)
+    {
+        uint8_t buffer[MAX_CONTROL_PACKET_SIZE];
+        uint16_t length = ReadRetainedMessage(*subscribeMessage, metadata.GetLength(), buffer);
+        SubscribeMessage subscribeRequest;
+        TopicRegistry::Entry* entry = nullptr;
+
+        if (length > 0 && subscribeRequest.Deserialize(buffer, length) == OT_ERROR_NONE
+            && subscribeRequest.GetTopicIdType() == kTopicName
+            && (entry = mTopicRegistry.Add(subscribeRequest.GetTopicName().AsCString())) != nullptr)
         {
-            break;
+            if (subackMessage.GetTopicId() != 0)
+            {
+                entry->SetRegistered(subackMessage.GetTopicId());
+            }
+            entry->SetSubscribed(subackMessage.GetQos());
+            SaveSession(*entry);
         }
+    }
+
+    // Invoke callback and dequeue message
+    if (metadata.mCallback)
+    {
+        metadata.mCallback(subackMessage.GetReturnCode(), subackMessage.GetTopicId(),
+            subackMessage.GetQos(), metadata.mContext);
+    }
+    mSubscribeQueue.Dequeue(*subscribeMessage);
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandlePublish(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    PublishMessage publishMessage;
+    ReturnCode code = kCodeRejectedTopicId;
+    Message* responseMessage = nullptr;
+
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aData);
+    OT_UNUSED_VARIABLE(aLength);
 
-        // Reset client timeout counter
-        client->mGwTimeout = 0;
-        // If the client is awake PINRESP message put it into sleep again
-        if (client->mClientState == kStateAwake)
+    SuccessOrExit(error = publishMessage.Deserialize(aMessage));
+
+    // Filter duplicate QoS level 2 messages, retransmitted PUBLISH is answered with retained PUBREC because
+    // the first PUBREC could be lost
+    if (publishMessage.GetQos() == kQos2)
+    {
+        MessageMetadata<void*> metadata;
+        Message* pubrecMessage = mPublishQos2PubrecQueue.Find(publishMessage.GetMessageId(), metadata);
+        if (pubrecMessage != nullptr)
         {
-            client->mClientState = kStateAsleep;
-            if (client->mDisconnectedCallback)
+            if (publishMessage.GetDupFlag())
             {
-                client->mDisconnectedCallback(kAsleep, client->mDisconnectedContext);
+                VerifyOrExit((responseMessage = pubrecMessage->Clone(pubrecMessage->GetLength()
+                    - metadata.GetLength())) != nullptr, error = OT_ERROR_NO_BUFS);
+                SuccessOrExit(error = SendMessage(*responseMessage, metadata.mDestinationAddress,
+                    metadata.mDestinationPort));
             }
+            ExitNow();
         }
     }
-        break;
-    // DISCONNECT message
-    case kTypeDisconnect:
+
+    if (mPublishReceivedCallback)
+    {
+        // Invoke callback
+        code = mPublishReceivedCallback(aMessage, publishMessage.GetPayloadOffset(), publishMessage.GetPayloadLength(),
+            publishMessage.GetTopicIdType(), publishMessage.GetTopicId(), publishMessage.GetShortTopicName(),
+            mPublishReceivedContext);
+    }
+
+    // Handle QoS
+    if (publishMessage.GetQos() == kQos1)
+    {
+        // On QoS level 1  send PUBACK response
+        PubackMessage pubackMessage(code, publishMessage.GetTopicId(), publishMessage.GetMessageId());
+        SuccessOrExit(NewMessage(&responseMessage, pubackMessage));
+        SuccessOrExit(SendMessage(*responseMessage));
+    }
+    else if (publishMessage.GetQos() == kQos2)
     {
+        // On QoS level 2 send PUBREC message and wait for PUBREL
+        PubrecMessage pubrecMessage(publishMessage.GetMessageId());
+        SuccessOrExit(NewMessage(&responseMessage, pubrecMessage));
+
+        // Send message copy and retain the message in waiting queue, message with same messageId will not be
+        // processed until PUBREL message received. PUBREC is not retransmitted, it is dropped after
+        // kPubrecLifetime so lost PUBREL does not hold waiting messages index slot.
+        SuccessOrExit(SendRetainedMessage(*responseMessage, mPublishQos2PubrecQueue, MessageMetadata<void*>(
+            mConfig.GetAddress(), mConfig.GetPort(), publishMessage.GetMessageId(), TimerMilli::GetNow(),
+            kPubrecLifetime, 0, NULL, NULL)));
+    }
+    // On QoS level 0 or -1 do nothing
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandleAdvertise(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    AdvertiseMessage advertiseMessage;
+
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = advertiseMessage.Deserialize(aData, aLength));
+
+    mGatewayTable.Update(advertiseMessage.GetGatewayId(), aMessageInfo.GetPeerAddr(), aMessageInfo.GetPeerPort(),
+        advertiseMessage.GetDuration(), TimerMilli::GetNow());
+    // Connected gateway is alive at least until its next advertisement
+    if (VerifyGatewayAddress(aMessageInfo))
+    {
+        HandleGatewayActivity(advertiseMessage.GetDuration() * 1000);
+    }
+    // Advertised gateway makes running expanding ring search unnecessary
+    mSearchGwRingAnswered = mSearchGwRingActive;
+    if (mAdvertiseCallback)
+    {
+        mAdvertiseCallback(aMessageInfo.GetPeerAddr(), advertiseMessage.GetGatewayId(),
+            advertiseMessage.GetDuration(), mAdvertiseContext);
+    }
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandleGwInfo(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    GwInfoMessage gwInfoMessage;
+    GatewayTable::Entry* entry = nullptr;
+    uint32_t now = TimerMilli::GetNow();
+
+    OT_UNUSED_VARIABLE(aMessage);
 
-        DisconnectMessage disconnectMessage;
-        if (disconnectMessage.Deserialize(data, length))
+    SuccessOrExit(error = gwInfoMessage.Deserialize(aData, aLength));
+
+    if (gwInfoMessage.GetHasAddress())
+    {
+        // GWINFO sent by other client carries gateway address, gateway is expected on searched port
+        entry = mGatewayTable.Update(gwInfoMessage.GetGatewayId(), gwInfoMessage.GetAddress(),
+            (mSearchGwPort != 0) ? mSearchGwPort : aMessageInfo.GetPeerPort(), 0, now);
+    }
+    else
+    {
+        entry = mGatewayTable.Update(gwInfoMessage.GetGatewayId(), aMessageInfo.GetPeerAddr(),
+            aMessageInfo.GetPeerPort(), 0, now);
+        // Gateway answers SEARCHGW immediately
+        if (mSearchGwTime != 0)
         {
-            break;
+            mGatewayTable.AddRttSample(*entry, now - mSearchGwTime);
         }
+    }
+
+    // Answer to own or other client search stops expanding ring search
+    mSearchGwRingAnswered = mSearchGwRingActive;
+    if (mSearchGwCallback)
+    {
+        mSearchGwCallback(entry->GetAddress(), gwInfoMessage.GetGatewayId(), mSearchGwContext);
+    }
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandleRegack(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    RegackMessage regackMessage;
+    MessageMetadata<RegisterCallbackFunc> metadata;
+    Message* registerMessage = nullptr;
 
-        DisconnectType reason = kServer;
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aMessage);
 
-        // Handle disconnection behavior depending on client state
-        switch (client->mClientState)
+    SuccessOrExit(error = regackMessage.Deserialize(aData, aLength));
+
+    // Batch requests are not retained in waiting queue
+    VerifyOrExit(!HandleBatchAcknowledgement(regackMessage.GetMessageId(), regackMessage.GetReturnCode(),
+        regackMessage.GetTopicId(), kQos0));
+
+    // Find waiting message with corresponding ID
+    registerMessage = mRegisterQueue.Find(regackMessage.GetMessageId(), metadata);
+    VerifyOrExit(registerMessage != nullptr);
+    HandleAcknowledgement(metadata.mTimestamp, metadata.mRetransmitted, regackMessage.GetReturnCode());
+
+    // Learn topic ID of the topic name from retained REGISTER message
+    {
+        uint8_t buffer[MAX_CONTROL_PACKET_SIZE];
+        uint16_t length = ReadRetainedMessage(*registerMessage, metadata.GetLength(), buffer);
+        RegisterMessage registerRequest;
+
+        if (length > 0 && registerRequest.Deserialize(buffer, length) == OT_ERROR_NONE)
         {
-        case kStateActive:
-        case kStateAwake:
-        case kStateAsleep:
-            if (client->mDisconnectRequested)
-            {
-                // Regular disconnect
-                client->mClientState = kStateDisconnected;
-                reason = kServer;
-            }
-            else if (client->mSleepRequested)
-            {
-                // Sleep state was requested - go asleep
-                client->mClientState = kStateAsleep;
-                reason = kAsleep;
-            }
-            else
-            {
-                // Disconnected by gateway
-                client->mClientState = kStateDisconnected;
-                reason = kServer;
-            }
-            break;
-        default:
-            break;
+            HandleTopicRegistered(registerRequest.GetTopicName().AsCString(), regackMessage.GetTopicId(),
+                regackMessage.GetReturnCode());
+        }
+    }
+
+    // Invoke callback and dequeue message
+    if (metadata.mCallback)
+    {
+        metadata.mCallback(regackMessage.GetReturnCode(), regackMessage.GetTopicId(), metadata.mContext);
+    }
+    mRegisterQueue.Dequeue(*registerMessage);
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandleRegister(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    RegisterMessage registerMessage;
+    ReturnCode code = kCodeAccepted;
+    Message* responseMessage = nullptr;
+    TopicRegistry::Entry* entry = nullptr;
+
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = registerMessage.Deserialize(aData, aLength));
+
+    // Invoke register callback, the application may reject the topic
+    if (mRegisterReceivedCallback)
+    {
+        code = mRegisterReceivedCallback(registerMessage.GetTopicId(), registerMessage.GetTopicName(), mRegisterReceivedContext);
+    }
+
+    // Store accepted topic ID to the registry, without application callback the topic is rejected when
+    // the registry is full
+    if (code == kCodeAccepted)
+    {
+        entry = mTopicRegistry.Add(registerMessage.GetTopicName().AsCString());
+        if (entry != nullptr)
+        {
+            entry->SetRegistered(registerMessage.GetTopicId());
+            SaveSession(*entry);
         }
-        // Check source IPv6 address
-        if (!client->VerifyGatewayAddress(messageInfo))
+        else if (!mRegisterReceivedCallback)
         {
-            break;
+            code = kCodeRejectedTopicId;
         }
-        client->OnDisconnected();
+    }
+
+    // Send REGACK response message
+    {
+        RegackMessage regackMessage(code, registerMessage.GetTopicId(), registerMessage.GetMessageId());
+        SuccessOrExit(NewMessage(&responseMessage, regackMessage));
+        SuccessOrExit(SendMessage(*responseMessage));
+    }
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandlePuback(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    PubackMessage pubackMessage;
+    MessageMetadata<PublishCallbackFunc> metadata;
+    Message* publishMessage = nullptr;
+
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = pubackMessage.Deserialize(aData, aLength));
 
-        // Invoke disconnected callback
-        if (client->mDisconnectedCallback)
+    // Process QoS level 1 message
+    // Find message waiting for acknowledge
+    publishMessage = mPublishQos1Queue.Find(pubackMessage.GetMessageId(), metadata);
+    if (publishMessage)
+    {
+        HandleAcknowledgement(metadata.mTimestamp, metadata.mRetransmitted, pubackMessage.GetReturnCode());
+        // Invoke confirmation callback
+        if (metadata.mCallback)
         {
-            client->mDisconnectedCallback(reason, client->mDisconnectedContext);
+            metadata.mCallback(pubackMessage.GetReturnCode(), metadata.mContext);
         }
+        // Dequeue waiting message
+        mPublishQos1Queue.Dequeue(*publishMessage);
+        ExitNow();
     }
-        break;
-    default:
-        break;
+    // May be QoS level 2 message error response
+    publishMessage = mPublishQos2PublishQueue.Find(pubackMessage.GetMessageId(), metadata);
+    if (publishMessage)
+    {
+        HandleAcknowledgement(metadata.mTimestamp, metadata.mRetransmitted, pubackMessage.GetReturnCode());
+        // Invoke confirmation callback
+        if (metadata.mCallback)
+        {
+            metadata.mCallback(pubackMessage.GetReturnCode(), metadata.mContext);
+        }
+        // Dequeue waiting message
+        mPublishQos2PublishQueue.Dequeue(*publishMessage);
+        ExitNow();
     }
+
+    // May be QoS level 0 message error response - it is not handled
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandlePubrec(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    PubrecMessage pubrecMessage;
+    MessageMetadata<PublishCallbackFunc> metadata;
+    Message* publishMessage = nullptr;
+    Message* responseMessage = nullptr;
+
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = pubrecMessage.Deserialize(aData, aLength));
+
+    // Process QoS level 2 message
+    // Find message waiting for receive acknowledge
+    publishMessage = mPublishQos2PublishQueue.Find(pubrecMessage.GetMessageId(), metadata);
+    VerifyOrExit(publishMessage != nullptr);
+    HandleAcknowledgement(metadata.mTimestamp, metadata.mRetransmitted, kCodeAccepted);
+
+    // Send PUBREL message
+    {
+        PubrelMessage pubrelMessage(metadata.mMessageId);
+        SuccessOrExit(NewMessage(&responseMessage, pubrelMessage));
+    }
+    // Send PUBREL message copy, retain the message and wait for PUBCOMP
+    SuccessOrExit(SendRetainedMessage(*responseMessage, mPublishQos2PubrelQueue,
+        MessageMetadata<PublishCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), metadata.mMessageId,
+            TimerMilli::GetNow(), GetRetransmissionTimeout(), mConfig.GetRetransmissionCount(),
+            metadata.mCallback, metadata.mContext)));
+
+    // Dequeue waiting PUBLISH message
+    mPublishQos2PublishQueue.Dequeue(*publishMessage);
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandlePubrel(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    PubrelMessage pubrelMessage;
+    MessageMetadata<void*> metadata;
+    Message* pubrecMessage = nullptr;
+    Message* responseMessage = nullptr;
+
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = pubrelMessage.Deserialize(aData, aLength));
+
+    // Process QoS level 2 PUBREL message
+    // Find PUBREC message waiting for receive acknowledge
+    pubrecMessage = mPublishQos2PubrecQueue.Find(pubrelMessage.GetMessageId(), metadata);
+
+    // Send PUBCOMP message also for unknown message ID, retransmitted PUBREL must be answered when PUBCOMP was lost
+    {
+        PubcompMessage pubcompMessage(pubrelMessage.GetMessageId());
+        SuccessOrExit(NewMessage(&responseMessage, pubcompMessage));
+        SuccessOrExit(SendMessage(*responseMessage));
+    }
+
+    // Dequeue waiting message
+    if (pubrecMessage != nullptr)
+    {
+        mPublishQos2PubrecQueue.Dequeue(*pubrecMessage);
+    }
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandlePubcomp(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    PubcompMessage pubcompMessage;
+    MessageMetadata<PublishCallbackFunc> metadata;
+    Message* pubrelMessage = nullptr;
+
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = pubcompMessage.Deserialize(aData, aLength));
+
+    // Process QoS level 2 PUBCOMP message
+    // Find PUBREL message waiting for receive acknowledge
+    pubrelMessage = mPublishQos2PubrelQueue.Find(pubcompMessage.GetMessageId(), metadata);
+    VerifyOrExit(pubrelMessage != nullptr);
+    HandleAcknowledgement(metadata.mTimestamp, metadata.mRetransmitted, kCodeAccepted);
+
+    // Invoke confirmation callback
+    if (metadata.mCallback)
+    {
+        metadata.mCallback(kCodeAccepted, metadata.mContext);
+    }
+    // Dequeue waiting message
+    mPublishQos2PubrelQueue.Dequeue(*pubrelMessage);
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandleUnsuback(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    UnsubackMessage unsubackMessage;
+    MessageMetadata<UnsubscribeCallbackFunc> metadata;
+    Message* unsubscribeMessage = nullptr;
+
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = unsubackMessage.Deserialize(aData, aLength));
+
+    // Find unsubscription message waiting for confirmation
+    unsubscribeMessage = mUnsubscribeQueue.Find(unsubackMessage.GetMessageId(), metadata);
+    VerifyOrExit(unsubscribeMessage != nullptr);
+    HandleAcknowledgement(metadata.mTimestamp, metadata.mRetransmitted, kCodeAccepted);
+
+    // Forget subscription of registered topic
+    {
+        uint8_t buffer[MAX_CONTROL_PACKET_SIZE];
+        uint16_t length = ReadRetainedMessage(*unsubscribeMessage, metadata.GetLength(), buffer);
+        UnsubscribeMessage unsubscribeRequest;
+        TopicRegistry::Entry* entry = nullptr;
+
+        if (length > 0 && unsubscribeRequest.Deserialize(buffer, length) == OT_ERROR_NONE
+            && unsubscribeRequest.GetTopicIdType() == kTopicId
+            && (entry = mTopicRegistry.Find(unsubscribeRequest.GetTopicId())) != nullptr)
+        {
+            entry->SetUnsubscribed();
+            SaveSession(*entry);
+        }
+    }
+
+    // Invoke unsubscribe confirmation callback
+    if (metadata.mCallback)
+    {
+        metadata.mCallback(kCodeAccepted, metadata.mContext);
+    }
+    // Dequeue waiting message
+    mUnsubscribeQueue.Dequeue(*unsubscribeMessage);
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandlePingreq(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    PingreqMessage pingreqMessage;
+    Message* responseMessage = nullptr;
+
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = pingreqMessage.Deserialize(aData, aLength));
+
+    // Send PINGRESP message
+    {
+        PingrespMessage pingrespMessage;
+        SuccessOrExit(NewMessage(&responseMessage, pingrespMessage));
+        SuccessOrExit(SendMessage(*responseMessage, aMessageInfo.GetPeerAddr(), mConfig.GetPort()));
+    }
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandlePingresp(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    PingrespMessage pingrespMessage;
+    bool isGateway = VerifyGatewayAddress(aMessageInfo);
+    uint32_t now = TimerMilli::GetNow();
+    GatewayTable::Entry* entry;
+
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = pingrespMessage.Deserialize(aData, aLength));
+
+    // Response to gateway probe is matched by its sender, keepalive PINGRESP of connected gateway is not
+    // a probe response
+    entry = mGatewayTable.Find(aMessageInfo.GetPeerAddr(), aMessageInfo.GetPeerPort());
+    if (entry != nullptr && entry->GetProbeTime() != 0 && (!isGateway || mClientState == kStateLost
+        || mClientState == kStateDisconnected))
+    {
+        if (now - entry->GetProbeTime() <= kRetransmissionTimeoutMax)
+        {
+            mGatewayTable.AddRttSample(*entry, now - entry->GetProbeTime());
+        }
+        entry->SetProbeTime(0);
+    }
+    VerifyOrExit(isGateway);
+
+    // Reset client timeout counter, requested disconnection or sleep still waits for DISCONNECT message
+    if (!mDisconnectRequested && !mSleepRequested)
+    {
+        mGwTimeout = 0;
+    }
+    mPingreqOutstanding = false;
+    // If the client is awake PINRESP message put it into sleep again
+    if (mClientState == kStateAwake)
+    {
+        mClientState = kStateAsleep;
+        if (mDisconnectedCallback)
+        {
+            mDisconnectedCallback(kAsleep, mDisconnectedContext);
+        }
+    }
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::HandleDisconnect(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+    const unsigned char *aData, uint16_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    DisconnectMessage disconnectMessage;
+    DisconnectType reason = kServer;
+
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aMessage);
+
+    SuccessOrExit(error = disconnectMessage.Deserialize(aData, aLength));
+
+    // Handle disconnection behavior depending on client state
+    switch (mClientState)
+    {
+    case kStateActive:
+    case kStateAwake:
+    case kStateAsleep:
+        if (mDisconnectRequested)
+        {
+            // Regular disconnect
+            mClientState = kStateDisconnected;
+            reason = kServer;
+        }
+        else if (mSleepRequested)
+        {
+            // Sleep state was requested - go asleep
+            mClientState = kStateAsleep;
+            reason = kAsleep;
+        }
+        else
+        {
+            // Disconnected by gateway
+            mClientState = kStateDisconnected;
+            reason = kServer;
+        }
+        break;
+    default:
+        break;
+    }
+    OnDisconnected();
+
+    // Invoke disconnected callback
+    if (mDisconnectedCallback)
+    {
+        mDisconnectedCallback(reason, mDisconnectedContext);
+    }
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::Start(uint16_t aPort)
+{
+    otError error = OT_ERROR_NONE;
+    Ip6::SockAddr sockaddr;
+    sockaddr.mPort = aPort;
+
+    // Open UDP socket
+    SuccessOrExit(error = mSocket.Open(MqttsnClient::HandleUdpReceive, this));
+    // Start listening on configured port
+    SuccessOrExit(error = mSocket.Bind(sockaddr));
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::Stop()
+{
+    otError error = mSocket.Close();
+    ClientState state = mClientState;
+
+    // Disconnect client if it is not disconnected already
+    mClientState = kStateDisconnected;
+    if (state != kStateDisconnected && state != kStateLost)
+    {
+        OnDisconnected();
+        if (mDisconnectedCallback)
+        {
+            mDisconnectedCallback(kClient, mDisconnectedContext);
+        }
+    }
+    // Waiting messages were timed out, no deadline is left
+    mProcessTimer.Stop();
+    UpdateFastPolling(false);
+    return error;
+}
+
+void MqttsnClient::HandleProcessTimer(Timer &aTimer)
+{
+    aTimer.GetOwner<MqttsnClient>().HandleProcessTimer();
+}
+
+void MqttsnClient::HandleProcessTimer()
+{
+    otError error = OT_ERROR_NONE;
+
+    uint32_t now = TimerMilli::GetNow();
+
+    // Process keep alive and send periodical PINGREQ message
+    if (mClientState == kStateActive && mPingReqTime != 0 && !WaitingMessagesIndex::IsBefore(now, mPingReqTime))
+    {
+        uint32_t fixedPingReqTime;
+
+        CountSavedPingreqs(now);
+        fixedPingReqTime = mFixedPingReqTime;
+        SuccessOrExit(error = PingGateway());
+        // Keepalive PINGREQ does not move fixed schedule, the schedule sends its own PINGREQs
+        mFixedPingReqTime = fixedPingReqTime;
+        mPingreqSent++;
+        mPingreqOutstanding = true;
+        mGwTimeout = TimerMilli::GetNow() + GetEstimatedTimeout();
+    }
+
+    // Set timeout flag when communication timed out
+    if (mGwTimeout != 0 && !WaitingMessagesIndex::IsBefore(now, mGwTimeout))
+    {
+        mTimeoutRaised = true;
+        goto exit;
+    }
+
+    // Handle expired pending messages retransmissions and timeouts
+    mWaitingMessagesIndex.HandleExpired(now);
+    HandleBatchDeadline(now);
+    HandleSearchGwDeadline(now);
+    HandleFailoverDeadline(now);
+
+exit:
+    // Handle timeout
+    if (mTimeoutRaised)
+    {
+        mClientState = kStateLost;
+        OnDisconnected();
+        // Connection continues with the next best gateway, the loss is reported only when no gateway is left
+        if (FailoverGateway() != OT_ERROR_NONE && mDisconnectedCallback)
+        {
+            mDisconnectedCallback(kTimeout, mDisconnectedContext);
+        }
+    }
+
+    if (error != OT_ERROR_NONE)
+    {
+        MQTTSN_LOG("Process timer handling failed with error: %d\r\n", error);
+    }
+    // Timed out messages may free in-flight window
+    NotifyPublishWindow();
+    UpdateProcessTimer();
+}
+
+void MqttsnClient::UpdateProcessTimer()
+{
+    uint32_t now = TimerMilli::GetNow();
+    uint32_t deadline = 0;
+    // Signed difference handles timer wrap around, passed deadlines are negative
+    int32_t interval = INT32_MAX;
+
+    // Waiting messages, batch and gateway timeout of CONNECT or PINGREQ expect response from the parent
+    UpdateFastPolling(mWaitingMessagesIndex.GetNextDeadline(deadline) || mBatchActive || mGwTimeout != 0);
+
+    if (mClientState == kStateActive && mPingReqTime != 0)
+    {
+        interval = OT_MIN(interval, static_cast<int32_t>(mPingReqTime - now));
+    }
+    if (mGwTimeout != 0)
+    {
+        interval = OT_MIN(interval, static_cast<int32_t>(mGwTimeout - now));
+    }
+    if (mWaitingMessagesIndex.GetNextDeadline(deadline))
+    {
+        interval = OT_MIN(interval, static_cast<int32_t>(deadline - now));
+    }
+    if (mBatchActive)
+    {
+        deadline = mBatch.mTimestamp + mBatch.mRetransmissionTimeout;
+        interval = OT_MIN(interval, static_cast<int32_t>(deadline - now));
+    }
+    if (mSearchGwRingActive)
+    {
+        interval = OT_MIN(interval, static_cast<int32_t>(mSearchGwRingDeadline - now));
+    }
+    if (mFailoverPending)
+    {
+        interval = OT_MIN(interval, static_cast<int32_t>(mFailoverTime - now));
+    }
+
+    if (interval == INT32_MAX)
+    {
+        // Nothing is pending
+        mProcessTimer.Stop();
+    }
+    else
+    {
+        mProcessTimer.Start(static_cast<uint32_t>(OT_MAX(interval, 0)));
+    }
+}
+
+otError MqttsnClient::Connect(MqttsnConfig &aConfig)
+{
+    otError error = OT_ERROR_NONE;
+    Message* message = nullptr;
+    ConnectMessage connectMessage;
+
+    // Cannot connect in active state (already connected)
+    if (mClientState == kStateActive)
+    {
+        error = OT_ERROR_INVALID_STATE;
+        goto exit;
+    }
+    mConfig = aConfig;
+    mGatewayFailover = false;
+    mFailoverPending = false;
+    connectMessage = ConnectMessage(mConfig.GetCleanSession(), false, mConfig.GetKeepAlive(), mConfig.GetClientId().AsCString());
+    SeedRttEstimate();
+    // Topic IDs and subscriptions are valid only within the session, persistent session is restored
+    // from settings. New session may restore them by sending REGISTER and SUBSCRIBE messages again.
+    if (mConfig.GetCleanSession())
+    {
+        if (mConfig.GetRestoreSession())
+        {
+            mTopicRegistry.InvalidateSession();
+        }
+        else
+        {
+            mTopicRegistry.Clear();
+        }
+        DeleteSession();
+    }
+    else
+    {
+        mTopicRegistry.Clear();
+        RestoreSession();
+    }
+
+    // Serialize and send CONNECT message
+    SuccessOrExit(error = NewMessage(&message, connectMessage));
+    SuccessOrExit(error = SendMessage(*message));
+
+    mDisconnectRequested = false;
+    mSleepRequested = false;
+    mConnectTime = TimerMilli::GetNow();
+    // Set timeout time
+    mGwTimeout = TimerMilli::GetNow() + GetEstimatedTimeout();
+    // Set next keepalive PINGREQ time, random phase keeps PINGREQs of simultaneously connected clients apart
+    mPingReqTime = TimerMilli::GetNow() + GetKeepAliveInterval();
+    UpdateProcessTimer();
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::Subscribe(const char* aTopicName, bool aIsShortTopicName, Qos aQos, SubscribeCallbackFunc aCallback, void* aContext)
+{
+    otError error = OT_ERROR_NONE;
+    Ip6::MessageInfo messageInfo;
+    Message *message = nullptr;
+    int32_t topicNameLength = strlen(aTopicName);
+    SubscribeMessage subscribeMessage;
+    // Topic length must be 1 or 2
+    VerifyOrExit(topicNameLength > 0, error = OT_ERROR_INVALID_ARGS);
+    VerifyOrExit(!aIsShortTopicName || topicNameLength <= 2, error = OT_ERROR_INVALID_ARGS);
+    subscribeMessage = aIsShortTopicName ?
+        SubscribeMessage(false, aQos, mMessageId, kShortTopicName, 0, aTopicName, "")
+        : SubscribeMessage(false, aQos, mMessageId, kTopicName, 0, "", aTopicName);
+
+    // Client state must be active
+    if (mClientState != kStateActive)
+    {
+        error = OT_ERROR_INVALID_STATE;
+        goto exit;
+    }
+
+    // Topic subscription is possible only for QoS levels 0, 1, 2
+    if (aQos != kQos0 && aQos != kQos1 && aQos != kQos2)
+    {
+        error = OT_ERROR_INVALID_ARGS;
+        goto exit;
+    }
+
+    // Subscription of long topic name may be already held by gateway
+    if (!aIsShortTopicName)
+    {
+        TopicRegistry::Entry* entry = mTopicRegistry.Find(aTopicName);
+        if (entry != nullptr && entry->IsSubscribed() && entry->GetSubscribeQos() == aQos)
+        {
+            if (aCallback)
+            {
+                aCallback(kCodeAccepted, entry->GetTopicId(), aQos, aContext);
+            }
+            ExitNow();
+        }
+    }
+
+    // Serialize and send SUBSCRIBE message
+    SuccessOrExit(error = NewMessage(&message, subscribeMessage));
+    // Send message copy and retain the message in waiting queue - waiting for SUBACK
+    SuccessOrExit(error = SendRetainedMessage(*message, mSubscribeQueue,
+        MessageMetadata<SubscribeCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
+            GetRetransmissionTimeout(), mConfig.GetRetransmissionCount(), aCallback, aContext)));
+    mMessageId++;
+    UpdateProcessTimer();
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::Subscribe(TopicId aTopicId, Qos aQos, SubscribeCallbackFunc aCallback, void* aContext)
+{
+    otError error = OT_ERROR_NONE;
+    Ip6::MessageInfo messageInfo;
+    Message *message = nullptr;
+    SubscribeMessage subscribeMessage(false, aQos, mMessageId, kShortTopicName, aTopicId, "", "");
+
+    // Client state must be active
+    if (mClientState != kStateActive)
+    {
+        error = OT_ERROR_INVALID_STATE;
+        goto exit;
+    }
+
+    // Topic subscription is possible only for QoS levels 0, 1, 2
+    if (aQos != kQos0 && aQos != kQos1 && aQos != kQos2)
+    {
+        error = OT_ERROR_INVALID_ARGS;
+        goto exit;
+    }
+
+    // Serialize and send SUBSCRIBE message
+    SuccessOrExit(error = NewMessage(&message, subscribeMessage));
+    // Send message copy and retain the message in waiting queue - waiting for SUBACK
+    SuccessOrExit(error = SendRetainedMessage(*message, mSubscribeQueue,
+        MessageMetadata<SubscribeCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
+            GetRetransmissionTimeout(), mConfig.GetRetransmissionCount(), aCallback, aContext)));
+    mMessageId++;
+    UpdateProcessTimer();
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::Register(const char* aTopicName, RegisterCallbackFunc aCallback, void* aContext)
+{
+    otError error = OT_ERROR_NONE;
+    Message* message = nullptr;
+    RegisterMessage registerMessage(0, mMessageId, aTopicName);
+    TopicRegistry::Entry* entry = nullptr;
+
+    // Client state must be active
+    if (mClientState != kStateActive)
+    {
+        error = OT_ERROR_INVALID_STATE;
+        goto exit;
+    }
+
+    // Topic ID may be already known from current or restored session
+    entry = mTopicRegistry.Find(aTopicName);
+    if (entry != nullptr && entry->IsRegistered())
+    {
+        if (aCallback)
+        {
+            aCallback(kCodeAccepted, entry->GetTopicId(), aContext);
+        }
+        ExitNow();
+    }
+
+    // Serialize and send REGISTER message
+    SuccessOrExit(error = NewMessage(&message, registerMessage));
+    // Send message copy and retain the message in waiting queue - waiting for REGACK
+    SuccessOrExit(error = SendRetainedMessage(*message, mRegisterQueue,
+        MessageMetadata<RegisterCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
+            GetRetransmissionTimeout(), mConfig.GetRetransmissionCount(), aCallback, aContext)));
+    mMessageId++;
+    UpdateProcessTimer();
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::SubscribeBatch(const char* const* aTopicNames, uint8_t aCount, Qos aQos, BatchCallbackFunc aCallback, void* aContext)
+{
+    otError error = OT_ERROR_NONE;
+
+    // Topic subscription is possible only for QoS levels 0, 1, 2
+    VerifyOrExit(aQos == kQos0 || aQos == kQos1 || aQos == kQos2, error = OT_ERROR_INVALID_ARGS);
+    error = StartBatch(kTypeSubscribe, aTopicNames, aCount, aQos, aCallback, aContext);
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::RegisterBatch(const char* const* aTopicNames, uint8_t aCount, BatchCallbackFunc aCallback, void* aContext)
+{
+    return StartBatch(kTypeRegister, aTopicNames, aCount, kQos0, aCallback, aContext);
+}
+
+otError MqttsnClient::Publish(const uint8_t* aData, int32_t aLength, Qos aQos, const char* aShortTopicName, PublishCallbackFunc aCallback, void* aContext)
+{
+    otError error = OT_ERROR_NONE;
+    Message* message = nullptr;
+    int32_t topicNameLength = strlen(aShortTopicName);
+    PublishMessage publishMessage;
+    // Topic length must be 1 or 2
+    VerifyOrExit(topicNameLength > 0 && topicNameLength <= 2, error = OT_ERROR_INVALID_ARGS);
+    publishMessage = PublishMessage(false, false, aQos, mMessageId, kShortTopicName, 0, aShortTopicName, aData, aLength);
+
+    // Client state must be active
+    if (mClientState != kStateActive)
+    {
+        error = OT_ERROR_INVALID_STATE;
+        goto exit;
+    }
+    SuccessOrExit(error = CheckPublishWindow(aQos));
+
+    // Serialize and send PUBLISH message
+    SuccessOrExit(error = NewMessage(&message, publishMessage));
+    SuccessOrExit(error = SendPublishMessage(*message, aQos, mMessageId, aCallback, aContext));
+    mMessageId++;
+    UpdateProcessTimer();
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::Publish(const uint8_t* aData, int32_t aLength, Qos aQos, TopicId aTopicId, PublishCallbackFunc aCallback, void* aContext)
+{
+    otError error = OT_ERROR_NONE;
+    Message* message = nullptr;
+    PublishMessage publishMessage(false, false, aQos, mMessageId, kTopicId, aTopicId, "", aData, aLength);
+
+    // Client state must be active
+    if (mClientState != kStateActive)
+    {
+        error = OT_ERROR_INVALID_STATE;
+        goto exit;
+    }
+    SuccessOrExit(error = CheckPublishWindow(aQos));
+
+    // Serialize and send PUBLISH message
+    SuccessOrExit(error = NewMessage(&message, publishMessage));
+    SuccessOrExit(error = SendPublishMessage(*message, aQos, mMessageId, aCallback, aContext));
+    mMessageId++;
+    UpdateProcessTimer();
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::Publish(const char* aTopicName, const uint8_t* aData, int32_t aLength, Qos aQos, PublishCallbackFunc aCallback, void* aContext)
+{
+    otError error = OT_ERROR_NONE;
+    Message* message = nullptr;
+    size_t topicNameLength = strlen(aTopicName);
+    TopicRegistry::Entry* entry = nullptr;
+    PendingPublish pending;
+
+    VerifyOrExit(topicNameLength > 0 && topicNameLength < kMaxTopicNameLength, error = OT_ERROR_INVALID_ARGS);
+    VerifyOrExit(aQos != kQosm1, error = OT_ERROR_INVALID_ARGS);
+    // Client state must be active
+    VerifyOrExit(mClientState == kStateActive, error = OT_ERROR_INVALID_STATE);
+    VerifyOrExit((entry = mTopicRegistry.Add(aTopicName)) != nullptr, error = OT_ERROR_NO_BUFS);
+
+    // Topic ID is known, publish immediately
+    if (entry->IsRegistered())
+    {
+        error = Publish(aData, aLength, aQos, entry->GetTopicId(), aCallback, aContext);
+        ExitNow();
+    }
+
+    SuccessOrExit(error = CheckPublishWindow(aQos));
+    VerifyOrExit(mPendingPublishCount < kMaxPendingPublishes, error = OT_ERROR_BUSY);
+
+    // Register the topic once, other publishes to the same topic wait for the same REGACK
+    if (!entry->IsRegistering())
+    {
+        SuccessOrExit(error = Register(entry->GetName(), nullptr, nullptr));
+        entry->SetRegistering();
+    }
+
+    // Serialize PUBLISH message with topic ID set later and retain it until REGACK is received
+    {
+        PublishMessage publishMessage(false, false, aQos, mMessageId, kTopicId, 0, "", aData, aLength);
+        SuccessOrExit(error = NewMessage(&message, publishMessage));
+    }
+    pending.mMessageId = mMessageId;
+    pending.mTopicIndex = mTopicRegistry.GetIndex(*entry);
+    pending.mQos = aQos;
+    pending.mCallback = aCallback;
+    pending.mContext = aContext;
+    SuccessOrExit(error = message->Append(&pending, sizeof(pending)));
+    SuccessOrExit(error = mPendingPublishQueue.Enqueue(*message));
+    mPendingPublishCount++;
+    mMessageId++;
+
+exit:
+    if (error != OT_ERROR_NONE && message != nullptr)
+    {
+        message->Free();
+    }
+    return error;
+}
+
+otError MqttsnClient::GetTopicId(const char* aTopicName, TopicId &aTopicId)
+{
+    otError error = OT_ERROR_NONE;
+    TopicRegistry::Entry* entry = mTopicRegistry.Find(aTopicName);
+
+    VerifyOrExit(entry != nullptr && entry->IsRegistered(), error = OT_ERROR_NOT_FOUND);
+    aTopicId = entry->GetTopicId();
+
+exit:
+    return error;
+}
+
+const char* MqttsnClient::GetTopicName(TopicId aTopicId)
+{
+    TopicRegistry::Entry* entry = mTopicRegistry.Find(aTopicId);
+    return (entry != nullptr) ? entry->GetName() : nullptr;
+}
+
+otError MqttsnClient::PublishQosm1(const uint8_t* aData, int32_t aLength, const char* aShortTopicName, Ip6::Address aAddress, uint16_t aPort)
+{
+    otError error = OT_ERROR_NONE;
+    Message* message = nullptr;
+    PublishMessage publishMessage;
+    int32_t topicNameLength = strlen(aShortTopicName);
+    VerifyOrExit(topicNameLength > 0 && topicNameLength <= 2, error = OT_ERROR_INVALID_ARGS);
+    publishMessage = PublishMessage(false, false, Qos::kQosm1, mMessageId, kShortTopicName, 0, aShortTopicName, aData, aLength);
+
+    // Serialize and send PUBLISH message
+    SuccessOrExit(error = NewMessage(&message, publishMessage));
+    SuccessOrExit(error = SendMessage(*message, aAddress, aPort));
+    mMessageId++;
+
+exit:
+    return error;
 }
 
-otError MqttsnClient::Start(uint16_t aPort)
+otError MqttsnClient::PublishQosm1(const uint8_t* aData, int32_t aLength, TopicId aTopicId, Ip6::Address aAddress, uint16_t aPort)
 {
     otError error = OT_ERROR_NONE;
-    Ip6::SockAddr sockaddr;
-    sockaddr.mPort = aPort;
+    Message* message = nullptr;
+    PublishMessage publishMessage(false, false, Qos::kQosm1, mMessageId, kTopicId, aTopicId, "", aData, aLength);
 
-    // Open UDP socket
-    SuccessOrExit(error = mSocket.Open(MqttsnClient::HandleUdpReceive, this));
-    // Start listening on configured port
-    SuccessOrExit(error = mSocket.Bind(sockaddr));
+    // Serialize and send PUBLISH message
+    SuccessOrExit(error = NewMessage(&message, publishMessage));
+    SuccessOrExit(error = SendMessage(*message, aAddress, aPort));
+    mMessageId++;
 
 exit:
     return error;
 }
 
-otError MqttsnClient::Stop()
+otError MqttsnClient::Unsubscribe(const char* aShortTopicName, UnsubscribeCallbackFunc aCallback, void* aContext)
 {
-    otError error = mSocket.Close();
-    // Disconnect client if it is not disconnected already
-    mClientState = kStateDisconnected;
-    if (mClientState != kStateDisconnected && mClientState != kStateLost)
+    otError error = OT_ERROR_NONE;
+    Message* message = nullptr;
+    int32_t topicNameLength = strlen(aShortTopicName);
+    UnsubscribeMessage unsubscribeMessage;
+    // Topic length must be 1 or 2
+    VerifyOrExit(topicNameLength > 0 && topicNameLength <= 2, error = OT_ERROR_INVALID_ARGS);
+    unsubscribeMessage = UnsubscribeMessage(mMessageId, kShortTopicName, 0, aShortTopicName);
+
+    // Client state must be active
+    if (mClientState != kStateActive)
     {
-        OnDisconnected();
-        if (mDisconnectedCallback)
-        {
-            mDisconnectedCallback(kClient, mDisconnectedContext);
-        }
+        error = OT_ERROR_INVALID_STATE;
+        goto exit;
     }
+
+    // Serialize and send UNSUBSCRIBE message
+    SuccessOrExit(error = NewMessage(&message, unsubscribeMessage));
+    // Send message copy and retain the message in waiting queue - waiting for UNSUBACK
+    SuccessOrExit(error = SendRetainedMessage(*message, mUnsubscribeQueue,
+        MessageMetadata<UnsubscribeCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
+            GetRetransmissionTimeout(), mConfig.GetRetransmissionCount(), aCallback, aContext)));
+    mMessageId++;
+    UpdateProcessTimer();
+
+exit:
     return error;
 }
 
-otError MqttsnClient::Process()
+otError MqttsnClient::Unsubscribe(TopicId aTopicId, UnsubscribeCallbackFunc aCallback, void* aContext)
 {
     otError error = OT_ERROR_NONE;
+    Message* message = nullptr;
+    UnsubscribeMessage unsubscribeMessage(mMessageId, kTopicId, aTopicId, "");
 
-    uint32_t now = TimerMilli::GetNow();
-
-    // Process keep alive and send periodical PINGREQ message
-    if (mClientState == kStateActive && mPingReqTime != 0 && mPingReqTime <= now)
-    {
-        SuccessOrExit(error = PingGateway());
-        mGwTimeout = TimerMilli::GetNow() + mConfig.GetRetransmissionTimeout() * 1000;
-    }
-
-    // Set timeout flag when communication timed out
-    if (mGwTimeout != 0 && mGwTimeout <= now)
+    // Client state must be active
+    if (mClientState != kStateActive)
     {
-        mTimeoutRaised = true;
+        error = OT_ERROR_INVALID_STATE;
         goto exit;
     }
 
-    // Handle pending messages timeouts
-    SuccessOrExit(error = mSubscribeQueue.HandleTimer());
-    SuccessOrExit(error = mRegisterQueue.HandleTimer());
-    SuccessOrExit(error = mUnsubscribeQueue.HandleTimer());
-    SuccessOrExit(error = mPublishQos1Queue.HandleTimer());
-    SuccessOrExit(error = mPublishQos2PublishQueue.HandleTimer());
-    SuccessOrExit(error = mPublishQos2PubrelQueue.HandleTimer());
+    // Serialize and send UNSUBSCRIBE message
+    SuccessOrExit(error = NewMessage(&message, unsubscribeMessage));
+    // Send message copy and retain the message in waiting queue - waiting for UNSUBACK
+    SuccessOrExit(error = SendRetainedMessage(*message, mUnsubscribeQueue,
+        MessageMetadata<UnsubscribeCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
+            GetRetransmissionTimeout(), mConfig.GetRetransmissionCount(), aCallback, aContext)));
+    mMessageId++;
+    UpdateProcessTimer();
 
 exit:
-    // Handle timeout
-    if (mTimeoutRaised)
-    {
-        mClientState = kStateLost;
-        OnDisconnected();
-        if (mDisconnectedCallback)
-        {
-            mDisconnectedCallback(kTimeout, mDisconnectedContext);
-        }
-    }
-
     return error;
 }
 
-otError MqttsnClient::Connect(MqttsnConfig &aConfig)
+otError MqttsnClient::Disconnect()
 {
     otError error = OT_ERROR_NONE;
-    int32_t length = -1;
     Message* message = nullptr;
-    ConnectMessage connectMessage(mConfig.GetCleanSession(), false, mConfig.GetKeepAlive(), mConfig.GetClientId().AsCString());
-    unsigned char buffer[MAX_PACKET_SIZE];
+    DisconnectMessage disconnectMessage(0);
 
-    // Cannot connect in active state (already connected)
-    if (mClientState == kStateActive)
+    // Client must be connected
+    if (mClientState != kStateActive && mClientState != kStateAwake
+        && mClientState != kStateAsleep)
     {
         error = OT_ERROR_INVALID_STATE;
         goto exit;
     }
-    mConfig = aConfig;
 
-    // Serialize and send CONNECT message
-    SuccessOrExit(error = connectMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
+    // Serialize and send DISCONNECT message
+    SuccessOrExit(error = NewMessage(&message, disconnectMessage));
     SuccessOrExit(error = SendMessage(*message));
 
-    mDisconnectRequested = false;
-    mSleepRequested = false;
+    // Set flag for regular disconnect request and wait for DISCONNECT message from gateway
+    mDisconnectRequested = true;
+    mPingreqOutstanding = false;
     // Set timeout time
-    mGwTimeout = TimerMilli::GetNow() + mConfig.GetRetransmissionTimeout() * 1000;
-    // Set next keepalive PINGREQ time
-    mPingReqTime = TimerMilli::GetNow() + mConfig.GetKeepAlive() * 700;
+    mGwTimeout = TimerMilli::GetNow() + GetEstimatedTimeout();
+    UpdateProcessTimer();
 
 exit:
     return error;
 }
 
-otError MqttsnClient::Subscribe(const char* aTopicName, bool aIsShortTopicName, Qos aQos, SubscribeCallbackFunc aCallback, void* aContext)
+otError MqttsnClient::Sleep(uint16_t aDuration)
 {
     otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Ip6::MessageInfo messageInfo;
-    Message *message = nullptr;
-    int32_t topicNameLength = strlen(aTopicName);
-    SubscribeMessage subscribeMessage;
-    // Topic length must be 1 or 2
-    VerifyOrExit(topicNameLength > 0, error = OT_ERROR_INVALID_ARGS);
-    VerifyOrExit(!aIsShortTopicName || length <= 2, error = OT_ERROR_INVALID_ARGS);
-    subscribeMessage = aIsShortTopicName ?
-        SubscribeMessage(false, aQos, mMessageId, kShortTopicName, 0, aTopicName, "")
-        : SubscribeMessage(false, aQos, mMessageId, kTopicName, 0, "", aTopicName);
-    unsigned char buffer[MAX_PACKET_SIZE];
+    Message* message = nullptr;
+    DisconnectMessage disconnectMessage(aDuration);
 
-    // Client state must be active
-    if (mClientState != kStateActive)
+    // Client must be connected
+    if (mClientState != kStateActive && mClientState != kStateAwake && mClientState != kStateAsleep)
     {
         error = OT_ERROR_INVALID_STATE;
         goto exit;
     }
 
-    // Topic subscription is possible only for QoS levels 1, 2, 3
-    if (aQos != kQos0 || aQos != kQos1 || aQos != kQos2)
+    // Serialize and send DISCONNECT message
+    SuccessOrExit(error = NewMessage(&message, disconnectMessage));
+    SuccessOrExit(error = SendMessage(*message));
+
+    // Set flag for sleep request and wait for DISCONNECT message from gateway
+    mSleepRequested = true;
+    mPingreqOutstanding = false;
+    // Set timeout time
+    mGwTimeout = TimerMilli::GetNow() + GetEstimatedTimeout();
+    UpdateProcessTimer();
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::Awake(uint32_t aTimeout)
+{
+    otError error = OT_ERROR_NONE;
+    // Awake is possible only when the client is in
+    if (mClientState != kStateAwake && mClientState != kStateAsleep)
     {
-        error = OT_ERROR_INVALID_ARGS;
+        error = OT_ERROR_INVALID_STATE;
         goto exit;
     }
 
-    // Serialize and send SUBSCRIBE message
-    SuccessOrExit(error = subscribeMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message));
+    // Send PINGEQ message
+    SuccessOrExit(error = PingGateway());
 
-    // Enqueue message to waiting queue - waiting for SUBACK
-    SuccessOrExit(error = mSubscribeQueue.EnqueueCopy(*message, message->GetLength(),
-        MessageMetadata<SubscribeCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
-            mConfig.GetRetransmissionTimeout() * 1000, aCallback, aContext)));
-    mMessageId++;
+    // Set awake state and wait for any PUBLISH messages
+    mClientState = kStateAwake;
+    // Set timeout time - PINGRESP message must be delivered within this time
+    mGwTimeout = TimerMilli::GetNow() + aTimeout;
+    UpdateProcessTimer();
 
 exit:
     return error;
 }
 
-otError MqttsnClient::Subscribe(TopicId aTopicId, Qos aQos, SubscribeCallbackFunc aCallback, void* aContext)
+otError MqttsnClient::SearchGateway(const Ip6::Address &aMulticastAddress, uint16_t aPort, uint8_t aRadius)
 {
     otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Ip6::MessageInfo messageInfo;
-    Message *message = nullptr;
-    SubscribeMessage subscribeMessage(false, aQos, mMessageId, kShortTopicName, aTopicId, "", "");
-    unsigned char buffer[MAX_PACKET_SIZE];
+    Message* message = nullptr;
+    SearchGwMessage searchGwMessage(aRadius);
 
-    // Client state must be active
-    if (mClientState != kStateActive)
+    // Serialize and send SEARCHGW message
+    SuccessOrExit(error = NewMessage(&message, searchGwMessage));
+    SuccessOrExit(error = SendMessage(*message, aMulticastAddress, aPort, aRadius));
+    mSearchGwPort = aPort;
+    mSearchGwTime = TimerMilli::GetNow();
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::SearchGatewayRing(const Ip6::Address &aMulticastAddress, uint16_t aPort, uint8_t aMaxRadius,
+    uint32_t aMaxJitter, SearchGwFinishedCallbackFunc aCallback, void* aContext)
+{
+    otError error = OT_ERROR_NONE;
+
+    VerifyOrExit(aMaxRadius > 0, error = OT_ERROR_INVALID_ARGS);
+    VerifyOrExit(!mSearchGwRingActive, error = OT_ERROR_BUSY);
+
+    mSearchGwRingAddress = aMulticastAddress;
+    mSearchGwPort = aPort;
+    mSearchGwRingMaxRadius = aMaxRadius;
+    mSearchGwRingRadius = 0;
+    mSearchGwRingAnswered = false;
+    mSearchGwFinishedCallback = aCallback;
+    mSearchGwFinishedContext = aContext;
+    // Random delay spreads searches of nodes which started at the same time
+    mSearchGwRingDeadline = TimerMilli::GetNow() + ((aMaxJitter > 0) ? otPlatRandomGet() % (aMaxJitter + 1) : 0);
+    mSearchGwRingActive = true;
+    UpdateProcessTimer();
+
+exit:
+    return error;
+}
+
+otError MqttsnClient::DiscoverNetworkDataGateways()
+{
+    otError error = OT_ERROR_NOT_FOUND;
+#if OPENTHREAD_ENABLE_SERVICE
+    otNetworkDataIterator iterator = OT_NETWORK_DATA_ITERATOR_INIT;
+    otServiceConfig config;
+    const uint8_t serviceDataLength = sizeof(MQTTSN_NETDATA_SERVICE_DATA) - 1;
+    uint32_t now = TimerMilli::GetNow();
+
+    while (otNetDataGetNextService(&GetInstance(), &iterator, &config) == OT_ERROR_NONE)
     {
-        error = OT_ERROR_INVALID_STATE;
-        goto exit;
+        const otServerConfig &server = config.mServerConfig;
+        Ip6::Address address;
+
+        if (config.mEnterpriseNumber != MQTTSN_NETDATA_ENTERPRISE_NUMBER
+            || config.mServiceDataLength != serviceDataLength
+            || memcmp(config.mServiceData, MQTTSN_NETDATA_SERVICE_DATA, serviceDataLength) != 0
+            || server.mServerDataLength < NETDATA_SERVER_DATA_LENGTH)
+        {
+            continue;
+        }
+
+        memcpy(&address, server.mServerData, sizeof(address));
+        mGatewayTable.Update(server.mServerData[NETDATA_SERVER_DATA_ID_OFFSET], address,
+            static_cast<uint16_t>((server.mServerData[NETDATA_SERVER_DATA_PORT_OFFSET] << 8)
+                | server.mServerData[NETDATA_SERVER_DATA_PORT_OFFSET + 1]), 0, now);
+        error = OT_ERROR_NONE;
     }
+#else
+    error = OT_ERROR_NOT_IMPLEMENTED;
+#endif
+    return error;
+}
+
+otError MqttsnClient::ConnectBestGateway(MqttsnConfig &aConfig)
+{
+    otError error = OT_ERROR_NONE;
+    GatewayTable::Entry* entry = mGatewayTable.GetBest(TimerMilli::GetNow());
 
-    // Topic subscription is possible only for QoS levels 1, 2, 3
-    if (aQos != kQos0 || aQos != kQos1 || aQos != kQos2)
+    VerifyOrExit(entry != nullptr, error = OT_ERROR_NOT_FOUND);
+    aConfig.SetAddress(entry->GetAddress());
+    aConfig.SetPort(entry->GetPort());
+    SuccessOrExit(error = Connect(aConfig));
+    mGatewayFailover = true;
+
+exit:
+    return error;
+}
+
+uint32_t MqttsnClient::NextReconnectDelay()
+{
+    uint32_t base = mConfig.GetReconnectBackoffBase();
+    uint32_t previous = (mReconnectDelay != 0) ? mReconnectDelay : base;
+    uint32_t upper = OT_MIN(mConfig.GetReconnectBackoffMax(), previous * 3);
+
+    // Decorrelated jitter, delay = min(max, random(base, previous * 3))
+    if (upper <= base)
     {
-        error = OT_ERROR_INVALID_ARGS;
-        goto exit;
+        mReconnectDelay = base;
+    }
+    else
+    {
+        mReconnectDelay = base + otPlatRandomGet() % (upper - base + 1);
     }
+    return mReconnectDelay;
+}
 
-    // Serialize and send SUBSCRIBE message
-    SuccessOrExit(error = subscribeMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message));
+otError MqttsnClient::ProbeGateways()
+{
+    otError error = OT_ERROR_NONE;
 
-    // Enqueue message to waiting queue - waiting for SUBACK
-    SuccessOrExit(error = mSubscribeQueue.EnqueueCopy(*message, message->GetLength(),
-        MessageMetadata<SubscribeCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
-            mConfig.GetRetransmissionTimeout() * 1000, aCallback, aContext)));
-    mMessageId++;
+    VerifyOrExit(mGatewayTable.GetCount() > 0, error = OT_ERROR_NOT_FOUND);
+    for (uint8_t i = 0; i < mGatewayTable.GetCount(); i++)
+    {
+        GatewayTable::Entry* entry = mGatewayTable.GetEntry(i);
+        Message* message = nullptr;
+        // PINGREQ without client ID does not affect client session on the gateway
+        PingreqMessage pingreqMessage;
+
+        SuccessOrExit(error = NewMessage(&message, pingreqMessage));
+        SuccessOrExit(error = SendMessage(*message, entry->GetAddress(), entry->GetPort()));
+        entry->SetProbeTime(TimerMilli::GetNow());
+    }
+
+exit:
+    return error;
+}
+
+ClientState MqttsnClient::GetState()
+{
+    return mClientState;
+}
+
+otError MqttsnClient::SetConnectedCallback(ConnectedCallbackFunc aCallback, void* aContext)
+{
+    mConnectedCallback = aCallback;
+    mConnectContext = aContext;
+    return OT_ERROR_NONE;
+}
+
+otError MqttsnClient::SetPublishReceivedCallback(PublishReceivedCallbackFunc aCallback, void* aContext)
+{
+    mPublishReceivedCallback = aCallback;
+    mPublishReceivedContext = aContext;
+    return OT_ERROR_NONE;
+}
+
+otError MqttsnClient::SetAdvertiseCallback(AdvertiseCallbackFunc aCallback, void* aContext)
+{
+    mAdvertiseCallback = aCallback;
+    mAdvertiseContext = aContext;
+    return OT_ERROR_NONE;
+}
+
+otError MqttsnClient::SetSearchGwCallback(SearchGwCallbackFunc aCallback, void* aContext)
+{
+    mSearchGwCallback = aCallback;
+    mSearchGwContext = aContext;
+    return OT_ERROR_NONE;
+}
+
+otError MqttsnClient::SetDisconnectedCallback(DisconnectedCallbackFunc aCallback, void* aContext)
+{
+    mDisconnectedCallback = aCallback;
+    mDisconnectedContext = aContext;
+    return OT_ERROR_NONE;
+}
+
+otError MqttsnClient::SetRegisterReceivedCallback(RegisterReceivedCallbackFunc aCallback, void* aContext)
+{
+    mRegisterReceivedCallback = aCallback;
+    mRegisterReceivedContext = aContext;
+    return OT_ERROR_NONE;
+}
+
+otError MqttsnClient::SetPublishWindowOpenedCallback(PublishWindowOpenedCallbackFunc aCallback, void* aContext)
+{
+    mPublishWindowOpenedCallback = aCallback;
+    mPublishWindowOpenedContext = aContext;
+    return OT_ERROR_NONE;
+}
+
+otError MqttsnClient::SetSessionRestoredCallback(SessionRestoredCallbackFunc aCallback, void* aContext)
+{
+    mSessionRestoredCallback = aCallback;
+    mSessionRestoredContext = aContext;
+    return OT_ERROR_NONE;
+}
+
+otError MqttsnClient::NewMessage(Message **aMessage, const MessageBase &aMqttsnMessage)
+{
+    otError error = OT_ERROR_NONE;
+    Message *message = nullptr;
+
+    VerifyOrExit((message = mSocket.NewMessage(0)) != nullptr, error = OT_ERROR_NO_BUFS);
+    SuccessOrExit(error = aMqttsnMessage.Serialize(*message));
+    *aMessage = message;
 
 exit:
+    if (error != OT_ERROR_NONE && message != nullptr)
+    {
+        message->Free();
+    }
     return error;
 }
 
-otError MqttsnClient::Register(const char* aTopicName, RegisterCallbackFunc aCallback, void* aContext)
+template <typename CallbackType>
+otError MqttsnClient::SendRetainedMessage(Message &aMessage, WaitingMessagesQueue<CallbackType> &aQueue, const MessageMetadata<CallbackType> &aMetadata)
 {
     otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Message* message = nullptr;
-    RegisterMessage registerMessage(0, mMessageId, aTopicName);
-    unsigned char buffer[MAX_PACKET_SIZE];
+    Message* transmission = nullptr;
 
-    // Client state must be active
-    if (mClientState != kStateActive)
-    {
-        error = OT_ERROR_INVALID_STATE;
-        goto exit;
-    }
-
-    // Serialize and send REGISTER message
-    SuccessOrExit(error = registerMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message));
-    // Enqueue message to waiting queue - waiting for REGACK
-    SuccessOrExit(error = mRegisterQueue.EnqueueCopy(*message, message->GetLength(),
-        MessageMetadata<RegisterCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
-            mConfig.GetRetransmissionTimeout() * 1000, aCallback, aContext)));
-    mMessageId++;
+    // Message is kept in waiting queue for retransmissions, only short-lived copy is passed to the stack
+    VerifyOrExit((transmission = aMessage.Clone()) != nullptr, error = OT_ERROR_NO_BUFS);
+    SuccessOrExit(error = SendMessage(*transmission, aMetadata.mDestinationAddress, aMetadata.mDestinationPort));
+    transmission = nullptr;
+    SuccessOrExit(error = aQueue.Enqueue(aMessage, aMetadata));
 
 exit:
+    if (error != OT_ERROR_NONE)
+    {
+        if (transmission)
+        {
+            transmission->Free();
+        }
+        aMessage.Free();
+    }
     return error;
 }
 
-otError MqttsnClient::Publish(const uint8_t* aData, int32_t aLength, Qos aQos, const char* aShortTopicName, PublishCallbackFunc aCallback, void* aContext)
+otError MqttsnClient::SendPublishMessage(Message &aMessage, Qos aQos, uint16_t aMessageId, PublishCallbackFunc aCallback, void* aContext)
 {
     otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Message* message = nullptr;
-    int32_t topicNameLength = strlen(aShortTopicName);
-    PublishMessage publishMessage;
-    // Topic length must be 1 or 2
-    VerifyOrExit(topicNameLength > 0 && topicNameLength <= 2, error = OT_ERROR_INVALID_ARGS);
-    publishMessage = PublishMessage(false, false, aQos, mMessageId, kShortTopicName, 0, aShortTopicName, aData, aLength);
-    unsigned char buffer[MAX_PACKET_SIZE];
 
-    // Client state must be active
-    if (mClientState != kStateActive)
+    if (aQos == Qos::kQos1)
     {
-        error = OT_ERROR_INVALID_STATE;
-        goto exit;
+        // If QoS level 1 send message copy and retain the message in waiting queue - waiting for PUBACK
+        SuccessOrExit(error = SendRetainedMessage(aMessage, mPublishQos1Queue,
+            MessageMetadata<PublishCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), aMessageId, TimerMilli::GetNow(),
+                GetRetransmissionTimeout(), mConfig.GetRetransmissionCount(), aCallback, aContext)));
     }
-
-    // Serialize and send PUBLISH message
-    SuccessOrExit(error = publishMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message));
-    if (aQos == Qos::kQos1)
+    else if (aQos == Qos::kQos2)
     {
-        // If QoS level 1 enqueue message to waiting queue - waiting for PUBACK
-        SuccessOrExit(error = mPublishQos1Queue.EnqueueCopy(*message, message->GetLength(),
-            MessageMetadata<PublishCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
-                mConfig.GetRetransmissionTimeout() * 1000, aCallback, aContext)));
+        // If QoS level 2 send message copy and retain the message in waiting queue - waiting for PUBREC
+        SuccessOrExit(error = SendRetainedMessage(aMessage, mPublishQos2PublishQueue,
+            MessageMetadata<PublishCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), aMessageId, TimerMilli::GetNow(),
+                GetRetransmissionTimeout(), mConfig.GetRetransmissionCount(), aCallback, aContext)));
     }
-    if (aQos == Qos::kQos2)
+    else
     {
-        // If QoS level 1 enqueue message to waiting queue - waiting for PUBREC
-        SuccessOrExit(error = mPublishQos2PublishQueue.EnqueueCopy(*message, message->GetLength(),
-            MessageMetadata<PublishCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
-                mConfig.GetRetransmissionTimeout() * 1000, aCallback, aContext)));
+        SuccessOrExit(error = SendMessage(aMessage));
     }
-    mMessageId++;
 
 exit:
     return error;
 }
 
-otError MqttsnClient::Publish(const uint8_t* aData, int32_t aLength, Qos aQos, TopicId aTopicId, PublishCallbackFunc aCallback, void* aContext)
+void MqttsnClient::HandleTopicRegistered(const char* aTopicName, TopicId aTopicId, ReturnCode aCode)
 {
-    otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Message* message = nullptr;
-    PublishMessage publishMessage(false, false, aQos, mMessageId, kTopicId, aTopicId, "", aData, aLength);
-    unsigned char buffer[MAX_PACKET_SIZE];
+    TopicRegistry::Entry* entry = nullptr;
 
-    // Client state must be active
-    if (mClientState != kStateActive)
+    if (aCode == kCodeAccepted)
     {
-        error = OT_ERROR_INVALID_STATE;
-        goto exit;
+        VerifyOrExit((entry = mTopicRegistry.Add(aTopicName)) != nullptr);
+        entry->SetRegistered(aTopicId);
+        SaveSession(*entry);
+    }
+    else
+    {
+        VerifyOrExit((entry = mTopicRegistry.Find(aTopicName)) != nullptr);
+        entry->SetUnregistered();
     }
+    FlushPendingPublishes(mTopicRegistry.GetIndex(*entry), aCode);
 
-    // Serialize and send PUBLISH message
-    SuccessOrExit(error = publishMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message));
-    if (aQos == Qos::kQos1)
+exit:
+    return;
+}
+
+void MqttsnClient::FlushPendingPublishes(uint8_t aTopicIndex, ReturnCode aCode)
+{
+    Message* message = nullptr;
+
+    // Publishes of accepted topic are sent within in-flight window, the rest is sent when the window opens
+    if (aCode == kCodeAccepted)
     {
-        // If QoS level 1 enqueue message to waiting queue - waiting for PUBACK
-        SuccessOrExit(error = mPublishQos1Queue.EnqueueCopy(*message, message->GetLength(),
-            MessageMetadata<PublishCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
-                mConfig.GetRetransmissionTimeout() * 1000, aCallback, aContext)));
+        SendPendingPublishes();
+        ExitNow();
     }
-    if (aQos == Qos::kQos2)
+
+    message = mPendingPublishQueue.GetHead();
+
+    while (message)
     {
-        // If QoS level 1 enqueue message to waiting queue - waiting for PUBREC
-        SuccessOrExit(error = mPublishQos2PublishQueue.EnqueueCopy(*message, message->GetLength(),
-            MessageMetadata<PublishCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
-                mConfig.GetRetransmissionTimeout() * 1000, aCallback, aContext)));
+        Message* current = message;
+        PendingPublish pending;
+        message = message->GetNext();
+
+        current->Read(current->GetLength() - sizeof(pending), sizeof(pending), &pending);
+        if (aTopicIndex != kAllTopics && pending.mTopicIndex != aTopicIndex)
+        {
+            continue;
+        }
+        mPendingPublishQueue.Dequeue(*current);
+        mPendingPublishCount--;
+        current->Free();
+
+        if (pending.mCallback)
+        {
+            pending.mCallback(aCode, pending.mContext);
+        }
     }
-    mMessageId++;
 
 exit:
-    return error;
+    return;
 }
 
-otError MqttsnClient::PublishQosm1(const uint8_t* aData, int32_t aLength, const char* aShortTopicName, Ip6::Address aAddress, uint16_t aPort)
+void MqttsnClient::SendPendingPublishes()
 {
-    otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Message* message = nullptr;
-    PublishMessage publishMessage;
-    int32_t topicNameLength = strlen(aShortTopicName);
-    VerifyOrExit(topicNameLength > 0 && topicNameLength <= 2, error = OT_ERROR_INVALID_ARGS);
-    publishMessage = PublishMessage(false, false, Qos::kQosm1, mMessageId, kShortTopicName, 0, aShortTopicName, aData, aLength);
-    unsigned char buffer[MAX_PACKET_SIZE];
+    Message* message = mPendingPublishQueue.GetHead();
 
-    // Serialize and send PUBLISH message
-    SuccessOrExit(error = publishMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message, aAddress, aPort));
-    mMessageId++;
+    while (message)
+    {
+        Message* current = message;
+        PendingPublish pending;
+        TopicRegistry::Entry* entry = nullptr;
+        otError error = OT_ERROR_NONE;
+        message = message->GetNext();
 
-exit:
-    return error;
+        current->Read(current->GetLength() - sizeof(pending), sizeof(pending), &pending);
+        entry = mTopicRegistry.GetEntry(pending.mTopicIndex);
+        // Queued publishes are admitted to in-flight window the same way as direct publishes
+        if (entry == nullptr || !entry->IsRegistered() || IsPublishWindowFull(pending.mQos))
+        {
+            continue;
+        }
+        mPendingPublishQueue.Dequeue(*current);
+        mPendingPublishCount--;
+        current->SetLength(current->GetLength() - sizeof(pending));
+
+        if ((error = PublishMessage::UpdateTopicId(*current, entry->GetTopicId())) != OT_ERROR_NONE)
+        {
+            current->Free();
+        }
+        else
+        {
+            // Message is freed by failed send
+            error = SendPublishMessage(*current, pending.mQos, pending.mMessageId, pending.mCallback,
+                pending.mContext);
+        }
+
+        // Report failure as local congestion
+        if (error != OT_ERROR_NONE && pending.mCallback)
+        {
+            pending.mCallback(kCodeRejectedCongestion, pending.mContext);
+        }
+    }
 }
 
-otError MqttsnClient::PublishQosm1(const uint8_t* aData, int32_t aLength, TopicId aTopicId, Ip6::Address aAddress, uint16_t aPort)
+uint16_t MqttsnClient::ReadRetainedMessage(const Message &aMessage, uint16_t aMetadataLength, uint8_t* aBuffer)
 {
-    otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Message* message = nullptr;
-    PublishMessage publishMessage(false, false, Qos::kQosm1, mMessageId, kTopicId, aTopicId, "", aData, aLength);
-    unsigned char buffer[MAX_PACKET_SIZE];
+    uint16_t length = aMessage.GetLength() - aMetadataLength;
 
-    // Serialize and send PUBLISH message
-    SuccessOrExit(error = publishMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message, aAddress, aPort));
-    mMessageId++;
+    if (length > MAX_CONTROL_PACKET_SIZE || aMessage.Read(0, length, aBuffer) != length)
+    {
+        return 0;
+    }
+    return length;
+}
 
-exit:
-    return error;
+void MqttsnClient::GetSessionBinding(SessionStore::Binding &aBinding)
+{
+    const char* clientId = mConfig.GetClientId().AsCString();
+    size_t length = OT_MIN(strlen(clientId), sizeof(aBinding.mClientId) - 1);
+
+    memset(&aBinding, 0, sizeof(aBinding));
+    memcpy(aBinding.mAddress, &mConfig.GetAddress(), sizeof(aBinding.mAddress));
+    aBinding.mPort = mConfig.GetPort();
+    memcpy(aBinding.mClientId, clientId, length);
+    aBinding.mClientId[length] = '\0';
 }
 
-otError MqttsnClient::Unsubscribe(const char* aShortTopicName, UnsubscribeCallbackFunc aCallback, void* aContext)
+void MqttsnClient::SaveSession(const TopicRegistry::Entry &aEntry)
 {
     otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Message* message = nullptr;
-    int32_t topicNameLength = strlen(aShortTopicName);
-    UnsubscribeMessage unsubscribeMessage;
-    // Topic length must be 1 or 2
-    VerifyOrExit(topicNameLength > 0 && topicNameLength <= 2, error = OT_ERROR_INVALID_ARGS);
-    unsubscribeMessage = UnsubscribeMessage(mMessageId, kShortTopicName, 0, aShortTopicName);
-    unsigned char buffer[MAX_PACKET_SIZE];
+    SessionStore::Binding binding;
 
-    // Client state must be active
-    if (mClientState != kStateActive)
+    // Session with clean flag is not persistent
+    VerifyOrExit(!mConfig.GetCleanSession());
+
+    GetSessionBinding(binding);
+    error = mSessionStore.Save(binding, aEntry);
+
+exit:
+    if (error != OT_ERROR_NONE)
     {
-        error = OT_ERROR_INVALID_STATE;
-        goto exit;
+        MQTTSN_LOG("Session store failed with error: %d\r\n", error);
     }
+}
 
-    // Serialize and send UNSUBSCRIBE message
-    SuccessOrExit(error = unsubscribeMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message));
-    // Enqueue message to waiting queue - waiting for UNSUBACK
-    SuccessOrExit(error = mUnsubscribeQueue.EnqueueCopy(*message, message->GetLength(),
-        MessageMetadata<UnsubscribeCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
-            mConfig.GetRetransmissionTimeout() * 1000, aCallback, aContext)));
-    mMessageId++;
+otError MqttsnClient::RestoreSession(void)
+{
+    SessionStore::Binding binding;
 
-exit:
-    return error;
+    GetSessionBinding(binding);
+    return mSessionStore.Restore(binding, mTopicRegistry);
 }
 
-otError MqttsnClient::Unsubscribe(TopicId aTopicId, UnsubscribeCallbackFunc aCallback, void* aContext)
+void MqttsnClient::DeleteSession(void)
 {
-    otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Message* message = nullptr;
-    UnsubscribeMessage unsubscribeMessage(mMessageId, kTopicId, aTopicId, "");
-    unsigned char buffer[MAX_PACKET_SIZE];
+    mSessionStore.Delete();
+}
 
-    // Client state must be active
-    if (mClientState != kStateActive)
+void MqttsnClient::StartSessionRestore(void)
+{
+    mSessionRestoreActive = true;
+    mSessionRestoreIndex = 0;
+    mSessionRestoreInFlight = 0;
+    mSessionRestoreMessages = 0;
+    mSessionRestoreCode = kCodeAccepted;
+    ContinueSessionRestore();
+}
+
+void MqttsnClient::ContinueSessionRestore(void)
+{
+    uint8_t limit = mConfig.GetMaxInFlightQos1();
+
+    VerifyOrExit(mSessionRestoreActive);
+
+    // Requests are not serialized, all of them are sent without waiting for acknowledgement up to the limit
+    while (mSessionRestoreIndex < mTopicRegistry.GetCount() && (limit == 0 || mSessionRestoreInFlight < limit))
     {
-        error = OT_ERROR_INVALID_STATE;
-        goto exit;
+        TopicRegistry::Entry* entry = mTopicRegistry.GetEntry(mSessionRestoreIndex++);
+        otError error = OT_ERROR_NONE;
+
+        mSessionRestoreInFlight++;
+        // SUBACK of long topic name carries topic ID too, separate REGISTER is not needed
+        if (entry->IsRestoreSubscription())
+        {
+            error = Subscribe(entry->GetName(), false, entry->GetSubscribeQos(), HandleSessionRestoreSubscribed, this);
+        }
+        else if (entry->IsRestoreRegistration())
+        {
+            error = Register(entry->GetName(), HandleSessionRestoreRegistered, this);
+        }
+        else
+        {
+            mSessionRestoreInFlight--;
+            continue;
+        }
+
+        if (error == OT_ERROR_NONE)
+        {
+            mSessionRestoreMessages++;
+        }
+        else
+        {
+            mSessionRestoreInFlight--;
+            mSessionRestoreCode = kCodeRejectedCongestion;
+        }
     }
 
-    // Serialize and send UNSUBSCRIBE message
-    SuccessOrExit(error = unsubscribeMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message));
-    // Enqueue message to waiting queue - waiting for UNSUBACK
-    SuccessOrExit(error = mUnsubscribeQueue.EnqueueCopy(*message, message->GetLength(),
-        MessageMetadata<UnsubscribeCallbackFunc>(mConfig.GetAddress(), mConfig.GetPort(), mMessageId, TimerMilli::GetNow(),
-            mConfig.GetRetransmissionTimeout() * 1000, aCallback, aContext)));
-    mMessageId++;
+    if (mSessionRestoreInFlight == 0 && mSessionRestoreIndex >= mTopicRegistry.GetCount())
+    {
+        FinishSessionRestore(mSessionRestoreCode);
+    }
 
 exit:
-    return error;
+    return;
 }
 
-otError MqttsnClient::Disconnect()
+void MqttsnClient::FinishSessionRestore(ReturnCode aCode)
 {
-    otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Message* message = nullptr;
-    DisconnectMessage disconnectMessage(0);
-    unsigned char buffer[MAX_PACKET_SIZE];
-
-    // Client must be connected
-    if (mClientState != kStateActive && mClientState != kStateAwake
-        && mClientState != kStateAsleep)
+    mSessionRestoreActive = false;
+    mSessionRestoreTime = TimerMilli::GetNow() - mConnectTime;
+    MQTTSN_LOG("Session restore finished in %lu ms, messages: %u, code: %d\r\n",
+        static_cast<unsigned long>(mSessionRestoreTime), mSessionRestoreMessages, aCode);
+    if (mSessionRestoredCallback)
     {
-        error = OT_ERROR_INVALID_STATE;
-        goto exit;
+        mSessionRestoredCallback(aCode, mSessionRestoreTime, mSessionRestoredContext);
     }
+}
 
-    // Serialize and send DISCONNECT message
-    SuccessOrExit(error = disconnectMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message));
+void MqttsnClient::HandleSessionRestoreResponse(ReturnCode aCode)
+{
+    VerifyOrExit(mSessionRestoreActive && mSessionRestoreInFlight > 0);
 
-    // Set flag for regular disconnect request and wait for DISCONNECT message from gateway
-    mDisconnectRequested = true;
-    // Set timeout time
-    mGwTimeout = TimerMilli::GetNow() + mConfig.GetRetransmissionTimeout() * 1000;
+    mSessionRestoreInFlight--;
+    if (aCode != kCodeAccepted)
+    {
+        mSessionRestoreCode = aCode;
+    }
+    ContinueSessionRestore();
 
 exit:
-    return error;
+    return;
 }
 
-otError MqttsnClient::Sleep(uint16_t aDuration)
+otError MqttsnClient::StartBatch(uint8_t aType, const char* const* aTopicNames, uint8_t aCount, Qos aQos,
+    BatchCallbackFunc aCallback, void* aContext)
 {
     otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Message* message = nullptr;
-    DisconnectMessage disconnectMessage(aDuration);
-    unsigned char buffer[MAX_PACKET_SIZE];
+    uint8_t topicIndexes[kMaxBatchTopics];
 
-    // Client must be connected
-    if (mClientState != kStateActive && mClientState != kStateAwake && mClientState != kStateAsleep)
+    static_assert(kMaxBatchTopics <= sizeof(mBatch.mPendingMask) * 8, "Batch pending mask is too small");
+
+    // Client state must be active
+    VerifyOrExit(mClientState == kStateActive, error = OT_ERROR_INVALID_STATE);
+    VerifyOrExit(!mBatchActive, error = OT_ERROR_BUSY);
+    VerifyOrExit(aTopicNames != nullptr && aCount > 0 && aCount <= kMaxBatchTopics, error = OT_ERROR_INVALID_ARGS);
+
+    // Topic names are interned in registry so that the messages can be serialized again for retransmission
+    for (uint8_t i = 0; i < aCount; i++)
     {
-        error = OT_ERROR_INVALID_STATE;
-        goto exit;
+        TopicRegistry::Entry* entry = nullptr;
+        size_t length = (aTopicNames[i] != nullptr) ? strlen(aTopicNames[i]) : 0;
+
+        VerifyOrExit(length > 0 && length < kMaxTopicNameLength, error = OT_ERROR_INVALID_ARGS);
+        VerifyOrExit((entry = mTopicRegistry.Add(aTopicNames[i])) != nullptr, error = OT_ERROR_NO_BUFS);
+        topicIndexes[i] = mTopicRegistry.GetIndex(*entry);
     }
 
-    // Serialize and send DISCONNECT message
-    SuccessOrExit(error = disconnectMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message));
+    mBatch.mType = aType;
+    mBatch.mQos = aQos;
+    mBatch.mCount = aCount;
+    mBatch.mRetransmissionCount = mConfig.GetRetransmissionCount();
+    mBatch.mRetransmitted = false;
+    mBatch.mPendingMask = 0;
+    mBatch.mCallback = aCallback;
+    mBatch.mContext = aContext;
+    for (uint8_t i = 0; i < aCount; i++)
+    {
+        TopicRegistry::Entry* entry = mTopicRegistry.GetEntry(topicIndexes[i]);
+        TopicResult &result = mBatch.mResults[i];
 
-    // Set flag for sleep request and wait for DISCONNECT message from gateway
-    mSleepRequested = true;
-    // Set timeout time
-    mGwTimeout = TimerMilli::GetNow() + mConfig.GetRetransmissionTimeout() * 1000;
+        mBatch.mTopicIndexes[i] = topicIndexes[i];
+        result.mCode = kCodeAccepted;
+        result.mTopicId = entry->GetTopicId();
+        result.mQos = (aType == kTypeSubscribe) ? entry->GetSubscribeQos() : kQos0;
+
+        // Topic known in current session is not requested again
+        if ((aType == kTypeRegister && entry->IsRegistered())
+            || (aType == kTypeSubscribe && entry->IsSubscribed() && entry->GetSubscribeQos() == aQos))
+        {
+            continue;
+        }
+        mBatch.mMessageIds[i] = mMessageId++;
+        mBatch.mPendingMask |= 1UL << i;
+    }
+    mBatchActive = true;
+
+    // All requests are sent back-to-back, acknowledgements are matched by message ID
+    mBatch.mTimestamp = TimerMilli::GetNow();
+    mBatch.mRetransmissionTimeout = GetRetransmissionTimeout();
+    SendBatchRequests(false);
+    FinishBatch();
+    UpdateProcessTimer();
 
 exit:
     return error;
 }
 
-otError MqttsnClient::Awake(uint32_t aTimeout)
+void MqttsnClient::SendBatchRequests(bool aDupFlag)
 {
-    otError error = OT_ERROR_NONE;
-    // Awake is possible only when the client is in
-    if (mClientState != kStateAwake && mClientState != kStateAsleep)
+    for (uint8_t i = 0; i < mBatch.mCount; i++)
     {
-        error = OT_ERROR_INVALID_STATE;
-        goto exit;
-    }
+        TopicRegistry::Entry* entry = mTopicRegistry.GetEntry(mBatch.mTopicIndexes[i]);
+        Message* message = nullptr;
+        otError error = OT_ERROR_NONE;
 
-    // Send PINGEQ message
-    SuccessOrExit(error = PingGateway());
+        if ((mBatch.mPendingMask & (1UL << i)) == 0)
+        {
+            continue;
+        }
 
-    // Set awake state and wait for any PUBLISH messages
-    mClientState = kStateAwake;
-    // Set timeout time - PINGRESP message must be delivered within this time
-    mGwTimeout = TimerMilli::GetNow() + aTimeout;
-exit:
-    return error;
+        if (mBatch.mType == kTypeSubscribe)
+        {
+            SubscribeMessage subscribeMessage(aDupFlag, mBatch.mQos, mBatch.mMessageIds[i], kTopicName, 0, "",
+                entry->GetName());
+            error = NewMessage(&message, subscribeMessage);
+        }
+        else
+        {
+            RegisterMessage registerMessage(0, mBatch.mMessageIds[i], entry->GetName());
+            error = NewMessage(&message, registerMessage);
+        }
+        if (error == OT_ERROR_NONE)
+        {
+            error = SendMessage(*message);
+        }
+
+        if (error != OT_ERROR_NONE)
+        {
+            // Report local send failure as congestion
+            mBatch.mPendingMask &= ~(1UL << i);
+            mBatch.mResults[i].mCode = kCodeRejectedCongestion;
+        }
+    }
 }
 
-otError MqttsnClient::SearchGateway(const Ip6::Address &aMulticastAddress, uint16_t aPort, uint8_t aRadius)
+bool MqttsnClient::HandleBatchAcknowledgement(uint16_t aMessageId, ReturnCode aCode, TopicId aTopicId, Qos aQos)
 {
-    otError error = OT_ERROR_NONE;
-    int32_t length = -1;
-    Message* message = nullptr;
-    SearchGwMessage searchGwMessage(aRadius);
-    unsigned char buffer[MAX_PACKET_SIZE];
+    TopicRegistry::Entry* entry = nullptr;
+    uint8_t index = 0;
 
-    // Serialize and send SEARCHGW message
-    SuccessOrExit(error = searchGwMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
-    SuccessOrExit(error = SendMessage(*message, aMulticastAddress, aPort, aRadius));
+    VerifyOrExit(mBatchActive);
+    while (index < mBatch.mCount
+        && ((mBatch.mPendingMask & (1UL << index)) == 0 || mBatch.mMessageIds[index] != aMessageId))
+    {
+        index++;
+    }
+    VerifyOrExit(index < mBatch.mCount);
+
+    HandleAcknowledgement(mBatch.mTimestamp, mBatch.mRetransmitted, aCode);
+    mBatch.mPendingMask &= ~(1UL << index);
+    mBatch.mResults[index].mCode = aCode;
+    entry = mTopicRegistry.GetEntry(mBatch.mTopicIndexes[index]);
+
+    if (mBatch.mType == kTypeRegister)
+    {
+        mBatch.mResults[index].mTopicId = (aCode == kCodeAccepted) ? aTopicId : 0;
+        HandleTopicRegistered(entry->GetName(), aTopicId, aCode);
+    }
+    else if (aCode == kCodeAccepted)
+    {
+        // Topic ID is zero for wildcard topics
+        if (aTopicId != 0)
+        {
+            entry->SetRegistered(aTopicId);
+        }
+        entry->SetSubscribed(aQos);
+        SaveSession(*entry);
+        mBatch.mResults[index].mTopicId = aTopicId;
+        mBatch.mResults[index].mQos = aQos;
+    }
+
+    FinishBatch();
+    return true;
 
 exit:
-    return error;
+    return false;
 }
 
-ClientState MqttsnClient::GetState()
+void MqttsnClient::HandleBatchDeadline(uint32_t aNow)
 {
-    return mClientState;
-}
+    VerifyOrExit(mBatchActive);
+    VerifyOrExit(!WaitingMessagesIndex::IsBefore(aNow, mBatch.mTimestamp + mBatch.mRetransmissionTimeout));
 
-otError MqttsnClient::SetConnectedCallback(ConnectedCallbackFunc aCallback, void* aContext)
-{
-    mConnectedCallback = aCallback;
-    mConnectContext = aContext;
-    return OT_ERROR_NONE;
+    if (mBatch.mRetransmissionCount == 0)
+    {
+        mTimeoutRaised = true;
+        AbortBatch(kCodeTimeout);
+        ExitNow();
+    }
+
+    // Retransmit unacknowledged requests together and double the timeout (exponential backoff)
+    mBatch.mRetransmissionCount--;
+    mBatch.mRetransmitted = true;
+    mBatch.mTimestamp = aNow;
+    mBatch.mRetransmissionTimeout *= 2;
+    DecreaseCongestionWindow();
+    MQTTSN_LOG("Retransmitting batch requests\r\n");
+    SendBatchRequests(true);
+    FinishBatch();
+
+exit:
+    return;
 }
 
-otError MqttsnClient::SetPublishReceivedCallback(PublishReceivedCallbackFunc aCallback, void* aContext)
+void MqttsnClient::AbortBatch(ReturnCode aCode)
 {
-    mPublishReceivedCallback = aCallback;
-    mPublishReceivedContext = aContext;
-    return OT_ERROR_NONE;
+    for (uint8_t i = 0; i < mBatch.mCount; i++)
+    {
+        if (mBatch.mPendingMask & (1UL << i))
+        {
+            mBatch.mResults[i].mCode = aCode;
+            mBatch.mResults[i].mTopicId = 0;
+        }
+    }
+    mBatch.mPendingMask = 0;
+    FinishBatch();
 }
 
-otError MqttsnClient::SetAdvertiseCallback(AdvertiseCallbackFunc aCallback, void* aContext)
+void MqttsnClient::FinishBatch(void)
 {
-    mAdvertiseCallback = aCallback;
-    mAdvertiseContext = aContext;
-    return OT_ERROR_NONE;
+    VerifyOrExit(mBatchActive && mBatch.mPendingMask == 0);
+
+    mBatchActive = false;
+    if (mBatch.mCallback)
+    {
+        mBatch.mCallback(mBatch.mResults, mBatch.mCount, mBatch.mContext);
+    }
+
+exit:
+    return;
 }
 
-otError MqttsnClient::SetSearchGwCallback(SearchGwCallbackFunc aCallback, void* aContext)
+void MqttsnClient::AddGatewayRttSample(const Ip6::Address &aAddress, uint16_t aPort, uint32_t aRtt)
 {
-    mSearchGwCallback = aCallback;
-    mSearchGwContext = aContext;
-    return OT_ERROR_NONE;
+    GatewayTable::Entry* entry = mGatewayTable.Find(aAddress, aPort);
+
+    if (entry != nullptr)
+    {
+        mGatewayTable.AddRttSample(*entry, aRtt);
+    }
 }
 
-otError MqttsnClient::SetDisconnectedCallback(DisconnectedCallbackFunc aCallback, void* aContext)
+otError MqttsnClient::FailoverGateway()
 {
-    mDisconnectedCallback = aCallback;
-    mDisconnectedContext = aContext;
-    return OT_ERROR_NONE;
+    otError error = OT_ERROR_NONE;
+    GatewayTable::Entry* entry = mGatewayTable.Find(mConfig.GetAddress(), mConfig.GetPort());
+
+    VerifyOrExit(mGatewayFailover, error = OT_ERROR_NOT_FOUND);
+    if (entry != nullptr)
+    {
+        entry->SetFailed();
+    }
+    VerifyOrExit(mGatewayTable.GetBest(TimerMilli::GetNow()) != nullptr, error = OT_ERROR_NOT_FOUND);
+
+    // Clients of the lost gateway fail over at the same moment, random delay spreads their CONNECT messages
+    mFailoverTime = TimerMilli::GetNow() + NextReconnectDelay();
+    mFailoverPending = true;
+    MQTTSN_LOG("Gateway lost, connecting to next gateway in %lu ms\r\n",
+        static_cast<unsigned long>(mFailoverTime - TimerMilli::GetNow()));
+
+exit:
+    return error;
 }
 
-otError MqttsnClient::SetRegisterReceivedCallback(RegisterReceivedCallbackFunc aCallback, void* aContext)
+void MqttsnClient::HandleFailoverDeadline(uint32_t aNow)
 {
-    mRegisterReceivedCallback = aCallback;
-    mRegisterReceivedContext = aContext;
-    return OT_ERROR_NONE;
+    MqttsnConfig config = mConfig;
+
+    VerifyOrExit(mFailoverPending);
+    VerifyOrExit(!WaitingMessagesIndex::IsBefore(aNow, mFailoverTime));
+    mFailoverPending = false;
+
+    // Gateway may expire during the delay, the loss is reported when no gateway is left
+    if (ConnectBestGateway(config) != OT_ERROR_NONE && mDisconnectedCallback)
+    {
+        mDisconnectedCallback(kTimeout, mDisconnectedContext);
+    }
+
+exit:
+    return;
 }
 
-otError MqttsnClient::NewMessage(Message **aMessage, unsigned char* aBuffer, int32_t aLength)
+void MqttsnClient::HandleSearchGwDeadline(uint32_t aNow)
 {
-    otError error = OT_ERROR_NONE;
-    Message *message = nullptr;
+    uint8_t radius;
 
-    VerifyOrExit((message = mSocket.NewMessage(0)) != nullptr, error = OT_ERROR_NO_BUFS);
-    SuccessOrExit(error = message->Append(aBuffer, aLength));
-    *aMessage = message;
+    VerifyOrExit(mSearchGwRingActive);
+    VerifyOrExit(!WaitingMessagesIndex::IsBefore(aNow, mSearchGwRingDeadline));
+
+    // Ring is not expanded when a gateway answered or it was heard during random delay
+    if (mSearchGwRingAnswered || mSearchGwRingRadius >= mSearchGwRingMaxRadius)
+    {
+        FinishSearchGwRing();
+        ExitNow();
+    }
+
+    radius = (mSearchGwRingRadius == 0) ? 1 : OT_MIN(mSearchGwRingRadius * 2, mSearchGwRingMaxRadius);
+    if (SearchGateway(mSearchGwRingAddress, mSearchGwPort, radius) != OT_ERROR_NONE)
+    {
+        FinishSearchGwRing();
+        ExitNow();
+    }
+    mSearchGwRingRadius = radius;
+    mSearchGwRingDeadline = aNow + kSearchGwRingTimeout * radius;
 
 exit:
-    if (error != OT_ERROR_NONE && message != nullptr)
+    return;
+}
+
+void MqttsnClient::FinishSearchGwRing(void)
+{
+    mSearchGwRingActive = false;
+    if (mSearchGwFinishedCallback)
     {
-        message->Free();
+        mSearchGwFinishedCallback(mGatewayTable.GetBest(TimerMilli::GetNow()), mSearchGwFinishedContext);
     }
-    return error;
 }
 
 otError MqttsnClient::SendMessage(Message &aMessage)
@@ -1452,17 +3128,25 @@ otError MqttsnClient::SendMessage(Message &aMessage, const Ip6::Address &aAddres
     messageInfo.SetPeerPort(aPort);
     messageInfo.SetInterfaceId(OT_NETIF_INTERFACE_ID_THREAD);
 
-    PRINTF("Sending message to %s[:%u]\r\n", messageInfo.GetPeerAddr().ToString().AsCString(), messageInfo.GetPeerPort());
     SuccessOrExit(error = mSocket.SendTo(aMessage, messageInfo));
 
+    mLastSendTime = TimerMilli::GetNow();
     if (mClientState == kStateActive)
     {
-        mPingReqTime = TimerMilli::GetNow() + mConfig.GetKeepAlive() * 700;
+        CountSavedPingreqs(mLastSendTime);
+        mPingReqTime = mLastSendTime + GetKeepAliveInterval();
+        if (mFixedPingReqTime != 0)
+        {
+            mFixedPingReqTime = mLastSendTime + mConfig.GetKeepAlive() * kKeepAlivePingTime;
+        }
     }
 
 exit:
     if (error != OT_ERROR_NONE)
     {
+        // Peer address is formatted only on failure, sent messages are not logged
+        MQTTSN_LOG("Sending message to %s[:%u] failed with error: %d\r\n",
+            messageInfo.GetPeerAddr().ToString().AsCString(), messageInfo.GetPeerPort(), error);
         aMessage.Free();
     }
     return error;
@@ -1471,10 +3155,8 @@ exit:
 otError MqttsnClient::PingGateway()
 {
     otError error = OT_ERROR_NONE;
-    int32_t length = -1;
     Message* message = nullptr;
     PingreqMessage pingreqMessage(mConfig.GetClientId().AsCString());
-    unsigned char buffer[MAX_PACKET_SIZE];
 
     if (mClientState != kStateActive && mClientState != kStateAwake)
     {
@@ -1483,8 +3165,7 @@ otError MqttsnClient::PingGateway()
     }
 
     // Serialize and send PINGREQ message
-    SuccessOrExit(error = pingreqMessage.Serialize(buffer, MAX_PACKET_SIZE, &length));
-    SuccessOrExit(error = NewMessage(&message, buffer, length));
+    SuccessOrExit(error = NewMessage(&message, pingreqMessage));
     SuccessOrExit(error = SendMessage(*message));
 
 exit:
@@ -1495,16 +3176,296 @@ void MqttsnClient::OnDisconnected()
 {
     mDisconnectRequested = false;
     mSleepRequested = false;
-    mTimeoutRaised = false;
     mGwTimeout = 0;
     mPingReqTime = 0;
+    mPingreqOutstanding = false;
+    // Keepalive statistics are collected only while connected
+    if (mFixedPingReqTime != 0)
+    {
+        CountSavedPingreqs(TimerMilli::GetNow());
+        mKeepAliveDuration += TimerMilli::GetNow() - mKeepAliveStartTime;
+        mFixedPingReqTime = 0;
+    }
+    // Publishing is not possible until the client connects again
+    mPublishQos1WindowFull = false;
+    mPublishQos2WindowFull = false;
+    // Path to the next gateway may differ, congestion control starts again
+    mCongestionWindow = kCongestionWindowInitial;
+    mCongestionAckCount = 0;
+    mCongestionRecoveryEnd = 0;
+    // Keep round trip time measured during the connection for gateway selection
+    if (mRttSamples > 0)
+    {
+        AddGatewayRttSample(mConfig.GetAddress(), mConfig.GetPort(), mSmoothedRtt);
+    }
+    mSmoothedRtt = 0;
+    mRttVariation = 0;
+    mRttSamples = 0;
+    // Restore requests time out together with other waiting messages, completion is reported once
+    bool sessionRestoreActive = mSessionRestoreActive;
+    mSessionRestoreActive = false;
 
     mSubscribeQueue.ForceTimeout();
     mRegisterQueue.ForceTimeout();
+    // Publishes waiting for registration time out together with the REGISTER messages
+    FlushPendingPublishes(kAllTopics, kCodeTimeout);
+    mTopicRegistry.CancelRegistrations();
     mUnsubscribeQueue.ForceTimeout();
     mPublishQos1Queue.ForceTimeout();
     mPublishQos2PublishQueue.ForceTimeout();
     mPublishQos2PubrelQueue.ForceTimeout();
+
+    if (mBatchActive)
+    {
+        AbortBatch(kCodeTimeout);
+    }
+
+    if (sessionRestoreActive)
+    {
+        FinishSessionRestore(kCodeTimeout);
+    }
+
+    // Timeout handlers of forced timeouts raise the flag again, it must not mark the next connection lost
+    mTimeoutRaised = false;
+}
+
+bool MqttsnClient::IsPublishWindowFull(Qos aQos)
+{
+    // QoS level 2 message is in flight until PUBCOMP is received
+    uint16_t qos1InFlight = mPublishQos1Queue.GetCount();
+    uint16_t qos2InFlight = mPublishQos2PublishQueue.GetCount() + mPublishQos2PubrelQueue.GetCount();
+    bool isFull = false;
+
+    if (aQos == kQos1)
+    {
+        isFull = mConfig.GetMaxInFlightQos1() != 0 && qos1InFlight >= mConfig.GetMaxInFlightQos1();
+    }
+    else if (aQos == kQos2)
+    {
+        isFull = mConfig.GetMaxInFlightQos2() != 0 && qos2InFlight >= mConfig.GetMaxInFlightQos2();
+    }
+    else
+    {
+        // QoS level 0 and -1 messages are not acknowledged and never wait
+        goto exit;
+    }
+    isFull = isFull || qos1InFlight + qos2InFlight >= mCongestionWindow;
+
+exit:
+    return isFull;
+}
+
+otError MqttsnClient::CheckPublishWindow(Qos aQos)
+{
+    otError error = OT_ERROR_NONE;
+
+    VerifyOrExit(IsPublishWindowFull(aQos));
+    if (aQos == kQos1)
+    {
+        mPublishQos1WindowFull = true;
+    }
+    else
+    {
+        mPublishQos2WindowFull = true;
+    }
+    error = OT_ERROR_BUSY;
+
+exit:
+    return error;
+}
+
+void MqttsnClient::NotifyPublishWindow()
+{
+    // Publishes waiting for the window since their topic was registered go first
+    if (mPendingPublishCount > 0)
+    {
+        SendPendingPublishes();
+    }
+
+    // Flags are cleared before the callback so it can publish and fill the window again
+    if (mPublishQos1WindowFull && !IsPublishWindowFull(kQos1))
+    {
+        mPublishQos1WindowFull = false;
+        if (mPublishWindowOpenedCallback)
+        {
+            mPublishWindowOpenedCallback(kQos1, mPublishWindowOpenedContext);
+        }
+    }
+    if (mPublishQos2WindowFull && !IsPublishWindowFull(kQos2))
+    {
+        mPublishQos2WindowFull = false;
+        if (mPublishWindowOpenedCallback)
+        {
+            mPublishWindowOpenedCallback(kQos2, mPublishWindowOpenedContext);
+        }
+    }
+}
+
+void MqttsnClient::HandleAcknowledgement(uint32_t aTimestamp, bool aRetransmitted, ReturnCode aCode)
+{
+    if (aCode == kCodeRejectedCongestion)
+    {
+        mCongestionRejections++;
+        DecreaseCongestionWindow();
+        ExitNow();
+    }
+
+    // Acknowledgement of retransmitted message is ambiguous, it is not used for measurement (Karn's algorithm)
+    VerifyOrExit(!aRetransmitted);
+
+    {
+        uint32_t rtt = TimerMilli::GetNow() - aTimestamp;
+        if (mRttSamples == 0)
+        {
+            // First measurement replaces estimate seeded from route cost
+            mSmoothedRtt = rtt;
+            mRttVariation = rtt / 2;
+        }
+        else
+        {
+            // Jacobson/Karels: RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - RTT|, SRTT = 7/8 SRTT + 1/8 RTT
+            uint32_t delta = (mSmoothedRtt > rtt) ? mSmoothedRtt - rtt : rtt - mSmoothedRtt;
+            mRttVariation = mRttVariation - mRttVariation / 4 + delta / 4;
+            mSmoothedRtt = mSmoothedRtt - mSmoothedRtt / 8 + rtt / 8;
+        }
+        mRttSamples++;
+    }
+
+    // Additive increase, the window grows by one message per window of timely acknowledgements
+    if (++mCongestionAckCount >= mCongestionWindow)
+    {
+        mCongestionAckCount = 0;
+        if (mCongestionWindow < kCongestionWindowMax)
+        {
+            mCongestionWindow++;
+        }
+    }
+
+exit:
+    return;
+}
+
+void MqttsnClient::DecreaseCongestionWindow()
+{
+    uint32_t now = TimerMilli::GetNow();
+
+    // Losses of messages sent before previous reduction belong to the same congestion event
+    VerifyOrExit(mCongestionRecoveryEnd == 0 || !WaitingMessagesIndex::IsBefore(now, mCongestionRecoveryEnd));
+
+    // Multiplicative decrease
+    mCongestionWindow = OT_MAX(mCongestionWindow / 2, 1);
+    mCongestionAckCount = 0;
+    mCongestionEvents++;
+    mCongestionRecoveryEnd = now + ((mSmoothedRtt != 0) ? mSmoothedRtt : GetEstimatedTimeout());
+    // Zero is reserved for no recovery period
+    if (mCongestionRecoveryEnd == 0)
+    {
+        mCongestionRecoveryEnd = 1;
+    }
+
+exit:
+    return;
+}
+
+void MqttsnClient::GetStats(ClientStats &aStats)
+{
+    aStats.mCongestionWindow = mCongestionWindow;
+    aStats.mSmoothedRtt = mSmoothedRtt;
+    aStats.mRttVariation = mRttVariation;
+    aStats.mRetransmissionTimeout = GetEstimatedTimeout();
+    aStats.mRttSamples = mRttSamples;
+    aStats.mCongestionEvents = mCongestionEvents;
+    aStats.mCongestionRejections = mCongestionRejections;
+    aStats.mSessionRestoreTime = mSessionRestoreTime;
+    aStats.mSessionRestoreMessages = mSessionRestoreMessages;
+
+    uint32_t duration = mKeepAliveDuration;
+    if (mFixedPingReqTime != 0)
+    {
+        CountSavedPingreqs(TimerMilli::GetNow());
+        duration += TimerMilli::GetNow() - mKeepAliveStartTime;
+    }
+    aStats.mPingreqSent = mPingreqSent;
+    aStats.mPingreqSaved = (mPingreqFixed > mPingreqSent) ? mPingreqFixed - mPingreqSent : 0;
+    aStats.mPingreqSavedPerHour = (duration > 0)
+        ? static_cast<uint32_t>(static_cast<uint64_t>(aStats.mPingreqSaved) * 3600000 / duration) : 0;
+}
+
+void MqttsnClient::UpdateFastPolling(bool aOutstanding)
+{
+    DataPollManager &pollManager = GetInstance().GetThreadNetif().GetMeshForwarder().GetDataPollManager();
+
+    if (aOutstanding && !mFastPolling)
+    {
+        // Only sleepy end device receives messages by data polls
+        VerifyOrExit(mConfig.GetFastPollPeriod() != 0 && !otThreadGetLinkMode(&GetInstance()).mRxOnWhenIdle);
+        mSlowPollPeriod = pollManager.GetExternalPollPeriod();
+        SuccessOrExit(pollManager.SetExternalPollPeriod(mConfig.GetFastPollPeriod()));
+        mFastPolling = true;
+    }
+    else if (!aOutstanding && mFastPolling)
+    {
+        pollManager.SetExternalPollPeriod(mSlowPollPeriod);
+        mFastPolling = false;
+    }
+
+exit:
+    return;
+}
+
+void MqttsnClient::HandleGatewayActivity(uint32_t aValidity)
+{
+    uint32_t pingReqTime = TimerMilli::GetNow() + aValidity;
+    uint32_t pingReqLimit = mLastSendTime + mConfig.GetKeepAlive() * kKeepAlivePingLimit;
+
+    VerifyOrExit(mClientState == kStateActive && mPingReqTime != 0);
+
+    // Gateway answered, sent keepalive PINGREQ does not need PINGRESP anymore. Timeout of requested
+    // disconnection or sleep waits for DISCONNECT message.
+    if (mPingreqOutstanding && !mDisconnectRequested && !mSleepRequested)
+    {
+        mGwTimeout = 0;
+    }
+    mPingreqOutstanding = false;
+    if (WaitingMessagesIndex::IsBefore(pingReqLimit, pingReqTime))
+    {
+        pingReqTime = pingReqLimit;
+    }
+    if (WaitingMessagesIndex::IsBefore(mPingReqTime, pingReqTime))
+    {
+        mPingReqTime = pingReqTime;
+    }
+
+exit:
+    return;
+}
+
+uint32_t MqttsnClient::GetKeepAliveInterval()
+{
+    uint32_t interval = mConfig.GetKeepAlive() * kKeepAlivePingTime;
+    uint32_t jitter = interval / 100 * OT_MIN(mConfig.GetKeepAliveJitter(), 100);
+
+    // PINGREQ is only sent earlier, so the client never exceeds gateway keepalive timeout
+    if (jitter > 0)
+    {
+        interval -= otPlatRandomGet() % (jitter + 1);
+    }
+    return interval;
+}
+
+void MqttsnClient::CountSavedPingreqs(uint32_t aNow)
+{
+    uint32_t interval = mConfig.GetKeepAlive() * kKeepAlivePingTime;
+
+    VerifyOrExit(mFixedPingReqTime != 0 && interval != 0);
+    while (!WaitingMessagesIndex::IsBefore(aNow, mFixedPingReqTime))
+    {
+        mPingreqFixed++;
+        mFixedPingReqTime += interval;
+    }
+
+exit:
+    return;
 }
 
 bool MqttsnClient::VerifyGatewayAddress(const Ip6::MessageInfo &aMessageInfo)
@@ -1513,46 +3474,157 @@ bool MqttsnClient::VerifyGatewayAddress(const Ip6::MessageInfo &aMessageInfo)
         && aMessageInfo.GetPeerPort() == mConfig.GetPort();
 }
 
+uint32_t MqttsnClient::GetRetransmissionTimeout()
+{
+    uint32_t timeout = GetEstimatedTimeout();
+    uint32_t jitter = timeout / 100 * mConfig.GetRetransmissionJitter();
+    // Randomize timeout so the retransmissions of different messages and clients are not synchronized
+    if (jitter > 0)
+    {
+        timeout += otPlatRandomGet() % (jitter + 1);
+    }
+    return timeout;
+}
+
+uint32_t MqttsnClient::GetEstimatedTimeout()
+{
+    uint32_t timeout;
+
+    // Smoothed RTT is zero only when there is neither measurement nor route cost estimate
+    VerifyOrExit(mSmoothedRtt != 0, timeout = mConfig.GetRetransmissionTimeout() * 1000);
+    timeout = mSmoothedRtt + 4 * mRttVariation;
+    timeout = OT_MAX(timeout, static_cast<uint32_t>(kRetransmissionTimeoutMin));
+    timeout = OT_MIN(timeout, static_cast<uint32_t>(kRetransmissionTimeoutMax));
+
+exit:
+    return timeout;
+}
+
+void MqttsnClient::SeedRttEstimate()
+{
+    uint8_t cost;
+
+    VerifyOrExit(mRttSamples == 0);
+    VerifyOrExit(GetGatewayRouteCost(cost));
+    // Route cost is at least one for any path which leaves the device
+    mSmoothedRtt = OT_MAX(cost, 1) * kRouteCostRtt;
+    mRttVariation = mSmoothedRtt / 2;
+
+exit:
+    return;
+}
+
+bool MqttsnClient::GetGatewayRouteCost(uint8_t &aCost)
+{
+    bool found = false;
+#if OPENTHREAD_FTD
+    ThreadNetif &netif = GetInstance().GetThreadNetif();
+    const Ip6::Address &address = mConfig.GetAddress();
+    uint16_t rloc16;
+    uint8_t prefixMatch;
+
+    if (address.IsRoutingLocator() || address.IsAnycastRoutingLocator())
+    {
+        // Gateway is Thread device
+        rloc16 = address.GetLocator();
+    }
+    else
+    {
+        // Gateway is outside of Thread network, use cost to border router which routes to it
+        SuccessOrExit(netif.GetNetworkDataLeader().RouteLookup(netif.GetMle().GetMeshLocal64(), address,
+            &prefixMatch, &rloc16));
+    }
+    aCost = netif.GetMle().GetCost(rloc16);
+    found = aCost < Mle::kMaxRouteCost;
+
+exit:
+#else
+    OT_UNUSED_VARIABLE(aCost);
+#endif
+    return found;
+}
+
+void MqttsnClient::HandleRetransmission(Message &aMessage, const Ip6::Address &aAddress, uint16_t aPort, void* aContext)
+{
+    MqttsnClient* client = static_cast<MqttsnClient*>(aContext);
+    uint8_t header[MQTTSN_MIN_PACKET_LENGTH + 3];
+    uint16_t length = aMessage.Read(0, sizeof(header), header);
+    // Length field has 1 or 3 bytes (0x01 followed by two byte length)
+    uint16_t typeOffset = (header[0] == 0x01) ? 3 : 1;
+
+    // Set DUP flag on retransmitted PUBLISH and SUBSCRIBE messages
+    if (length > typeOffset + 1 &&
+        (header[typeOffset] == kTypePublish || header[typeOffset] == kTypeSubscribe))
+    {
+        header[typeOffset + 1] |= MQTTSN_FLAG_DUP;
+        aMessage.Write(typeOffset + 1, 1, &header[typeOffset + 1]);
+    }
+
+    // Expired acknowledgement is loss signal for congestion control
+    client->DecreaseCongestionWindow();
+
+    MQTTSN_LOG("Retransmitting message\r\n");
+    client->SendMessage(aMessage, aAddress, aPort);
+}
+
 void MqttsnClient::HandleSubscribeTimeout(const MessageMetadata<SubscribeCallbackFunc> &aMetadata, void* aContext)
 {
     MqttsnClient* client = static_cast<MqttsnClient*>(aContext);
     client->mTimeoutRaised = true;
-    aMetadata.mCallback(kCodeTimeout, 0, kQos0, aMetadata.mContext);
+    if (aMetadata.mCallback)
+    {
+        aMetadata.mCallback(kCodeTimeout, 0, kQos0, aMetadata.mContext);
+    }
 }
 
 void MqttsnClient::HandleRegisterTimeout(const MessageMetadata<RegisterCallbackFunc> &aMetadata, void* aContext)
 {
     MqttsnClient* client = static_cast<MqttsnClient*>(aContext);
     client->mTimeoutRaised = true;
-    aMetadata.mCallback(kCodeTimeout, 0, aMetadata.mContext);
+    if (aMetadata.mCallback)
+    {
+        aMetadata.mCallback(kCodeTimeout, 0, aMetadata.mContext);
+    }
 }
 
 void MqttsnClient::HandleUnsubscribeTimeout(const MessageMetadata<UnsubscribeCallbackFunc> &aMetadata, void* aContext)
 {
     MqttsnClient* client = static_cast<MqttsnClient*>(aContext);
     client->mTimeoutRaised = true;
-    aMetadata.mCallback(kCodeTimeout, aMetadata.mContext);
+    if (aMetadata.mCallback)
+    {
+        aMetadata.mCallback(kCodeTimeout, aMetadata.mContext);
+    }
 }
 
 void MqttsnClient::HandlePublishQos1Timeout(const MessageMetadata<PublishCallbackFunc> &aMetadata, void* aContext)
 {
     MqttsnClient* client = static_cast<MqttsnClient*>(aContext);
     client->mTimeoutRaised = true;
-    aMetadata.mCallback(kCodeTimeout, aMetadata.mContext);
+    if (aMetadata.mCallback)
+    {
+        aMetadata.mCallback(kCodeTimeout, aMetadata.mContext);
+    }
 }
 
 void MqttsnClient::HandlePublishQos2PublishTimeout(const MessageMetadata<PublishCallbackFunc> &aMetadata, void* aContext)
 {
     MqttsnClient* client = static_cast<MqttsnClient*>(aContext);
     client->mTimeoutRaised = true;
-    aMetadata.mCallback(kCodeTimeout, aMetadata.mContext);
+    if (aMetadata.mCallback)
+    {
+        aMetadata.mCallback(kCodeTimeout, aMetadata.mContext);
+    }
 }
 
 void MqttsnClient::HandlePublishQos2PubrelTimeout(const MessageMetadata<PublishCallbackFunc> &aMetadata, void* aContext)
 {
     MqttsnClient* client = static_cast<MqttsnClient*>(aContext);
     client->mTimeoutRaised = true;
-    aMetadata.mCallback(kCodeTimeout, aMetadata.mContext);
+    if (aMetadata.mCallback)
+    {
+        aMetadata.mCallback(kCodeTimeout, aMetadata.mContext);
+    }
 }
 
 void MqttsnClient::HandlePublishQos2PubrecTimeout(const MessageMetadata<void*> &aMetadata, void* aContext)
@@ -1561,6 +3633,19 @@ void MqttsnClient::HandlePublishQos2PubrecTimeout(const MessageMetadata<void*> &
     OT_UNUSED_VARIABLE(aContext);
 }
 
+void MqttsnClient::HandleSessionRestoreRegistered(ReturnCode aCode, TopicId aTopicId, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aTopicId);
+    static_cast<MqttsnClient*>(aContext)->HandleSessionRestoreResponse(aCode);
+}
+
+void MqttsnClient::HandleSessionRestoreSubscribed(ReturnCode aCode, TopicId aTopicId, Qos aQos, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aTopicId);
+    OT_UNUSED_VARIABLE(aQos);
+    static_cast<MqttsnClient*>(aContext)->HandleSessionRestoreResponse(aCode);
+}
+
 }
 
 }
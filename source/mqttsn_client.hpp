@@ -31,6 +31,7 @@
 
 #include "common/locator.hpp"
 #include "common/instance.hpp"
+#include "common/timer.hpp"
 #include "net/ip6_address.hpp"
 #include "net/udp6.hpp"
 #include "openthread/error.h"
@@ -141,7 +142,101 @@ enum
      * Short topic maximal length (with null terminator).
      *
      */
-    kShortTopicNameLength = 3
+    kShortTopicNameLength = 3,
+    /**
+     * Maximal number of messages waiting for acknowledgement in all waiting queues.
+     *
+     */
+    kMaxWaitingMessages = 32,
+    /**
+     * Size of message ID lookup table of waiting messages index. It must be power of two and larger
+     * than kMaxWaitingMessages.
+     *
+     */
+    kWaitingMessagesIdTableSize = 64,
+    /**
+     * Initial congestion window, maximal number of QoS level 1 and 2 PUBLISH messages in flight after connect.
+     *
+     */
+    kCongestionWindowInitial = 2,
+    /**
+     * Upper limit of congestion window.
+     *
+     */
+    kCongestionWindowMax = 16,
+    /**
+     * Lower limit of retransmission timeout derived from measured round trip time in milliseconds.
+     *
+     */
+    kRetransmissionTimeoutMin = 1000,
+    /**
+     * Upper limit of retransmission timeout derived from measured round trip time in milliseconds.
+     *
+     */
+    kRetransmissionTimeoutMax = 60000,
+    /**
+     * Time in milliseconds for which PUBREC of received QoS level 2 PUBLISH is kept for duplicate detection
+     * while waiting for PUBREL. It covers retransmissions of PUBLISH and PUBREL by the gateway.
+     *
+     */
+    kPubrecLifetime = 2 * kRetransmissionTimeoutMax,
+    /**
+     * Round trip time estimate in milliseconds per unit of Thread route cost. It is used for initial estimate
+     * before the first round trip time is measured.
+     *
+     */
+    kRouteCostRtt = 50,
+    /**
+     * Maximal number of topic names in topic registry.
+     *
+     */
+    kMaxRegisteredTopics = 16,
+    /**
+     * Size of name lookup table of topic registry. It must be power of two and larger than kMaxRegisteredTopics.
+     *
+     */
+    kTopicRegistryTableSize = 32,
+    /**
+     * Size of topic registry pool for interned topic names (with null terminators) in bytes.
+     *
+     */
+    kTopicRegistryNamePoolSize = 512,
+    /**
+     * Maximal number of messages published by topic name which wait for topic registration.
+     *
+     */
+    kMaxPendingPublishes = 8,
+    /**
+     * Maximal number of topics in single batch subscription or registration.
+     *
+     */
+    kMaxBatchTopics = kMaxRegisteredTopics,
+    /**
+     * Maximal number of gateways in gateway table.
+     *
+     */
+    kMaxGateways = 4,
+    /**
+     * Number of missed ADVERTISE periods after which advertised gateway is considered unavailable.
+     *
+     */
+    kGatewayAdvertiseMissed = 3,
+    /**
+     * Time in milliseconds per hop of search radius for which expanding ring search waits for GWINFO.
+     *
+     */
+    kSearchGwRingTimeout = 250,
+    /**
+     * Milliseconds per keepalive second after the last gateway activity when PINGREQ is sent.
+     *
+     */
+    kKeepAlivePingTime = 700,
+    /**
+     * Milliseconds per keepalive second after the last sent message when PINGREQ is sent regardless of
+     * received messages. Gateway considers the client lost after 1.5 keepalive periods without message.
+     *
+     */
+    kKeepAlivePingLimit = 1000
 };
 
 /**
@@ -190,799 +285,2278 @@ typedef String<kMaxTopicNameLength> TopicNameString;
  */
 typedef String<kCliendIdStringMax> ClientIdString;
 
-template <typename CallbackType>
-class WaitingMessagesQueue;
-
 /**
- * Message metadata which are stored in waiting messages queue.
+ * Result of single topic of batch subscription or registration.
  *
  */
-template <typename CallbackType>
-class MessageMetadata
+struct TopicResult
 {
-    friend class MqttsnClient;
-    friend class WaitingMessagesQueue<CallbackType>;
-
-public:
     /**
-     * Default constructor for the object.
-     *
+     * SUBACK or REGACK return code or -1 when the request timed out.
      */
-    MessageMetadata(void);
-
+    ReturnCode mCode;
     /**
-     * This constructor initializes the object with specific values.
-     *
-     * @param[in]  aDestinationAddress     A reference of message destination IPv6 address.
-     * @param[in]  aDestinationPort        Message destination port.
-     * @param[in]  aMessageId              MQTT-SN Message ID.
-     * @param[in]  aTimestamp              Time stamp of message in milliseconds for timeout evaluation.
-     * @param[in]  aRetransmissionTimeout  Time in millisecond after which message is message timeout invoked.
-     * @param[in]  aCallback               A function pointer for handling message timeout.
-     * @param[in]  aContext                Pointer to callback passed to timeout callback.
-     *
+     * Topic ID assigned by gateway. Zero for wildcard subscriptions or failed requests.
      */
-    MessageMetadata(const Ip6::Address &aDestinationAddress, uint16_t aDestinationPort, uint16_t aMessageId, uint32_t aTimestamp, uint32_t aRetransmissionTimeout, CallbackType aCallback, void* aContext);
-
+    TopicId mTopicId;
     /**
-     * Append metadata to the message.
-     *
-     * @param[in]  aMessage  A reference to the message.
-     *
-     * @retval OT_ERROR_NONE     Successfully appended the bytes.
-     * @retval OT_ERROR_NO_BUFS  Insufficient available buffers to grow the message.
-     *
+     * Granted quality of service level of subscription.
      */
-    otError AppendTo(Message &aMessage) const;
+    Qos mQos;
+};
 
+/**
+ * Client congestion control statistics.
+ *
+ */
+struct ClientStats
+{
     /**
-     * Read metadata from the message.
-     *
-     * @param[in]  aMessage  A reference to the message.
-     *
-     * @returns The number of bytes read.
-     *
+     * Current congestion window, maximal number of QoS level 1 and 2 PUBLISH messages in flight.
      */
-    uint16_t ReadFrom(Message &aMessage);
-
+    uint8_t mCongestionWindow;
     /**
-     * Get metadata length in bytes.
-     *
-     * @returns The number of bytes.
-     *
+     * Smoothed round trip time in milliseconds. Zero when no sample was measured yet.
      */
-    uint16_t GetLength(void) const;
-
-private:
+    uint32_t mSmoothedRtt;
     /**
-     * A reference of message destination IPv6 address.
-     *
+     * Round trip time variation in milliseconds.
      */
-    Ip6::Address mDestinationAddress;
+    uint32_t mRttVariation;
     /**
-     * Message destination port.
-     *
+     * Current retransmission timeout without jitter in milliseconds.
      */
-    uint16_t mDestinationPort;
+    uint32_t mRetransmissionTimeout;
     /**
-     * MQTT-SN Message ID.
-     *
+     * Number of round trip time samples.
      */
-    uint16_t mMessageId;
+    uint32_t mRttSamples;
     /**
-     * Time stamp of message in milliseconds for timeout evaluation.
-     *
+     * Number of congestion window reductions.
      */
-    uint32_t mTimestamp;
+    uint32_t mCongestionEvents;
     /**
-     * Time in millisecond after which message is message timeout invoked.
-     *
+     * Number of acknowledgements rejected by gateway for congestion.
      */
-    uint32_t mRetransmissionTimeout;
+    uint32_t mCongestionRejections;
     /**
-     * Message retransmission count.
-     *
+     * Time from CONNECT to completed restore of registrations and subscriptions in milliseconds. Zero when
+     * no session was restored yet.
      */
-    uint8_t mRetransmissionCount;
+    uint32_t mSessionRestoreTime;
     /**
-     * A function pointer for handling message timeout.
-     *
+     * Number of REGISTER and SUBSCRIBE messages sent by the last session restore.
      */
-    CallbackType mCallback;
+    uint8_t mSessionRestoreMessages;
     /**
-     * A pointer to callback passed to timeout callback.
+     * Number of keepalive PINGREQ messages sent.
+     */
+    uint32_t mPingreqSent;
+    /**
+     * Number of keepalive PINGREQ messages which were not sent thanks to received gateway messages compared
+     * to fixed schedule after the last sent message.
+     */
+    uint32_t mPingreqSaved;
+    /**
+     * Saved keepalive PINGREQ messages per hour of connected time.
+     */
+    uint32_t mPingreqSavedPerHour;
+};
+
+template <typename CallbackType>
+class WaitingMessagesQueue;
+
+class MessageBase;
+
+/**
+ * The base class of waiting messages queues which can handle expired deadlines.
+ *
+ */
+class WaitingMessagesQueueBase
+{
+public:
+    /**
+     * Handle expired deadline of the waiting message. The message must be either rescheduled or removed
+     * from the waiting messages index.
+     *
+     * @param[in]  aMessage  A reference to expired message in the queue.
      *
      */
-    void* mContext;
+    virtual void HandleDeadline(Message &aMessage) = 0;
 };
 
 /**
- * The class represents the queue which contains messages waiting for acknowledgements from gateway.
+ * The class represents index of messages waiting in all waiting queues. Deadlines are ordered in binary
+ * min-heap with fixed capacity. The earliest deadline is available in constant time and insertion,
+ * update or removal costs O(log n). Deadlines are compared with signed difference so the timer wrap around
+ * is handled correctly. Entries without deadline are ordered after all entries with deadline and never expire.
+ * Messages are also looked up by queue and message ID in open addressed hash table with linear probing, so
+ * acknowledgement matching does not depend on number of messages in flight.
  *
  */
-template <typename CallbackType>
-class WaitingMessagesQueue
+class WaitingMessagesIndex
 {
 public:
     /**
-     * Declaration of a function pointer which is used as timeout callback.
+     * Default constructor for the object.
      *
      */
-    typedef void (*TimeoutCallbackFunc)(const MessageMetadata<CallbackType> &aMetadata, void* aContext);
+    WaitingMessagesIndex(void);
 
     /**
-     * This constructor initializes the object with specific values.
+     * Add the message to the index.
+     *
+     * @param[in]   aDeadline     Deadline time in milliseconds.
+     * @param[in]   aHasDeadline  False if the message waits without deadline, aDeadline is ignored.
+     * @param[in]   aMessageId  MQTT-SN message ID of the message.
+     * @param[in]   aMessage    A reference to waiting message.
+     * @param[in]   aQueue      A reference to the queue in which is the message waiting.
+     * @param[out]  aSlot       Slot identifier of the new entry. It is valid until the entry is removed.
      *
-     * @param[in]  aTimeoutCallback  A function pointer to callback which is invoked on message timeout.
-     * @param[in]  aTimeoutContext   A pointer to context passed to timeout callback.
+     * @retval OT_ERROR_NONE     Successfully added the message.
+     * @retval OT_ERROR_NO_BUFS  The index is full.
      *
      */
-    WaitingMessagesQueue(TimeoutCallbackFunc aTimeoutCallback, void* aTimeoutContext);
+    otError Add(uint32_t aDeadline, bool aHasDeadline, uint16_t aMessageId, Message &aMessage,
+        WaitingMessagesQueueBase &aQueue, uint8_t &aSlot);
 
     /**
-     * Default object destructor.
+     * Change the deadline of the entry.
+     *
+     * @param[in]  aSlot      Entry slot identifier.
+     * @param[in]  aDeadline  New deadline time in milliseconds.
      *
      */
-    ~WaitingMessagesQueue(void);
+    void Update(uint8_t aSlot, uint32_t aDeadline);
 
     /**
-     * Copy message data and enqueue message to waiting queue.
-     *
-     * @param[in]  aMessage   A reference to message object to be enqueued.
-     * @param[in]  aLength    Message length.
-     * @param[in]  aMetadata  A reference to message metadata.
+     * Remove the entry from the index.
      *
-     * @retval OT_ERROR_NONE     Successfully enqueued the message.
-     * @retval OT_ERROR_NO_BUFS  Insufficient available buffers to copy or enqueue the message.
+     * @param[in]  aSlot  Entry slot identifier.
      *
      */
-    otError EnqueueCopy(const Message &aMessage, uint16_t aLength, const MessageMetadata<CallbackType> &aMetadata);
+    void Remove(uint8_t aSlot);
 
     /**
-     * Dequeue specific message from waiting queue.
+     * Find waiting message by message ID.
      *
-     * @param[in]  aMessage   A reference to message object to be dequeued.
+     * @param[in]  aQueue      A reference to the queue in which is the message waiting.
+     * @param[in]  aMessageId  MQTT-SN message ID.
      *
-     * @retval OT_ERROR_NONE       Successfully dequeued the message.
-     * @retval OT_ERROR_NOT_FOUND  Message was not found in waiting queue.
+     * @returns  A pointer to the message if found or null otherwise.
      *
      */
-    otError Dequeue(Message &aMessage);
+    Message* Find(const WaitingMessagesQueueBase &aQueue, uint16_t aMessageId) const;
 
     /**
-     * Find message by message ID and read message metadata.
+     * Get the earliest deadline.
      *
-     * @param[in]  aMessageId  Message ID.
-     * @param[out] aMetadata   A reference to initialized metadata object.
+     * @param[out]  aDeadline  Earliest deadline time in milliseconds.
      *
-     * @returns  If the message is found the message ID is returned or null otherwise.
+     * @returns  True if there is any entry with deadline in the index.
      *
      */
-    Message* Find(uint16_t aMessageId, MessageMetadata<CallbackType> &aMetadata);
+    bool GetNextDeadline(uint32_t &aDeadline) const;
 
     /**
-     * Evaluate queued messages timeout and retransmission.
+     * Invoke deadline handler of the queues for every expired entry. Only expired entries are touched.
      *
-     * @retval OT_ERROR_NONE  Timeouts were successfully processed.
+     * @param[in]  aNow  Current time in milliseconds.
      *
      */
-    otError HandleTimer(void);
+    void HandleExpired(uint32_t aNow);
 
     /**
-     * Force waiting messages timeout, invoke callback and empty queue.
+     * Compare two timestamps with respect to timer wrap around.
+     *
+     * @param[in]  aFirst   First time in milliseconds.
+     * @param[in]  aSecond  Second time in milliseconds.
+     *
+     * @returns  True if the first time is before the second one.
      *
      */
-    void ForceTimeout(void);
+    static bool IsBefore(uint32_t aFirst, uint32_t aSecond)
+    {
+        return static_cast<int32_t>(aFirst - aSecond) < 0;
+    }
 
 private:
-    MessageQueue mQueue;
-    TimeoutCallbackFunc mTimeoutCallback;
-    void* mTimeoutContext;
+    struct Entry
+    {
+        uint32_t mDeadline;
+        Message* mMessage;
+        WaitingMessagesQueueBase* mQueue;
+        uint16_t mMessageId;
+        uint8_t mHeapIndex;
+        bool mHasDeadline;
+    };
+
+    bool IsEarlier(uint8_t aFirst, uint8_t aSecond) const;
+
+    static uint8_t GetIdHome(uint16_t aMessageId)
+    {
+        return aMessageId & (kWaitingMessagesIdTableSize - 1);
+    }
+
+    void AddId(uint8_t aSlot);
+
+    void RemoveId(uint8_t aSlot);
+
+    void Swap(uint8_t aFirst, uint8_t aSecond);
+
+    void SiftUp(uint8_t aIndex);
+
+    void SiftDown(uint8_t aIndex);
+
+    Entry mEntries[kMaxWaitingMessages];
+    uint8_t mHeap[kMaxWaitingMessages];
+    // Message ID lookup table holds slot identifier increased by one, zero marks empty position
+    uint8_t mIdTable[kWaitingMessagesIdTableSize];
+    uint8_t mSize;
 };
 
 /**
- * This class contains MQTT-SN connection parameters.
+ * The class represents registry of topic names and their topic IDs. Topic names are interned to fixed size
+ * name pool and looked up by name hash in open addressed table with linear probing. Entries are never removed
+ * one by one, the whole registry is cleared when the session ends.
  *
  */
-class MqttsnConfig
+class TopicRegistry
 {
 public:
-
     /**
-     * Default constructor for the object.
+     * The class represents registered topic name.
      *
      */
-    MqttsnConfig(void)
-        : mAddress()
-        , mPort()
-        , mClientId()
-        , mKeepAlive(30)
-        , mCleanSession()
-        , mRetransmissionTimeout(10)
+    class Entry
     {
-        ;
-    }
+        friend class TopicRegistry;
+
+    public:
+        /**
+         * Get interned topic name.
+         *
+         * @returns A pointer to null terminated topic name.
+         *
+         */
+        const char* GetName(void) const { return mName; }
+
+        /**
+         * Get topic ID assigned by gateway.
+         *
+         * @returns Topic ID. It is valid only when the topic is registered.
+         *
+         */
+        TopicId GetTopicId(void) const { return mTopicId; }
+
+        /**
+         * Check whether topic ID of the topic is known.
+         *
+         * @returns True if the topic is registered.
+         *
+         */
+        bool IsRegistered(void) const { return mState == kRegistered; }
+
+        /**
+         * Check whether REGISTER message for the topic is waiting for REGACK.
+         *
+         * @returns True if the registration is in progress.
+         *
+         */
+        bool IsRegistering(void) const { return mState == kRegistering; }
+
+        /**
+         * Set topic ID assigned by gateway and mark the topic registered.
+         *
+         * @param[in]  aTopicId  Topic ID.
+         *
+         */
+        void SetRegistered(TopicId aTopicId)
+        {
+            mTopicId = aTopicId;
+            mState = kRegistered;
+            mRestore &= ~kRestoreRegistration;
+        }
+
+        /**
+         * Mark the topic as waiting for REGACK.
+         *
+         */
+        void SetRegistering(void) { mState = kRegistering; }
+
+        /**
+         * Forget topic ID of the topic.
+         *
+         */
+        void SetUnregistered(void) { mState = kUnregistered; }
+
+        /**
+         * Check whether the client is subscribed to the topic.
+         *
+         * @returns True if the topic is subscribed.
+         *
+         */
+        bool IsSubscribed(void) const { return mSubscribed; }
+
+        /**
+         * Get quality of service level granted by gateway for the subscription.
+         *
+         * @returns Quality of service level.
+         *
+         */
+        Qos GetSubscribeQos(void) const { return static_cast<Qos>(mSubscribeQos); }
+
+        /**
+         * Mark the topic subscribed.
+         *
+         * @param[in]  aQos  Quality of service level granted by gateway.
+         *
+         */
+        void SetSubscribed(Qos aQos)
+        {
+            mSubscribed = true;
+            mSubscribeQos = aQos;
+            mRestore &= ~kRestoreSubscription;
+        }
+
+        /**
+         * Mark the topic unsubscribed.
+         *
+         */
+        void SetUnsubscribed(void) { mSubscribed = false; mRestore &= ~kRestoreSubscription; }
+
+        /**
+         * Check whether the topic was registered in previous session and must be registered again.
+         *
+         * @returns True if the registration is to be restored.
+         *
+         */
+        bool IsRestoreRegistration(void) const { return (mRestore & kRestoreRegistration) != 0; }
+
+        /**
+         * Check whether the topic was subscribed in previous session and must be subscribed again with
+         * the same QoS level.
+         *
+         * @returns True if the subscription is to be restored.
+         *
+         */
+        bool IsRestoreSubscription(void) const { return (mRestore & kRestoreSubscription) != 0; }
+
+    private:
+        enum State
+        {
+            kUnregistered,
+            kRegistering,
+            kRegistered
+        };
+
+        enum
+        {
+            kRestoreRegistration = 0x01,
+            kRestoreSubscription = 0x02
+        };
+
+        const char* mName;
+        uint32_t mHash;
+        TopicId mTopicId;
+        uint8_t mState;
+        bool mSubscribed;
+        uint8_t mSubscribeQos;
+        uint8_t mRestore;
+    };
 
     /**
-     * Get gateway IPv6 address.
-     *
-     * @returns A reference to IPv6 address.
+     * Default constructor for the object.
      *
      */
-    const Ip6::Address &GetAddress()
-    {
-        return mAddress;
-    }
+    TopicRegistry(void);
 
     /**
-     * Set gateway IPv6 address.
+     * Find entry of the topic name or add new unregistered entry.
      *
-     * @param[in]  aAddress  A reference to gateway IPv6 address.
+     * @param[in]  aName  A pointer to null terminated topic name.
+     *
+     * @returns  A pointer to the entry or null when the registry or the name pool is full.
      *
      */
-    void SetAddress(const Ip6::Address &aAddress)
-    {
-        mAddress = aAddress;
-    }
+    Entry* Add(const char* aName);
 
     /**
-     * Get gateway interface port number.
+     * Find entry by topic name.
      *
-     * @returns Gateway port number.
+     * @param[in]  aName  A pointer to null terminated topic name.
+     *
+     * @returns  A pointer to the entry if found or null otherwise.
      *
      */
-    uint16_t GetPort()
-    {
-        return mPort;
-    }
+    Entry* Find(const char* aName);
 
     /**
-     * Set gateway interface port number.
+     * Find registered entry by topic ID.
      *
-     * @param[in]  aPort  Gateway port number.
+     * @param[in]  aTopicId  Topic ID.
+     *
+     * @returns  A pointer to the entry if found or null otherwise.
      *
      */
-    void SetPort(uint16_t aPort)
-    {
-        mPort = aPort;
-    }
+    Entry* Find(TopicId aTopicId);
 
     /**
-     * Get client ID.
+     * Get entry by its index.
      *
-     * @returns Cliend ID string.
+     * @param[in]  aIndex  Entry index.
+     *
+     * @returns  A pointer to the entry or null when the index is not valid.
      *
      */
-    const ClientIdString &GetClientId()
-    {
-        return mClientId;
-    }
+    Entry* GetEntry(uint8_t aIndex) { return (aIndex < mCount) ? &mEntries[aIndex] : nullptr; }
 
     /**
-     * Set client ID.
+     * Get index of the entry. The index is valid until the registry is cleared.
      *
-     * @param[in]  aClientId  A pointer to client ID string.
+     * @param[in]  aEntry  A reference to the entry.
+     *
+     * @returns  Entry index.
      *
      */
-    void SetClientId(const char* aClientId)
-    {
-        mClientId.Set("%s", aClientId);
-    }
+    uint8_t GetIndex(const Entry &aEntry) const { return static_cast<uint8_t>(&aEntry - mEntries); }
 
     /**
-     * Get keepalive period in seconds.
+     * Get number of entries.
      *
-     * @returns Keepalive time in seconds.
+     * @returns  Number of entries.
      *
      */
-    int16_t GetKeepAlive()
-    {
-        return mKeepAlive;
-    }
+    uint8_t GetCount(void) const { return mCount; }
 
     /**
-     * Set keepalive period in seconds.
+     * Mark all entries with registration in progress as unregistered.
      *
-     * @param[in]  Keepalive time in seconds.
+     */
+    void CancelRegistrations(void);
+
+    /**
+     * Invalidate topic IDs and subscriptions held by gateway and mark them to be restored in new session.
+     * Topic names are kept.
      *
      */
-    void SetKeepAlive(int16_t aDuration)
-    {
-        mKeepAlive = aDuration;
-    }
+    void InvalidateSession(void);
 
     /**
-     * Get clean session flag.
+     * Remove all entries and release the name pool.
      *
-     * @returns Clean session flag.
+     */
+    void Clear(void);
+
+private:
+    static uint32_t Hash(const char* aName);
+
+    Entry mEntries[kMaxRegisteredTopics];
+    // Name lookup table holds entry index increased by one, zero marks empty position
+    uint8_t mNameTable[kTopicRegistryTableSize];
+    char mNamePool[kTopicRegistryNamePoolSize];
+    uint16_t mNamePoolLength;
+    uint8_t mCount;
+};
+
+/**
+ * The class stores topic registry of persistent session in non-volatile settings. Each topic is kept in its own
+ * settings record which is written only when the topic state changes, so the number of flash writes grows
+ * linearly with the number of changed topics.
+ *
+ */
+class SessionStore
+{
+public:
+    /**
+     * Stored session binding. Topic records are valid only for the same client ID and gateway.
      *
      */
-    bool GetCleanSession()
+    struct Binding
     {
-        return mCleanSession;
-    }
+        uint8_t mAddress[sizeof(Ip6::Address)];
+        uint16_t mPort;
+        char mClientId[kCliendIdStringMax];
+    };
 
     /**
-     * Set clean session flag.
+     * Constructor of the object.
      *
-     * @param[in]  aCleanSession  Clean session flag.
+     * @param[in]  aInstance  A pointer to OpenThread instance which owns the settings.
      *
      */
-    void SetCleanSession(bool aCleanSession)
-    {
-        mCleanSession = aCleanSession;
-    }
+    explicit SessionStore(otInstance* aInstance);
 
     /**
-     * Get retransmission timeout in milliseconds.
+     * Load stored topic records to the registry when they are bound to the same client ID and gateway.
      *
-     * @returns Retransmission timeout in milliseconds.
+     * @param[in]  aBinding   A reference to current session binding.
+     * @param[in]  aRegistry  A reference to topic registry to which topics are added.
+     *
+     * @retval OT_ERROR_NONE       Session successfully restored.
+     * @retval OT_ERROR_NOT_FOUND  There is no stored session for the binding.
+     * @retval OT_ERROR_NO_BUFS    Topic registry is full.
      *
      */
-    uint32_t GetRetransmissionTimeout()
-    {
-        return mRetransmissionTimeout;
-    }
+    otError Restore(const Binding &aBinding, TopicRegistry &aRegistry);
 
     /**
-     * Set retransmission timeout in milliseconds.
+     * Store state of the topic. Record of the topic is replaced only when its content differs and it is removed
+     * when the topic is neither registered nor subscribed. Records of another binding are removed first.
+     *
+     * @param[in]  aBinding  A reference to current session binding.
+     * @param[in]  aEntry    A reference to changed topic entry.
      *
-     * @param[in]  aTimeout  Retransmission timeout value in milliseconds.
+     * @retval OT_ERROR_NONE          Topic successfully stored.
+     * @retval OT_ERROR_INVALID_ARGS  Topic name is too long.
      *
      */
-    void SetRetransmissionTimeout(uint32_t aTimeout)
-    {
-        mRetransmissionTimeout = aTimeout;
-    }
+    otError Save(const Binding &aBinding, const TopicRegistry::Entry &aEntry);
+
+    /**
+     * Remove stored session binding and all topic records.
+     *
+     */
+    void Delete(void);
 
 private:
-    Ip6::Address mAddress;
-    uint16_t mPort;
-    ClientIdString mClientId;
-    uint16_t mKeepAlive;
-    bool mCleanSession;
-    uint32_t mRetransmissionTimeout;
+    otError Bind(const Binding &aBinding);
+
+    int FindRecord(const char* aName, uint16_t aNameLength, uint8_t* aRecord, uint16_t &aLength);
+
+    otInstance* mInstance;
+    Binding mBinding;
+    bool mBound;
 };
 
 /**
- * The class representing MQTT-SN protocol client.
+ * The class represents table of gateways learned from ADVERTISE and GWINFO messages. Gateways are ranked
+ * by measured round trip time, gateway which failed is skipped until it is heard again.
  *
  */
-class MqttsnClient: public InstanceLocator
+class GatewayTable
 {
 public:
     /**
-     * Declaration of function for connection callback.
-     *
-     * @param[in]  aCode     CONNACK return code value or -1 when connection establishment timed out.
-     * @param[in]  aContext  A pointer to connection callback context object.
+     * The class represents known gateway.
      *
      */
-    typedef void (*ConnectedCallbackFunc)(ReturnCode aCode, void* aContext);
+    class Entry
+    {
+        friend class GatewayTable;
+
+    public:
+        /**
+         * Get gateway ID.
+         *
+         * @returns Gateway ID.
+         *
+         */
+        uint8_t GetGatewayId(void) const { return mGatewayId; }
+
+        /**
+         * Get gateway IPv6 address.
+         *
+         * @returns A reference to gateway address.
+         *
+         */
+        const Ip6::Address &GetAddress(void) const { return mAddress; }
+
+        /**
+         * Get gateway port.
+         *
+         * @returns Gateway UDP port.
+         *
+         */
+        uint16_t GetPort(void) const { return mPort; }
+
+        /**
+         * Get advertise duration of the gateway.
+         *
+         * @returns Interval between ADVERTISE messages in seconds. Zero when the gateway was learned from GWINFO.
+         *
+         */
+        uint32_t GetDuration(void) const { return mDuration; }
+
+        /**
+         * Get time when the gateway was heard last time.
+         *
+         * @returns Time stamp in milliseconds.
+         *
+         */
+        uint32_t GetLastSeen(void) const { return mLastSeen; }
+
+        /**
+         * Get smoothed round trip time to the gateway.
+         *
+         * @returns Round trip time in milliseconds. Zero when not measured yet.
+         *
+         */
+        uint32_t GetRtt(void) const { return mRtt; }
+
+        /**
+         * Check whether connection to the gateway failed since it was heard last time.
+         *
+         * @returns True if the gateway failed.
+         *
+         */
+        bool IsFailed(void) const { return mFailed; }
+
+        /**
+         * Mark the gateway failed. It is not selected until it is heard again.
+         *
+         */
+        void SetFailed(void) { mFailed = true; }
+
+        /**
+         * Get time when PINGREQ probe was sent to the gateway.
+         *
+         * @returns Time stamp in milliseconds. Zero when no probe is outstanding.
+         *
+         */
+        uint32_t GetProbeTime(void) const { return mProbeTime; }
+
+        /**
+         * Set time when PINGREQ probe was sent to the gateway.
+         *
+         * @param[in]  aProbeTime  Time stamp in milliseconds or zero when the probe was answered.
+         *
+         */
+        void SetProbeTime(uint32_t aProbeTime) { mProbeTime = aProbeTime; }
+
+    private:
+        Ip6::Address mAddress;
+        uint32_t mDuration;
+        uint32_t mLastSeen;
+        uint32_t mRtt;
+        uint32_t mProbeTime;
+        uint16_t mPort;
+        uint8_t mGatewayId;
+        bool mFailed;
+    };
 
     /**
-     * Declaration of function for subscribe callback.
-     *
-     * @param[in]  aCode     SUBACK return code or -1 when subscription timed out.
-     * @param[in]  aTopicId  Subscribed topic ID. The value is 0 when timed out or subscribed by short topic name.
-     * @param[in]  aQos      Subscribed quality of service level.
-     * @param[in]  aContext  A pointer to subscription callback context object.
+     * Default constructor for the object.
      *
      */
-    typedef void (*SubscribeCallbackFunc)(ReturnCode aCode, TopicId aTopicId, Qos aQos, void* aContext);
+    GatewayTable(void);
 
     /**
-     * Declaration of function for callback invoked when publish message received.
+     * Add new gateway or refresh known gateway with the same gateway ID. When the table is full, failed or
+     * least recently heard gateway is replaced.
      *
-     * @param[in]  aPayload         A pointer to PUBLISH message payload byte array.
-     * @param[in]  aPayloadLength   PUBLISH message payload length.
-     * @param[in]  aTopicIdType     Topic ID type. Possible values are kTopicId or kShortTopicName.
-     * @param[in]  aTopicId         PUBLISH message topic ID. It is set only when aTopicIdType is kTopicId.
-     * @param[in]  aShortTopicName  PUBLISH message short topic name. It is set only when aTopicIdType is kShortTopicName.
-     * @param[in]  aContext         A pointer to publish received callback context object.
+     * @param[in]  aGatewayId  Gateway ID.
+     * @param[in]  aAddress    A reference to gateway address.
+     * @param[in]  aPort       Gateway port.
+     * @param[in]  aDuration   Advertise duration in seconds or zero when unknown.
+     * @param[in]  aNow        Current time in milliseconds.
+     *
+     * @returns  A pointer to the entry.
      *
-     * @returns  Code to be send in response PUBACK message. Timeout value is not relevant.
      */
-    typedef ReturnCode (*PublishReceivedCallbackFunc)(const uint8_t* aPayload, int32_t aPayloadLength, TopicIdType aTopicIdType, TopicId aTopicId, ShortTopicNameString aShortTopicName, void* aContext);
+    Entry* Update(uint8_t aGatewayId, const Ip6::Address &aAddress, uint16_t aPort, uint32_t aDuration, uint32_t aNow);
 
     /**
-     * Declaration of function for advertise callback.
+     * Find gateway by its address and port.
      *
-     * @param[in]  aAddress    A reference to advertised gateway IPv6 address.
-     * @param[in]  aGatewayId  Advertised gateway ID.
-     * @param[in]  aDuration   Advertise message duration parameter.
-     * @param[in]  aContext    A pointer to advertise callback context object.
+     * @param[in]  aAddress  A reference to gateway address.
+     * @param[in]  aPort     Gateway port.
+     *
+     * @returns  A pointer to the entry if found or null otherwise.
      *
      */
-    typedef void (*AdvertiseCallbackFunc)(const Ip6::Address &aAddress, uint8_t aGatewayId, uint32_t aDuration, void* aContext);
+    Entry* Find(const Ip6::Address &aAddress, uint16_t aPort);
 
     /**
-     * Declaration of function for search gateway callback.
+     * Add round trip time sample to exponentially weighted average of the gateway.
      *
-     * @param[in]  aAddress  A reference to IPv6 address of discovered gateway.
-     * @param[in]  aAddress  Discovered gateway ID.
-     * @param[in]  aContext  A pointer to search gateway context object.
+     * @param[in]  aEntry  A reference to gateway entry.
+     * @param[in]  aRtt    Measured round trip time in milliseconds.
      *
      */
-    typedef void (*SearchGwCallbackFunc)(const Ip6::Address &aAddress, uint8_t aGatewayId, void* aContext);
+    void AddRttSample(Entry &aEntry, uint32_t aRtt);
 
     /**
-     * Declaration of function for register callback.
+     * Select the best available gateway. Gateway with the lowest measured round trip time is preferred,
+     * gateways without measurement are ranked after measured ones by last seen time. Failed gateways and
+     * gateways which missed kGatewayAdvertiseMissed ADVERTISE periods are skipped.
      *
-     * @param[in]  aCode     REGACK return code or -1 when subscription timed out.
-     * @param[in]  aTopicId  Registered topic ID.
-     * @param[in]  aContext  A pointer to register callback context object.
+     * @param[in]  aNow  Current time in milliseconds.
+     *
+     * @returns  A pointer to the best entry or null when no gateway is available.
      *
      */
-    typedef void (*RegisterCallbackFunc)(ReturnCode aCode, TopicId aTopicId, void* aContext);
+    Entry* GetBest(uint32_t aNow);
 
     /**
-     * Declaration of function for callback invoked when register message received.
+     * Get entry by its index.
      *
-     * @param[in]  aTopicId    Registered topic ID.
-     * @param[in]  aTopicName  Long topic name string mapped to registered topic.
-     * @param[in]  aContext    A pointer to register received callback context object.
+     * @param[in]  aIndex  Entry index.
      *
-     * @returns  Code to be send in response REGACK message. Timeout value is not relevant.
+     * @returns  A pointer to the entry or null when the index is not valid.
      *
      */
-    typedef ReturnCode (*RegisterReceivedCallbackFunc)(TopicId aTopicId, const TopicNameString &aTopicName, void* aContext);
+    Entry* GetEntry(uint8_t aIndex) { return (aIndex < mCount) ? &mEntries[aIndex] : nullptr; }
 
     /**
-     * Declaration of function for publish callback. It is invoked only when quality of service level is 1 or 2.
+     * Get number of gateways.
      *
-     * @param[in]  aCode     Publish response code or -1 when publish timed out.
-     * @param[in]  aTopicId  Topic ID of published message. It is set to 0 when timed out or short topic name is used.
-     * @param[in]  aContext  A pointer to publish callback context object.
+     * @returns  Number of gateways.
      *
      */
-    typedef void (*PublishCallbackFunc)(ReturnCode aCode, void* aContext);
+    uint8_t GetCount(void) const { return mCount; }
 
     /**
-     * Declaration of function for unsubscribe callback.
+     * Remove all gateways.
      *
-     * @param[in]  aCode     UNSUBACK response code or -1 when publish timed out.
-     * @param[in]  aContext  A pointer to unsubscribe callback context object.
+     */
+    void Clear(void);
+
+private:
+    bool IsAvailable(const Entry &aEntry, uint32_t aNow) const;
+
+    Entry mEntries[kMaxGateways];
+    uint8_t mCount;
+};
+
+/**
+ * Message metadata which are stored in waiting messages queue.
+ *
+ */
+template <typename CallbackType>
+class MessageMetadata
+{
+    friend class MqttsnClient;
+    friend class WaitingMessagesQueue<CallbackType>;
+
+public:
+    /**
+     * Default constructor for the object.
      *
      */
-    typedef void (*UnsubscribeCallbackFunc)(ReturnCode aCode, void* aContext);
+    MessageMetadata(void);
 
     /**
-     * Declaration of function for disconnection callback.
+     * This constructor initializes the object with specific values.
      *
-     * @param[in]  aType     Disconnection reason.
-     * @param[in]  aContext  A pointer to disconnection callback context object.
+     * @param[in]  aDestinationAddress     A reference of message destination IPv6 address.
+     * @param[in]  aDestinationPort        Message destination port.
+     * @param[in]  aMessageId              MQTT-SN Message ID.
+     * @param[in]  aTimestamp              Time stamp of message in milliseconds for timeout evaluation.
+     * @param[in]  aRetransmissionTimeout  Time in millisecond after which message is message timeout invoked. Zero
+     *                                     means the message waits without deadline until it is dequeued.
+     * @param[in]  aRetransmissionCount    Number of retransmissions before the message times out.
+     * @param[in]  aCallback               A function pointer for handling message timeout.
+     * @param[in]  aContext                Pointer to callback passed to timeout callback.
      *
      */
-    typedef void (*DisconnectedCallbackFunc)(DisconnectType aType, void* aContext);
+    MessageMetadata(const Ip6::Address &aDestinationAddress, uint16_t aDestinationPort, uint16_t aMessageId, uint32_t aTimestamp, uint32_t aRetransmissionTimeout, uint8_t aRetransmissionCount, CallbackType aCallback, void* aContext);
 
     /**
-     * This constructor initializes the object.
+     * Append metadata to the message.
      *
-     * @param[in]  aInstance  A reference to the OpenThread instance.
+     * @param[in]  aMessage  A reference to the message.
+     *
+     * @retval OT_ERROR_NONE     Successfully appended the bytes.
+     * @retval OT_ERROR_NO_BUFS  Insufficient available buffers to grow the message.
      *
      */
-    MqttsnClient(Instance &aInstance);
+    otError AppendTo(Message &aMessage) const;
 
     /**
-     * Default object destructor.
+     * Read metadata from the message.
+     *
+     * @param[in]  aMessage  A reference to the message.
+     *
+     * @returns The number of bytes read.
      *
      */
-    ~MqttsnClient(void);
+    uint16_t ReadFrom(Message &aMessage);
 
     /**
-     * Start MQTT-SN service and start connection and listening.
+     * Overwrite metadata already appended to the message.
      *
-     * @param[in]  aPort  MQTT-SN client listening port.
+     * @param[in]  aMessage  A reference to the message.
      *
-     * @retval OT_ERROR_NONE  Successfully started the service.
+     * @returns The number of bytes written.
      *
      */
-    otError Start(uint16_t aPort);
+    int UpdateIn(Message &aMessage) const;
 
     /**
-     * Stop MQTT-SN service.
+     * Get metadata length in bytes.
      *
-     * @retval OT_ERROR_NONE  Successfully stopped the service.
+     * @returns The number of bytes.
      *
      */
-    otError Stop(void);
+    uint16_t GetLength(void) const;
 
+private:
     /**
-     * Process service workers.
+     * A reference of message destination IPv6 address.
      *
-     * @retval OT_ERROR_NONE  Successfully processed.
+     */
+    Ip6::Address mDestinationAddress;
+    /**
+     * Message destination port.
      *
      */
-    otError Process(void);
-
+    uint16_t mDestinationPort;
     /**
-     * Establish MQTT-SN connection with gateway.
+     * MQTT-SN Message ID.
      *
-     * @param[in]  aConfig  A reference to configuration object with connection parameters.
+     */
+    uint16_t mMessageId;
+    /**
+     * Time stamp of message in milliseconds for timeout evaluation.
      *
-     * @retval OT_ERROR_NONE           Connection message successfully queued.
-     * @retval OT_ERROR_INVALID_ARGS   Invalid connection parameters.
-     * @retval OT_ERROR_INVALID_STATE  The client is in invalid state. It must be disconnected before new connection establishment.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     */
+    uint32_t mTimestamp;
+    /**
+     * Time in millisecond after which message is message timeout invoked.
      *
      */
-    otError Connect(MqttsnConfig &aConfig);
-
+    uint32_t mRetransmissionTimeout;
     /**
-     * Subscribe to the topic by topic name string.
+     * Number of remaining message retransmissions.
      *
-     * @param[in]  aTopicName         A pointer to long topic name string.
-     * @param[in]  aIsShortTopicName  Set to true when subscribing by long topic name or false in case of short topic name.
-     * @param[in]  aQos               Quality of service level to be subscribed.
-     * @param[in]  aCallback          A function pointer to callback which is invoked when subscription is acknowledged.
-     * @param[in]  aContext           A pointer to context object passed to callback.
+     */
+    uint8_t mRetransmissionCount;
+    /**
+     * Waiting messages index slot of the message.
      *
-     * @retval OT_ERROR_NONE           Subscription message successfully queued.
-     * @retval OT_ERROR_INVALID_ARGS   Invalid subscription parameters.
-     * @retval OT_ERROR_INVALID_STATE  The client cannot connect in active state.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     */
+    uint8_t mIndexSlot;
+    /**
+     * The message was retransmitted, its acknowledgement is not used for round trip time measurement.
      *
      */
-    otError Subscribe(const char* aTopicName, bool aIsShortTopicName, Qos aQos, SubscribeCallbackFunc aCallback, void* aContext);
+    bool mRetransmitted;
+    /**
+     * A function pointer for handling message timeout.
+     *
+     */
+    CallbackType mCallback;
+    /**
+     * A pointer to callback passed to timeout callback.
+     *
+     */
+    void* mContext;
+};
 
+/**
+ * The class represents the queue which contains messages waiting for acknowledgements from gateway.
+ *
+ */
+template <typename CallbackType>
+class WaitingMessagesQueue : public WaitingMessagesQueueBase
+{
+public:
     /**
-     * Subscribe to the topic by topic ID.
+     * Declaration of a function pointer which is used as timeout callback.
      *
-     * @param[in]  aTopicId   Topic ID to subscribe to.
-     * @param[in]  aCallback  A function pointer to callback which is invoked when subscription is acknowledged.
-     * @param[in]  aContext   A pointer to context object passed to callback.
+     */
+    typedef void (*TimeoutCallbackFunc)(const MessageMetadata<CallbackType> &aMetadata, void* aContext);
+
+    /**
+     * Declaration of a function pointer which is used to send message retransmission. The function takes
+     * ownership of the message.
      *
-     * @retval OT_ERROR_NONE           Subscription message successfully queued.
-     * @retval OT_ERROR_INVALID_ARGS   Invalid subscription parameters.
-     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
      */
-    otError Subscribe(TopicId aTopicId, Qos aQos, SubscribeCallbackFunc aCallback, void* aContext);
+    typedef void (*RetransmissionFunc)(Message &aMessage, const Ip6::Address &aAddress, uint16_t aPort, void* aContext);
 
     /**
-     * Register to topic with long topic name and obtain related topic ID.
+     * This constructor initializes the object with specific values.
      *
-     * @param[in]  aTopicName  A pointer to long topic name string.
-     * @param[in]  aCallback   A function pointer to callback invoked when registration is acknowledged.
-     * @param[in]  aContext    A pointer to context object passed to callback.
+     * @param[in]  aTimeoutCallback        A function pointer to callback which is invoked on message timeout.
+     * @param[in]  aTimeoutContext         A pointer to context passed to timeout callback.
+     * @param[in]  aRetransmissionFunc     A function pointer to function which sends message retransmission.
+     * @param[in]  aRetransmissionContext  A pointer to context passed to retransmission function.
+     * @param[in]  aWaitingMessagesIndex   A reference to index used for timeout evaluation and message lookup.
      *
-     * @retval OT_ERROR_NONE           Registration message successfully queued.
-     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     */
+    WaitingMessagesQueue(TimeoutCallbackFunc aTimeoutCallback, void* aTimeoutContext, RetransmissionFunc aRetransmissionFunc, void* aRetransmissionContext, WaitingMessagesIndex &aWaitingMessagesIndex);
+
+    /**
+     * Default object destructor.
      *
      */
-    otError Register(const char* aTopicName, RegisterCallbackFunc aCallback, void* aContext);
+    ~WaitingMessagesQueue(void);
+
+    /**
+     * Enqueue message to waiting queue without copying it. Metadata are appended to the message and the queue takes
+     * ownership of the message on success.
+     *
+     * @param[in]  aMessage   A reference to message object to be enqueued.
+     * @param[in]  aMetadata  A reference to message metadata.
+     *
+     * @retval OT_ERROR_NONE     Successfully enqueued the message.
+     * @retval OT_ERROR_NO_BUFS  Insufficient available buffers to enqueue the message or waiting messages index is full.
+     *
+     */
+    otError Enqueue(Message &aMessage, const MessageMetadata<CallbackType> &aMetadata);
+
+    /**
+     * Dequeue specific message from waiting queue.
+     *
+     * @param[in]  aMessage   A reference to message object to be dequeued.
+     *
+     * @retval OT_ERROR_NONE       Successfully dequeued the message.
+     * @retval OT_ERROR_NOT_FOUND  Message was not found in waiting queue.
+     *
+     */
+    otError Dequeue(Message &aMessage);
+
+    /**
+     * Find message by message ID and read message metadata.
+     *
+     * @param[in]  aMessageId  Message ID.
+     * @param[out] aMetadata   A reference to initialized metadata object.
+     *
+     * @returns  If the message is found the message ID is returned or null otherwise.
+     *
+     */
+    Message* Find(uint16_t aMessageId, MessageMetadata<CallbackType> &aMetadata);
+
+    /**
+     * Evaluate expired message timeout and retransmission. Expired message is retransmitted with doubled
+     * timeout until retransmission count is exhausted. Then timeout callback is invoked and message is dequeued.
+     *
+     * @param[in]  aMessage  A reference to expired message in the queue.
+     *
+     */
+    void HandleDeadline(Message &aMessage);
+
+    /**
+     * Force waiting messages timeout, invoke callback and empty queue.
+     *
+     */
+    void ForceTimeout(void);
+
+    /**
+     * Get number of messages in the queue.
+     *
+     * @returns Number of waiting messages.
+     *
+     */
+    uint16_t GetCount(void) const
+    {
+        return mCount;
+    }
+
+private:
+    MessageQueue mQueue;
+    uint16_t mCount;
+    TimeoutCallbackFunc mTimeoutCallback;
+    void* mTimeoutContext;
+    RetransmissionFunc mRetransmissionFunc;
+    void* mRetransmissionContext;
+    WaitingMessagesIndex &mWaitingMessagesIndex;
+};
+
+/**
+ * This class contains MQTT-SN connection parameters.
+ *
+ */
+class MqttsnConfig
+{
+public:
+
+    /**
+     * Default constructor for the object.
+     *
+     */
+    MqttsnConfig(void)
+        : mAddress()
+        , mPort()
+        , mClientId()
+        , mKeepAlive(30)
+        , mCleanSession()
+        , mRetransmissionTimeout(10)
+        , mRetransmissionCount(3)
+        , mRetransmissionJitter(25)
+        , mMaxInFlightQos1(8)
+        , mMaxInFlightQos2(4)
+        , mRestoreSession(false)
+        , mReconnectBackoffBase(1000)
+        , mReconnectBackoffMax(60000)
+        , mKeepAliveJitter(10)
+        , mFastPollPeriod(200)
+    {
+        ;
+    }
+
+    /**
+     * Get gateway IPv6 address.
+     *
+     * @returns A reference to IPv6 address.
+     *
+     */
+    const Ip6::Address &GetAddress()
+    {
+        return mAddress;
+    }
+
+    /**
+     * Set gateway IPv6 address.
+     *
+     * @param[in]  aAddress  A reference to gateway IPv6 address.
+     *
+     */
+    void SetAddress(const Ip6::Address &aAddress)
+    {
+        mAddress = aAddress;
+    }
+
+    /**
+     * Get gateway interface port number.
+     *
+     * @returns Gateway port number.
+     *
+     */
+    uint16_t GetPort()
+    {
+        return mPort;
+    }
+
+    /**
+     * Set gateway interface port number.
+     *
+     * @param[in]  aPort  Gateway port number.
+     *
+     */
+    void SetPort(uint16_t aPort)
+    {
+        mPort = aPort;
+    }
+
+    /**
+     * Get client ID.
+     *
+     * @returns Cliend ID string.
+     *
+     */
+    const ClientIdString &GetClientId()
+    {
+        return mClientId;
+    }
+
+    /**
+     * Set client ID.
+     *
+     * @param[in]  aClientId  A pointer to client ID string.
+     *
+     */
+    void SetClientId(const char* aClientId)
+    {
+        mClientId.Set("%s", aClientId);
+    }
+
+    /**
+     * Get keepalive period in seconds.
+     *
+     * @returns Keepalive time in seconds.
+     *
+     */
+    int16_t GetKeepAlive()
+    {
+        return mKeepAlive;
+    }
+
+    /**
+     * Set keepalive period in seconds.
+     *
+     * @param[in]  Keepalive time in seconds.
+     *
+     */
+    void SetKeepAlive(int16_t aDuration)
+    {
+        mKeepAlive = aDuration;
+    }
+
+    /**
+     * Get clean session flag.
+     *
+     * @returns Clean session flag.
+     *
+     */
+    bool GetCleanSession()
+    {
+        return mCleanSession;
+    }
+
+    /**
+     * Set clean session flag.
+     *
+     * @param[in]  aCleanSession  Clean session flag.
+     *
+     */
+    void SetCleanSession(bool aCleanSession)
+    {
+        mCleanSession = aCleanSession;
+    }
+
+    /**
+     * Get initial retransmission timeout in seconds.
+     *
+     * @returns Retransmission timeout in seconds.
+     *
+     */
+    uint32_t GetRetransmissionTimeout()
+    {
+        return mRetransmissionTimeout;
+    }
+
+    /**
+     * Set initial retransmission timeout in seconds. The timeout is used until round trip time to the gateway
+     * is measured or estimated from Thread route cost, then the timeout is derived from the measurement.
+     *
+     * @param[in]  aTimeout  Retransmission timeout value in seconds.
+     *
+     */
+    void SetRetransmissionTimeout(uint32_t aTimeout)
+    {
+        mRetransmissionTimeout = aTimeout;
+    }
+
+    /**
+     * Get number of message retransmissions before the message times out.
+     *
+     * @returns Retransmission count.
+     *
+     */
+    uint8_t GetRetransmissionCount()
+    {
+        return mRetransmissionCount;
+    }
+
+    /**
+     * Set number of message retransmissions before the message times out. Retransmission timeout is doubled
+     * with each retransmission.
+     *
+     * @param[in]  aCount  Retransmission count.
+     *
+     */
+    void SetRetransmissionCount(uint8_t aCount)
+    {
+        mRetransmissionCount = aCount;
+    }
+
+    /**
+     * Get retransmission timeout jitter in percent.
+     *
+     * @returns Retransmission timeout jitter in percent.
+     *
+     */
+    uint8_t GetRetransmissionJitter()
+    {
+        return mRetransmissionJitter;
+    }
+
+    /**
+     * Set retransmission timeout jitter in percent. Initial retransmission timeout of each message is randomly
+     * prolonged by up to this percentage.
+     *
+     * @param[in]  aJitter  Retransmission timeout jitter in percent.
+     *
+     */
+    void SetRetransmissionJitter(uint8_t aJitter)
+    {
+        mRetransmissionJitter = aJitter;
+    }
+
+    /**
+     * Get maximal number of QoS level 1 PUBLISH messages waiting for acknowledgement.
+     *
+     * @returns Maximal number of in-flight messages, zero means no limit.
+     *
+     */
+    uint8_t GetMaxInFlightQos1()
+    {
+        return mMaxInFlightQos1;
+    }
+
+    /**
+     * Set maximal number of QoS level 1 PUBLISH messages waiting for acknowledgement. Publishing beyond
+     * the limit is rejected until PUBACK or timeout frees the window.
+     *
+     * @param[in]  aCount  Maximal number of in-flight messages, zero means no limit.
+     *
+     */
+    void SetMaxInFlightQos1(uint8_t aCount)
+    {
+        mMaxInFlightQos1 = aCount;
+    }
+
+    /**
+     * Get maximal number of QoS level 2 PUBLISH messages with unfinished PUBREC/PUBREL/PUBCOMP exchange.
+     *
+     * @returns Maximal number of in-flight messages, zero means no limit.
+     *
+     */
+    uint8_t GetMaxInFlightQos2()
+    {
+        return mMaxInFlightQos2;
+    }
+
+    /**
+     * Set maximal number of QoS level 2 PUBLISH messages with unfinished PUBREC/PUBREL/PUBCOMP exchange.
+     * Publishing beyond the limit is rejected until PUBCOMP or timeout frees the window.
+     *
+     * @param[in]  aCount  Maximal number of in-flight messages, zero means no limit.
+     *
+     */
+    void SetMaxInFlightQos2(uint8_t aCount)
+    {
+        mMaxInFlightQos2 = aCount;
+    }
+
+    /**
+     * Get session restore flag.
+     *
+     * @returns True if topic registrations and subscriptions are restored after connection.
+     *
+     */
+    bool GetRestoreSession()
+    {
+        return mRestoreSession;
+    }
+
+    /**
+     * Set session restore flag. When set and new session is started with clean session flag, topic registrations
+     * and subscriptions of previous session are sent again right after CONNACK is received. The messages are
+     * pipelined within QoS level 1 in-flight limit and completion is reported by single callback.
+     *
+     * @param[in]  aRestoreSession  True if registrations and subscriptions are restored.
+     *
+     */
+    void SetRestoreSession(bool aRestoreSession)
+    {
+        mRestoreSession = aRestoreSession;
+    }
+
+    /**
+     * Get minimal reconnect delay in milliseconds.
+     *
+     * @returns Minimal reconnect delay in milliseconds.
+     *
+     */
+    uint32_t GetReconnectBackoffBase()
+    {
+        return mReconnectBackoffBase;
+    }
+
+    /**
+     * Set minimal reconnect delay in milliseconds. Each reconnect delay is chosen randomly between this value
+     * and three times the previous delay (decorrelated jitter), so clients which lost the same gateway do not
+     * reconnect at once. Zero disables the delay.
+     *
+     * @param[in]  aDelay  Minimal reconnect delay in milliseconds.
+     *
+     */
+    void SetReconnectBackoffBase(uint32_t aDelay)
+    {
+        mReconnectBackoffBase = aDelay;
+    }
+
+    /**
+     * Get maximal reconnect delay in milliseconds.
+     *
+     * @returns Maximal reconnect delay in milliseconds.
+     *
+     */
+    uint32_t GetReconnectBackoffMax()
+    {
+        return mReconnectBackoffMax;
+    }
+
+    /**
+     * Set maximal reconnect delay in milliseconds.
+     *
+     * @param[in]  aDelay  Maximal reconnect delay in milliseconds.
+     *
+     */
+    void SetReconnectBackoffMax(uint32_t aDelay)
+    {
+        mReconnectBackoffMax = aDelay;
+    }
+
+    /**
+     * Get keepalive jitter in percent.
+     *
+     * @returns Keepalive jitter in percent.
+     *
+     */
+    uint8_t GetKeepAliveJitter()
+    {
+        return mKeepAliveJitter;
+    }
+
+    /**
+     * Set keepalive jitter in percent. Each keepalive PINGREQ interval is randomly shortened by up to this
+     * percentage, so PINGREQs of clients connected at the same time drift apart.
+     *
+     * @param[in]  aJitter  Keepalive jitter in percent, at most 100.
+     *
+     */
+    void SetKeepAliveJitter(uint8_t aJitter)
+    {
+        mKeepAliveJitter = aJitter;
+    }
+
+    /**
+     * Get data poll period used by sleepy end device while waiting for response.
+     *
+     * @returns Fast poll period in milliseconds.
+     *
+     */
+    uint32_t GetFastPollPeriod()
+    {
+        return mFastPollPeriod;
+    }
+
+    /**
+     * Set data poll period used by sleepy end device while waiting for response. Parent keeps the response
+     * until the next data poll, so the client polls faster while any acknowledgement, CONNACK or PINGRESP
+     * is outstanding and restores previous poll period when all transactions are finished.
+     *
+     * @param[in]  aPeriod  Fast poll period in milliseconds, zero disables fast polling.
+     *
+     */
+    void SetFastPollPeriod(uint32_t aPeriod)
+    {
+        mFastPollPeriod = aPeriod;
+    }
+
+private:
+    Ip6::Address mAddress;
+    uint16_t mPort;
+    ClientIdString mClientId;
+    uint16_t mKeepAlive;
+    bool mCleanSession;
+    uint32_t mRetransmissionTimeout;
+    uint8_t mRetransmissionCount;
+    uint8_t mRetransmissionJitter;
+    uint8_t mMaxInFlightQos1;
+    uint8_t mMaxInFlightQos2;
+    bool mRestoreSession;
+    uint32_t mReconnectBackoffBase;
+    uint32_t mReconnectBackoffMax;
+    uint8_t mKeepAliveJitter;
+    uint32_t mFastPollPeriod;
+};
+
+/**
+ * The class representing MQTT-SN protocol client.
+ *
+ */
+class MqttsnClient: public InstanceLocator
+{
+public:
+    /**
+     * Declaration of function for connection callback.
+     *
+     * @param[in]  aCode     CONNACK return code value or -1 when connection establishment timed out.
+     * @param[in]  aContext  A pointer to connection callback context object.
+     *
+     */
+    typedef void (*ConnectedCallbackFunc)(ReturnCode aCode, void* aContext);
+
+    /**
+     * Declaration of function for subscribe callback.
+     *
+     * @param[in]  aCode     SUBACK return code or -1 when subscription timed out.
+     * @param[in]  aTopicId  Subscribed topic ID. The value is 0 when timed out or subscribed by short topic name.
+     * @param[in]  aQos      Subscribed quality of service level.
+     * @param[in]  aContext  A pointer to subscription callback context object.
+     *
+     */
+    typedef void (*SubscribeCallbackFunc)(ReturnCode aCode, TopicId aTopicId, Qos aQos, void* aContext);
+
+    /**
+     * Declaration of function for callback invoked when publish message received.
+     *
+     * @param[in]  aMessage         A reference to received message. The message is valid only during the callback.
+     * @param[in]  aPayloadOffset   PUBLISH message payload offset in the message.
+     * @param[in]  aPayloadLength   PUBLISH message payload length.
+     * @param[in]  aTopicIdType     Topic ID type. Possible values are kTopicId or kShortTopicName.
+     * @param[in]  aTopicId         PUBLISH message topic ID. It is set only when aTopicIdType is kTopicId.
+     * @param[in]  aShortTopicName  PUBLISH message short topic name. It is set only when aTopicIdType is kShortTopicName.
+     * @param[in]  aContext         A pointer to publish received callback context object.
+     *
+     * @returns  Code to be send in response PUBACK message. Timeout value is not relevant.
+     */
+    typedef ReturnCode (*PublishReceivedCallbackFunc)(const Message &aMessage, uint16_t aPayloadOffset, int32_t aPayloadLength, TopicIdType aTopicIdType, TopicId aTopicId, ShortTopicNameString aShortTopicName, void* aContext);
+
+    /**
+     * Declaration of function for advertise callback.
+     *
+     * @param[in]  aAddress    A reference to advertised gateway IPv6 address.
+     * @param[in]  aGatewayId  Advertised gateway ID.
+     * @param[in]  aDuration   Advertise message duration parameter.
+     * @param[in]  aContext    A pointer to advertise callback context object.
+     *
+     */
+    typedef void (*AdvertiseCallbackFunc)(const Ip6::Address &aAddress, uint8_t aGatewayId, uint32_t aDuration, void* aContext);
+
+    /**
+     * Declaration of function for search gateway callback.
+     *
+     * @param[in]  aAddress  A reference to IPv6 address of discovered gateway.
+     * @param[in]  aAddress  Discovered gateway ID.
+     * @param[in]  aContext  A pointer to search gateway context object.
+     *
+     */
+    typedef void (*SearchGwCallbackFunc)(const Ip6::Address &aAddress, uint8_t aGatewayId, void* aContext);
+
+    /**
+     * Declaration of function for expanding ring gateway search callback.
+     *
+     * @param[in]  aGateway  A pointer to the best gateway in gateway table or null when no gateway was found.
+     * @param[in]  aContext  A pointer to search gateway context object.
+     *
+     */
+    typedef void (*SearchGwFinishedCallbackFunc)(const GatewayTable::Entry* aGateway, void* aContext);
+
+    /**
+     * Declaration of function for register callback.
+     *
+     * @param[in]  aCode     REGACK return code or -1 when subscription timed out.
+     * @param[in]  aTopicId  Registered topic ID.
+     * @param[in]  aContext  A pointer to register callback context object.
+     *
+     */
+    typedef void (*RegisterCallbackFunc)(ReturnCode aCode, TopicId aTopicId, void* aContext);
+
+    /**
+     * Declaration of function for callback invoked when register message received.
+     *
+     * @param[in]  aTopicId    Registered topic ID.
+     * @param[in]  aTopicName  Long topic name string mapped to registered topic.
+     * @param[in]  aContext    A pointer to register received callback context object.
+     *
+     * @returns  Code to be send in response REGACK message. Timeout value is not relevant.
+     *
+     */
+    typedef ReturnCode (*RegisterReceivedCallbackFunc)(TopicId aTopicId, const TopicNameString &aTopicName, void* aContext);
+
+    /**
+     * Declaration of function for publish callback. It is invoked only when quality of service level is 1 or 2.
+     *
+     * @param[in]  aCode     Publish response code or -1 when publish timed out.
+     * @param[in]  aTopicId  Topic ID of published message. It is set to 0 when timed out or short topic name is used.
+     * @param[in]  aContext  A pointer to publish callback context object.
+     *
+     */
+    typedef void (*PublishCallbackFunc)(ReturnCode aCode, void* aContext);
+
+    /**
+     * Declaration of function for unsubscribe callback.
+     *
+     * @param[in]  aCode     UNSUBACK response code or -1 when publish timed out.
+     * @param[in]  aContext  A pointer to unsubscribe callback context object.
+     *
+     */
+    typedef void (*UnsubscribeCallbackFunc)(ReturnCode aCode, void* aContext);
+
+    /**
+     * Declaration of function for disconnection callback.
+     *
+     * @param[in]  aType     Disconnection reason.
+     * @param[in]  aContext  A pointer to disconnection callback context object.
+     *
+     */
+    typedef void (*DisconnectedCallbackFunc)(DisconnectType aType, void* aContext);
+
+    /**
+     * Declaration of function for publish window opened callback. It is invoked when publish with the QoS level
+     * was rejected for full in-flight window and acknowledgement or timeout freed the window since then.
+     *
+     * @param[in]  aQos      Quality of service level of the opened window.
+     * @param[in]  aContext  A pointer to callback context object.
+     *
+     */
+    typedef void (*PublishWindowOpenedCallbackFunc)(Qos aQos, void* aContext);
+
+    /**
+     * Declaration of function for session restored callback.
+     *
+     * @param[in]  aCode      kCodeAccepted when all registrations and subscriptions were restored, otherwise
+     *                        return code of the last failed request or -1 when a request timed out.
+     * @param[in]  aDuration  Time from CONNECT to restore completion in milliseconds.
+     * @param[in]  aContext   A pointer to callback context object.
+     *
+     */
+    typedef void (*SessionRestoredCallbackFunc)(ReturnCode aCode, uint32_t aDuration, void* aContext);
+
+    /**
+     * Declaration of function for batch subscription or registration callback.
+     *
+     * @param[in]  aResults  A pointer to array of per-topic results in order of requested topic names.
+     *                       The array is valid only during the callback.
+     * @param[in]  aCount    Number of results.
+     * @param[in]  aContext  A pointer to callback context object.
+     *
+     */
+    typedef void (*BatchCallbackFunc)(const TopicResult* aResults, uint8_t aCount, void* aContext);
+
+    /**
+     * This constructor initializes the object.
+     *
+     * @param[in]  aInstance  A reference to the OpenThread instance.
+     *
+     */
+    MqttsnClient(Instance &aInstance);
+
+    /**
+     * Default object destructor.
+     *
+     */
+    ~MqttsnClient(void);
+
+    /**
+     * Start MQTT-SN service and start connection and listening.
+     *
+     * @param[in]  aPort  MQTT-SN client listening port.
+     *
+     * @retval OT_ERROR_NONE  Successfully started the service.
+     *
+     */
+    otError Start(uint16_t aPort);
+
+    /**
+     * Stop MQTT-SN service.
+     *
+     * @retval OT_ERROR_NONE  Successfully stopped the service.
+     *
+     */
+    otError Stop(void);
+
+    /**
+     * Establish MQTT-SN connection with gateway. With clean session flag cleared the client restores topic
+     * registry and subscriptions stored for the same client ID and gateway, otherwise the stored session is removed.
+     *
+     * @param[in]  aConfig  A reference to configuration object with connection parameters.
+     *
+     * @retval OT_ERROR_NONE           Connection message successfully queued.
+     * @retval OT_ERROR_INVALID_ARGS   Invalid connection parameters.
+     * @retval OT_ERROR_INVALID_STATE  The client is in invalid state. It must be disconnected before new connection establishment.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError Connect(MqttsnConfig &aConfig);
+
+    /**
+     * Subscribe to the topic by topic name string. When the client is already subscribed to the long topic name
+     * with the same QoS level in current or restored session, the callback is invoked immediately and no message
+     * is sent.
+     *
+     * @param[in]  aTopicName         A pointer to long topic name string.
+     * @param[in]  aIsShortTopicName  Set to true when subscribing by long topic name or false in case of short topic name.
+     * @param[in]  aQos               Quality of service level to be subscribed.
+     * @param[in]  aCallback          A function pointer to callback which is invoked when subscription is acknowledged.
+     * @param[in]  aContext           A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE           Subscription message successfully queued.
+     * @retval OT_ERROR_INVALID_ARGS   Invalid subscription parameters.
+     * @retval OT_ERROR_INVALID_STATE  The client cannot connect in active state.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError Subscribe(const char* aTopicName, bool aIsShortTopicName, Qos aQos, SubscribeCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Subscribe to the topic by topic ID.
+     *
+     * @param[in]  aTopicId   Topic ID to subscribe to.
+     * @param[in]  aCallback  A function pointer to callback which is invoked when subscription is acknowledged.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE           Subscription message successfully queued.
+     * @retval OT_ERROR_INVALID_ARGS   Invalid subscription parameters.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     */
+    otError Subscribe(TopicId aTopicId, Qos aQos, SubscribeCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Register to topic with long topic name and obtain related topic ID. When the topic ID is already known
+     * in current or restored session, the callback is invoked immediately and no message is sent.
+     *
+     * @param[in]  aTopicName  A pointer to long topic name string.
+     * @param[in]  aCallback   A function pointer to callback invoked when registration is acknowledged.
+     * @param[in]  aContext    A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE           Registration message successfully queued.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError Register(const char* aTopicName, RegisterCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Subscribe to multiple topics by long topic names. SUBSCRIBE messages are sent back-to-back without waiting
+     * for acknowledgements and the callback is invoked once when all topics are acknowledged or timed out.
+     * Topics already subscribed with the same QoS level are reported as accepted without sending a message.
+     * Only one batch can be in progress.
+     *
+     * @param[in]  aTopicNames  A pointer to array of long topic name strings.
+     * @param[in]  aCount       Number of topic names, at most kMaxBatchTopics.
+     * @param[in]  aQos         Quality of service level to be subscribed.
+     * @param[in]  aCallback    A function pointer to callback invoked when the batch completes.
+     * @param[in]  aContext     A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE           Subscription messages successfully sent.
+     * @retval OT_ERROR_INVALID_ARGS   Invalid subscription parameters.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
+     * @retval OT_ERROR_BUSY           Another batch is in progress.
+     * @retval OT_ERROR_NO_BUFS        Topic registry is full.
+     *
+     */
+    otError SubscribeBatch(const char* const* aTopicNames, uint8_t aCount, Qos aQos, BatchCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Register multiple topics by long topic names. REGISTER messages are sent back-to-back without waiting
+     * for acknowledgements and the callback is invoked once when all topics are acknowledged or timed out.
+     * Topics with already known topic ID are reported as accepted without sending a message. Only one batch
+     * can be in progress.
+     *
+     * @param[in]  aTopicNames  A pointer to array of long topic name strings.
+     * @param[in]  aCount       Number of topic names, at most kMaxBatchTopics.
+     * @param[in]  aCallback    A function pointer to callback invoked when the batch completes.
+     * @param[in]  aContext     A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE           Registration messages successfully sent.
+     * @retval OT_ERROR_INVALID_ARGS   Invalid registration parameters.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
+     * @retval OT_ERROR_BUSY           Another batch is in progress.
+     * @retval OT_ERROR_NO_BUFS        Topic registry is full.
+     *
+     */
+    otError RegisterBatch(const char* const* aTopicNames, uint8_t aCount, BatchCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Publish message to the topic with specific short topic name.
+     *
+     * @param[in]  aData            A pointer to byte array to be send as message payload.
+     * @param[in]  aLength          Length of message payload data.
+     * @param[in]  aQos             Message quality of service level.
+     * @param[in]  aShortTopicName  A pointer to short topic name string of target topic.
+     * @param[in]  aCallback        A function pointer to callback invoked when registration is acknowledged.
+     * @param[in]  aContext         A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE           Publish message successfully queued.
+     * @retval OT_ERROR_INVALID_ARGS   Invalid publish parameters. Short topic name must have one or two characters.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
+     * @retval OT_ERROR_BUSY           In-flight window of the QoS level is full.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError Publish(const uint8_t* aData, int32_t aLength, Qos aQos, const char* aShortTopicName, PublishCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Publish message to the topic with specific topic ID.
+     *
+     * @param[in]  aData      A pointer to byte array to be send as message payload.
+     * @param[in]  aLength    Length of message payload data.
+     * @param[in]  aQos       Message quality of service level.
+     * @param[in]  aTopicId   Topic ID of target topic.
+     * @param[in]  aCallback  A function pointer to callback invoked when registration is acknowledged.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE           Publish message successfully queued.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
+     * @retval OT_ERROR_BUSY           In-flight window of the QoS level is full.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError Publish(const uint8_t* aData, int32_t aLength, Qos aQos, TopicId aTopicId, PublishCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Publish message to the topic with specific topic name. Topic ID is taken from the topic registry. When
+     * the topic is not registered yet REGISTER message is sent and the publish waits for REGACK.
+     *
+     * @param[in]  aTopicName  A pointer to topic name string.
+     * @param[in]  aData       A pointer to byte array to be send as message payload.
+     * @param[in]  aLength     Length of message payload data.
+     * @param[in]  aQos        Message quality of service level.
+     * @param[in]  aCallback   A function pointer to callback invoked when publish is acknowledged or fails.
+     * @param[in]  aContext    A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE           Publish message successfully queued.
+     * @retval OT_ERROR_INVALID_ARGS   Invalid topic name or QoS level -1.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
+     * @retval OT_ERROR_BUSY           In-flight window of the QoS level or pending publishes queue is full.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process or topic registry is full.
+     *
+     */
+    otError Publish(const char* aTopicName, const uint8_t* aData, int32_t aLength, Qos aQos, PublishCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Get topic ID of the topic name from topic registry. Registry learns topic IDs from REGACK and from
+     * REGISTER messages sent by gateway.
+     *
+     * @param[in]   aTopicName  A pointer to topic name string.
+     * @param[out]  aTopicId    A reference to topic ID.
+     *
+     * @retval OT_ERROR_NONE       Topic ID found.
+     * @retval OT_ERROR_NOT_FOUND  Topic name is not registered.
+     *
+     */
+    otError GetTopicId(const char* aTopicName, TopicId &aTopicId);
+
+    /**
+     * Get topic name of the topic ID from topic registry.
+     *
+     * @param[in]  aTopicId  Topic ID.
+     *
+     * @returns  A pointer to topic name string or null if the topic ID is not registered.
+     *
+     */
+    const char* GetTopicName(TopicId aTopicId);
+
+    /**
+     * Publish message to the topic with specific short topic name with QoS level -1. No connection or subscription is required.
+     *
+     * @param[in]  aData            A pointer to byte array to be send as message payload.
+     * @param[in]  aLength          Length of message payload data.
+     * @param[in]  aShortTopicName  A pointer to short topic name string of target topic.
+     * @param[in]  aAddress         Gateway address.
+     * @param[in]  aPort            Gateway port.
+     *
+     * @retval OT_ERROR_NONE           Publish message successfully queued.
+     * @retval OT_ERROR_INVALID_ARGS   Invalid publish parameters. Short topic name must have one or two characters.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError PublishQosm1(const uint8_t* aData, int32_t aLength, const char* aShortTopicName, Ip6::Address aAddress, uint16_t aPort);
+
+    /**
+     * Publish message to the topic with specific topic ID with QoS level -1. No connection or subscription is required.
+     *
+     * @param[in]  aData      A pointer to byte array to be send as message payload.
+     * @param[in]  aLength    Length of message payload data.
+     * @param[in]  aTopicId   Topic ID of target topic.
+     * @param[in]  aAddress   Gateway address.
+     * @param[in]  aPort      Gateway port.
+     *
+     * @retval OT_ERROR_NONE           Publish message successfully queued.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError PublishQosm1(const uint8_t* aData, int32_t aLength, TopicId aTopicId, Ip6::Address aAddress, uint16_t aPort);
+
+    /**
+     * Unsubscribe from the topic with specific short topic name.
+     *
+     * @param[in]  aShortTopicName  A pointer to short topic name string of target topic.
+     * @param[in]  aCallback        A function pointer to callback invoked when unsubscription is acknowledged.
+     * @param[in]  aContext         A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE           Unsubscribe message successfully queued.
+     * @retval OT_ERROR_INVALID_ARGS   Invalid unsubscribe parameters. Short topic name must have one or two characters.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError Unsubscribe(const char* aShortTopicName, UnsubscribeCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Unsubscribe from the topic with specific topic ID.
+     *
+     * @param[in]  aTopicId   A pointer to short topic name string of target topic.
+     * @param[in]  aCallback  A function pointer to callback invoked when unsubscription is acknowledged.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE           Unsubscribe message successfully queued.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to unsubscribe.
+     *
+     */
+    otError Unsubscribe(TopicId aTopicId, UnsubscribeCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Disconnect MQTT-SN client from gateway.
+     *
+     * @retval OT_ERROR_NONE           Disconnection message successfully queued.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in relevant state. It must be asleep, awake or active.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError Disconnect(void);
+
+    /**
+     * Put the client into asleep state or change sleep duration. Client must be awaken or reconnected before duration time passes.
+     *
+     * @param[in]  aDuration  Duration time for which will the client stay in asleep state.
+     *
+     * @retval OT_ERROR_NONE           Sleep request successfully queued.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in relevant state. It must be asleep, awake or active.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError Sleep(uint16_t aDuration);
+
+    /**
+     * Awake the client and receive pending messages.
+     *
+     * @param[in]  aTimeout  Timeout in milliseconds for staying in awake state. PINGRESP message must be received before timeout time passes.
+     *
+     * @retval OT_ERROR_NONE           Awake request successfully queued.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in relevant state. It must be asleep or awake.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError Awake(uint32_t aTimeout);
+
+    /**
+     * Search for gateway with multicast message.
+     *
+     * @param[in]  aMulticastAddress  A reference to multicast IPv6 address.
+     * @param[in]  aPort              Gateway port number.
+     * @param[in]  aRadius            Message hop limit (time to live)
+     *
+     * @retval OT_ERROR_NONE           Search gateway request successfully queued.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError SearchGateway(const Ip6::Address &aMulticastAddress, uint16_t aPort, uint8_t aRadius);
+
+    /**
+     * Establish MQTT-SN connection with the best gateway from gateway table. Address and port of the gateway
+     * are set to the configuration. When connection to the gateway is lost, the client connects to the next best
+     * gateway with the same configuration after randomized reconnect delay and the connected callback is invoked
+     * again.
+     * Disconnected callback with kTimeout is invoked only when no other gateway is available.
+     *
+     * @param[in]  aConfig  A reference to configuration object with connection parameters.
+     *
+     * @retval OT_ERROR_NONE           Connection message successfully queued.
+     * @retval OT_ERROR_NOT_FOUND      No gateway is available.
+     * @retval OT_ERROR_INVALID_STATE  The client is in invalid state. It must be disconnected before new connection establishment.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError ConnectBestGateway(MqttsnConfig &aConfig);
+
+    /**
+     * Get delay before the next reconnect attempt. The delay is chosen randomly between reconnect backoff
+     * base and three times the previous delay limited by reconnect backoff maximum of current configuration.
+     * The delay starts from the base again when connection is accepted. Application should wait for the delay
+     * before it reconnects after disconnection, so clients of restarted gateway do not reconnect at once.
+     *
+     * @returns Reconnect delay in milliseconds.
+     *
+     */
+    uint32_t NextReconnectDelay(void);
+
+    /**
+     * Search for gateway with expanding ring of multicast SEARCHGW messages. First message is sent after random
+     * delay with radius 1, radius is doubled up to the maximal radius while no gateway answers. Each ring waits
+     * kSearchGwRingTimeout milliseconds per hop. The search ends without sending any message when ADVERTISE
+     * or GWINFO sent to other client is heard during the delay, so that nodes which boot at once do not all
+     * flood the network. The callback is invoked once when the ring in which a gateway answered completes.
+     *
+     * @param[in]  aMulticastAddress  A reference to multicast IPv6 address.
+     * @param[in]  aPort              Gateway port number.
+     * @param[in]  aMaxRadius         Maximal message hop limit.
+     * @param[in]  aMaxJitter         Maximal random delay before first message in milliseconds.
+     * @param[in]  aCallback          A function pointer to callback invoked when the search finishes.
+     * @param[in]  aContext           A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE          Search successfully started.
+     * @retval OT_ERROR_INVALID_ARGS  Maximal radius is zero.
+     * @retval OT_ERROR_BUSY          Expanding ring search is already in progress.
+     *
+     */
+    otError SearchGatewayRing(const Ip6::Address &aMulticastAddress, uint16_t aPort, uint8_t aMaxRadius,
+        uint32_t aMaxJitter, SearchGwFinishedCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Add gateways published as Thread Network Data service to gateway table. The service is identified by
+     * MQTTSN_NETDATA_ENTERPRISE_NUMBER and MQTTSN_NETDATA_SERVICE_DATA, server data contains 16 bytes of gateway
+     * IPv6 address, 2 bytes of port in network byte order and 1 byte of gateway ID. The function is intended
+     * to be called when OT_CHANGED_THREAD_NETDATA is signaled, no message is sent.
+     *
+     * @retval OT_ERROR_NONE             At least one gateway found.
+     * @retval OT_ERROR_NOT_FOUND        No gateway service in Network Data.
+     * @retval OT_ERROR_NOT_IMPLEMENTED  OpenThread is built without service support.
+     *
+     */
+    otError DiscoverNetworkDataGateways(void);
+
+    /**
+     * Send PINGREQ message without client ID to each gateway in gateway table. Send time is stored in each
+     * gateway entry and PINGRESP from the gateway address updates round trip time of that gateway.
+     *
+     * @retval OT_ERROR_NONE       Probes successfully sent.
+     * @retval OT_ERROR_NOT_FOUND  Gateway table is empty.
+     * @retval OT_ERROR_NO_BUFS    Insufficient available buffers to process.
+     *
+     */
+    otError ProbeGateways(void);
+
+    /**
+     * Get table of gateways learned from ADVERTISE and GWINFO messages.
+     *
+     * @returns  A reference to gateway table.
+     *
+     */
+    GatewayTable &GetGatewayTable(void) { return mGatewayTable; }
+
+    /**
+     * Get current MQTT-SN client state.
+     *
+     * @returns Current client state.
+     *
+     */
+    ClientState GetState(void);
+
+    /**
+     * Set callback function invoked when connection acknowledged or timed out.
+     *
+     * @param[in]  aCallback  A function pointer to connect callback function.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE  Callback function successfully set.
+     *
+     */
+    otError SetConnectedCallback(ConnectedCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Set callback function invoked when publish message received from the topic.
+     *
+     * @param[in]  aCallback  A function pointer to publish received callback function.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE  Callback function successfully set.
+     *
+     */
+    otError SetPublishReceivedCallback(PublishReceivedCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Set callback function invoked when advertise message received from the gateway.
+     *
+     * @param[in]  aCallback  A function pointer to advertise callback function.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE  Callback function successfully set.
+     *
+     */
+    otError SetAdvertiseCallback(AdvertiseCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Set callback function invoked when gateway info received from gateway.
+     *
+     * @param[in]  aCallback  A function pointer to gateway info received callback function.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE  Callback function successfully set.
+     *
+     */
+    otError SetSearchGwCallback(SearchGwCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Set callback function invoked when disconnect acknowledged or timed out.
+     *
+     * @param[in]  aCallback  A function pointer to disconnect callback function.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE  Callback function successfully set.
+     *
+     */
+    otError SetDisconnectedCallback(DisconnectedCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Set callback function invoked when register acknowledged.
+     *
+     * @param[in]  aCallback  A function pointer to register callback function.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE  Callback function successfully set.
+     *
+     */
+    otError SetRegisterReceivedCallback(RegisterReceivedCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Set callback function invoked when full QoS level 1 or 2 in-flight window opens again.
+     *
+     * @param[in]  aCallback  A function pointer to callback invoked when the window opens.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE  Callback function successfully set.
+     *
+     */
+    otError SetPublishWindowOpenedCallback(PublishWindowOpenedCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Set callback function invoked when session restore completes.
+     *
+     * @param[in]  aCallback  A function pointer to callback invoked when the session is restored.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE  Callback function successfully set.
+     *
+     */
+    otError SetSessionRestoredCallback(SessionRestoredCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Get congestion control statistics.
+     *
+     * @param[out]  aStats  A reference to statistics structure to be filled.
+     *
+     */
+    void GetStats(ClientStats &aStats);
+
+protected:
+    /**
+     * Allocate new message and serialize MQTT-SN message directly to it.
+     *
+     * @param[out]  aMessage        A pointer to message pointer.
+     * @param[in]   aMqttsnMessage  A reference to MQTT-SN message to be serialized.
+     *
+     * @retval OT_ERROR_NONE      New message successfully created.
+     * @retval OT_ERROR_NO_BUFS   Insufficient available buffers to allocate new message.
+     * @retval OT_ERROR_FAILED    MQTT-SN message serialization failed.
+     *
+     */
+    otError NewMessage(Message **aMessage, const MessageBase &aMqttsnMessage);
+
+    /**
+     * Send copy of the message and retain the message in waiting queue for retransmissions. The function takes
+     * ownership of the message, it is freed on failure.
+     *
+     * @param[in]  aMessage   A reference to message to be sent.
+     * @param[in]  aQueue     A reference to waiting queue in which the message is retained.
+     * @param[in]  aMetadata  A reference to message metadata.
+     *
+     * @retval OT_ERROR_NONE     Message successfully sent and enqueued.
+     * @retval OT_ERROR_NO_BUFS  Insufficient available buffers to copy or enqueue the message.
+     *
+     */
+    template <typename CallbackType>
+    otError SendRetainedMessage(Message &aMessage, WaitingMessagesQueue<CallbackType> &aQueue, const MessageMetadata<CallbackType> &aMetadata);
 
     /**
-     * Publish message to the topic with specific short topic name.
+     * Send serialized PUBLISH message. QoS level 1 and 2 messages are retained in waiting queue. The function
+     * takes ownership of the message, it is freed on failure.
      *
-     * @param[in]  aData            A pointer to byte array to be send as message payload.
-     * @param[in]  aLength          Length of message payload data.
-     * @param[in]  aQos             Message quality of service level.
-     * @param[in]  aShortTopicName  A pointer to short topic name string of target topic.
-     * @param[in]  aCallback        A function pointer to callback invoked when registration is acknowledged.
-     * @param[in]  aContext         A pointer to context object passed to callback.
+     * @param[in]  aMessage    A reference to serialized PUBLISH message.
+     * @param[in]  aQos        Message quality of service level.
+     * @param[in]  aMessageId  MQTT-SN message ID of the message.
+     * @param[in]  aCallback   A function pointer to callback invoked when publish is acknowledged.
+     * @param[in]  aContext    A pointer to context object passed to callback.
      *
-     * @retval OT_ERROR_NONE           Publish message successfully queued.
-     * @retval OT_ERROR_INVALID_ARGS   Invalid publish parameters. Short topic name must have one or two characters.
-     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     * @retval OT_ERROR_NONE     Message successfully sent.
+     * @retval OT_ERROR_NO_BUFS  Insufficient available buffers to process.
      *
      */
-    otError Publish(const uint8_t* aData, int32_t aLength, Qos aQos, const char* aShortTopicName, PublishCallbackFunc aCallback, void* aContext);
+    otError SendPublishMessage(Message &aMessage, Qos aQos, uint16_t aMessageId, PublishCallbackFunc aCallback, void* aContext);
 
     /**
-     * Publish message to the topic with specific topic ID.
-     *
-     * @param[in]  aData      A pointer to byte array to be send as message payload.
-     * @param[in]  aLength    Length of message payload data.
-     * @param[in]  aQos       Message quality of service level.
-     * @param[in]  aTopicId   Topic ID of target topic.
-     * @param[in]  aCallback  A function pointer to callback invoked when registration is acknowledged.
-     * @param[in]  aContext   A pointer to context object passed to callback.
+     * Update topic registry with registration result and send or fail publishes waiting for the topic.
      *
-     * @retval OT_ERROR_NONE           Publish message successfully queued.
-     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     * @param[in]  aTopicName  A pointer to topic name string.
+     * @param[in]  aTopicId    Topic ID assigned by gateway.
+     * @param[in]  aCode       Registration return code.
      *
      */
-    otError Publish(const uint8_t* aData, int32_t aLength, Qos aQos, TopicId aTopicId, PublishCallbackFunc aCallback, void* aContext);
+    void HandleTopicRegistered(const char* aTopicName, TopicId aTopicId, ReturnCode aCode);
 
     /**
-     * Publish message to the topic with specific short topic name with QoS level -1. No connection or subscription is required.
+     * Send or fail publishes waiting for topic registration.
      *
-     * @param[in]  aData            A pointer to byte array to be send as message payload.
-     * @param[in]  aLength          Length of message payload data.
-     * @param[in]  aShortTopicName  A pointer to short topic name string of target topic.
-     * @param[in]  aAddress         Gateway address.
-     * @param[in]  aPort            Gateway port.
+     * @param[in]  aTopicIndex  Topic registry entry index or kAllTopics for all waiting publishes.
+     * @param[in]  aCode        Registration return code. Publishes are sent only when the topic was accepted.
      *
-     * @retval OT_ERROR_NONE           Publish message successfully queued.
-     * @retval OT_ERROR_INVALID_ARGS   Invalid publish parameters. Short topic name must have one or two characters.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     */
+    void FlushPendingPublishes(uint8_t aTopicIndex, ReturnCode aCode);
+
+    /**
+     * Send waiting publishes of registered topics which fit in-flight window. Publishes which do not fit
+     * stay queued until the window opens.
      *
      */
-    otError PublishQosm1(const uint8_t* aData, int32_t aLength, const char* aShortTopicName, Ip6::Address aAddress, uint16_t aPort);
+    void SendPendingPublishes(void);
 
     /**
-     * Publish message to the topic with specific topic ID with QoS level -1. No connection or subscription is required.
+     * Read MQTT-SN message retained in waiting queue without appended metadata.
      *
-     * @param[in]  aData      A pointer to byte array to be send as message payload.
-     * @param[in]  aLength    Length of message payload data.
-     * @param[in]  aTopicId   Topic ID of target topic.
-     * @param[in]  aAddress   Gateway address.
-     * @param[in]  aPort      Gateway port.
+     * @param[in]   aMessage         A reference to retained message.
+     * @param[in]   aMetadataLength  Length of appended metadata.
+     * @param[out]  aBuffer          A pointer to buffer with size MAX_CONTROL_PACKET_SIZE.
      *
-     * @retval OT_ERROR_NONE           Publish message successfully queued.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     * @returns  Length of the message or zero when it does not fit to the buffer.
      *
      */
-    otError PublishQosm1(const uint8_t* aData, int32_t aLength, TopicId aTopicId, Ip6::Address aAddress, uint16_t aPort);
+    uint16_t ReadRetainedMessage(const Message &aMessage, uint16_t aMetadataLength, uint8_t* aBuffer);
 
     /**
-     * Unsubscribe from the topic with specific short topic name.
+     * Store registration and subscription of the topic to non-volatile settings. Stored session is bound
+     * to client ID, gateway address and port.
      *
-     * @param[in]  aShortTopicName  A pointer to short topic name string of target topic.
-     * @param[in]  aCallback        A function pointer to callback invoked when unsubscription is acknowledged.
-     * @param[in]  aContext         A pointer to context object passed to callback.
-     *
-     * @retval OT_ERROR_NONE           Unsubscribe message successfully queued.
-     * @retval OT_ERROR_INVALID_ARGS   Invalid unsubscribe parameters. Short topic name must have one or two characters.
-     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     * @param[in]  aEntry  A reference to changed topic entry.
      *
      */
-    otError Unsubscribe(const char* aShortTopicName, UnsubscribeCallbackFunc aCallback, void* aContext);
+    void SaveSession(const TopicRegistry::Entry &aEntry);
 
     /**
-     * Unsubscribe from the topic with specific topic ID.
-     *
-     * @param[in]  aTopicId   A pointer to short topic name string of target topic.
-     * @param[in]  aCallback  A function pointer to callback invoked when unsubscription is acknowledged.
-     * @param[in]  aContext   A pointer to context object passed to callback.
+     * Load topic registry and subscriptions from non-volatile settings when they are bound to current client ID
+     * and gateway.
      *
-     * @retval OT_ERROR_NONE           Unsubscribe message successfully queued.
-     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to unsubscribe.
+     * @retval OT_ERROR_NONE       Session successfully restored.
+     * @retval OT_ERROR_NOT_FOUND  There is no stored session for current client ID and gateway.
      *
      */
-    otError Unsubscribe(TopicId aTopicId, UnsubscribeCallbackFunc aCallback, void* aContext);
+    otError RestoreSession(void);
 
     /**
-     * Disconnect MQTT-SN client from gateway.
+     * Remove stored session from non-volatile settings.
      *
-     * @retval OT_ERROR_NONE           Disconnection message successfully queued.
-     * @retval OT_ERROR_INVALID_STATE  The client is not in relevant state. It must be asleep, awake or active.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     */
+    void DeleteSession(void);
+
+    /**
+     * Start restore of registrations and subscriptions marked in topic registry after CONNACK.
      *
      */
-    otError Disconnect(void);
+    void StartSessionRestore(void);
 
     /**
-     * Put the client into asleep state or change sleep duration. Client must be awaken or reconnected before duration time passes.
+     * Send REGISTER and SUBSCRIBE messages of the session restore until in-flight limit is reached and
+     * report completion when nothing is left in flight.
      *
-     * @param[in]  aDuration  Duration time for which will the client stay in asleep state.
+     */
+    void ContinueSessionRestore(void);
+
+    /**
+     * Complete session restore and invoke session restored callback.
      *
-     * @retval OT_ERROR_NONE           Sleep request successfully queued.
-     * @retval OT_ERROR_INVALID_STATE  The client is not in relevant state. It must be asleep, awake or active.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     * @param[in]  aCode  Result of the session restore.
      *
      */
-    otError Sleep(uint16_t aDuration);
+    void FinishSessionRestore(ReturnCode aCode);
 
     /**
-     * Awake the client and receive pending messages.
+     * Handle acknowledgement or timeout of session restore request.
      *
-     * @param[in]  aTimeout  Timeout in milliseconds for staying in awake state. PINGRESP message must be received before timeout time passes.
-     *
-     * @retval OT_ERROR_NONE           Awake request successfully queued.
-     * @retval OT_ERROR_INVALID_STATE  The client is not in relevant state. It must be asleep or awake.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     * @param[in]  aCode  Return code of the request.
      *
      */
-    otError Awake(uint32_t aTimeout);
+    void HandleSessionRestoreResponse(ReturnCode aCode);
 
     /**
-     * Search for gateway with multicast message.
+     * Add topics of batch request to topic registry and send REGISTER or SUBSCRIBE message for each topic
+     * which is not known yet.
      *
-     * @param[in]  aMulticastAddress  A reference to multicast IPv6 address.
-     * @param[in]  aPort              Gateway port number.
-     * @param[in]  aRadius            Message hop limit (time to live)
+     * @param[in]  aType        Request message type, kTypeRegister or kTypeSubscribe.
+     * @param[in]  aTopicNames  A pointer to array of long topic name strings.
+     * @param[in]  aCount       Number of topic names.
+     * @param[in]  aQos         Quality of service level of subscriptions.
+     * @param[in]  aCallback    A function pointer to batch callback.
+     * @param[in]  aContext     A pointer to context object passed to callback.
      *
-     * @retval OT_ERROR_NONE           Search gateway request successfully queued.
-     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     * @retval OT_ERROR_NONE           Batch successfully started.
+     * @retval OT_ERROR_INVALID_ARGS   Invalid parameters.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
+     * @retval OT_ERROR_BUSY           Another batch is in progress.
+     * @retval OT_ERROR_NO_BUFS        Topic registry is full.
      *
      */
-    otError SearchGateway(const Ip6::Address &aMulticastAddress, uint16_t aPort, uint8_t aRadius);
+    otError StartBatch(uint8_t aType, const char* const* aTopicNames, uint8_t aCount, Qos aQos,
+        BatchCallbackFunc aCallback, void* aContext);
 
     /**
-     * Get current MQTT-SN client state.
+     * Serialize and send messages of all unacknowledged batch topics. Topics which cannot be sent fail.
      *
-     * @returns Current client state.
+     * @param[in]  aDupFlag  Set DUP flag of SUBSCRIBE messages.
      *
      */
-    ClientState GetState(void);
+    void SendBatchRequests(bool aDupFlag);
 
     /**
-     * Set callback function invoked when connection acknowledged or timed out.
+     * Match SUBACK or REGACK with batch request and update topic registry.
      *
-     * @param[in]  aCallback  A function pointer to connect callback function.
-     * @param[in]  aContext   A pointer to context object passed to callback.
+     * @param[in]  aMessageId  Message ID of the acknowledgement.
+     * @param[in]  aCode       Return code of the acknowledgement.
+     * @param[in]  aTopicId    Topic ID assigned by gateway.
+     * @param[in]  aQos        Granted quality of service level.
      *
-     * @retval OT_ERROR_NONE  Callback function successfully set.
+     * @returns  True if the acknowledgement belongs to the batch.
      *
      */
-    otError SetConnectedCallback(ConnectedCallbackFunc aCallback, void* aContext);
+    bool HandleBatchAcknowledgement(uint16_t aMessageId, ReturnCode aCode, TopicId aTopicId, Qos aQos);
 
     /**
-     * Set callback function invoked when publish message received from the topic.
-     *
-     * @param[in]  aCallback  A function pointer to publish received callback function.
-     * @param[in]  aContext   A pointer to context object passed to callback.
+     * Retransmit unacknowledged batch requests or time them out when the batch deadline expired.
      *
-     * @retval OT_ERROR_NONE  Callback function successfully set.
+     * @param[in]  aNow  Current time in milliseconds.
      *
      */
-    otError SetPublishReceivedCallback(PublishReceivedCallbackFunc aCallback, void* aContext);
+    void HandleBatchDeadline(uint32_t aNow);
 
     /**
-     * Set callback function invoked when advertise message received from the gateway.
-     *
-     * @param[in]  aCallback  A function pointer to advertise callback function.
-     * @param[in]  aContext   A pointer to context object passed to callback.
+     * Fail unacknowledged batch topics with the code and complete the batch.
      *
-     * @retval OT_ERROR_NONE  Callback function successfully set.
+     * @param[in]  aCode  Return code reported for unacknowledged topics.
      *
      */
-    otError SetAdvertiseCallback(AdvertiseCallbackFunc aCallback, void* aContext);
+    void AbortBatch(ReturnCode aCode);
 
     /**
-     * Set callback function invoked when gateway info received from gateway.
+     * Invoke batch callback when no topic of the batch is waiting for acknowledgement.
      *
-     * @param[in]  aCallback  A function pointer to gateway info received callback function.
-     * @param[in]  aContext   A pointer to context object passed to callback.
+     */
+    void FinishBatch(void);
+
+    /**
+     * Add round trip time sample to gateway table entry of the gateway.
      *
-     * @retval OT_ERROR_NONE  Callback function successfully set.
+     * @param[in]  aAddress  A reference to gateway address.
+     * @param[in]  aPort     Gateway port.
+     * @param[in]  aRtt      Measured round trip time in milliseconds.
      *
      */
-    otError SetSearchGwCallback(SearchGwCallbackFunc aCallback, void* aContext);
+    void AddGatewayRttSample(const Ip6::Address &aAddress, uint16_t aPort, uint32_t aRtt);
 
     /**
-     * Set callback function invoked when disconnect acknowledged or timed out.
-     *
-     * @param[in]  aCallback  A function pointer to disconnect callback function.
-     * @param[in]  aContext   A pointer to context object passed to callback.
+     * Mark current gateway failed and schedule connection to the next best gateway after reconnect delay.
      *
-     * @retval OT_ERROR_NONE  Callback function successfully set.
+     * @retval OT_ERROR_NONE       Connection to other gateway successfully scheduled.
+     * @retval OT_ERROR_NOT_FOUND  No other gateway is available.
      *
      */
-    otError SetDisconnectedCallback(DisconnectedCallbackFunc aCallback, void* aContext);
+    otError FailoverGateway(void);
 
     /**
-     * Set callback function invoked when register acknowledged.
+     * Connect to the next best gateway when reconnect delay of scheduled failover expired.
      *
-     * @param[in]  aCallback  A function pointer to register callback function.
-     * @param[in]  aContext   A pointer to context object passed to callback.
+     * @param[in]  aNow  Current time in milliseconds.
      *
-     * @retval OT_ERROR_NONE  Callback function successfully set.
+     */
+    void HandleFailoverDeadline(uint32_t aNow);
+
+    /**
+     * Get randomized keepalive PINGREQ interval shortened by up to configured keepalive jitter.
+     *
+     * @returns Keepalive interval in milliseconds.
      *
      */
-    otError SetRegisterReceivedCallback(RegisterReceivedCallbackFunc aCallback, void* aContext);
+    uint32_t GetKeepAliveInterval(void);
 
-protected:
     /**
-     * Allocate new message with payload.
+     * Send next SEARCHGW message of expanding ring search or finish the search when its deadline expired.
      *
-     * @param[out]  aMessage  A pointer to message pointer.
-     * @param[in]   aBuffer   A pointer to payload byte array.
-     * @param[in]   aLength   Payload length in bytes.
+     * @param[in]  aNow  Current time in milliseconds.
      *
-     * @retval OT_ERROR_NONE      New message successfully created.
-     * @retval OT_ERROR_NO_BUFS   Insufficient available buffers to allocate new message.
+     */
+    void HandleSearchGwDeadline(uint32_t aNow);
+
+    /**
+     * Finish expanding ring search and invoke its callback.
      *
      */
-    otError NewMessage(Message **aMessage, unsigned char* aBuffer, int32_t aLength);
+    void FinishSearchGwRing(void);
 
     /**
      * Send OT message to configured gateway address.
@@ -1037,6 +2611,25 @@ protected:
      */
     void OnDisconnected(void);
 
+    /**
+     * Postpone keepalive PINGREQ after message received from connected gateway. Any valid message proves
+     * the gateway is alive, so PINGREQ is sent only when the link is silent. PINGREQ is still sent
+     * kKeepAlivePingLimit after the last sent message because gateway supervises client messages only.
+     * Outstanding keepalive PINGREQ is answered by the message, other gateway timeouts are kept.
+     *
+     * @param[in]  aValidity  Time in milliseconds for which the activity proves gateway liveness.
+     *
+     */
+    void HandleGatewayActivity(uint32_t aValidity);
+
+    /**
+     * Count keepalive PINGREQ messages which would be sent by fixed schedule until given time.
+     *
+     * @param[in]  aNow  Current time in milliseconds.
+     *
+     */
+    void CountSavedPingreqs(uint32_t aNow);
+
     /**
      * Compare IPv6 address with configured gateway address.
      *
@@ -1047,9 +2640,220 @@ protected:
      */
     bool VerifyGatewayAddress(const Ip6::MessageInfo &aMessageInfo);
 
+    /**
+     * Get randomized initial retransmission timeout for new waiting message.
+     *
+     * @returns Retransmission timeout in milliseconds.
+     *
+     */
+    uint32_t GetRetransmissionTimeout(void);
+
+    /**
+     * Get retransmission timeout derived from smoothed round trip time and its variation
+     * (RTO = SRTT + 4 * RTTVAR). Configured timeout is used when there is no estimate.
+     *
+     * @returns Retransmission timeout in milliseconds.
+     *
+     */
+    uint32_t GetEstimatedTimeout(void);
+
+    /**
+     * Initialize round trip time estimate from Thread route cost to the gateway when it is available.
+     *
+     */
+    void SeedRttEstimate(void);
+
+    /**
+     * Get Thread route cost to the gateway or to the border router which routes to the gateway.
+     *
+     * @param[out]  aCost  A reference to route cost.
+     *
+     * @returns  True if the route cost is known.
+     *
+     */
+    bool GetGatewayRouteCost(uint8_t &aCost);
+
+    /**
+     * Check whether in-flight window of the QoS level is full. The window is limited by configured maximum
+     * of the QoS level and by congestion window shared by QoS levels 1 and 2. Congestion window grows by one
+     * message per window of timely acknowledgements and it is halved on retransmission or congestion rejection.
+     *
+     * @param[in]  aQos  Quality of service level.
+     *
+     * @returns  True if no other PUBLISH message with the QoS level can be sent.
+     *
+     */
+    bool IsPublishWindowFull(Qos aQos);
+
+    /**
+     * Update round trip time estimate and congestion window with received acknowledgement.
+     *
+     * @param[in]  aTimestamp      Time stamp of the acknowledged message in milliseconds.
+     * @param[in]  aRetransmitted  The acknowledged message was retransmitted.
+     * @param[in]  aCode           Return code of the acknowledgement.
+     *
+     */
+    void HandleAcknowledgement(uint32_t aTimestamp, bool aRetransmitted, ReturnCode aCode);
+
+    /**
+     * Halve congestion window on message loss or congestion. The window is reduced at most once per
+     * round trip time so single loss event does not collapse it.
+     *
+     */
+    void DecreaseCongestionWindow(void);
+
+    /**
+     * Check that another PUBLISH message with the QoS level fits in-flight window. When the window is full
+     * the window opened callback is armed for the QoS level.
+     *
+     * @param[in]  aQos  Quality of service level of published message.
+     *
+     * @retval OT_ERROR_NONE  Message can be published.
+     * @retval OT_ERROR_BUSY  In-flight window of the QoS level is full.
+     *
+     */
+    otError CheckPublishWindow(Qos aQos);
+
+    /**
+     * Invoke window opened callback for QoS levels which were full and have free window now.
+     *
+     */
+    void NotifyPublishWindow(void);
+
+    /**
+     * Schedule process timer to the earliest pending deadline (keepalive, gateway timeout or message
+     * retransmission). The timer is stopped when nothing is pending.
+     *
+     */
+    void UpdateProcessTimer(void);
+
+    /**
+     * Switch data poll period of sleepy end device to configured fast poll period while any transaction is
+     * outstanding and restore previous period when all transactions are finished.
+     *
+     * @param[in]  aOutstanding  True if the client waits for any response.
+     *
+     */
+    void UpdateFastPolling(bool aOutstanding);
+
 private:
+    enum
+    {
+        kAllTopics = 0xff
+    };
+
+    void GetSessionBinding(SessionStore::Binding &aBinding);
+
+    /**
+     * Metadata appended to PUBLISH message waiting for topic registration.
+     *
+     */
+    struct PendingPublish
+    {
+        uint16_t mMessageId;
+        uint8_t mTopicIndex;
+        Qos mQos;
+        PublishCallbackFunc mCallback;
+        void* mContext;
+    };
+
+    /**
+     * Batch subscription or registration. Only topic registry indexes and message IDs are retained, messages
+     * are serialized again for retransmission.
+     *
+     */
+    struct BatchTransaction
+    {
+        uint8_t mType;
+        Qos mQos;
+        uint8_t mCount;
+        uint8_t mRetransmissionCount;
+        bool mRetransmitted;
+        uint32_t mPendingMask;
+        uint32_t mTimestamp;
+        uint32_t mRetransmissionTimeout;
+        BatchCallbackFunc mCallback;
+        void* mContext;
+        uint16_t mMessageIds[kMaxBatchTopics];
+        uint8_t mTopicIndexes[kMaxBatchTopics];
+        TopicResult mResults[kMaxBatchTopics];
+    };
+
+    /**
+     * Received message handler function. Non-PUBLISH messages are read to the buffer aData, PUBLISH message
+     * is deserialized directly from aMessage. The handler returns error only when the message could not be
+     * deserialized.
+     *
+     */
+    typedef otError (MqttsnClient::*MessageHandlerFunc)(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    /**
+     * Entry of received messages dispatch table indexed by message type.
+     *
+     */
+    struct MessageHandlerEntry
+    {
+        uint8_t mAllowedStates;
+        bool mVerifyGateway;
+        MessageHandlerFunc mHandler;
+    };
+
+    static const MessageHandlerEntry sMessageHandlers[];
+
+    static void HandleProcessTimer(Timer &aTimer);
+
+    void HandleProcessTimer(void);
+
     static void HandleUdpReceive(void *aContext, otMessage *aMessage, const otMessageInfo *aMessageInfo);
 
+    otError HandleConnack(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandleSuback(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandlePublish(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandleAdvertise(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandleGwInfo(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandleRegack(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandleRegister(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandlePuback(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandlePubrec(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandlePubrel(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandlePubcomp(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandleUnsuback(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandlePingreq(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandlePingresp(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    otError HandleDisconnect(const Ip6::MessageInfo &aMessageInfo, const Message &aMessage,
+        const unsigned char *aData, uint16_t aLength);
+
+    static void HandleRetransmission(Message &aMessage, const Ip6::Address &aAddress, uint16_t aPort, void* aContext);
+
     static void HandleSubscribeTimeout(const MessageMetadata<SubscribeCallbackFunc> &aMetadata, void* aContext);
 
     static void HandleRegisterTimeout(const MessageMetadata<RegisterCallbackFunc> &aMetadata, void* aContext);
@@ -1064,7 +2868,13 @@ private:
 
     static void HandlePublishQos2PubrecTimeout(const MessageMetadata<void*> &aMetadata, void* aContext);
 
+    static void HandleSessionRestoreRegistered(ReturnCode aCode, TopicId aTopicId, void* aContext);
+
+    static void HandleSessionRestoreSubscribed(ReturnCode aCode, TopicId aTopicId, Qos aQos, void* aContext);
+
     Ip6::UdpSocket mSocket;
+    TimerMilli mProcessTimer;
+    WaitingMessagesIndex mWaitingMessagesIndex;
     MqttsnConfig mConfig;
     uint16_t mMessageId;
     uint32_t mPingReqTime;
@@ -1080,6 +2890,10 @@ private:
     WaitingMessagesQueue<PublishCallbackFunc> mPublishQos2PublishQueue;
     WaitingMessagesQueue<PublishCallbackFunc> mPublishQos2PubrelQueue;
     WaitingMessagesQueue<void*> mPublishQos2PubrecQueue;
+    TopicRegistry mTopicRegistry;
+    SessionStore mSessionStore;
+    MessageQueue mPendingPublishQueue;
+    uint8_t mPendingPublishCount;
     ConnectedCallbackFunc mConnectedCallback;
     void* mConnectContext;
     PublishReceivedCallbackFunc mPublishReceivedCallback;
@@ -1092,6 +2906,53 @@ private:
     void* mDisconnectedContext;
     RegisterReceivedCallbackFunc mRegisterReceivedCallback;
     void* mRegisterReceivedContext;
+    PublishWindowOpenedCallbackFunc mPublishWindowOpenedCallback;
+    void* mPublishWindowOpenedContext;
+    bool mPublishQos1WindowFull;
+    bool mPublishQos2WindowFull;
+    uint8_t mCongestionWindow;
+    uint8_t mCongestionAckCount;
+    uint32_t mCongestionRecoveryEnd;
+    uint32_t mSmoothedRtt;
+    uint32_t mRttVariation;
+    uint32_t mRttSamples;
+    uint32_t mCongestionEvents;
+    uint32_t mCongestionRejections;
+    SessionRestoredCallbackFunc mSessionRestoredCallback;
+    void* mSessionRestoredContext;
+    uint32_t mConnectTime;
+    uint32_t mSessionRestoreTime;
+    uint8_t mSessionRestoreIndex;
+    uint8_t mSessionRestoreInFlight;
+    uint8_t mSessionRestoreMessages;
+    bool mSessionRestoreActive;
+    ReturnCode mSessionRestoreCode;
+    BatchTransaction mBatch;
+    bool mBatchActive;
+    GatewayTable mGatewayTable;
+    bool mGatewayFailover;
+    uint16_t mSearchGwPort;
+    uint32_t mSearchGwTime;
+    Ip6::Address mSearchGwRingAddress;
+    uint32_t mSearchGwRingDeadline;
+    uint8_t mSearchGwRingRadius;
+    uint8_t mSearchGwRingMaxRadius;
+    bool mSearchGwRingActive;
+    bool mSearchGwRingAnswered;
+    SearchGwFinishedCallbackFunc mSearchGwFinishedCallback;
+    void* mSearchGwFinishedContext;
+    uint32_t mLastSendTime;
+    uint32_t mFixedPingReqTime;
+    uint32_t mKeepAliveStartTime;
+    uint32_t mKeepAliveDuration;
+    uint32_t mPingreqSent;
+    uint32_t mPingreqFixed;
+    bool mPingreqOutstanding;
+    uint32_t mReconnectDelay;
+    uint32_t mFailoverTime;
+    bool mFailoverPending;
+    uint32_t mSlowPollPeriod;
+    bool mFastPolling;
 };
 
 }
@@ -0,0 +1,313 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mqttsn_log.hpp"
+
+#if !MQTTSN_LOG_BACKEND_HOST
+#include "board.h"
+#include "fsl_lpuart.h"
+#endif
+
+/**
+ * @file
+ *   This file contains implementation of deferred log output.
+ *
+ */
+
+#if (MQTTSN_LOG_BUFFER_SIZE & (MQTTSN_LOG_BUFFER_SIZE - 1)) != 0 || MQTTSN_LOG_BUFFER_SIZE > 0x8000
+#error "MQTTSN_LOG_BUFFER_SIZE must be power of two and at most 32768"
+#endif
+
+#define LOG_BUFFER_MASK (MQTTSN_LOG_BUFFER_SIZE - 1)
+
+namespace ot {
+
+namespace Mqttsn {
+
+// Read and write positions are free running, their difference is the number of buffered bytes
+static uint8_t sLogBuffer[MQTTSN_LOG_BUFFER_SIZE];
+static uint16_t sLogHead = 0;
+static uint16_t sLogTail = 0;
+static uint32_t sLogDropped = 0;
+
+#if MQTTSN_LOG_BACKEND_HOST
+static uint16_t OutputWrite(const uint8_t* aData, uint16_t aLength)
+{
+    return static_cast<uint16_t>(fwrite(aData, 1, aLength, stdout));
+}
+#else
+static uint16_t OutputWrite(const uint8_t* aData, uint16_t aLength)
+{
+    LPUART_Type* base = reinterpret_cast<LPUART_Type*>(BOARD_DEBUG_UART_BASEADDR);
+    uint16_t written = 0;
+
+    // Write only while transmit register is empty so the call never waits for the UART
+    while (written < aLength && (LPUART_GetStatusFlags(base) & kLPUART_TxDataRegEmptyFlag))
+    {
+        LPUART_WriteByte(base, aData[written++]);
+    }
+    return written;
+}
+#endif
+
+void Log::Printf(const char* aFormat, ...)
+{
+    va_list args;
+    va_start(args, aFormat);
+    Vprintf(aFormat, args);
+    va_end(args);
+}
+
+#if MQTTSN_LOG_TOKENIZED
+static uint32_t RuntimeTokenHash(const char* aString)
+{
+    uint32_t hash = 2166136261u;
+
+    while (*aString != '\0')
+    {
+        hash = (hash ^ static_cast<uint8_t>(*aString++)) * 16777619u;
+    }
+    return hash;
+}
+
+void Log::Vprintf(const char* aFormat, va_list aArgs)
+{
+    // Format strings passed at runtime (e.g. by OpenThread) are hashed here and the arguments are encoded
+    // according to conversion specifiers. The same rules are used by the host decoder.
+    uint8_t record[kMaxRecordLength];
+    uint16_t length = EncodeToken(record, RuntimeTokenHash(aFormat));
+
+    for (const char* format = aFormat; *format != '\0'; format++)
+    {
+        uint8_t longCount = 0;
+
+        if (*format != '%')
+        {
+            continue;
+        }
+        if (*(++format) == '%')
+        {
+            continue;
+        }
+        // Skip flags, width and precision, asterisk takes integer argument
+        while (*format != '\0' && strchr("-+ #0123456789.*", *format) != nullptr)
+        {
+            if (*format == '*')
+            {
+                length = EncodeArg(record, length, va_arg(aArgs, int));
+            }
+            format++;
+        }
+        while (*format == 'l' || *format == 'h' || *format == 'z' || *format == 'j' || *format == 't')
+        {
+            longCount += (*format == 'h') ? 0 : 1;
+            format++;
+        }
+        switch (*format)
+        {
+        case 's':
+            length = EncodeArg(record, length, va_arg(aArgs, const char*));
+            break;
+        case 'p':
+            length = EncodeArg(record, length, static_cast<int32_t>(reinterpret_cast<uintptr_t>(va_arg(aArgs, void*))));
+            break;
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'c':
+            if (longCount >= 2)
+            {
+                length = EncodeArg(record, length, static_cast<int32_t>(va_arg(aArgs, long long)));
+            }
+            else if (longCount == 1)
+            {
+                length = EncodeArg(record, length, static_cast<int32_t>(va_arg(aArgs, long)));
+            }
+            else
+            {
+                length = EncodeArg(record, length, va_arg(aArgs, int));
+            }
+            break;
+        case '\0':
+            format--;
+            break;
+        default:
+            break;
+        }
+    }
+    Commit(record, length);
+}
+
+uint16_t Log::EncodeToken(uint8_t* aRecord, uint32_t aToken)
+{
+    // The first byte is reserved for record length
+    aRecord[1] = static_cast<uint8_t>(aToken);
+    aRecord[2] = static_cast<uint8_t>(aToken >> 8);
+    aRecord[3] = static_cast<uint8_t>(aToken >> 16);
+    aRecord[4] = static_cast<uint8_t>(aToken >> 24);
+    return 5;
+}
+
+uint16_t Log::EncodeArg(uint8_t* aRecord, uint16_t aLength, int32_t aValue)
+{
+    // ZigZag encoding keeps small negative numbers short
+    uint32_t value = (static_cast<uint32_t>(aValue) << 1) ^ static_cast<uint32_t>(aValue >> 31);
+
+    do
+    {
+        if (aLength >= kMaxRecordLength)
+        {
+            // Mark record as overflowed
+            return kMaxRecordLength + 1;
+        }
+        aRecord[aLength++] = static_cast<uint8_t>((value & 0x7f) | ((value > 0x7f) ? 0x80 : 0));
+        value >>= 7;
+    } while (value != 0);
+    return aLength;
+}
+
+uint16_t Log::EncodeArg(uint8_t* aRecord, uint16_t aLength, const char* aValue)
+{
+    uint16_t length = (aValue != nullptr) ? static_cast<uint16_t>(strnlen(aValue, kMaxStringLength)) : 0;
+
+    if (aLength >= kMaxRecordLength)
+    {
+        return kMaxRecordLength + 1;
+    }
+    // Strings are truncated to the space left in the record
+    if (length > kMaxRecordLength - aLength - 1)
+    {
+        length = kMaxRecordLength - aLength - 1;
+    }
+    aRecord[aLength++] = static_cast<uint8_t>(length);
+    memcpy(&aRecord[aLength], aValue, length);
+    return aLength + length;
+}
+
+void Log::Commit(uint8_t* aRecord, uint16_t aLength)
+{
+    if (aLength > kMaxRecordLength)
+    {
+        sLogDropped++;
+        return;
+    }
+    aRecord[0] = static_cast<uint8_t>(aLength - 1);
+    Write(aRecord, aLength);
+}
+#else
+void Log::Vprintf(const char* aFormat, va_list aArgs)
+{
+    char line[MQTTSN_LOG_LINE_SIZE];
+    int length = vsnprintf(line, sizeof(line), aFormat, aArgs);
+
+    if (length < 0)
+    {
+        return;
+    }
+    if (length >= static_cast<int>(sizeof(line)))
+    {
+        length = sizeof(line) - 1;
+    }
+    Write(reinterpret_cast<const uint8_t*>(line), static_cast<uint16_t>(length));
+}
+#endif
+
+bool Log::Write(const uint8_t* aData, uint16_t aLength)
+{
+    uint16_t position;
+    uint16_t first;
+
+    if (aLength > MQTTSN_LOG_BUFFER_SIZE - GetPendingLength())
+    {
+        sLogDropped++;
+        return false;
+    }
+
+    // Copy data in at most two parts when wrapping around the buffer end
+    position = sLogHead & LOG_BUFFER_MASK;
+    first = MQTTSN_LOG_BUFFER_SIZE - position;
+    if (first > aLength)
+    {
+        first = aLength;
+    }
+    memcpy(&sLogBuffer[position], aData, first);
+    memcpy(sLogBuffer, aData + first, aLength - first);
+    sLogHead += aLength;
+    return true;
+}
+
+void Log::Process(void)
+{
+    while (GetPendingLength() > 0)
+    {
+        uint16_t position = sLogTail & LOG_BUFFER_MASK;
+        uint16_t length = MQTTSN_LOG_BUFFER_SIZE - position;
+        uint16_t written;
+
+        if (length > GetPendingLength())
+        {
+            length = GetPendingLength();
+        }
+        written = OutputWrite(&sLogBuffer[position], length);
+        sLogTail += written;
+        if (written < length)
+        {
+            break;
+        }
+    }
+}
+
+void Log::Flush(void)
+{
+    while (GetPendingLength() > 0)
+    {
+        Process();
+    }
+#if MQTTSN_LOG_BACKEND_HOST
+    fflush(stdout);
+#endif
+}
+
+uint32_t Log::GetDroppedCount(void)
+{
+    return sLogDropped;
+}
+
+uint16_t Log::GetPendingLength(void)
+{
+    return static_cast<uint16_t>(sLogHead - sLogTail);
+}
+
+}
+
+}
@@ -0,0 +1,237 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MQTTSN_LOG_HPP_
+#define MQTTSN_LOG_HPP_
+
+#include <stdarg.h>
+#include <stdint.h>
+
+/**
+ * @file
+ *   This file includes interface of deferred log output. Log messages are formatted to RAM ring buffer and
+ *   the buffer is drained to the output without blocking from the main loop.
+ *
+ */
+
+/**
+ * Enable log output. When disabled log macros are compiled out.
+ *
+ */
+#ifndef MQTTSN_LOG_ENABLE
+#define MQTTSN_LOG_ENABLE 1
+#endif
+
+/**
+ * Log ring buffer size in bytes. It must be power of two.
+ *
+ */
+#ifndef MQTTSN_LOG_BUFFER_SIZE
+#define MQTTSN_LOG_BUFFER_SIZE 1024
+#endif
+
+/**
+ * Maximal length of single formatted log line in bytes. Longer lines are truncated.
+ *
+ */
+#ifndef MQTTSN_LOG_LINE_SIZE
+#define MQTTSN_LOG_LINE_SIZE 128
+#endif
+
+/**
+ * Use standard output instead of debug UART. It allows to run and benchmark the log on host.
+ *
+ */
+#ifndef MQTTSN_LOG_BACKEND_HOST
+#define MQTTSN_LOG_BACKEND_HOST 0
+#endif
+
+/**
+ * Replace log format strings by 32-bit tokens computed at build time. Only tokens and encoded arguments are
+ * written to the output and format strings are not stored in the firmware. Tokens database is built from
+ * sources and the output is decoded to text on host with tools/log_tokens.py.
+ *
+ */
+#ifndef MQTTSN_LOG_TOKENIZED
+#define MQTTSN_LOG_TOKENIZED 0
+#endif
+
+#if MQTTSN_LOG_ENABLE && MQTTSN_LOG_TOKENIZED
+#define MQTTSN_LOG(aFormat, ...) \
+    ot::Mqttsn::Log::Tokenized(ot::Mqttsn::LogToken<ot::Mqttsn::LogTokenHash(aFormat)>::kValue, ##__VA_ARGS__)
+#elif MQTTSN_LOG_ENABLE
+#define MQTTSN_LOG(...) ot::Mqttsn::Log::Printf(__VA_ARGS__)
+#else
+#define MQTTSN_LOG(...)
+#endif
+
+namespace ot {
+
+namespace Mqttsn {
+
+/**
+ * Compute 32-bit FNV-1a hash of log format string. The hash is used as log token.
+ *
+ * @param[in]  aString  A pointer to null terminated format string.
+ * @param[in]  aHash    Hash of preceding characters.
+ *
+ * @returns  Hash of the string.
+ *
+ */
+constexpr uint32_t LogTokenHash(const char* aString, uint32_t aHash = 2166136261u)
+{
+    return (*aString == '\0') ? aHash
+        : LogTokenHash(aString + 1, (aHash ^ static_cast<uint8_t>(*aString)) * 16777619u);
+}
+
+/**
+ * The template forces evaluation of the log token at build time.
+ *
+ */
+template <uint32_t kToken>
+struct LogToken
+{
+    enum : uint32_t { kValue = kToken };
+};
+
+/**
+ * This class implements deferred log output with fixed size ring buffer.
+ *
+ */
+class Log
+{
+public:
+    /**
+     * Format log message and store it in the ring buffer. The message is dropped when there is not enough
+     * space in the buffer.
+     *
+     * @param[in]  aFormat  A pointer to format string.
+     *
+     */
+    static void Printf(const char* aFormat, ...);
+
+    /**
+     * Format log message with variable arguments list and store it in the ring buffer.
+     *
+     * @param[in]  aFormat  A pointer to format string.
+     * @param[in]  aArgs    Variable arguments list.
+     *
+     */
+    static void Vprintf(const char* aFormat, va_list aArgs);
+
+    /**
+     * Store raw data in the ring buffer. Data are stored whole or dropped.
+     *
+     * @param[in]  aData    A pointer to data.
+     * @param[in]  aLength  Data length in bytes.
+     *
+     * @returns  True if data were stored.
+     *
+     */
+    static bool Write(const uint8_t* aData, uint16_t aLength);
+
+    /**
+     * Move buffered data to the output as long as the output accepts them without waiting. Must be called
+     * periodically from the main loop.
+     *
+     */
+    static void Process(void);
+
+    /**
+     * Move all buffered data to the output. The function blocks until the buffer is empty.
+     *
+     */
+    static void Flush(void);
+
+    /**
+     * Get number of log messages dropped because of full buffer.
+     *
+     * @returns  Number of dropped messages.
+     *
+     */
+    static uint32_t GetDroppedCount(void);
+
+    /**
+     * Get number of bytes waiting in the buffer.
+     *
+     * @returns  Number of bytes.
+     *
+     */
+    static uint16_t GetPendingLength(void);
+
+#if MQTTSN_LOG_TOKENIZED
+    /**
+     * Encode tokenized log record and store it in the ring buffer. The record consists of length byte, token
+     * and arguments. Integers are encoded as ZigZag varints and strings are prefixed by length byte.
+     *
+     * @param[in]  aToken  Token of the format string.
+     * @param[in]  aArgs   Format arguments. Only integers and strings are supported.
+     *
+     */
+    template <typename... Args>
+    static void Tokenized(uint32_t aToken, Args... aArgs)
+    {
+        uint8_t record[kMaxRecordLength];
+        uint16_t length = EncodeArgs(record, EncodeToken(record, aToken), aArgs...);
+        Commit(record, length);
+    }
+
+private:
+    enum
+    {
+        kMaxRecordLength = (MQTTSN_LOG_LINE_SIZE < 256) ? MQTTSN_LOG_LINE_SIZE : 256,
+        kMaxStringLength = 48,
+    };
+
+    static uint16_t EncodeToken(uint8_t* aRecord, uint32_t aToken);
+
+    static uint16_t EncodeArg(uint8_t* aRecord, uint16_t aLength, int32_t aValue);
+
+    static uint16_t EncodeArg(uint8_t* aRecord, uint16_t aLength, const char* aValue);
+
+    static uint16_t EncodeArgs(uint8_t* aRecord, uint16_t aLength)
+    {
+        (void)aRecord;
+        return aLength;
+    }
+
+    template <typename Arg, typename... Args>
+    static uint16_t EncodeArgs(uint8_t* aRecord, uint16_t aLength, Arg aArg, Args... aArgs)
+    {
+        return EncodeArgs(aRecord, EncodeArg(aRecord, aLength, aArg), aArgs...);
+    }
+
+    static void Commit(uint8_t* aRecord, uint16_t aLength);
+#endif
+};
+
+}
+
+}
+
+#endif /* MQTTSN_LOG_HPP_ */
@@ -0,0 +1,250 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "mqttsn_publish_aggregator.hpp"
+
+/**
+ * @file
+ *   This file includes implementation of publish aggregator.
+ *
+ */
+
+namespace ot {
+
+namespace Mqttsn {
+
+PublishAggregator::PublishAggregator(Instance &aInstance, MqttsnClient &aClient)
+    : InstanceLocator(aInstance)
+    , mClient(aClient)
+    , mTimer(aInstance, &PublishAggregator::HandleTimer, this)
+    , mTopics()
+{
+    ;
+}
+
+otError PublishAggregator::AddTopic(TopicId aTopicId, Qos aQos, uint8_t aThreshold, uint32_t aMaxLatency,
+    MqttsnClient::PublishCallbackFunc aCallback, void* aContext)
+{
+    otError error = OT_ERROR_NONE;
+    Topic *topic = nullptr;
+
+    // Threshold must allow at least one sample with its length prefix
+    VerifyOrExit(aThreshold >= 2 && aThreshold <= MQTTSN_AGGREGATOR_MAX_BATCH_SIZE, error = OT_ERROR_INVALID_ARGS);
+    VerifyOrExit(aQos == kQos0 || aQos == kQos1 || aQos == kQos2, error = OT_ERROR_INVALID_ARGS);
+    VerifyOrExit(FindTopic(aTopicId) == nullptr, error = OT_ERROR_ALREADY);
+
+    for (uint8_t i = 0; i < MQTTSN_AGGREGATOR_MAX_TOPICS; i++)
+    {
+        if (!mTopics[i].mIsUsed)
+        {
+            topic = &mTopics[i];
+            break;
+        }
+    }
+    VerifyOrExit(topic != nullptr, error = OT_ERROR_NO_BUFS);
+
+    memset(topic, 0, sizeof(*topic));
+    topic->mIsUsed = true;
+    topic->mTopicId = aTopicId;
+    topic->mQos = aQos;
+    topic->mThreshold = aThreshold;
+    topic->mMaxLatency = aMaxLatency;
+    topic->mCallback = aCallback;
+    topic->mContext = aContext;
+
+exit:
+    return error;
+}
+
+otError PublishAggregator::RemoveTopic(TopicId aTopicId)
+{
+    otError error = OT_ERROR_NONE;
+    Topic *topic = FindTopic(aTopicId);
+
+    VerifyOrExit(topic != nullptr, error = OT_ERROR_NOT_FOUND);
+
+    // Buffered samples are lost when they cannot be published
+    Flush(*topic);
+    topic->mIsUsed = false;
+    UpdateTimer();
+
+exit:
+    return error;
+}
+
+otError PublishAggregator::Publish(TopicId aTopicId, const uint8_t* aData, uint8_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    Topic *topic = FindTopic(aTopicId);
+
+    VerifyOrExit(topic != nullptr, error = OT_ERROR_NOT_FOUND);
+    VerifyOrExit(aLength + 1 <= topic->mThreshold, error = OT_ERROR_INVALID_ARGS);
+
+    // Publish buffered batch first when the sample does not fit
+    if (topic->mLength + aLength + 1 > topic->mThreshold)
+    {
+        SuccessOrExit(error = Flush(*topic));
+    }
+
+    if (topic->mSamples == 0)
+    {
+        topic->mDeadline = TimerMilli::GetNow() + topic->mMaxLatency;
+    }
+    topic->mBuffer[topic->mLength++] = aLength;
+    memcpy(topic->mBuffer + topic->mLength, aData, aLength);
+    topic->mLength += aLength;
+    topic->mSamples++;
+    topic->mCounters.mSamples++;
+
+    // Publish the batch when no other sample fits. On failure it is retried when the deadline expires.
+    if (topic->mThreshold - topic->mLength < 2)
+    {
+        Flush(*topic);
+    }
+
+exit:
+    UpdateTimer();
+    return error;
+}
+
+otError PublishAggregator::Flush(TopicId aTopicId)
+{
+    otError error = OT_ERROR_NONE;
+    Topic *topic = FindTopic(aTopicId);
+
+    VerifyOrExit(topic != nullptr, error = OT_ERROR_NOT_FOUND);
+    error = Flush(*topic);
+    UpdateTimer();
+
+exit:
+    return error;
+}
+
+otError PublishAggregator::GetCounters(TopicId aTopicId, AggregatorCounters &aCounters) const
+{
+    otError error = OT_ERROR_NONE;
+    const Topic *topic = FindTopic(aTopicId);
+
+    VerifyOrExit(topic != nullptr, error = OT_ERROR_NOT_FOUND);
+    aCounters = topic->mCounters;
+
+exit:
+    return error;
+}
+
+PublishAggregator::Topic *PublishAggregator::FindTopic(TopicId aTopicId)
+{
+    return const_cast<Topic *>(static_cast<const PublishAggregator *>(this)->FindTopic(aTopicId));
+}
+
+const PublishAggregator::Topic *PublishAggregator::FindTopic(TopicId aTopicId) const
+{
+    for (uint8_t i = 0; i < MQTTSN_AGGREGATOR_MAX_TOPICS; i++)
+    {
+        if (mTopics[i].mIsUsed && mTopics[i].mTopicId == aTopicId)
+        {
+            return &mTopics[i];
+        }
+    }
+    return nullptr;
+}
+
+otError PublishAggregator::Flush(Topic &aTopic)
+{
+    otError error = OT_ERROR_NONE;
+
+    VerifyOrExit(aTopic.mSamples > 0);
+
+    error = mClient.Publish(aTopic.mBuffer, aTopic.mLength, aTopic.mQos, aTopic.mTopicId,
+        aTopic.mCallback, aTopic.mContext);
+    if (error != OT_ERROR_NONE)
+    {
+        // Keep the batch and retry after next latency period
+        aTopic.mCounters.mFailedFlushes++;
+        aTopic.mDeadline = TimerMilli::GetNow() + aTopic.mMaxLatency;
+        goto exit;
+    }
+
+    aTopic.mCounters.mPublishes++;
+    aTopic.mCounters.mFramesSaved += aTopic.mSamples - 1;
+    aTopic.mLength = 0;
+    aTopic.mSamples = 0;
+
+exit:
+    return error;
+}
+
+void PublishAggregator::UpdateTimer()
+{
+    uint32_t now = TimerMilli::GetNow();
+    // Signed difference handles timer wrap around, passed deadlines are negative
+    int32_t interval = INT32_MAX;
+
+    for (uint8_t i = 0; i < MQTTSN_AGGREGATOR_MAX_TOPICS; i++)
+    {
+        if (mTopics[i].mIsUsed && mTopics[i].mSamples > 0)
+        {
+            interval = OT_MIN(interval, static_cast<int32_t>(mTopics[i].mDeadline - now));
+        }
+    }
+
+    if (interval == INT32_MAX)
+    {
+        mTimer.Stop();
+    }
+    else
+    {
+        mTimer.Start(static_cast<uint32_t>(OT_MAX(interval, 0)));
+    }
+}
+
+void PublishAggregator::HandleTimer(Timer &aTimer)
+{
+    aTimer.GetOwner<PublishAggregator>().HandleTimer();
+}
+
+void PublishAggregator::HandleTimer()
+{
+    uint32_t now = TimerMilli::GetNow();
+
+    // Publish batches which reached maximal latency
+    for (uint8_t i = 0; i < MQTTSN_AGGREGATOR_MAX_TOPICS; i++)
+    {
+        Topic &topic = mTopics[i];
+        if (topic.mIsUsed && topic.mSamples > 0 && !WaitingMessagesIndex::IsBefore(now, topic.mDeadline))
+        {
+            Flush(topic);
+        }
+    }
+
+    UpdateTimer();
+}
+
+}
+}
@@ -0,0 +1,219 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MQTTSN_PUBLISH_AGGREGATOR_HPP_
+#define MQTTSN_PUBLISH_AGGREGATOR_HPP_
+
+#include "common/locator.hpp"
+#include "common/timer.hpp"
+#include "mqttsn_client.hpp"
+
+/**
+ * @file
+ *   This file includes interface of publish aggregator. Short payloads published to the same topic are buffered
+ *   and sent as single PUBLISH message carrying batch of length-prefixed samples.
+ *
+ */
+
+/**
+ * Maximal number of topics with active aggregation.
+ *
+ */
+#ifndef MQTTSN_AGGREGATOR_MAX_TOPICS
+#define MQTTSN_AGGREGATOR_MAX_TOPICS 4
+#endif
+
+/**
+ * Maximal size of aggregated batch in bytes. Default value keeps PUBLISH message in single unfragmented
+ * 802.15.4 frame: 127 bytes frame without MAC header, security and FCS (~21 bytes), compressed IPv6 and UDP
+ * headers (~30 bytes) and PUBLISH header (7 bytes) leaves about 69 bytes of payload.
+ *
+ */
+#ifndef MQTTSN_AGGREGATOR_MAX_BATCH_SIZE
+#define MQTTSN_AGGREGATOR_MAX_BATCH_SIZE 64
+#endif
+
+namespace ot {
+
+namespace Mqttsn {
+
+/**
+ * Aggregation counters of single topic.
+ *
+ */
+struct AggregatorCounters
+{
+    /**
+     * Number of samples accepted for aggregation.
+     */
+    uint32_t mSamples;
+    /**
+     * Number of PUBLISH messages sent.
+     */
+    uint32_t mPublishes;
+    /**
+     * Number of PUBLISH messages (and radio frames) saved by aggregation.
+     */
+    uint32_t mFramesSaved;
+    /**
+     * Number of flushes which failed to publish the batch. The batch is kept and flush is retried.
+     */
+    uint32_t mFailedFlushes;
+};
+
+/**
+ * This class implements publisher which aggregates short payloads to the same topic into single PUBLISH message.
+ *
+ * Buffered samples are encoded as sequence of one byte length followed by the sample data. The batch is published
+ * when next sample would exceed the topic size threshold or when the oldest buffered sample reaches maximal latency.
+ *
+ */
+class PublishAggregator: public InstanceLocator
+{
+public:
+    /**
+     * This constructor initializes the object.
+     *
+     * @param[in]  aInstance  A reference to the OpenThread instance.
+     * @param[in]  aClient    A reference to MQTT-SN client used for publishing.
+     *
+     */
+    PublishAggregator(Instance &aInstance, MqttsnClient &aClient);
+
+    /**
+     * Start aggregation of samples published to the topic.
+     *
+     * @param[in]  aTopicId      Topic ID of target topic.
+     * @param[in]  aQos          Quality of service level of published batches.
+     * @param[in]  aThreshold    Batch size in bytes which triggers flush. At most MQTTSN_AGGREGATOR_MAX_BATCH_SIZE.
+     * @param[in]  aMaxLatency   Maximal time in milliseconds the sample is buffered before flush.
+     * @param[in]  aCallback     A function pointer to callback invoked when published batch is acknowledged. It may
+     *                           be null also for QoS level 1 and 2, the client does not invoke missing callback on
+     *                           acknowledgement nor on timeout.
+     * @param[in]  aContext      A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE          Topic aggregation successfully added.
+     * @retval OT_ERROR_INVALID_ARGS  Invalid threshold or QoS level.
+     * @retval OT_ERROR_ALREADY       Topic is already aggregated.
+     * @retval OT_ERROR_NO_BUFS       Maximal number of aggregated topics reached.
+     *
+     */
+    otError AddTopic(TopicId aTopicId, Qos aQos, uint8_t aThreshold, uint32_t aMaxLatency,
+        MqttsnClient::PublishCallbackFunc aCallback, void* aContext);
+
+    /**
+     * Stop aggregation of samples published to the topic. Buffered samples are flushed.
+     *
+     * @param[in]  aTopicId  Topic ID of aggregated topic.
+     *
+     * @retval OT_ERROR_NONE       Topic aggregation successfully removed.
+     * @retval OT_ERROR_NOT_FOUND  Topic is not aggregated.
+     *
+     */
+    otError RemoveTopic(TopicId aTopicId);
+
+    /**
+     * Add sample to aggregated batch of the topic. The batch is published when the threshold is reached.
+     *
+     * @param[in]  aTopicId  Topic ID of aggregated topic.
+     * @param[in]  aData     A pointer to sample data.
+     * @param[in]  aLength   Length of sample data.
+     *
+     * @retval OT_ERROR_NONE           Sample successfully buffered.
+     * @retval OT_ERROR_NOT_FOUND      Topic is not aggregated.
+     * @retval OT_ERROR_INVALID_ARGS   Sample does not fit to the batch of the topic.
+     * @retval OT_ERROR_INVALID_STATE  Batch is full and it could not be published, the client is not in active state.
+     * @retval OT_ERROR_NO_BUFS        Batch is full and it could not be published, insufficient available buffers.
+     *
+     */
+    otError Publish(TopicId aTopicId, const uint8_t* aData, uint8_t aLength);
+
+    /**
+     * Publish buffered samples of the topic immediately.
+     *
+     * @param[in]  aTopicId  Topic ID of aggregated topic.
+     *
+     * @retval OT_ERROR_NONE           Batch successfully published or no samples were buffered.
+     * @retval OT_ERROR_NOT_FOUND      Topic is not aggregated.
+     * @retval OT_ERROR_INVALID_STATE  The client is not in active state.
+     * @retval OT_ERROR_BUSY           In-flight window of the topic QoS level is full.
+     * @retval OT_ERROR_NO_BUFS        Insufficient available buffers to process.
+     *
+     */
+    otError Flush(TopicId aTopicId);
+
+    /**
+     * Get aggregation counters of the topic.
+     *
+     * @param[in]   aTopicId   Topic ID of aggregated topic.
+     * @param[out]  aCounters  A reference to counters structure to be filled.
+     *
+     * @retval OT_ERROR_NONE       Counters successfully read.
+     * @retval OT_ERROR_NOT_FOUND  Topic is not aggregated.
+     *
+     */
+    otError GetCounters(TopicId aTopicId, AggregatorCounters &aCounters) const;
+
+private:
+    struct Topic
+    {
+        bool mIsUsed;
+        TopicId mTopicId;
+        Qos mQos;
+        uint8_t mThreshold;
+        uint8_t mLength;
+        uint8_t mSamples;
+        uint32_t mMaxLatency;
+        uint32_t mDeadline;
+        MqttsnClient::PublishCallbackFunc mCallback;
+        void* mContext;
+        AggregatorCounters mCounters;
+        uint8_t mBuffer[MQTTSN_AGGREGATOR_MAX_BATCH_SIZE];
+    };
+
+    Topic *FindTopic(TopicId aTopicId);
+
+    const Topic *FindTopic(TopicId aTopicId) const;
+
+    otError Flush(Topic &aTopic);
+
+    void UpdateTimer(void);
+
+    static void HandleTimer(Timer &aTimer);
+
+    void HandleTimer(void);
+
+    MqttsnClient &mClient;
+    TimerMilli mTimer;
+    Topic mTopics[MQTTSN_AGGREGATOR_MAX_TOPICS];
+};
+
+}
+}
+
+#endif /* MQTTSN_PUBLISH_AGGREGATOR_HPP_ */
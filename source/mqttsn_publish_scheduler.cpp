@@ -0,0 +1,348 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "mqttsn_publish_scheduler.hpp"
+#include "openthread/platform/random.h"
+
+/**
+ * @file
+ *   This file includes implementation of publish scheduler.
+ *
+ */
+
+// FNV-1a hash spreads similar extended addresses and client IDs over the slots
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+namespace ot {
+
+namespace Mqttsn {
+
+static uint32_t HashKey(const uint8_t* aKey, uint8_t aLength)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for (uint8_t i = 0; i < aLength; i++)
+    {
+        hash = (hash ^ aKey[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+PublishScheduler::PublishScheduler(Instance &aInstance, MqttsnClient &aClient)
+    : InstanceLocator(aInstance)
+    , mClient(aClient)
+    , mTimer(aInstance, &PublishScheduler::HandleTimer, this)
+    , mSlotHash(0)
+    , mHasSlotKey(false)
+    , mExtAddress()
+    , mSlotCount(MQTTSN_SCHEDULER_SLOT_COUNT)
+    , mSlot(0)
+    , mCcaThreshold(MQTTSN_SCHEDULER_CCA_THRESHOLD)
+    , mCcaFailures(0)
+    , mMacCcaFailures(otLinkGetCounters(&aInstance)->mTxErrCca)
+    , mSlotChanges(0)
+    , mTopics()
+{
+    mExtAddress = *otLinkGetExtendedAddress(&aInstance);
+    mSlotHash = HashKey(mExtAddress.m8, sizeof(mExtAddress.m8));
+    mSlot = mSlotHash % mSlotCount;
+}
+
+void PublishScheduler::SetSlotKey(const uint8_t* aKey, uint8_t aLength)
+{
+    mHasSlotKey = true;
+    mSlotHash = HashKey(aKey, aLength);
+    mSlot = mSlotHash % mSlotCount;
+}
+
+otError PublishScheduler::SetSlotCount(uint16_t aSlotCount)
+{
+    otError error = OT_ERROR_NONE;
+
+    VerifyOrExit(aSlotCount > 0, error = OT_ERROR_INVALID_ARGS);
+    mSlotCount = aSlotCount;
+    mSlot = mSlotHash % mSlotCount;
+
+exit:
+    return error;
+}
+
+void PublishScheduler::SetCcaThreshold(uint16_t aThreshold)
+{
+    mCcaThreshold = aThreshold;
+}
+
+uint16_t PublishScheduler::GetSlot() const
+{
+    return mSlot;
+}
+
+uint32_t PublishScheduler::GetSlotChanges() const
+{
+    return mSlotChanges;
+}
+
+otError PublishScheduler::AddTopic(TopicId aTopicId, Qos aQos, uint32_t aPeriod,
+    MqttsnClient::PublishCallbackFunc aCallback, void* aContext)
+{
+    otError error = OT_ERROR_NONE;
+    Topic *topic = nullptr;
+
+    // Period must be long enough to give each slot at least one millisecond
+    VerifyOrExit(aPeriod >= mSlotCount, error = OT_ERROR_INVALID_ARGS);
+    VerifyOrExit(aQos == kQos0 || aQos == kQos1 || aQos == kQos2, error = OT_ERROR_INVALID_ARGS);
+    VerifyOrExit(FindTopic(aTopicId) == nullptr, error = OT_ERROR_ALREADY);
+
+    for (uint8_t i = 0; i < MQTTSN_SCHEDULER_MAX_TOPICS; i++)
+    {
+        if (!mTopics[i].mIsUsed)
+        {
+            topic = &mTopics[i];
+            break;
+        }
+    }
+    VerifyOrExit(topic != nullptr, error = OT_ERROR_NO_BUFS);
+
+    memset(topic, 0, sizeof(*topic));
+    topic->mIsUsed = true;
+    topic->mTopicId = aTopicId;
+    topic->mQos = aQos;
+    topic->mPeriod = aPeriod;
+    topic->mPeriodStart = TimerMilli::GetNow();
+    topic->mCallback = aCallback;
+    topic->mContext = aContext;
+    UpdateSlotKey();
+    ScheduleSlot(*topic);
+    UpdateTimer();
+
+exit:
+    return error;
+}
+
+otError PublishScheduler::RemoveTopic(TopicId aTopicId)
+{
+    otError error = OT_ERROR_NONE;
+    Topic *topic = FindTopic(aTopicId);
+
+    VerifyOrExit(topic != nullptr, error = OT_ERROR_NOT_FOUND);
+    topic->mIsUsed = false;
+    UpdateTimer();
+
+exit:
+    return error;
+}
+
+otError PublishScheduler::Publish(TopicId aTopicId, const uint8_t* aData, uint8_t aLength)
+{
+    otError error = OT_ERROR_NONE;
+    Topic *topic = FindTopic(aTopicId);
+
+    VerifyOrExit(topic != nullptr, error = OT_ERROR_NOT_FOUND);
+    VerifyOrExit(aLength <= MQTTSN_SCHEDULER_MAX_PAYLOAD_SIZE, error = OT_ERROR_INVALID_ARGS);
+
+    // Only the latest sample of periodic topic is worth sending
+    if (topic->mHasSample)
+    {
+        topic->mCounters.mReplacedSamples++;
+    }
+    memcpy(topic->mBuffer, aData, aLength);
+    topic->mLength = aLength;
+    topic->mHasSample = true;
+
+exit:
+    return error;
+}
+
+void PublishScheduler::ReportCcaFailures(uint32_t aCount)
+{
+    mCcaFailures += aCount;
+}
+
+otError PublishScheduler::GetCounters(TopicId aTopicId, SchedulerCounters &aCounters) const
+{
+    otError error = OT_ERROR_NONE;
+    const Topic *topic = FindTopic(aTopicId);
+
+    VerifyOrExit(topic != nullptr, error = OT_ERROR_NOT_FOUND);
+    aCounters = topic->mCounters;
+
+exit:
+    return error;
+}
+
+PublishScheduler::Topic *PublishScheduler::FindTopic(TopicId aTopicId)
+{
+    return const_cast<Topic *>(static_cast<const PublishScheduler *>(this)->FindTopic(aTopicId));
+}
+
+const PublishScheduler::Topic *PublishScheduler::FindTopic(TopicId aTopicId) const
+{
+    for (uint8_t i = 0; i < MQTTSN_SCHEDULER_MAX_TOPICS; i++)
+    {
+        if (mTopics[i].mIsUsed && mTopics[i].mTopicId == aTopicId)
+        {
+            return &mTopics[i];
+        }
+    }
+    return nullptr;
+}
+
+void PublishScheduler::ScheduleSlot(Topic &aTopic)
+{
+    uint32_t slotLength = aTopic.mPeriod / mSlotCount;
+
+    // Random offset within the first half of the slot separates nodes with the same slot
+    aTopic.mDeadline = aTopic.mPeriodStart + slotLength * mSlot;
+    if (slotLength >= 2)
+    {
+        aTopic.mDeadline += otPlatRandomGet() % (slotLength / 2);
+    }
+}
+
+void PublishScheduler::UpdateSlotKey()
+{
+    const otExtAddress* extAddress = otLinkGetExtendedAddress(&GetInstance());
+
+    // Extended address is generated again e.g. on factory reset or when joining other network
+    VerifyOrExit(!mHasSlotKey && memcmp(extAddress->m8, mExtAddress.m8, sizeof(mExtAddress.m8)) != 0);
+    mExtAddress = *extAddress;
+    mSlotHash = HashKey(mExtAddress.m8, sizeof(mExtAddress.m8));
+    mSlot = mSlotHash % mSlotCount;
+
+exit:
+    return;
+}
+
+void PublishScheduler::CollectCcaFailures()
+{
+    uint32_t macCcaFailures = otLinkGetCounters(&GetInstance())->mTxErrCca;
+
+    mCcaFailures += macCcaFailures - mMacCcaFailures;
+    mMacCcaFailures = macCcaFailures;
+}
+
+void PublishScheduler::UpdateSlot()
+{
+    CollectCcaFailures();
+    if (mCcaThreshold > 0 && mCcaFailures >= mCcaThreshold && mSlotCount > 1)
+    {
+        // Other nodes share the busy slot, move to any other slot
+        mSlot = (mSlot + 1 + otPlatRandomGet() % (mSlotCount - 1)) % mSlotCount;
+        mSlotChanges++;
+    }
+    mCcaFailures = 0;
+}
+
+void PublishScheduler::UpdateTimer()
+{
+    uint32_t now = TimerMilli::GetNow();
+    // Signed difference handles timer wrap around, passed deadlines are negative
+    int32_t interval = INT32_MAX;
+
+    for (uint8_t i = 0; i < MQTTSN_SCHEDULER_MAX_TOPICS; i++)
+    {
+        if (mTopics[i].mIsUsed)
+        {
+            interval = OT_MIN(interval, static_cast<int32_t>(mTopics[i].mDeadline - now));
+        }
+    }
+
+    if (interval == INT32_MAX)
+    {
+        mTimer.Stop();
+    }
+    else
+    {
+        mTimer.Start(static_cast<uint32_t>(OT_MAX(interval, 0)));
+    }
+}
+
+void PublishScheduler::HandleTimer(Timer &aTimer)
+{
+    aTimer.GetOwner<PublishScheduler>().HandleTimer();
+}
+
+void PublishScheduler::HandleTimer()
+{
+    uint32_t now = TimerMilli::GetNow();
+    bool isSlotReached = false;
+
+    for (uint8_t i = 0; i < MQTTSN_SCHEDULER_MAX_TOPICS; i++)
+    {
+        if (mTopics[i].mIsUsed && !WaitingMessagesIndex::IsBefore(now, mTopics[i].mDeadline))
+        {
+            isSlotReached = true;
+        }
+    }
+
+    // Slot is evaluated once per pass, so all topics published in the pass are scheduled to the same next slot
+    if (isSlotReached)
+    {
+        UpdateSlotKey();
+        UpdateSlot();
+    }
+
+    // Publish samples of topics which reached their slot
+    for (uint8_t i = 0; i < MQTTSN_SCHEDULER_MAX_TOPICS; i++)
+    {
+        Topic &topic = mTopics[i];
+        if (!topic.mIsUsed || WaitingMessagesIndex::IsBefore(now, topic.mDeadline))
+        {
+            continue;
+        }
+
+        if (topic.mHasSample)
+        {
+            if (mClient.Publish(topic.mBuffer, topic.mLength, topic.mQos, topic.mTopicId,
+                topic.mCallback, topic.mContext) == OT_ERROR_NONE)
+            {
+                topic.mCounters.mPublishes++;
+                topic.mHasSample = false;
+            }
+            else
+            {
+                // Keep the sample for the next slot, sending it out of slot would collide with other nodes
+                topic.mCounters.mFailedPublishes++;
+            }
+        }
+
+        // Late timer skips missed periods instead of publishing in burst
+        do
+        {
+            topic.mPeriodStart += topic.mPeriod;
+        } while (!WaitingMessagesIndex::IsBefore(now, topic.mPeriodStart + topic.mPeriod));
+        ScheduleSlot(topic);
+    }
+
+    UpdateTimer();
+}
+
+}
+}
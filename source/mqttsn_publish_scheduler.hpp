@@ -0,0 +1,286 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MQTTSN_PUBLISH_SCHEDULER_HPP_
+#define MQTTSN_PUBLISH_SCHEDULER_HPP_
+
+#include "common/locator.hpp"
+#include "common/timer.hpp"
+#include "mqttsn_client.hpp"
+#include "openthread/link.h"
+
+/**
+ * @file
+ *   This file includes interface of publish scheduler. Periodic publications of the node are sent in its own
+ *   time slot within the period, so periodic sensors on many nodes do not transmit at the same time.
+ *
+ */
+
+/**
+ * Maximal number of periodically published topics.
+ *
+ */
+#ifndef MQTTSN_SCHEDULER_MAX_TOPICS
+#define MQTTSN_SCHEDULER_MAX_TOPICS 4
+#endif
+
+/**
+ * Maximal size of scheduled payload in bytes.
+ *
+ */
+#ifndef MQTTSN_SCHEDULER_MAX_PAYLOAD_SIZE
+#define MQTTSN_SCHEDULER_MAX_PAYLOAD_SIZE 64
+#endif
+
+/**
+ * Default number of slots in the publish period.
+ *
+ */
+#ifndef MQTTSN_SCHEDULER_SLOT_COUNT
+#define MQTTSN_SCHEDULER_SLOT_COUNT 16
+#endif
+
+/**
+ * Default number of CCA failures observed between two slots of the node after which the node moves to other slot.
+ *
+ */
+#ifndef MQTTSN_SCHEDULER_CCA_THRESHOLD
+#define MQTTSN_SCHEDULER_CCA_THRESHOLD 4
+#endif
+
+namespace ot {
+
+namespace Mqttsn {
+
+/**
+ * Scheduler counters of single topic.
+ *
+ */
+struct SchedulerCounters
+{
+    /**
+     * Number of PUBLISH messages sent in the slot.
+     */
+    uint32_t mPublishes;
+    /**
+     * Number of samples replaced by newer sample before their slot.
+     */
+    uint32_t mReplacedSamples;
+    /**
+     * Number of slots in which the sample could not be published. The sample is kept for the next slot.
+     */
+    uint32_t mFailedPublishes;
+};
+
+/**
+ * This class implements scheduler which publishes the latest sample of periodic topics in the node time slot.
+ *
+ * Publish period of each topic is divided to the configured number of slots. The slot of the node is derived
+ * from hash of its IEEE 802.15.4 extended address or of other key, e.g. client ID, so nodes started at the same
+ * time spread their publications over the whole period. Each sample is sent at random time within the first half
+ * of the slot to separate nodes sharing the slot. Nodes do not share common time, the slot determines phase of the
+ * node relative to topic start. When CCA failures observed between two slots reach the threshold, the node moves
+ * to other random slot.
+ *
+ */
+class PublishScheduler: public InstanceLocator
+{
+public:
+    /**
+     * This constructor initializes the object. The slot is derived from extended address of the node and it is
+     * derived again when the address changes until other key is set.
+     *
+     * @param[in]  aInstance  A reference to the OpenThread instance.
+     * @param[in]  aClient    A reference to MQTT-SN client used for publishing.
+     *
+     */
+    PublishScheduler(Instance &aInstance, MqttsnClient &aClient);
+
+    /**
+     * Derive node slot from given key instead of extended address, e.g. from client ID. Later changes of extended
+     * address do not move the slot.
+     *
+     * @param[in]  aKey     A pointer to key data.
+     * @param[in]  aLength  Length of key data.
+     *
+     */
+    void SetSlotKey(const uint8_t* aKey, uint8_t aLength);
+
+    /**
+     * Set number of slots in the publish period. Schedule of already added topics is not changed.
+     *
+     * @param[in]  aSlotCount  Number of slots, at least one.
+     *
+     * @retval OT_ERROR_NONE          Slot count successfully set.
+     * @retval OT_ERROR_INVALID_ARGS  Slot count is zero.
+     *
+     */
+    otError SetSlotCount(uint16_t aSlotCount);
+
+    /**
+     * Set number of CCA failures observed between two slots of the node after which the node moves to other slot.
+     *
+     * @param[in]  aThreshold  CCA failure threshold, zero disables slot changes.
+     *
+     */
+    void SetCcaThreshold(uint16_t aThreshold);
+
+    /**
+     * Get current slot of the node.
+     *
+     * @returns Slot index.
+     *
+     */
+    uint16_t GetSlot(void) const;
+
+    /**
+     * Get number of slot changes caused by CCA failures.
+     *
+     * @returns Number of slot changes.
+     *
+     */
+    uint32_t GetSlotChanges(void) const;
+
+    /**
+     * Start periodic publishing of the topic. The first slot starts within one period.
+     *
+     * @param[in]  aTopicId   Topic ID of target topic.
+     * @param[in]  aQos       Quality of service level of published messages.
+     * @param[in]  aPeriod    Publish period in milliseconds.
+     * @param[in]  aCallback  A function pointer to callback invoked when published message is acknowledged. It may be
+     *                        null also for QoS level 1 and 2.
+     * @param[in]  aContext   A pointer to context object passed to callback.
+     *
+     * @retval OT_ERROR_NONE          Topic successfully added.
+     * @retval OT_ERROR_INVALID_ARGS  Invalid period or QoS level.
+     * @retval OT_ERROR_ALREADY       Topic is already scheduled.
+     * @retval OT_ERROR_NO_BUFS       Maximal number of scheduled topics reached.
+     *
+     */
+    otError AddTopic(TopicId aTopicId, Qos aQos, uint32_t aPeriod, MqttsnClient::PublishCallbackFunc aCallback,
+        void* aContext);
+
+    /**
+     * Stop periodic publishing of the topic. Sample waiting for its slot is dropped.
+     *
+     * @param[in]  aTopicId  Topic ID of scheduled topic.
+     *
+     * @retval OT_ERROR_NONE       Topic successfully removed.
+     * @retval OT_ERROR_NOT_FOUND  Topic is not scheduled.
+     *
+     */
+    otError RemoveTopic(TopicId aTopicId);
+
+    /**
+     * Set sample published in the next slot of the topic. Sample waiting for its slot is replaced.
+     *
+     * @param[in]  aTopicId  Topic ID of scheduled topic.
+     * @param[in]  aData     A pointer to sample data.
+     * @param[in]  aLength   Length of sample data.
+     *
+     * @retval OT_ERROR_NONE          Sample successfully stored.
+     * @retval OT_ERROR_NOT_FOUND     Topic is not scheduled.
+     * @retval OT_ERROR_INVALID_ARGS  Sample is larger than MQTTSN_SCHEDULER_MAX_PAYLOAD_SIZE.
+     *
+     */
+    otError Publish(TopicId aTopicId, const uint8_t* aData, uint8_t aLength);
+
+    /**
+     * Report CCA failures observed by application. CCA failures counted by MAC layer are collected automatically
+     * in each slot.
+     *
+     * @param[in]  aCount  Number of new CCA failures.
+     *
+     */
+    void ReportCcaFailures(uint32_t aCount);
+
+    /**
+     * Get scheduler counters of the topic.
+     *
+     * @param[in]   aTopicId   Topic ID of scheduled topic.
+     * @param[out]  aCounters  A reference to counters structure to be filled.
+     *
+     * @retval OT_ERROR_NONE       Counters successfully read.
+     * @retval OT_ERROR_NOT_FOUND  Topic is not scheduled.
+     *
+     */
+    otError GetCounters(TopicId aTopicId, SchedulerCounters &aCounters) const;
+
+private:
+    struct Topic
+    {
+        bool mIsUsed;
+        TopicId mTopicId;
+        Qos mQos;
+        uint8_t mLength;
+        bool mHasSample;
+        uint32_t mPeriod;
+        uint32_t mPeriodStart;
+        uint32_t mDeadline;
+        MqttsnClient::PublishCallbackFunc mCallback;
+        void* mContext;
+        SchedulerCounters mCounters;
+        uint8_t mBuffer[MQTTSN_SCHEDULER_MAX_PAYLOAD_SIZE];
+    };
+
+    Topic *FindTopic(TopicId aTopicId);
+
+    const Topic *FindTopic(TopicId aTopicId) const;
+
+    void ScheduleSlot(Topic &aTopic);
+
+    void UpdateSlotKey(void);
+
+    void CollectCcaFailures(void);
+
+    void UpdateSlot(void);
+
+    void UpdateTimer(void);
+
+    static void HandleTimer(Timer &aTimer);
+
+    void HandleTimer(void);
+
+    MqttsnClient &mClient;
+    TimerMilli mTimer;
+    uint32_t mSlotHash;
+    bool mHasSlotKey;
+    otExtAddress mExtAddress;
+    uint16_t mSlotCount;
+    uint16_t mSlot;
+    uint16_t mCcaThreshold;
+    uint32_t mCcaFailures;
+    uint32_t mMacCcaFailures;
+    uint32_t mSlotChanges;
+    Topic mTopics[MQTTSN_SCHEDULER_MAX_TOPICS];
+};
+
+}
+}
+
+#endif /* MQTTSN_PUBLISH_SCHEDULER_HPP_ */
@@ -36,10 +36,74 @@
  *
  */
 
+/**
+ * Maximal length of MQTT-SN length field in bytes.
+ *
+ */
+#define MQTTSN_MAX_LENGTH_FIELD_SIZE 3
+/**
+ * Length of PUBLISH message fields following the length field (type, flags, topic ID and message ID).
+ *
+ */
+#define MQTTSN_PUBLISH_FIELDS_LENGTH 6
+/**
+ * Size of buffer in which control messages (messages without payload) are serialized. The longest one is REGISTER
+ * with the longest topic name, 55 bytes. Longer messages fail to serialize.
+ *
+ */
+#define MQTTSN_MAX_CONTROL_PACKET_SIZE 64
+/**
+ * Length of REGISTER message fields other than topic name (length, type, topic ID and message ID).
+ *
+ */
+#define MQTTSN_REGISTER_FIELDS_LENGTH 6
+/**
+ * Maximal length of MQTT-SN message with one byte long length field.
+ *
+ */
+#define MQTTSN_MAX_SHORT_PACKET_SIZE 255
+/**
+ * PUBLISH message flags masks.
+ *
+ */
+#define MQTTSN_FLAG_DUP 0x80
+#define MQTTSN_FLAG_QOS_MASK 0x60
+#define MQTTSN_FLAG_QOS_SHIFT 5
+#define MQTTSN_FLAG_RETAIN 0x10
+#define MQTTSN_FLAG_TOPIC_ID_TYPE_MASK 0x03
+
 namespace ot {
 
 namespace Mqttsn {
 
+static otError MessageHeaderDecode(const Message &aMessage, uint8_t* aLengthFieldSize, uint8_t* aMessageType)
+{
+    otError error = OT_ERROR_NONE;
+    uint8_t header[MQTTSN_MAX_LENGTH_FIELD_SIZE + 1];
+    uint16_t length = aMessage.GetLength() - aMessage.GetOffset();
+    uint16_t read = aMessage.Read(aMessage.GetOffset(), sizeof(header), header);
+    uint16_t packetLength;
+
+    VerifyOrExit(read >= 2, error = OT_ERROR_FAILED);
+    // Value 0x01 of the first byte indicates three bytes long length field
+    if (header[0] == 0x01)
+    {
+        VerifyOrExit(read >= MQTTSN_MAX_LENGTH_FIELD_SIZE + 1, error = OT_ERROR_FAILED);
+        packetLength = static_cast<uint16_t>((header[1] << 8) | header[2]);
+        *aLengthFieldSize = MQTTSN_MAX_LENGTH_FIELD_SIZE;
+    }
+    else
+    {
+        packetLength = header[0];
+        *aLengthFieldSize = 1;
+    }
+    VerifyOrExit(packetLength == length, error = OT_ERROR_FAILED);
+    *aMessageType = header[*aLengthFieldSize];
+
+exit:
+    return error;
+}
+
 static int32_t PacketDecode(const unsigned char* aData, size_t aLength)
 {
     int lenlen = 0;
@@ -64,6 +128,34 @@ otError MessageBase::DeserializeMessageType(const uint8_t* aBuffer, int32_t aBuf
     return OT_ERROR_NONE;
 }
 
+otError MessageBase::Serialize(Message &aMessage) const
+{
+    otError error = OT_ERROR_NONE;
+    uint8_t buffer[MQTTSN_MAX_CONTROL_PACKET_SIZE];
+    int32_t length;
+
+    static_assert(MQTTSN_REGISTER_FIELDS_LENGTH + kMaxTopicNameLength - 1 <= MQTTSN_MAX_CONTROL_PACKET_SIZE,
+        "Control packet buffer is too small for the longest topic name");
+    SuccessOrExit(error = Serialize(buffer, sizeof(buffer), &length));
+    SuccessOrExit(error = aMessage.Append(buffer, static_cast<uint16_t>(length)));
+
+exit:
+    return error;
+}
+
+otError MessageBase::DeserializeMessageType(const Message &aMessage, MessageType* aMessageType)
+{
+    otError error = OT_ERROR_NONE;
+    uint8_t lengthFieldSize;
+    uint8_t type;
+
+    SuccessOrExit(error = MessageHeaderDecode(aMessage, &lengthFieldSize, &type));
+    *aMessageType = static_cast<MessageType>(type);
+
+exit:
+    return error;
+}
+
 otError AdvertiseMessage::Serialize(uint8_t* aBuffer, uint8_t aBufferLength, int32_t* aLength) const
 {
     int32_t length = MQTTSNSerialize_advertise(aBuffer, aBufferLength, mGatewayId, mDuration);
@@ -133,18 +225,19 @@ otError GwInfoMessage::Deserialize(const uint8_t* aBuffer, int32_t aBufferLength
     Ip6::Address::InfoString addressString;
     int32_t length = MQTTSNDeserialize_gwinfo(&mGatewayId, &addressLength, &address, const_cast<unsigned char*>(aBuffer), aBufferLength);
     VerifyOrExit(length > 0, error = OT_ERROR_FAILED);
+    // Address is present only in GWINFO sent by other client
     if (addressLength > 0)
     {
         SuccessOrExit(addressString.Set("%.*s", static_cast<int32_t>(addressLength), address));
+        SuccessOrExit(error = mAddress.FromString(addressString.AsCString()));
         mHasAddress = true;
     }
     else
     {
+        mAddress = Ip6::Address();
         mHasAddress = false;
     }
 
-    SuccessOrExit(error = mAddress.FromString(addressString.AsCString()));
-
 exit:
     return error;
 }
@@ -267,7 +360,7 @@ otError PublishMessage::Serialize(uint8_t* aBuffer, uint8_t aBufferLength, int32
         topicId.data.id = static_cast<unsigned short>(mTopicId);
         break;
     case kShortTopicName:
-        topicId.type = MQTTSN_TOPIC_TYPE_NORMAL;
+        topicId.type = MQTTSN_TOPIC_TYPE_SHORT;
         memcpy(topicId.data.short_name, mShortTopicName.AsCString(), 2);
         break;
     default:
@@ -283,6 +376,73 @@ otError PublishMessage::Serialize(uint8_t* aBuffer, uint8_t aBufferLength, int32
     return OT_ERROR_NONE;
 }
 
+otError PublishMessage::Serialize(Message &aMessage) const
+{
+    otError error = OT_ERROR_NONE;
+    uint8_t header[MQTTSN_MAX_LENGTH_FIELD_SIZE + MQTTSN_PUBLISH_FIELDS_LENGTH];
+    uint16_t offset = aMessage.GetLength();
+    uint32_t length = MQTTSN_PUBLISH_FIELDS_LENGTH + static_cast<uint32_t>(mPayloadLength);
+    uint8_t lengthFieldSize;
+    uint8_t* fields;
+
+    VerifyOrExit(mPayloadLength >= 0 && (mPayload != nullptr || mPayloadLength == 0), error = OT_ERROR_INVALID_ARGS);
+
+    // Compute exact packet length, three bytes long length field is used for packets longer than 255 bytes
+    if (length + 1 > MQTTSN_MAX_SHORT_PACKET_SIZE)
+    {
+        length += MQTTSN_MAX_LENGTH_FIELD_SIZE;
+        VerifyOrExit(length <= 0xffff, error = OT_ERROR_INVALID_ARGS);
+        lengthFieldSize = MQTTSN_MAX_LENGTH_FIELD_SIZE;
+        header[0] = 0x01;
+        header[1] = static_cast<uint8_t>(length >> 8);
+        header[2] = static_cast<uint8_t>(length & 0xff);
+    }
+    else
+    {
+        length += 1;
+        lengthFieldSize = 1;
+        header[0] = static_cast<uint8_t>(length);
+    }
+
+    header[lengthFieldSize] = kTypePublish;
+    // Fields following the message type: flags, topic ID and message ID
+    fields = header + lengthFieldSize + 1;
+    fields[0] = static_cast<uint8_t>((mQos << MQTTSN_FLAG_QOS_SHIFT) & MQTTSN_FLAG_QOS_MASK);
+    if (mDupFlag)
+    {
+        fields[0] |= MQTTSN_FLAG_DUP;
+    }
+    if (mRetainedFlag)
+    {
+        fields[0] |= MQTTSN_FLAG_RETAIN;
+    }
+    switch (mTopicIdType)
+    {
+    case kTopicId:
+        fields[0] |= MQTTSN_TOPIC_TYPE_PREDEFINED;
+        fields[1] = static_cast<uint8_t>(mTopicId >> 8);
+        fields[2] = static_cast<uint8_t>(mTopicId & 0xff);
+        break;
+    case kShortTopicName:
+        fields[0] |= MQTTSN_TOPIC_TYPE_SHORT;
+        memcpy(&fields[1], mShortTopicName.AsCString(), 2);
+        break;
+    default:
+        error = OT_ERROR_INVALID_STATE;
+        goto exit;
+    }
+    fields[3] = static_cast<uint8_t>(mMessageId >> 8);
+    fields[4] = static_cast<uint8_t>(mMessageId & 0xff);
+
+    // Reserve the whole packet at once and write header and payload to their positions
+    SuccessOrExit(error = aMessage.SetLength(offset + static_cast<uint16_t>(length)));
+    aMessage.Write(offset, lengthFieldSize + MQTTSN_PUBLISH_FIELDS_LENGTH, header);
+    aMessage.Write(offset + lengthFieldSize + MQTTSN_PUBLISH_FIELDS_LENGTH, static_cast<uint16_t>(mPayloadLength), mPayload);
+
+exit:
+    return error;
+}
+
 otError PublishMessage::Deserialize(const uint8_t* aBuffer, int32_t aBufferLength)
 {
     otError error = OT_ERROR_NONE;
@@ -320,6 +480,72 @@ otError PublishMessage::Deserialize(const uint8_t* aBuffer, int32_t aBufferLengt
 
     mPayload = payload;
     mPayloadLength = static_cast<int32_t>(payloadLength);
+    mPayloadOffset = 0;
+
+exit:
+    return error;
+}
+
+otError PublishMessage::Deserialize(const Message &aMessage)
+{
+    otError error = OT_ERROR_NONE;
+    uint8_t header[MQTTSN_MAX_LENGTH_FIELD_SIZE + MQTTSN_PUBLISH_FIELDS_LENGTH];
+    uint16_t length = aMessage.GetLength() - aMessage.GetOffset();
+    uint8_t lengthFieldSize;
+    uint8_t type;
+    uint16_t headerLength;
+    uint8_t* fields;
+
+    SuccessOrExit(error = MessageHeaderDecode(aMessage, &lengthFieldSize, &type));
+    VerifyOrExit(type == kTypePublish, error = OT_ERROR_FAILED);
+    headerLength = lengthFieldSize + MQTTSN_PUBLISH_FIELDS_LENGTH;
+    VerifyOrExit(length >= headerLength, error = OT_ERROR_FAILED);
+    aMessage.Read(aMessage.GetOffset(), headerLength, header);
+
+    // Fields following the message type: flags, topic ID and message ID
+    fields = header + lengthFieldSize + 1;
+    mDupFlag = (fields[0] & MQTTSN_FLAG_DUP) != 0;
+    mRetainedFlag = (fields[0] & MQTTSN_FLAG_RETAIN) != 0;
+    mQos = static_cast<Qos>((fields[0] & MQTTSN_FLAG_QOS_MASK) >> MQTTSN_FLAG_QOS_SHIFT);
+    mMessageId = static_cast<uint16_t>((fields[3] << 8) | fields[4]);
+
+    switch (fields[0] & MQTTSN_FLAG_TOPIC_ID_TYPE_MASK)
+    {
+    case MQTTSN_TOPIC_TYPE_PREDEFINED:
+        mTopicIdType = kTopicId;
+        mTopicId = static_cast<TopicId>((fields[1] << 8) | fields[2]);
+        break;
+    case MQTTSN_TOPIC_TYPE_SHORT:
+        mTopicIdType = kShortTopicName;
+        SuccessOrExit(error = mShortTopicName.Set("%.*s", 2, reinterpret_cast<const char*>(&fields[1])));
+        break;
+    default:
+        error = OT_ERROR_INVALID_STATE;
+        goto exit;
+    }
+
+    mPayload = nullptr;
+    mPayloadOffset = aMessage.GetOffset() + headerLength;
+    mPayloadLength = static_cast<int32_t>(length - headerLength);
+
+exit:
+    return error;
+}
+
+otError PublishMessage::UpdateTopicId(Message &aMessage, TopicId aTopicId)
+{
+    otError error = OT_ERROR_NONE;
+    uint8_t lengthFieldSize;
+    uint8_t type;
+    uint8_t topicId[2];
+
+    SuccessOrExit(error = MessageHeaderDecode(aMessage, &lengthFieldSize, &type));
+    VerifyOrExit(type == kTypePublish, error = OT_ERROR_FAILED);
+
+    // Topic ID follows message type and flags
+    topicId[0] = static_cast<uint8_t>(aTopicId >> 8);
+    topicId[1] = static_cast<uint8_t>(aTopicId & 0xff);
+    aMessage.Write(aMessage.GetOffset() + lengthFieldSize + 2, sizeof(topicId), topicId);
 
 exit:
     return error;
@@ -363,7 +589,13 @@ otError PubcompMessage::Serialize(uint8_t* aBuffer, uint8_t aBufferLength, int32
 
 otError PubcompMessage::Deserialize(const uint8_t* aBuffer, int32_t aBufferLength)
 {
-    return OT_ERROR_NOT_IMPLEMENTED;
+    unsigned char type;
+    if (MQTTSNDeserialize_ack(&type, &mMessageId, const_cast<unsigned char*>(aBuffer), aBufferLength) != 1
+        || type != kTypePubcomp)
+    {
+        return OT_ERROR_FAILED;
+    }
+    return OT_ERROR_NONE;
 }
 
 otError PubrecMessage::Serialize(uint8_t* aBuffer, uint8_t aBufferLength, int32_t* aLength) const
@@ -379,7 +611,13 @@ otError PubrecMessage::Serialize(uint8_t* aBuffer, uint8_t aBufferLength, int32_
 
 otError PubrecMessage::Deserialize(const uint8_t* aBuffer, int32_t aBufferLength)
 {
-    return OT_ERROR_NOT_IMPLEMENTED;
+    unsigned char type;
+    if (MQTTSNDeserialize_ack(&type, &mMessageId, const_cast<unsigned char*>(aBuffer), aBufferLength) != 1
+        || type != kTypePubrec)
+    {
+        return OT_ERROR_FAILED;
+    }
+    return OT_ERROR_NONE;
 }
 
 otError PubrelMessage::Serialize(uint8_t* aBuffer, uint8_t aBufferLength, int32_t* aLength) const
@@ -395,7 +633,13 @@ otError PubrelMessage::Serialize(uint8_t* aBuffer, uint8_t aBufferLength, int32_
 
 otError PubrelMessage::Deserialize(const uint8_t* aBuffer, int32_t aBufferLength)
 {
-    return OT_ERROR_NOT_IMPLEMENTED;
+    unsigned char type;
+    if (MQTTSNDeserialize_ack(&type, &mMessageId, const_cast<unsigned char*>(aBuffer), aBufferLength) != 1
+        || type != kTypePubrel)
+    {
+        return OT_ERROR_FAILED;
+    }
+    return OT_ERROR_NONE;
 }
 
 otError SubscribeMessage::Serialize(uint8_t* aBuffer, uint8_t aBufferLength, int32_t* aLength) const
@@ -31,6 +31,7 @@
 
 #include <stdint.h>
 
+#include "common/message.hpp"
 #include "net/ip6_address.hpp"
 #include "mqttsn_client.hpp"
 
@@ -95,10 +96,26 @@ public:
 
     virtual otError Serialize(uint8_t* aBuffer, uint8_t aBufferLength, int32_t* aLength) const = 0;
 
+    /**
+     * Serialize the message to the end of OpenThread message. Control messages are short and they are
+     * serialized with Paho serializer in 64 bytes long stack buffer by default, which fits REGISTER with the
+     * longest topic name. Messages with payload write content directly to the message.
+     *
+     * @param[in]  aMessage  A reference to the message to which serialized packet is appended.
+     *
+     * @retval OT_ERROR_NONE     Message successfully serialized.
+     * @retval OT_ERROR_FAILED   Message does not fit the buffer or its fields are invalid.
+     * @retval OT_ERROR_NO_BUFS  Insufficient available buffers to extend the message.
+     *
+     */
+    virtual otError Serialize(Message &aMessage) const;
+
     virtual otError Deserialize(const uint8_t* aBuffer, int32_t aBufferLength) = 0;
 
     static otError DeserializeMessageType(const uint8_t* aBuffer, int32_t aBufferLength, MessageType* aMessageType);
 
+    static otError DeserializeMessageType(const Message &aMessage, MessageType* aMessageType);
+
 private:
     MessageType mMessageType;
 };
@@ -379,6 +396,7 @@ public:
         , mShortTopicName("%s", aShortTopicName)
         , mPayload(aPayload)
         , mPayloadLength(aPayloadLength)
+        , mPayloadOffset(0)
     {
         ;
     }
@@ -419,10 +437,38 @@ public:
 
     void SetPayloadLenghth(int32_t aPayloadLenght) { mPayloadLength = aPayloadLenght; }
 
+    uint16_t GetPayloadOffset() const { return mPayloadOffset; }
+
     otError Serialize(uint8_t* aBuffer, uint8_t aBufferLength, int32_t* aLength) const;
 
+    /**
+     * Serialize PUBLISH message to the end of the message. The message is extended to the exact packet length
+     * and the payload is written directly without intermediate buffer.
+     *
+     */
+    otError Serialize(Message &aMessage) const;
+
     otError Deserialize(const uint8_t* aBuffer, int32_t aBufferLength);
 
+    /**
+     * Deserialize PUBLISH header in place from the message starting at message offset. Payload is not
+     * copied, its position in the message is available by GetPayloadOffset and payload pointer is null.
+     *
+     */
+    otError Deserialize(const Message &aMessage);
+
+    /**
+     * Overwrite topic ID of PUBLISH message serialized in the message.
+     *
+     * @param[in]  aMessage  A reference to the message with serialized PUBLISH message.
+     * @param[in]  aTopicId  New topic ID.
+     *
+     * @retval OT_ERROR_NONE    Topic ID successfully updated.
+     * @retval OT_ERROR_FAILED  The message does not contain PUBLISH message.
+     *
+     */
+    static otError UpdateTopicId(Message &aMessage, TopicId aTopicId);
+
 private:
     bool mDupFlag;
     bool mRetainedFlag;
@@ -433,6 +479,7 @@ private:
     ShortTopicNameString mShortTopicName;
     const uint8_t* mPayload;
     int32_t mPayloadLength;
+    uint16_t mPayloadOffset;
 };
 
 class PubackMessage : public MessageBase
@@ -163,7 +163,7 @@
 #define OPENTHREAD_ENABLE_RAW_LINK_API 0
 
 /* Define to 1 if you want to enable Service */
-#define OPENTHREAD_ENABLE_SERVICE 0
+#define OPENTHREAD_ENABLE_SERVICE 1
 
 /* Define to 1 if you want to enable SNTP Client */
 #define OPENTHREAD_ENABLE_SNTP_CLIENT 0
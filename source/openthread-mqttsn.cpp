@@ -36,11 +36,11 @@
 #include "utils/slaac_address.hpp"
 
 #include "board.h"
-#include "fsl_debug_console.h"
 
 // TODO: Implement log output with OT platform implementation
 
 #include "mqttsn_client.hpp"
+#include "mqttsn_log.hpp"
 
 #define NETWORK_NAME "OTBR4444"
 #define PANID 0x4444
@@ -55,6 +55,7 @@
 #define GATEWAY_MULTICAST_PORT 10000
 #define GATEWAY_MULTICAST_ADDRESS "ff03::2"
 #define GATEWAY_MULTICAST_RADIUS 8
+#define GATEWAY_SEARCH_JITTER 1000
 
 #define DEFAULT_TOPIC "topic"
 #define SEND_TIMEOUT 3000
@@ -68,8 +69,10 @@ enum ApplicationState
     kInitialized,
     kThreadStarting,
     kThreadStarted,
+    kMqttReconnectWait,
     kMqttSearchGw,
     kMqttConnecting,
+    kMqttRestoring,
     kMqttConnected,
     kMqttRunning
 };
@@ -77,11 +80,17 @@ enum ApplicationState
 static ApplicationState sState = kStarted;
 static ot::Mqttsn::MqttsnClient* sClient = nullptr;
 static uint32_t sConnectionTimeoutTime = 0;
+static uint32_t sReconnectTime = 0;
 static otNetifAddress sSlaacAddresses[OPENTHREAD_CONFIG_NUM_SLAAC_ADDRESSES];
-#if GATEWAY_SEARCH
-static ot::Ip6::Address sGatewayAddress;
-static uint32_t sSearchGwTimeoutTime = 0;
-#endif
+
+static void MqttsnReconnectLater()
+{
+    // Clients of restarted gateway must not reconnect at the same time
+    uint32_t delay = sClient->NextReconnectDelay();
+    MQTTSN_LOG("Reconnecting in %lu ms.\r\n", static_cast<unsigned long>(delay));
+    sReconnectTime = ot::TimerMilli::GetNow() + delay;
+    sState = kMqttReconnectWait;
+}
 
 static void MqttsnConnectedCallback(ot::Mqttsn::ReturnCode aCode, void* aContext)
 {
@@ -89,13 +98,24 @@ static void MqttsnConnectedCallback(ot::Mqttsn::ReturnCode aCode, void* aContext
 
     if (aCode == ot::Mqttsn::kCodeAccepted)
     {
-        PRINTF("Successfully connected.\r\n");
-        sState = kMqttConnected;
+        MQTTSN_LOG("Successfully connected.\r\n");
+        sState = kMqttRestoring;
     }
     else
     {
-        PRINTF("Connection failed with code: %d.\r\n", aCode);
-        sState = kThreadStarted;
+        MQTTSN_LOG("Connection failed with code: %d.\r\n", aCode);
+        MqttsnReconnectLater();
+    }
+}
+
+static void MqttsnSessionRestoredCallback(ot::Mqttsn::ReturnCode aCode, uint32_t aDuration, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+
+    MQTTSN_LOG("Session restored in %lu ms with code: %d.\r\n", static_cast<unsigned long>(aDuration), aCode);
+    if (sState == kMqttRestoring)
+    {
+        sState = kMqttConnected;
     }
 }
 
@@ -103,53 +123,84 @@ static void MqttsnDisconnectedCallback(ot::Mqttsn::DisconnectType aType, void* a
 {
     OT_UNUSED_VARIABLE(aContext);
 
-    PRINTF("Client disconnected. Reason: %d.\r\n", aType);
-    sState = kThreadStarted;
+    MQTTSN_LOG("Client disconnected. Reason: %d.\r\n", aType);
+    MqttsnReconnectLater();
 }
 
-static ot::Mqttsn::ReturnCode MqttsnReceived(const uint8_t* aPayload, int32_t aPayloadLength, ot::Mqttsn::TopicIdType aTopicIdType, ot::Mqttsn::TopicId aTopicId, ot::Mqttsn::ShortTopicNameString aShortTopicName, void* aContext)
+static ot::Mqttsn::ReturnCode MqttsnReceived(const ot::Message &aMessage, uint16_t aPayloadOffset, int32_t aPayloadLength, ot::Mqttsn::TopicIdType aTopicIdType, ot::Mqttsn::TopicId aTopicId, ot::Mqttsn::ShortTopicNameString aShortTopicName, void* aContext)
 {
     OT_UNUSED_VARIABLE(aContext);
 
     if (aTopicIdType == ot::Mqttsn::kTopicId)
     {
-        PRINTF("Message received from topic %d.\r\n", aTopicId);
+        MQTTSN_LOG("Message received from topic %d.\r\n", aTopicId);
     }
     else if (aTopicIdType == ot::Mqttsn::kShortTopicName)
     {
-        PRINTF("Message received from topic %s.\r\n", aShortTopicName);
+        MQTTSN_LOG("Message received from topic %s.\r\n", aShortTopicName.AsCString());
     }
 
-    for (int i = 0; i < aPayloadLength; i++)
+    // Read payload from the message by small chunks
+    char buffer[17];
+    for (int32_t i = 0; i < aPayloadLength; i += sizeof(buffer) - 1)
     {
-        PRINTF("%c", static_cast<int8_t>(aPayload[i]));
+        uint16_t length = aMessage.Read(aPayloadOffset + i, sizeof(buffer) - 1, buffer);
+        length = (length < aPayloadLength - i) ? length : aPayloadLength - i;
+        buffer[length] = '\0';
+        MQTTSN_LOG("%s", buffer);
     }
-    PRINTF("\r\n");
+    MQTTSN_LOG("\r\n");
     return ot::Mqttsn::kCodeAccepted;
 }
 
+static void MqttsnPrepareConnection(ot::Mqttsn::MqttsnConfig &aConfig)
+{
+    aConfig.SetClientId(CLIENT_ID);
+    aConfig.SetKeepAlive(30);
+    aConfig.SetCleanSession(true);
+    aConfig.SetRestoreSession(true);
+    sClient->SetConnectedCallback(MqttsnConnectedCallback, nullptr);
+    sClient->SetDisconnectedCallback(MqttsnDisconnectedCallback, nullptr);
+    sClient->SetSessionRestoredCallback(MqttsnSessionRestoredCallback, nullptr);
+    sClient->SetPublishReceivedCallback(MqttsnReceived, nullptr);
+}
+
+#if GATEWAY_SEARCH
+static void MqttsnConnectBestGateway()
+{
+    // Client fails over to other known gateways when the connection is lost
+    auto config = ot::Mqttsn::MqttsnConfig();
+    MqttsnPrepareConnection(config);
+
+    otError error = OT_ERROR_NONE;
+    if ((error = sClient->ConnectBestGateway(config)) == OT_ERROR_NONE)
+    {
+        MQTTSN_LOG("Connecting to MQTTSN broker %s.\r\n", config.GetAddress().ToString().AsCString());
+    }
+    else
+    {
+        MQTTSN_LOG("Connection failed with error: %d.\r\n", error);
+    }
+}
+#else
 static void MqttsnConnect(const ot::Ip6::Address &aAddress, uint16_t aPort)
 {
     auto config = ot::Mqttsn::MqttsnConfig();
-    config.SetClientId(CLIENT_ID);
-    config.SetKeepAlive(30);
-    config.SetCleanSession(true);
+    MqttsnPrepareConnection(config);
     config.SetPort(aPort);
     config.SetAddress(aAddress);
-    sClient->SetConnectedCallback(MqttsnConnectedCallback, nullptr);
-    sClient->SetDisconnectedCallback(MqttsnDisconnectedCallback, nullptr);
-    sClient->SetPublishReceivedCallback(MqttsnReceived, nullptr);
 
     otError error = OT_ERROR_NONE;
     if ((error = sClient->Connect(config)) == OT_ERROR_NONE)
     {
-        PRINTF("Connecting to MQTTSN broker.\r\n");
+        MQTTSN_LOG("Connecting to MQTTSN broker.\r\n");
     }
     else
     {
-        PRINTF("Connection failed with error: %d.\r\n", error);
+        MQTTSN_LOG("Connection failed with error: %d.\r\n", error);
     }
 }
+#endif
 
 static void MqttsnPublished(ot::Mqttsn::ReturnCode aCode, void* aContext)
 {
@@ -157,11 +208,11 @@ static void MqttsnPublished(ot::Mqttsn::ReturnCode aCode, void* aContext)
 
     if (aCode == ot::Mqttsn::kCodeAccepted)
     {
-        PRINTF("Successfully published %d.\r\n");
+        MQTTSN_LOG("Successfully published.\r\n");
     }
     else
     {
-        PRINTF("Publish failed with code: %d.\r\n", aCode);
+        MQTTSN_LOG("Publish failed with code: %d.\r\n", aCode);
     }
 }
 
@@ -171,7 +222,7 @@ static void MqttsnSubscribeCallback(ot::Mqttsn::ReturnCode aCode, ot::Mqttsn::To
 
     if (aCode == ot::Mqttsn::kCodeAccepted)
     {
-        PRINTF("Successfully subscribed to topic: %d with QoS level %d.\r\n", aTopicId, aQos);
+        MQTTSN_LOG("Successfully subscribed to topic: %d with QoS level %d.\r\n", aTopicId, aQos);
         sState = kMqttRunning;
 
         // Test Qos 1 message
@@ -179,19 +230,19 @@ static void MqttsnSubscribeCallback(ot::Mqttsn::ReturnCode aCode, ot::Mqttsn::To
         otError error = sClient->Publish(reinterpret_cast<unsigned char*>(text), sizeof(text), ot::Mqttsn::kQos1, aTopicId, MqttsnPublished, nullptr);
         if (error != OT_ERROR_NONE)
         {
-            PRINTF("Publish failed with error: %d.\r\n", error);
+            MQTTSN_LOG("Publish failed with error: %d.\r\n", error);
         }
     }
     else
     {
-        PRINTF("Subscription failed with code: %d.\r\n", aCode);
+        MQTTSN_LOG("Subscription failed with code: %d.\r\n", aCode);
     }
 }
 
 static void MqttsnSubscribe()
 {
     sClient->Subscribe(DEFAULT_TOPIC, false, ot::Mqttsn::Qos::kQos1, MqttsnSubscribeCallback, nullptr);
-    PRINTF("Subscribing to topic: %s\r\n", DEFAULT_TOPIC);
+    MQTTSN_LOG("Subscribing to topic: %s\r\n", DEFAULT_TOPIC);
 }
 
 #if GATEWAY_SEARCH
@@ -199,19 +250,32 @@ static void SearchGatewayCallback(const ot::Ip6::Address &aAddress, uint8_t aGat
 {
     OT_UNUSED_VARIABLE(aContext);
 
-    PRINTF("SearchGw found gateway with id: %u, %s\r\n", aGatewayId, aAddress.ToString().AsCString());
-    sGatewayAddress = aAddress;
-    MqttsnConnect(sGatewayAddress, GATEWAY_MULTICAST_PORT);
-    sState = kMqttConnecting;
+    MQTTSN_LOG("SearchGw found gateway with id: %u, %s\r\n", aGatewayId, aAddress.ToString().AsCString());
 }
 
 static void AdvertiseCallback(const ot::Ip6::Address &aAddress, uint8_t aGatewayId, uint32_t aDuration, void* aContext)
 {
     OT_UNUSED_VARIABLE(aContext);
 
-    PRINTF("Received gateway advertise with id: %u, %s\r\n", aGatewayId, aAddress.ToString().AsCString());
-    sGatewayAddress = aAddress;
-    MqttsnConnect(sGatewayAddress, GATEWAY_MULTICAST_PORT);
+    MQTTSN_LOG("Received gateway advertise with id: %u, %s\r\n", aGatewayId, aAddress.ToString().AsCString());
+}
+
+static void SearchGatewayFinishedCallback(const ot::Mqttsn::GatewayTable::Entry* aGateway, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+
+    // Gateway could be found in Network Data during the search
+    if (sState != kMqttSearchGw)
+    {
+        return;
+    }
+    if (aGateway == nullptr)
+    {
+        MQTTSN_LOG("No gateway found.\r\n");
+        MqttsnReconnectLater();
+        return;
+    }
+    MqttsnConnectBestGateway();
     sState = kMqttConnecting;
 }
 
@@ -220,14 +284,15 @@ static void SearchGateway(const char* aMulticastAddress, uint16_t aPort)
     otError error = OT_ERROR_NONE;
     ot::Ip6::Address address;
     address.FromString(aMulticastAddress);
-    if ((error = sClient->SearchGateway(address, aPort, GATEWAY_MULTICAST_RADIUS)) == OT_ERROR_NONE)
+    // Search starts with nearest nodes and it is skipped when a gateway is heard during random delay
+    if ((error = sClient->SearchGatewayRing(address, aPort, GATEWAY_MULTICAST_RADIUS, GATEWAY_SEARCH_JITTER,
+        SearchGatewayFinishedCallback, nullptr)) == OT_ERROR_NONE)
     {
-        sSearchGwTimeoutTime = ot::TimerMilli::GetNow() + SEND_TIMEOUT;
-        PRINTF("Searching gateway.\r\n");
+        MQTTSN_LOG("Searching gateway.\r\n");
     }
     else
     {
-        PRINTF("Search gateway failed with error: %d.\r\n", error);
+        MQTTSN_LOG("Search gateway failed with error: %d.\r\n", error);
     }
     sState = kMqttSearchGw;
 }
@@ -242,7 +307,7 @@ static void ProcessWorker(ot::Instance &aInstance)
         role = aInstance.GetThreadNetif().GetMle().GetRole();
         if (role == OT_DEVICE_ROLE_CHILD || role == OT_DEVICE_ROLE_LEADER || role == OT_DEVICE_ROLE_ROUTER)
         {
-            PRINTF("Thread started. Role: %d.\r\n", role);
+            MQTTSN_LOG("Thread started. Role: %d.\r\n", role);
             sState = kThreadStarted;
         }
         break;
@@ -250,16 +315,30 @@ static void ProcessWorker(ot::Instance &aInstance)
         if (sConnectionTimeoutTime != 0 && sConnectionTimeoutTime < ot::TimerMilli::GetNow())
         {
             role = aInstance.GetThreadNetif().GetMle().GetRole();
-            PRINTF("Connection timeout. Role: %d\r\n", role);
+            MQTTSN_LOG("Connection timeout. Role: %d\r\n", role);
+            MqttsnReconnectLater();
+        }
+        break;
+    case kMqttReconnectWait:
+        if (sReconnectTime < ot::TimerMilli::GetNow())
+        {
             sState = kThreadStarted;
         }
         break;
     case kMqttConnected:
+        // Subscription restored after reconnection is confirmed immediately
         MqttsnSubscribe();
         sState = kMqttRunning;
         break;
     case kThreadStarted:
 #if GATEWAY_SEARCH
+        // Gateway published in Network Data is used without searching
+        if (sClient->DiscoverNetworkDataGateways() == OT_ERROR_NONE)
+        {
+            MqttsnConnectBestGateway();
+            sState = kMqttConnecting;
+            break;
+        }
         SearchGateway(GATEWAY_MULTICAST_ADDRESS, GATEWAY_MULTICAST_PORT);
 #else
         ot::Ip6::Address address;
@@ -269,16 +348,6 @@ static void ProcessWorker(ot::Instance &aInstance)
         sState = kMqttConnecting;
 #endif
         break;
-#if GATEWAY_SEARCH
-    case kMqttSearchGw:
-        if (sSearchGwTimeoutTime != 0 && sSearchGwTimeoutTime < ot::TimerMilli::GetNow())
-        {
-            role = aInstance.GetThreadNetif().GetMle().GetRole();
-            PRINTF("Connection timeout. Role: %d\r\n", role);
-            sState = kThreadStarted;
-        }
-        break;
-#endif
     default:
         break;
     }
@@ -291,6 +360,15 @@ void HandleNetifStateChanged(otChangedFlags aFlags, void *aContext)
 
     ot::Utils::Slaac::UpdateAddresses(&instance, sSlaacAddresses, sizeof(sSlaacAddresses), ot::Utils::Slaac::CreateRandomIid, nullptr);
 
+#if GATEWAY_SEARCH
+    // Gateway service may be published after the search started
+    if (sState == kMqttSearchGw && sClient->DiscoverNetworkDataGateways() == OT_ERROR_NONE)
+    {
+        MqttsnConnectBestGateway();
+        sState = kMqttConnecting;
+    }
+#endif
+
 exit:
     return;
 }
@@ -330,19 +408,20 @@ int main(int aArgc, char *aArgv[])
     SuccessOrExit(error = sClient->SetAdvertiseCallback(AdvertiseCallback, NULL));
 #endif
     sState = kThreadStarting;
-    PRINTF("Thread starting.\r\n");
+    MQTTSN_LOG("Thread starting.\r\n");
 
     while (true)
     {
         instance.GetTaskletScheduler().ProcessQueuedTasklets();
         otSysProcessDrivers(&instance);
         ProcessWorker(instance);
-        SuccessOrExit(error = sClient->Process());
+        ot::Mqttsn::Log::Process();
     }
     return 0;
 
 exit:
-    PRINTF("Initialization failed with error: %d\r\n", error);
+    MQTTSN_LOG("Initialization failed with error: %d\r\n", error);
+    ot::Mqttsn::Log::Flush();
     return 1;
 }
 
@@ -353,7 +432,7 @@ extern "C" void otPlatLog(otLogLevel aLogLevel, otLogRegion aLogRegion, const ch
 
     va_list ap;
     va_start(ap, aFormat);
-    VPRINTF(aFormat, ap);
+    ot::Mqttsn::Log::Vprintf(aFormat, ap);
     va_end(ap);
 }
 
@@ -0,0 +1,209 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host_platform.hpp"
+#include "mqttsn_client.hpp"
+#include "openthread/platform/random.h"
+
+/**
+ * @file
+ *   This file contains benchmark of acknowledgement matching against number of messages in flight. Each
+ *   acknowledgement finds the waiting message by message ID, removes it and the next message is added with new
+ *   message ID. Waiting messages index is compared with walk of the message queue which reads message ID from
+ *   metadata at the end of each message. Lookup alone is measured separately from deadline heap update.
+ *
+ */
+
+#define BENCH_ACKS 1000000
+#define BENCH_MESSAGE_LENGTH 40
+#define BENCH_SEQUENCE_LENGTH 4096
+
+using namespace ot;
+using namespace ot::Mqttsn;
+
+class BenchQueue : public WaitingMessagesQueueBase
+{
+public:
+    void HandleDeadline(Message &aMessage) { OT_UNUSED_VARIABLE(aMessage); }
+};
+
+static Message* NewMessage(uint16_t aMessageId)
+{
+    uint8_t data[BENCH_MESSAGE_LENGTH];
+    Message* message = Message::New(0);
+
+    // Message ID is stored at the end of the message like waiting message metadata
+    memset(data, 0, sizeof(data));
+    memcpy(&data[sizeof(data) - sizeof(aMessageId)], &aMessageId, sizeof(aMessageId));
+    message->Append(data, sizeof(data));
+    return message;
+}
+
+static Message* FindInQueue(const MessageQueue &aQueue, uint16_t aMessageId)
+{
+    for (Message* message = aQueue.GetHead(); message != nullptr; message = message->GetNext())
+    {
+        uint16_t messageId;
+        message->Read(message->GetLength() - sizeof(messageId), sizeof(messageId), &messageId);
+        if (messageId == aMessageId)
+        {
+            return message;
+        }
+    }
+    return nullptr;
+}
+
+static double BenchIndex(uint8_t aDepth, const uint8_t* aSequence)
+{
+    static WaitingMessagesIndex index;
+    BenchQueue queue;
+    Message* messages[kMaxWaitingMessages];
+    uint16_t messageIds[kMaxWaitingMessages];
+    uint8_t slots[kMaxWaitingMessages];
+    uint16_t nextMessageId = 1;
+    uint64_t start;
+    uint64_t elapsed;
+
+    for (uint8_t i = 0; i < aDepth; i++)
+    {
+        messageIds[i] = nextMessageId++;
+        messages[i] = NewMessage(messageIds[i]);
+        index.Add(otPlatRandomGet() % 10000, true, messageIds[i], *messages[i], queue, slots[i]);
+    }
+
+    start = Host::GetTimeNs();
+    for (uint32_t i = 0; i < BENCH_ACKS; i++)
+    {
+        uint8_t acked = aSequence[i % BENCH_SEQUENCE_LENGTH] % aDepth;
+        Message* message = index.Find(queue, messageIds[acked]);
+
+        index.Remove(slots[acked]);
+        messageIds[acked] = nextMessageId++;
+        index.Add(i, true, messageIds[acked], *message, queue, slots[acked]);
+    }
+    elapsed = Host::GetTimeNs() - start;
+
+    for (uint8_t i = 0; i < aDepth; i++)
+    {
+        index.Remove(slots[i]);
+        messages[i]->Free();
+    }
+    return static_cast<double>(elapsed) / BENCH_ACKS;
+}
+
+static double BenchIndexFind(uint8_t aDepth, const uint8_t* aSequence)
+{
+    static WaitingMessagesIndex index;
+    BenchQueue queue;
+    Message* messages[kMaxWaitingMessages];
+    uint8_t slots[kMaxWaitingMessages];
+    uintptr_t found = 0;
+    uint64_t start;
+    uint64_t elapsed;
+
+    for (uint8_t i = 0; i < aDepth; i++)
+    {
+        messages[i] = NewMessage(i + 1);
+        index.Add(otPlatRandomGet() % 10000, true, i + 1, *messages[i], queue, slots[i]);
+    }
+
+    start = Host::GetTimeNs();
+    for (uint32_t i = 0; i < BENCH_ACKS; i++)
+    {
+        found += reinterpret_cast<uintptr_t>(index.Find(queue, aSequence[i % BENCH_SEQUENCE_LENGTH] % aDepth + 1));
+    }
+    elapsed = Host::GetTimeNs() - start;
+
+    for (uint8_t i = 0; i < aDepth; i++)
+    {
+        index.Remove(slots[i]);
+        messages[i]->Free();
+    }
+    // Keep the lookups from being optimized out
+    return (found != 0) ? static_cast<double>(elapsed) / BENCH_ACKS : 0;
+}
+
+static double BenchQueueWalk(uint8_t aDepth, const uint8_t* aSequence)
+{
+    MessageQueue queue;
+    uint16_t messageIds[kMaxWaitingMessages];
+    uint16_t nextMessageId = 1;
+    uint64_t start;
+    uint64_t elapsed;
+
+    for (uint8_t i = 0; i < aDepth; i++)
+    {
+        messageIds[i] = nextMessageId++;
+        queue.Enqueue(*NewMessage(messageIds[i]));
+    }
+
+    start = Host::GetTimeNs();
+    for (uint32_t i = 0; i < BENCH_ACKS; i++)
+    {
+        uint8_t acked = aSequence[i % BENCH_SEQUENCE_LENGTH] % aDepth;
+        Message* message = FindInQueue(queue, messageIds[acked]);
+
+        queue.Dequeue(*message);
+        messageIds[acked] = nextMessageId++;
+        message->Write(message->GetLength() - sizeof(uint16_t), sizeof(uint16_t), &messageIds[acked]);
+        queue.Enqueue(*message);
+    }
+    elapsed = Host::GetTimeNs() - start;
+
+    while (queue.GetHead() != nullptr)
+    {
+        queue.GetHead()->Free();
+    }
+    return static_cast<double>(elapsed) / BENCH_ACKS;
+}
+
+int main(void)
+{
+    static uint8_t sequence[BENCH_SEQUENCE_LENGTH];
+
+    // Acknowledgements arrive in random order of messages in flight
+    for (uint16_t i = 0; i < BENCH_SEQUENCE_LENGTH; i++)
+    {
+        sequence[i] = static_cast<uint8_t>(otPlatRandomGet());
+    }
+
+    fprintf(stderr, "%u acknowledgements, cost per acknowledgement\n", BENCH_ACKS);
+    fprintf(stderr, "index Find + Remove + Add includes deadline heap maintenance, queue walk includes requeue\n");
+    fprintf(stderr, "%9s %19s %12s %12s\n", "in flight", "Find + Remove + Add", "Find", "queue walk");
+    for (uint8_t depth = 1; depth <= kMaxWaitingMessages; depth *= 2)
+    {
+        double indexNs = BenchIndex(depth, sequence);
+        double findNs = BenchIndexFind(depth, sequence);
+        double walkNs = BenchQueueWalk(depth, sequence);
+        fprintf(stderr, "%9u %16.1f ns %9.1f ns %9.1f ns\n", depth, indexNs, findNs, walkNs);
+    }
+    return 0;
+}
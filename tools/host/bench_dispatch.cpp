@@ -0,0 +1,175 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host_platform.hpp"
+#include "mqttsn_client.hpp"
+#include "mqttsn_serializer.hpp"
+
+/**
+ * @file
+ *   This file contains benchmark of received message dispatch. Connected client receives each message type
+ *   many times and the time per message is measured from delivery to the UDP socket to return of the handler.
+ *   Messages rejected by type decoding, dispatch table and source check show the cost of dispatch alone.
+ *
+ */
+
+#define BENCH_MESSAGES 200000
+#define BENCH_PACKET_SIZE 64
+#define BENCH_CLIENT_PORT 10000
+#define BENCH_GATEWAY_PORT 10000
+#define BENCH_GATEWAY_ID 1
+#define BENCH_TOPIC_ID 1
+
+using namespace ot;
+using namespace ot::Mqttsn;
+
+struct BenchMessage
+{
+    const char* mName;
+    uint8_t mData[BENCH_PACKET_SIZE];
+    int32_t mLength;
+    bool mFromGateway;
+};
+
+static uint32_t sSentCount = 0;
+static uint32_t sReceivedCount = 0;
+
+static void HandleUdpSend(Ip6::UdpSocket &aSocket, const Message &aMessage, const Ip6::MessageInfo &aMessageInfo,
+    void* aContext)
+{
+    OT_UNUSED_VARIABLE(aSocket);
+    OT_UNUSED_VARIABLE(aMessage);
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aContext);
+    sSentCount++;
+}
+
+static ReturnCode HandlePublishReceived(const Message &aMessage, uint16_t aPayloadOffset, int32_t aPayloadLength,
+    TopicIdType aTopicIdType, TopicId aTopicId, ShortTopicNameString aShortTopicName, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aMessage);
+    OT_UNUSED_VARIABLE(aPayloadOffset);
+    OT_UNUSED_VARIABLE(aPayloadLength);
+    OT_UNUSED_VARIABLE(aTopicIdType);
+    OT_UNUSED_VARIABLE(aTopicId);
+    OT_UNUSED_VARIABLE(aShortTopicName);
+    OT_UNUSED_VARIABLE(aContext);
+    sReceivedCount++;
+    return kCodeAccepted;
+}
+
+static void Deliver(const uint8_t* aData, uint16_t aLength, bool aFromGateway)
+{
+    Ip6::MessageInfo messageInfo;
+    Ip6::Address address;
+
+    address.FromString(aFromGateway ? "fd00::1" : "fd00::2");
+    messageInfo.SetPeerAddr(address);
+    messageInfo.SetPeerPort(BENCH_GATEWAY_PORT);
+    messageInfo.SetSockPort(BENCH_CLIENT_PORT);
+    Host::Receive(aData, aLength, messageInfo);
+}
+
+static void Prepare(BenchMessage &aBenchMessage, const char* aName, const MessageBase &aMessage, bool aFromGateway)
+{
+    aBenchMessage.mName = aName;
+    aBenchMessage.mFromGateway = aFromGateway;
+    aMessage.Serialize(aBenchMessage.mData, sizeof(aBenchMessage.mData), &aBenchMessage.mLength);
+}
+
+int main(void)
+{
+    static const uint8_t kPayload[] = {0x32, 0x31, 0x2e, 0x35};
+    Instance &instance = Instance::Get();
+    MqttsnClient client(instance);
+    MqttsnConfig config;
+    Ip6::Address address;
+    BenchMessage messages[9];
+    uint8_t count = 0;
+    uint8_t buffer[BENCH_PACKET_SIZE];
+    int32_t length;
+
+    Host::SetUdpSendHandler(HandleUdpSend, nullptr);
+    client.SetPublishReceivedCallback(HandlePublishReceived, nullptr);
+    client.Start(BENCH_CLIENT_PORT);
+
+    // Connect to the gateway
+    address.FromString("fd00::1");
+    config.SetAddress(address);
+    config.SetPort(BENCH_GATEWAY_PORT);
+    config.SetClientId("bench");
+    config.SetKeepAlive(600);
+    config.SetCleanSession(true);
+    client.Connect(config);
+    ConnackMessage(kCodeAccepted).Serialize(buffer, sizeof(buffer), &length);
+    Deliver(buffer, static_cast<uint16_t>(length), true);
+    if (client.GetState() != kStateActive)
+    {
+        fprintf(stderr, "Client is not connected\n");
+        return 1;
+    }
+
+    // Rejected before handler
+    Prepare(messages[count], "malformed length", PingrespMessage(), true);
+    messages[count++].mData[0] = 0x10;
+    Prepare(messages[count++], "SEARCHGW no handler", SearchGwMessage(1), false);
+    Prepare(messages[count++], "PUBLISH other source", PublishMessage(false, false, kQos0, 0, kTopicId,
+        BENCH_TOPIC_ID, nullptr, kPayload, sizeof(kPayload)), false);
+    // Handled
+    Prepare(messages[count++], "PUBACK unknown ID", PubackMessage(kCodeAccepted, BENCH_TOPIC_ID, 0x7fff), true);
+    Prepare(messages[count++], "UNSUBACK unknown ID", UnsubackMessage(kCodeAccepted, 0x7fff), true);
+    Prepare(messages[count++], "PINGRESP", PingrespMessage(), true);
+    Prepare(messages[count++], "ADVERTISE", AdvertiseMessage(BENCH_GATEWAY_ID, 900), true);
+    Prepare(messages[count++], "PUBLISH QoS 0", PublishMessage(false, false, kQos0, 0, kTopicId, BENCH_TOPIC_ID,
+        nullptr, kPayload, sizeof(kPayload)), true);
+    Prepare(messages[count++], "REGISTER with REGACK", RegisterMessage(BENCH_TOPIC_ID, 1, "sensors/temperature"), true);
+
+    fprintf(stderr, "%u messages of each type\n", BENCH_MESSAGES);
+    fprintf(stderr, "%-22s %12s %8s %8s\n", "message", "dispatch", "sent", "handled");
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint32_t sent = sSentCount;
+        uint32_t received = sReceivedCount;
+        uint64_t start = Host::GetTimeNs();
+        uint64_t elapsed;
+
+        for (uint32_t j = 0; j < BENCH_MESSAGES; j++)
+        {
+            Deliver(messages[i].mData, static_cast<uint16_t>(messages[i].mLength), messages[i].mFromGateway);
+        }
+        elapsed = Host::GetTimeNs() - start;
+        fprintf(stderr, "%-22s %9.1f ns %8u %8u\n", messages[i].mName,
+            static_cast<double>(elapsed) / BENCH_MESSAGES, sSentCount - sent, sReceivedCount - received);
+    }
+
+    client.Stop();
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host_platform.hpp"
+#include "mqttsn_log.hpp"
+
+/**
+ * @file
+ *   This file contains benchmark of MQTTSN_LOG call cost. Log output is written to standard output and results
+ *   to standard error. Time of the same line written by blocking PRINTF is computed from UART baud rate, since
+ *   the call waits until the last byte is sent.
+ *
+ */
+
+#define BENCH_ITERATIONS 100000
+#define BENCH_DRAIN_PERIOD 16
+#define BENCH_UART_BAUD_RATE 115200
+#define BENCH_BURST_LENGTH 100
+
+using namespace ot;
+using namespace ot::Mqttsn;
+
+// Runs the log call in loop, buffer is drained outside of measured time so no line is dropped
+#define BENCH_LOG_CALL(aName, aLineLength, ...)                                                           \
+    do                                                                                                    \
+    {                                                                                                     \
+        uint64_t elapsed = 0;                                                                             \
+        uint32_t recordLength;                                                                            \
+        Log::Flush();                                                                                     \
+        MQTTSN_LOG(__VA_ARGS__);                                                                          \
+        recordLength = Log::GetPendingLength();                                                           \
+        for (uint32_t i = 0; i < BENCH_ITERATIONS; i += BENCH_DRAIN_PERIOD)                               \
+        {                                                                                                 \
+            uint64_t start;                                                                               \
+            Log::Flush();                                                                                 \
+            start = Host::GetTimeNs();                                                                    \
+            for (uint32_t j = 0; j < BENCH_DRAIN_PERIOD; j++)                                             \
+            {                                                                                             \
+                MQTTSN_LOG(__VA_ARGS__);                                                                  \
+            }                                                                                             \
+            elapsed += Host::GetTimeNs() - start;                                                         \
+        }                                                                                                 \
+        PrintResult(aName, static_cast<double>(elapsed) / BENCH_ITERATIONS, recordLength, aLineLength);   \
+    } while (false)
+
+static void PrintResult(const char* aName, double aCallNs, uint32_t aRecordLength, uint32_t aLineLength)
+{
+    // Start bit, eight data bits and stop bit per byte
+    double uartUs = aLineLength * 10 * 1000000.0 / BENCH_UART_BAUD_RATE;
+
+    fprintf(stderr, "%-24s %10.0f ns %8u B %14.0f us\n", aName, aCallNs, aRecordLength, uartUs);
+}
+
+static uint32_t LineLength(const char* aFormat, ...)
+{
+    char line[MQTTSN_LOG_LINE_SIZE];
+    va_list args;
+    int length;
+
+    va_start(args, aFormat);
+    length = vsnprintf(line, sizeof(line), aFormat, args);
+    va_end(args);
+    return static_cast<uint32_t>(length);
+}
+
+int main(void)
+{
+    const char* address = "fd11:22::ff:fe00:fc10";
+    uint32_t dropped;
+    uint32_t stored = 0;
+
+    fprintf(stderr, "MQTTSN_LOG_TOKENIZED=%d, %u calls\n", MQTTSN_LOG_TOKENIZED, BENCH_ITERATIONS);
+    fprintf(stderr, "%-24s %13s %10s %17s\n", "log call", "call", "record", "blocking PRINTF");
+
+    BENCH_LOG_CALL("received message", LineLength("UDP message received, type: %d, length: %u\r\n", 13, 24u),
+        "UDP message received, type: %d, length: %u\r\n", 13, 24u);
+    BENCH_LOG_CALL("sent message", LineLength("Sending message to %s[:%u]\r\n", address, 10000u),
+        "Sending message to %s[:%u]\r\n", address, 10000u);
+    BENCH_LOG_CALL("constant string", LineLength("Connected to gateway\r\n"), "Connected to gateway\r\n");
+
+    // Burst without draining is dropped instead of blocking
+    Log::Flush();
+    dropped = Log::GetDroppedCount();
+    for (uint32_t i = 0; i < BENCH_BURST_LENGTH; i++)
+    {
+        uint16_t pending = Log::GetPendingLength();
+        MQTTSN_LOG("UDP message received, type: %d, length: %u\r\n", 13, 24u);
+        stored += (Log::GetPendingLength() != pending) ? 1 : 0;
+    }
+    fprintf(stderr, "burst of %u lines to %u B buffer: %u stored, %u dropped\n", BENCH_BURST_LENGTH,
+        MQTTSN_LOG_BUFFER_SIZE, stored, Log::GetDroppedCount() - dropped);
+    Log::Flush();
+    return 0;
+}
@@ -0,0 +1,518 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "host_platform.hpp"
+#include "common/timer.hpp"
+#include "openthread/link.h"
+#include "openthread/netdata.h"
+#include "openthread/thread.h"
+#include "openthread/platform/random.h"
+
+/**
+ * @file
+ *   This file contains implementation of host platform for MQTT-SN client tests and benchmarks.
+ *
+ */
+
+namespace ot {
+
+static uint32_t sNow = 0;
+static Timer* sTimers = nullptr;
+static uint32_t sRandomState = 1;
+static Ip6::UdpSocket* sSockets = nullptr;
+static Host::UdpSendHandler sUdpSendHandler = nullptr;
+static void* sUdpSendContext = nullptr;
+static otExtAddress sExtAddress = {{0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0}};
+static otMacCounters sMacCounters = {0, 0, 0};
+static bool sRxOnWhenIdle = true;
+
+Instance &Instance::Get(void)
+{
+    static Instance sInstance;
+    return sInstance;
+}
+
+Message::Message(void)
+    : mLength(0)
+    , mOffset(0)
+    , mNext(nullptr)
+    , mPrev(nullptr)
+    , mQueue(nullptr)
+{
+}
+
+Message* Message::New(uint16_t aReserved)
+{
+    OT_UNUSED_VARIABLE(aReserved);
+    return new Message();
+}
+
+void Message::Free(void)
+{
+    if (mQueue != nullptr)
+    {
+        mQueue->Dequeue(*this);
+    }
+    delete this;
+}
+
+otError Message::SetLength(uint16_t aLength)
+{
+    if (aLength > kMaxLength)
+    {
+        return OT_ERROR_NO_BUFS;
+    }
+    mLength = aLength;
+    return OT_ERROR_NONE;
+}
+
+otError Message::SetOffset(uint16_t aOffset)
+{
+    if (aOffset > mLength)
+    {
+        return OT_ERROR_INVALID_ARGS;
+    }
+    mOffset = aOffset;
+    return OT_ERROR_NONE;
+}
+
+otError Message::Append(const void* aBuf, uint16_t aLength)
+{
+    uint16_t offset = mLength;
+    otError error = SetLength(mLength + aLength);
+
+    if (error == OT_ERROR_NONE)
+    {
+        memcpy(&mBuffer[offset], aBuf, aLength);
+    }
+    return error;
+}
+
+otError Message::Prepend(const void* aBuf, uint16_t aLength)
+{
+    uint16_t length = mLength;
+    otError error = SetLength(mLength + aLength);
+
+    if (error == OT_ERROR_NONE)
+    {
+        memmove(&mBuffer[aLength], mBuffer, length);
+        memcpy(mBuffer, aBuf, aLength);
+    }
+    return error;
+}
+
+uint16_t Message::Read(uint16_t aOffset, uint16_t aLength, void* aBuf) const
+{
+    if (aOffset >= mLength)
+    {
+        return 0;
+    }
+    aLength = OT_MIN(aLength, static_cast<uint16_t>(mLength - aOffset));
+    memcpy(aBuf, &mBuffer[aOffset], aLength);
+    return aLength;
+}
+
+int Message::Write(uint16_t aOffset, uint16_t aLength, const void* aBuf)
+{
+    if (aOffset >= mLength)
+    {
+        return 0;
+    }
+    aLength = OT_MIN(aLength, static_cast<uint16_t>(mLength - aOffset));
+    memcpy(&mBuffer[aOffset], aBuf, aLength);
+    return aLength;
+}
+
+int Message::CopyTo(uint16_t aSourceOffset, uint16_t aDestinationOffset, uint16_t aLength, Message &aMessage) const
+{
+    uint8_t buffer[kMaxLength];
+    uint16_t length = Read(aSourceOffset, aLength, buffer);
+
+    return aMessage.Write(aDestinationOffset, length, buffer);
+}
+
+Message* Message::Clone(uint16_t aLength) const
+{
+    Message* message = New(0);
+
+    aLength = OT_MIN(aLength, mLength);
+    message->SetLength(aLength);
+    memcpy(message->mBuffer, mBuffer, aLength);
+    message->mOffset = OT_MIN(mOffset, aLength);
+    return message;
+}
+
+Message* Message::GetNext(void) const
+{
+    return mNext;
+}
+
+Message* Message::GetPrev(void) const
+{
+    return mPrev;
+}
+
+MessageQueue::MessageQueue(void)
+    : mHead(nullptr)
+    , mTail(nullptr)
+{
+}
+
+otError MessageQueue::Enqueue(Message &aMessage)
+{
+    if (aMessage.mQueue != nullptr)
+    {
+        return OT_ERROR_ALREADY;
+    }
+    aMessage.mQueue = this;
+    aMessage.mNext = nullptr;
+    aMessage.mPrev = mTail;
+    if (mTail != nullptr)
+    {
+        mTail->mNext = &aMessage;
+    }
+    else
+    {
+        mHead = &aMessage;
+    }
+    mTail = &aMessage;
+    return OT_ERROR_NONE;
+}
+
+otError MessageQueue::Dequeue(Message &aMessage)
+{
+    if (aMessage.mQueue != this)
+    {
+        return OT_ERROR_NOT_FOUND;
+    }
+    if (aMessage.mPrev != nullptr)
+    {
+        aMessage.mPrev->mNext = aMessage.mNext;
+    }
+    else
+    {
+        mHead = aMessage.mNext;
+    }
+    if (aMessage.mNext != nullptr)
+    {
+        aMessage.mNext->mPrev = aMessage.mPrev;
+    }
+    else
+    {
+        mTail = aMessage.mPrev;
+    }
+    aMessage.mQueue = nullptr;
+    aMessage.mNext = nullptr;
+    aMessage.mPrev = nullptr;
+    return OT_ERROR_NONE;
+}
+
+Timer::Timer(Handler aHandler, void* aOwner)
+    : mHandler(aHandler)
+    , mOwner(aOwner)
+    , mFireTime(0)
+    , mRunning(false)
+    , mNext(nullptr)
+{
+}
+
+void Timer::StartAt(uint32_t aT0, uint32_t aDt)
+{
+    Stop();
+    mFireTime = aT0 + aDt;
+    mRunning = true;
+    mNext = sTimers;
+    sTimers = this;
+}
+
+void Timer::Stop(void)
+{
+    for (Timer** timer = &sTimers; *timer != nullptr; timer = &(*timer)->mNext)
+    {
+        if (*timer == this)
+        {
+            *timer = mNext;
+            break;
+        }
+    }
+    mRunning = false;
+    mNext = nullptr;
+}
+
+uint32_t TimerMilli::GetNow(void)
+{
+    return sNow;
+}
+
+namespace Ip6 {
+
+bool Address::IsUnspecified(void) const
+{
+    static const uint8_t kUnspecified[sizeof(mFields)] = {0};
+    return memcmp(mFields, kUnspecified, sizeof(mFields)) == 0;
+}
+
+bool Address::IsRoutingLocator(void) const
+{
+    static const uint8_t kAloc16Mask = 0xfc;
+    return mFields[8] == 0 && mFields[9] == 0 && mFields[10] == 0 && mFields[11] == 0xff && mFields[12] == 0xfe
+        && mFields[13] == 0 && mFields[14] < kAloc16Mask;
+}
+
+bool Address::IsAnycastRoutingLocator(void) const
+{
+    return mFields[8] == 0 && mFields[9] == 0 && mFields[10] == 0 && mFields[11] == 0xff && mFields[12] == 0xfe
+        && mFields[13] == 0 && mFields[14] == 0xfc;
+}
+
+otError Address::FromString(const char* aBuf)
+{
+    return (inet_pton(AF_INET6, aBuf, mFields) == 1) ? OT_ERROR_NONE : OT_ERROR_PARSE;
+}
+
+Address::InfoString Address::ToString(void) const
+{
+    char buffer[INET6_ADDRSTRLEN];
+
+    inet_ntop(AF_INET6, mFields, buffer, sizeof(buffer));
+    return InfoString("%s", buffer);
+}
+
+UdpSocket::UdpSocket(Udp &aUdp)
+    : mHandler(nullptr)
+    , mContext(nullptr)
+    , mSockName()
+    , mNext(nullptr)
+    , mOpen(false)
+{
+    OT_UNUSED_VARIABLE(aUdp);
+}
+
+otError UdpSocket::Open(otUdpReceive aHandler, void* aContext)
+{
+    if (mOpen)
+    {
+        return OT_ERROR_ALREADY;
+    }
+    mHandler = aHandler;
+    mContext = aContext;
+    mOpen = true;
+    mNext = sSockets;
+    sSockets = this;
+    return OT_ERROR_NONE;
+}
+
+otError UdpSocket::Bind(const SockAddr &aSockAddr)
+{
+    mSockName = aSockAddr;
+    return OT_ERROR_NONE;
+}
+
+otError UdpSocket::Close(void)
+{
+    for (UdpSocket** socket = &sSockets; *socket != nullptr; socket = &(*socket)->mNext)
+    {
+        if (*socket == this)
+        {
+            *socket = mNext;
+            break;
+        }
+    }
+    mOpen = false;
+    mNext = nullptr;
+    return OT_ERROR_NONE;
+}
+
+Message* UdpSocket::NewMessage(uint16_t aReserved)
+{
+    return Message::New(aReserved);
+}
+
+otError UdpSocket::SendTo(Message &aMessage, const MessageInfo &aMessageInfo)
+{
+    if (!mOpen)
+    {
+        return OT_ERROR_INVALID_STATE;
+    }
+    if (sUdpSendHandler != nullptr)
+    {
+        sUdpSendHandler(*this, aMessage, aMessageInfo, sUdpSendContext);
+    }
+    // Message is owned by the stack after successful send
+    aMessage.Free();
+    return OT_ERROR_NONE;
+}
+
+void UdpSocket::HandleReceive(Message &aMessage, const MessageInfo &aMessageInfo)
+{
+    if (mOpen && mHandler != nullptr)
+    {
+        mHandler(mContext, &aMessage, &aMessageInfo);
+    }
+}
+
+}
+
+namespace Host {
+
+void SetUdpSendHandler(UdpSendHandler aHandler, void* aContext)
+{
+    sUdpSendHandler = aHandler;
+    sUdpSendContext = aContext;
+}
+
+otError Receive(const uint8_t* aData, uint16_t aLength, const Ip6::MessageInfo &aMessageInfo)
+{
+    otError error = OT_ERROR_NOT_FOUND;
+    Ip6::UdpSocket* socket = sSockets;
+    Message* message = nullptr;
+
+    while (socket != nullptr && socket->GetPort() != aMessageInfo.GetSockPort())
+    {
+        socket = socket->GetNext();
+    }
+    VerifyOrExit(socket != nullptr);
+
+    message = Message::New(0);
+    SuccessOrExit(error = message->Append(aData, aLength));
+    socket->HandleReceive(*message, aMessageInfo);
+
+exit:
+    if (message != nullptr)
+    {
+        message->Free();
+    }
+    return error;
+}
+
+void AdvanceTime(uint32_t aNow)
+{
+    for (;;)
+    {
+        Timer* expired = nullptr;
+
+        // Fire the earliest expired timer first, its handler may start or stop other timers
+        for (Timer* timer = sTimers; timer != nullptr; timer = timer->mNext)
+        {
+            if (static_cast<int32_t>(timer->mFireTime - aNow) <= 0
+                && (expired == nullptr || static_cast<int32_t>(timer->mFireTime - expired->mFireTime) < 0))
+            {
+                expired = timer;
+            }
+        }
+        if (expired == nullptr)
+        {
+            break;
+        }
+        if (static_cast<int32_t>(expired->mFireTime - sNow) > 0)
+        {
+            sNow = expired->mFireTime;
+        }
+        expired->Stop();
+        expired->mHandler(*expired);
+    }
+    sNow = aNow;
+}
+
+void SetRandomSeed(uint32_t aSeed)
+{
+    sRandomState = (aSeed != 0) ? aSeed : 1;
+}
+
+void SetExtendedAddress(const otExtAddress &aExtAddress)
+{
+    sExtAddress = aExtAddress;
+}
+
+void AddCcaFailures(uint32_t aCount)
+{
+    sMacCounters.mTxTotal += aCount;
+    sMacCounters.mTxErrCca += aCount;
+}
+
+void SetRxOnWhenIdle(bool aRxOnWhenIdle)
+{
+    sRxOnWhenIdle = aRxOnWhenIdle;
+}
+
+uint64_t GetTimeNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+}
+
+}
+
+}
+
+extern "C" uint32_t otPlatRandomGet(void)
+{
+    // xorshift32
+    ot::sRandomState ^= ot::sRandomState << 13;
+    ot::sRandomState ^= ot::sRandomState >> 17;
+    ot::sRandomState ^= ot::sRandomState << 5;
+    return ot::sRandomState;
+}
+
+extern "C" otLinkModeConfig otThreadGetLinkMode(otInstance* aInstance)
+{
+    otLinkModeConfig config;
+
+    OT_UNUSED_VARIABLE(aInstance);
+    memset(&config, 0, sizeof(config));
+    config.mRxOnWhenIdle = ot::sRxOnWhenIdle;
+    return config;
+}
+
+extern "C" const otExtAddress* otLinkGetExtendedAddress(otInstance* aInstance)
+{
+    OT_UNUSED_VARIABLE(aInstance);
+    return &ot::sExtAddress;
+}
+
+extern "C" const otMacCounters* otLinkGetCounters(otInstance* aInstance)
+{
+    OT_UNUSED_VARIABLE(aInstance);
+    return &ot::sMacCounters;
+}
+
+extern "C" otError otNetDataGetNextService(otInstance* aInstance, otNetworkDataIterator* aIterator,
+    otServiceConfig* aConfig)
+{
+    OT_UNUSED_VARIABLE(aInstance);
+    OT_UNUSED_VARIABLE(aIterator);
+    OT_UNUSED_VARIABLE(aConfig);
+    return OT_ERROR_NOT_FOUND;
+}
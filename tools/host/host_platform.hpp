@@ -0,0 +1,144 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HOST_PLATFORM_HPP_
+#define HOST_PLATFORM_HPP_
+
+#include "common/instance.hpp"
+#include "common/message.hpp"
+#include "net/udp6.hpp"
+#include "openthread/link.h"
+
+/**
+ * @file
+ *   This file includes interface of host platform which runs MQTT-SN client in single process. Time is virtual
+ *   and it is moved forward by the test, UDP messages sent by clients are passed to the test handler.
+ *
+ */
+
+namespace ot {
+namespace Host {
+
+/**
+ * Handler of UDP message sent by the client. The message is freed after the handler returns.
+ *
+ */
+typedef void (*UdpSendHandler)(Ip6::UdpSocket &aSocket, const Message &aMessage,
+    const Ip6::MessageInfo &aMessageInfo, void* aContext);
+
+/**
+ * Set handler of sent UDP messages. Sent messages are dropped when no handler is set.
+ *
+ * @param[in]  aHandler  A pointer to handler function.
+ * @param[in]  aContext  A pointer to handler context.
+ *
+ */
+void SetUdpSendHandler(UdpSendHandler aHandler, void* aContext);
+
+/**
+ * Deliver UDP message to the open socket bound to the destination port.
+ *
+ * @param[in]  aData         A pointer to UDP payload.
+ * @param[in]  aLength       UDP payload length.
+ * @param[in]  aMessageInfo  A reference to message info with peer address and port and destination port.
+ *
+ * @retval OT_ERROR_NONE       The message was delivered.
+ * @retval OT_ERROR_NOT_FOUND  No socket is bound to the destination port.
+ *
+ */
+otError Receive(const uint8_t* aData, uint16_t aLength, const Ip6::MessageInfo &aMessageInfo);
+
+/**
+ * Move virtual time forward and fire expired timers in order of their fire time.
+ *
+ * @param[in]  aNow  New virtual time in milliseconds.
+ *
+ */
+void AdvanceTime(uint32_t aNow);
+
+/**
+ * Seed the random generator behind otPlatRandomGet.
+ *
+ * @param[in]  aSeed  Nonzero seed.
+ *
+ */
+void SetRandomSeed(uint32_t aSeed);
+
+/**
+ * Set IEEE 802.15.4 extended address returned by otLinkGetExtendedAddress.
+ *
+ * @param[in]  aExtAddress  A reference to extended address.
+ *
+ */
+void SetExtendedAddress(const otExtAddress &aExtAddress);
+
+/**
+ * Count transmissions failed on CCA in MAC counters returned by otLinkGetCounters.
+ *
+ * @param[in]  aCount  Number of failed transmissions.
+ *
+ */
+void AddCcaFailures(uint32_t aCount);
+
+/**
+ * Set receiver mode returned by otThreadGetLinkMode. The device is not sleepy by default.
+ *
+ * @param[in]  aRxOnWhenIdle  False if the device is sleepy end device which receives by data polls.
+ *
+ */
+void SetRxOnWhenIdle(bool aRxOnWhenIdle);
+
+/**
+ * Set file in which settings are stored. Settings are loaded from the file by otPlatSettingsInit and the file is
+ * rewritten after each change.
+ *
+ * @param[in]  aPath  A pointer to file path.
+ *
+ */
+void SetSettingsFile(const char* aPath);
+
+/**
+ * Get number of settings changes which rewrote the storage since otPlatSettingsInit.
+ *
+ * @returns  Number of writes.
+ *
+ */
+uint32_t GetSettingsWriteCount(void);
+
+/**
+ * Get monotonic wall clock time for benchmarks.
+ *
+ * @returns  Time in nanoseconds.
+ *
+ */
+uint64_t GetTimeNs(void);
+
+}
+}
+
+#endif /* HOST_PLATFORM_HPP_ */
@@ -0,0 +1,204 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host_platform.hpp"
+#include "openthread/platform/settings.h"
+
+/**
+ * @file
+ *   This file contains settings backend which keeps settings in a file like OpenThread POSIX platform. Records
+ *   are stored as key, length and value, the order of records with the same key is kept. Whole file is rewritten
+ *   on each change, the number of changes is counted to measure flash wear of settings users.
+ *
+ */
+
+#define SETTINGS_MAX_SIZE 8192
+
+namespace ot {
+
+static const char* sSettingsPath = "settings.bin";
+static uint8_t sSettings[SETTINGS_MAX_SIZE];
+static uint16_t sSettingsLength = 0;
+static uint32_t sSettingsWrites = 0;
+
+static void SettingsFlush(void)
+{
+    FILE* file = fopen(sSettingsPath, "wb");
+
+    if (file != nullptr)
+    {
+        fwrite(sSettings, 1, sSettingsLength, file);
+        fclose(file);
+    }
+    sSettingsWrites++;
+}
+
+// Find record of the key with the index, returns its offset or SETTINGS_MAX_SIZE
+static uint16_t SettingsFind(uint16_t aKey, int aIndex)
+{
+    uint16_t offset = 0;
+
+    while (offset + 4 <= sSettingsLength)
+    {
+        uint16_t key = static_cast<uint16_t>(sSettings[offset] | (sSettings[offset + 1] << 8));
+        uint16_t length = static_cast<uint16_t>(sSettings[offset + 2] | (sSettings[offset + 3] << 8));
+
+        if (key == aKey && aIndex-- == 0)
+        {
+            return offset;
+        }
+        offset += 4 + length;
+    }
+    return SETTINGS_MAX_SIZE;
+}
+
+static void SettingsRemove(uint16_t aOffset)
+{
+    uint16_t size = 4 + static_cast<uint16_t>(sSettings[aOffset + 2] | (sSettings[aOffset + 3] << 8));
+
+    memmove(&sSettings[aOffset], &sSettings[aOffset + size], sSettingsLength - aOffset - size);
+    sSettingsLength -= size;
+}
+
+namespace Host {
+
+void SetSettingsFile(const char* aPath)
+{
+    sSettingsPath = aPath;
+}
+
+uint32_t GetSettingsWriteCount(void)
+{
+    return sSettingsWrites;
+}
+
+}
+
+}
+
+using namespace ot;
+
+extern "C" void otPlatSettingsInit(otInstance* aInstance)
+{
+    FILE* file = fopen(sSettingsPath, "rb");
+
+    OT_UNUSED_VARIABLE(aInstance);
+    sSettingsLength = 0;
+    sSettingsWrites = 0;
+    if (file != nullptr)
+    {
+        sSettingsLength = static_cast<uint16_t>(fread(sSettings, 1, sizeof(sSettings), file));
+        fclose(file);
+    }
+}
+
+extern "C" otError otPlatSettingsGet(otInstance* aInstance, uint16_t aKey, int aIndex, uint8_t* aValue,
+    uint16_t* aValueLength)
+{
+    uint16_t offset = SettingsFind(aKey, aIndex);
+    uint16_t length;
+
+    OT_UNUSED_VARIABLE(aInstance);
+    if (offset == SETTINGS_MAX_SIZE)
+    {
+        return OT_ERROR_NOT_FOUND;
+    }
+    length = static_cast<uint16_t>(sSettings[offset + 2] | (sSettings[offset + 3] << 8));
+    if (aValue != nullptr && aValueLength != nullptr)
+    {
+        memcpy(aValue, &sSettings[offset + 4], OT_MIN(length, *aValueLength));
+    }
+    if (aValueLength != nullptr)
+    {
+        *aValueLength = length;
+    }
+    return OT_ERROR_NONE;
+}
+
+extern "C" otError otPlatSettingsAdd(otInstance* aInstance, uint16_t aKey, const uint8_t* aValue,
+    uint16_t aValueLength)
+{
+    OT_UNUSED_VARIABLE(aInstance);
+    if (sSettingsLength + 4 + aValueLength > SETTINGS_MAX_SIZE)
+    {
+        return OT_ERROR_NO_BUFS;
+    }
+    sSettings[sSettingsLength++] = static_cast<uint8_t>(aKey & 0xff);
+    sSettings[sSettingsLength++] = static_cast<uint8_t>(aKey >> 8);
+    sSettings[sSettingsLength++] = static_cast<uint8_t>(aValueLength & 0xff);
+    sSettings[sSettingsLength++] = static_cast<uint8_t>(aValueLength >> 8);
+    memcpy(&sSettings[sSettingsLength], aValue, aValueLength);
+    sSettingsLength += aValueLength;
+    SettingsFlush();
+    return OT_ERROR_NONE;
+}
+
+extern "C" otError otPlatSettingsDelete(otInstance* aInstance, uint16_t aKey, int aIndex)
+{
+    uint16_t offset;
+    bool found = false;
+
+    OT_UNUSED_VARIABLE(aInstance);
+    while ((offset = SettingsFind(aKey, (aIndex < 0) ? 0 : aIndex)) != SETTINGS_MAX_SIZE)
+    {
+        SettingsRemove(offset);
+        found = true;
+        if (aIndex >= 0)
+        {
+            break;
+        }
+    }
+    if (!found)
+    {
+        return OT_ERROR_NOT_FOUND;
+    }
+    SettingsFlush();
+    return OT_ERROR_NONE;
+}
+
+extern "C" otError otPlatSettingsSet(otInstance* aInstance, uint16_t aKey, const uint8_t* aValue,
+    uint16_t aValueLength)
+{
+    uint16_t offset;
+
+    while ((offset = SettingsFind(aKey, 0)) != SETTINGS_MAX_SIZE)
+    {
+        SettingsRemove(offset);
+    }
+    return otPlatSettingsAdd(aInstance, aKey, aValue, aValueLength);
+}
+
+extern "C" void otPlatSettingsWipe(otInstance* aInstance)
+{
+    OT_UNUSED_VARIABLE(aInstance);
+    sSettingsLength = 0;
+    SettingsFlush();
+}
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CODE_UTILS_HPP_
+#define CODE_UTILS_HPP_
+
+#include "openthread/error.h"
+
+#define OT_ARRAY_LENGTH(aArray) (sizeof(aArray) / sizeof(aArray[0]))
+
+#define OT_MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+#define OT_MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+#define SuccessOrExit(aStatus) \
+    do                         \
+    {                          \
+        if ((aStatus) != 0)    \
+        {                      \
+            goto exit;         \
+        }                      \
+    } while (false)
+
+#define VerifyOrExit(aCondition, ...) \
+    do                                \
+    {                                 \
+        if (!(aCondition))            \
+        {                             \
+            __VA_ARGS__;              \
+            goto exit;                \
+        }                             \
+    } while (false)
+
+#define ExitNow(...) \
+    do               \
+    {                \
+        __VA_ARGS__; \
+        goto exit;   \
+    } while (false)
+
+#endif /* CODE_UTILS_HPP_ */
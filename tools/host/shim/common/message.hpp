@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MESSAGE_HPP_
+#define MESSAGE_HPP_
+
+#include "common/code_utils.hpp"
+
+struct otMessage
+{
+};
+
+namespace ot {
+
+class MessageQueue;
+
+/**
+ * Message with contiguous heap buffer. Message is allocated by UdpSocket::NewMessage or Message::New and it is
+ * released by Free.
+ *
+ */
+class Message : public otMessage
+{
+    friend class MessageQueue;
+
+public:
+    enum
+    {
+        kMaxLength = 1280
+    };
+
+    static Message* New(uint16_t aReserved);
+
+    void Free(void);
+
+    uint16_t GetLength(void) const { return mLength; }
+
+    otError SetLength(uint16_t aLength);
+
+    uint16_t GetOffset(void) const { return mOffset; }
+
+    otError SetOffset(uint16_t aOffset);
+
+    otError Append(const void* aBuf, uint16_t aLength);
+
+    otError Prepend(const void* aBuf, uint16_t aLength);
+
+    uint16_t Read(uint16_t aOffset, uint16_t aLength, void* aBuf) const;
+
+    int Write(uint16_t aOffset, uint16_t aLength, const void* aBuf);
+
+    int CopyTo(uint16_t aSourceOffset, uint16_t aDestinationOffset, uint16_t aLength, Message &aMessage) const;
+
+    Message* Clone(uint16_t aLength) const;
+
+    Message* Clone(void) const { return Clone(mLength); }
+
+    Message* GetNext(void) const;
+
+    Message* GetPrev(void) const;
+
+private:
+    Message(void);
+
+    uint8_t mBuffer[kMaxLength];
+    uint16_t mLength;
+    uint16_t mOffset;
+    Message* mNext;
+    Message* mPrev;
+    MessageQueue* mQueue;
+};
+
+/**
+ * Doubly linked queue of messages.
+ *
+ */
+class MessageQueue
+{
+public:
+    MessageQueue(void);
+
+    Message* GetHead(void) const { return mHead; }
+
+    Message* GetTail(void) const { return mTail; }
+
+    otError Enqueue(Message &aMessage);
+
+    otError Dequeue(Message &aMessage);
+
+private:
+    Message* mHead;
+    Message* mTail;
+};
+
+}
+
+#endif /* MESSAGE_HPP_ */
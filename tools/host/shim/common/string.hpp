@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STRING_HPP_
+#define STRING_HPP_
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common/code_utils.hpp"
+
+namespace ot {
+
+template <uint16_t kSize>
+class String
+{
+public:
+    String(void) { mBuffer[0] = '\0'; }
+
+    String(const char* aFormat, ...)
+    {
+        va_list args;
+        va_start(args, aFormat);
+        vsnprintf(mBuffer, kSize, aFormat, args);
+        va_end(args);
+    }
+
+    otError Set(const char* aFormat, ...)
+    {
+        va_list args;
+        int length;
+        va_start(args, aFormat);
+        length = vsnprintf(mBuffer, kSize, aFormat, args);
+        va_end(args);
+        return (length < kSize) ? OT_ERROR_NONE : OT_ERROR_NO_BUFS;
+    }
+
+    void Clear(void) { mBuffer[0] = '\0'; }
+
+    uint16_t GetSize(void) const { return kSize; }
+
+    uint16_t GetLength(void) const { return static_cast<uint16_t>(strlen(mBuffer)); }
+
+    const char* AsCString(void) const { return mBuffer; }
+
+private:
+    char mBuffer[kSize];
+};
+
+}
+
+#endif /* STRING_HPP_ */
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TIMER_HPP_
+#define TIMER_HPP_
+
+#include "common/code_utils.hpp"
+
+namespace ot {
+
+class Instance;
+
+namespace Host {
+void AdvanceTime(uint32_t aNow);
+}
+
+/**
+ * Timer driven by virtual host clock. Time is moved forward and expired timers are fired by Host::AdvanceTime.
+ *
+ */
+class Timer
+{
+public:
+    typedef void (*Handler)(Timer &aTimer);
+
+    template <typename OwnerType>
+    OwnerType &GetOwner(void)
+    {
+        return *static_cast<OwnerType*>(mOwner);
+    }
+
+    bool IsRunning(void) const { return mRunning; }
+
+    uint32_t GetFireTime(void) const { return mFireTime; }
+
+protected:
+    Timer(Handler aHandler, void* aOwner);
+
+    void StartAt(uint32_t aT0, uint32_t aDt);
+
+    void Stop(void);
+
+private:
+    friend void Host::AdvanceTime(uint32_t aNow);
+
+    Handler mHandler;
+    void* mOwner;
+    uint32_t mFireTime;
+    bool mRunning;
+    Timer* mNext;
+};
+
+class TimerMilli : public Timer
+{
+public:
+    TimerMilli(Instance &aInstance, Handler aHandler, void* aOwner)
+        : Timer(aHandler, aOwner)
+    {
+        OT_UNUSED_VARIABLE(aInstance);
+    }
+
+    void Start(uint32_t aDt) { Timer::StartAt(GetNow(), aDt); }
+
+    void StartAt(uint32_t aT0, uint32_t aDt) { Timer::StartAt(aT0, aDt); }
+
+    void Stop(void) { Timer::Stop(); }
+
+    static uint32_t GetNow(void);
+
+    static uint32_t SecToMsec(uint32_t aSeconds) { return aSeconds * 1000u; }
+
+    static uint32_t MsecToSec(uint32_t aMilliseconds) { return aMilliseconds / 1000u; }
+};
+
+}
+
+#endif /* TIMER_HPP_ */
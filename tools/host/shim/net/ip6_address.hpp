@@ -0,0 +1,70 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IP6_ADDRESS_HPP_
+#define IP6_ADDRESS_HPP_
+
+#include <string.h>
+
+#include "common/code_utils.hpp"
+#include "common/encoding.hpp"
+#include "common/string.hpp"
+
+namespace ot {
+namespace Ip6 {
+
+class Address
+{
+public:
+    typedef String<40> InfoString;
+
+    bool IsUnspecified(void) const;
+
+    bool IsMulticast(void) const { return mFields[0] == 0xff; }
+
+    bool IsRoutingLocator(void) const;
+
+    bool IsAnycastRoutingLocator(void) const;
+
+    uint16_t GetLocator(void) const { return static_cast<uint16_t>((mFields[14] << 8) | mFields[15]); }
+
+    bool operator==(const Address &aOther) const { return memcmp(mFields, aOther.mFields, sizeof(mFields)) == 0; }
+
+    bool operator!=(const Address &aOther) const { return !(*this == aOther); }
+
+    otError FromString(const char* aBuf);
+
+    InfoString ToString(void) const;
+
+    uint8_t mFields[16];
+};
+
+}
+}
+
+#endif /* IP6_ADDRESS_HPP_ */
@@ -0,0 +1,143 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef UDP6_HPP_
+#define UDP6_HPP_
+
+#include "common/message.hpp"
+#include "net/ip6_address.hpp"
+
+struct otMessageInfo
+{
+};
+
+typedef void (*otUdpReceive)(void* aContext, otMessage* aMessage, const otMessageInfo* aMessageInfo);
+
+namespace ot {
+namespace Ip6 {
+
+class MessageInfo : public otMessageInfo
+{
+public:
+    MessageInfo(void)
+        : mSockPort(0)
+        , mPeerPort(0)
+        , mHopLimit(0)
+        , mInterfaceId(0)
+    {
+        memset(&mSockAddr, 0, sizeof(mSockAddr));
+        memset(&mPeerAddr, 0, sizeof(mPeerAddr));
+    }
+
+    const Address &GetSockAddr(void) const { return mSockAddr; }
+
+    void SetSockAddr(const Address &aAddress) { mSockAddr = aAddress; }
+
+    const Address &GetPeerAddr(void) const { return mPeerAddr; }
+
+    void SetPeerAddr(const Address &aAddress) { mPeerAddr = aAddress; }
+
+    uint16_t GetSockPort(void) const { return mSockPort; }
+
+    void SetSockPort(uint16_t aPort) { mSockPort = aPort; }
+
+    uint16_t GetPeerPort(void) const { return mPeerPort; }
+
+    void SetPeerPort(uint16_t aPort) { mPeerPort = aPort; }
+
+    uint8_t GetHopLimit(void) const { return mHopLimit; }
+
+    void SetHopLimit(uint8_t aHopLimit) { mHopLimit = aHopLimit; }
+
+    void SetInterfaceId(int8_t aInterfaceId) { mInterfaceId = aInterfaceId; }
+
+private:
+    Address mSockAddr;
+    Address mPeerAddr;
+    uint16_t mSockPort;
+    uint16_t mPeerPort;
+    uint8_t mHopLimit;
+    int8_t mInterfaceId;
+};
+
+struct SockAddr
+{
+    SockAddr(void)
+        : mPort(0)
+    {
+        memset(&mAddress, 0, sizeof(mAddress));
+    }
+
+    Address mAddress;
+    uint16_t mPort;
+};
+
+class Udp;
+
+/**
+ * UDP socket. Sent messages are passed to handler set by Host::SetUdpSendHandler and received messages are
+ * delivered by Host::Receive to the open socket bound to the destination port.
+ *
+ */
+class UdpSocket
+{
+public:
+    explicit UdpSocket(Udp &aUdp);
+
+    otError Open(otUdpReceive aHandler, void* aContext);
+
+    otError Bind(const SockAddr &aSockAddr);
+
+    otError Close(void);
+
+    Message* NewMessage(uint16_t aReserved);
+
+    otError SendTo(Message &aMessage, const MessageInfo &aMessageInfo);
+
+    uint16_t GetPort(void) const { return mSockName.mPort; }
+
+    void HandleReceive(Message &aMessage, const MessageInfo &aMessageInfo);
+
+    UdpSocket* GetNext(void) const { return mNext; }
+
+private:
+    otUdpReceive mHandler;
+    void* mContext;
+    SockAddr mSockName;
+    UdpSocket* mNext;
+    bool mOpen;
+};
+
+class Udp
+{
+};
+
+}
+}
+
+#endif /* UDP6_HPP_ */
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OPENTHREAD_ERROR_H_
+#define OPENTHREAD_ERROR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file
+ *   Host stand-in of OpenThread types used by MQTT-SN client. Only declarations needed to build the client on
+ *   host are provided.
+ *
+ */
+
+typedef enum otError
+{
+    OT_ERROR_NONE = 0,
+    OT_ERROR_FAILED = 1,
+    OT_ERROR_DROP = 2,
+    OT_ERROR_NO_BUFS = 3,
+    OT_ERROR_BUSY = 5,
+    OT_ERROR_PARSE = 6,
+    OT_ERROR_INVALID_ARGS = 7,
+    OT_ERROR_RESPONSE_TIMEOUT = 10,
+    OT_ERROR_INVALID_STATE = 13,
+    OT_ERROR_NOT_IMPLEMENTED = 16,
+    OT_ERROR_NOT_FOUND = 23,
+    OT_ERROR_ALREADY = 24,
+} otError;
+
+#define OT_NETIF_INTERFACE_ID_THREAD 1
+
+#define OT_CHANGED_THREAD_NETDATA (1 << 9)
+
+#define OT_UNUSED_VARIABLE(aVariable) ((void)(aVariable))
+
+typedef struct otInstance otInstance;
+
+#endif /* OPENTHREAD_ERROR_H_ */
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OPENTHREAD_NETDATA_H_
+#define OPENTHREAD_NETDATA_H_
+
+#include "openthread/error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t otNetworkDataIterator;
+
+#define OT_NETWORK_DATA_ITERATOR_INIT 0
+
+#define OT_SERVICE_DATA_MAX_SIZE 252
+
+#define OT_SERVER_DATA_MAX_SIZE 248
+
+typedef struct otServerConfig
+{
+    bool mStable;
+    uint8_t mServerDataLength;
+    uint8_t mServerData[OT_SERVER_DATA_MAX_SIZE];
+    uint16_t mRloc16;
+} otServerConfig;
+
+typedef struct otServiceConfig
+{
+    uint8_t mServiceId;
+    uint32_t mEnterpriseNumber;
+    uint8_t mServiceDataLength;
+    uint8_t mServiceData[OT_SERVICE_DATA_MAX_SIZE];
+    otServerConfig mServerConfig;
+} otServiceConfig;
+
+otError otNetDataGetNextService(otInstance* aInstance, otNetworkDataIterator* aIterator, otServiceConfig* aConfig);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OPENTHREAD_NETDATA_H_ */
@@ -0,0 +1,99 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef THREAD_NETIF_HPP_
+#define THREAD_NETIF_HPP_
+
+#include "common/code_utils.hpp"
+#include "net/udp6.hpp"
+
+namespace ot {
+
+/**
+ * Data poll manager of sleepy end device. Host device is always receiving, the poll period is only stored.
+ *
+ */
+class DataPollManager
+{
+public:
+    DataPollManager(void)
+        : mExternalPollPeriod(0)
+    {
+    }
+
+    otError SetExternalPollPeriod(uint32_t aPeriod)
+    {
+        mExternalPollPeriod = aPeriod;
+        return OT_ERROR_NONE;
+    }
+
+    uint32_t GetExternalPollPeriod(void) const { return mExternalPollPeriod; }
+
+    void SendFastPolls(uint8_t aNumFastPolls) { OT_UNUSED_VARIABLE(aNumFastPolls); }
+
+private:
+    uint32_t mExternalPollPeriod;
+};
+
+class MeshForwarder
+{
+public:
+    DataPollManager &GetDataPollManager(void) { return mDataPollManager; }
+
+private:
+    DataPollManager mDataPollManager;
+};
+
+namespace Ip6 {
+
+class Ip6
+{
+public:
+    Udp &GetUdp(void) { return mUdp; }
+
+private:
+    Udp mUdp;
+};
+
+}
+
+class ThreadNetif
+{
+public:
+    Ip6::Ip6 &GetIp6(void) { return mIp6; }
+
+    MeshForwarder &GetMeshForwarder(void) { return mMeshForwarder; }
+
+private:
+    Ip6::Ip6 mIp6;
+    MeshForwarder mMeshForwarder;
+};
+
+}
+
+#endif /* THREAD_NETIF_HPP_ */
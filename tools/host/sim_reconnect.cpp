@@ -0,0 +1,281 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host_platform.hpp"
+#include "mqttsn_client.hpp"
+#include "mqttsn_serializer.hpp"
+
+/**
+ * @file
+ *   This file contains simulation of mass reconnect after gateway restart. Clients connect at once, the gateway
+ *   stops answering and starts again after a while. Gateway handles limited number of packets per time bucket
+ *   and drops the rest. Packets sent to the gateway are counted per bucket in virtual time with reconnect
+ *   backoff and keepalive jitter disabled and with default configuration.
+ *
+ */
+
+#define SIM_CLIENT_COUNT 300
+#define SIM_CLIENT_PORT 20000
+#define SIM_GATEWAY_PORT 10000
+#define SIM_KEEPALIVE 60
+#define SIM_LATENCY 20
+#define SIM_BUCKET 100
+#define SIM_GATEWAY_CAPACITY 20
+#define SIM_GATEWAY_DOWN 100000
+#define SIM_GATEWAY_UP 130000
+#define SIM_STEADY 400000
+#define SIM_END 520000
+#define SIM_PACKET_SIZE 64
+
+using namespace ot;
+using namespace ot::Mqttsn;
+
+struct SimClient
+{
+    MqttsnClient* mClient;
+    MqttsnConfig mConfig;
+    uint32_t mReconnectTime;
+    uint32_t mResponseTime;
+    MessageType mResponseType;
+    bool mReconnectPending;
+    bool mResponsePending;
+    bool mConnected;
+};
+
+struct SimResult
+{
+    uint32_t mBuckets[SIM_END / SIM_BUCKET];
+    uint32_t mDropped;
+    uint32_t mConnectedCount;
+    uint32_t mReconnectedTime;
+};
+
+static SimClient sClients[SIM_CLIENT_COUNT];
+static SimResult sResult;
+static MqttsnConfig sConfig;
+static uint32_t sNow = 0;
+static uint32_t sStart = 0;
+
+static void HandleUdpSend(Ip6::UdpSocket &aSocket, const Message &aMessage, const Ip6::MessageInfo &aMessageInfo,
+    void* aContext)
+{
+    SimClient &client = sClients[aSocket.GetPort() - SIM_CLIENT_PORT];
+    uint32_t time = sNow - sStart;
+    uint32_t &bucket = sResult.mBuckets[time / SIM_BUCKET];
+    MessageType type;
+
+    OT_UNUSED_VARIABLE(aMessageInfo);
+    OT_UNUSED_VARIABLE(aContext);
+
+    // Packets over gateway capacity are dropped like packets sent while the gateway is down
+    bucket++;
+    if (time >= SIM_GATEWAY_DOWN && time < SIM_GATEWAY_UP)
+    {
+        return;
+    }
+    if (bucket > SIM_GATEWAY_CAPACITY)
+    {
+        sResult.mDropped++;
+        return;
+    }
+    if (MessageBase::DeserializeMessageType(aMessage, &type) != OT_ERROR_NONE)
+    {
+        return;
+    }
+    if (type == kTypeConnect || type == kTypePingreq)
+    {
+        client.mResponseType = type;
+        client.mResponseTime = sNow + SIM_LATENCY;
+        client.mResponsePending = true;
+    }
+}
+
+static void HandleConnected(ReturnCode aCode, void* aContext)
+{
+    SimClient &client = *static_cast<SimClient*>(aContext);
+
+    if (aCode == kCodeAccepted && !client.mConnected)
+    {
+        client.mConnected = true;
+        sResult.mConnectedCount++;
+    }
+    // Time when the last client lost by the restart is connected again
+    if (sResult.mConnectedCount == SIM_CLIENT_COUNT && sNow - sStart >= SIM_GATEWAY_UP)
+    {
+        sResult.mReconnectedTime = sNow - sStart - SIM_GATEWAY_UP;
+    }
+}
+
+static void HandleDisconnected(DisconnectType aType, void* aContext)
+{
+    SimClient &client = *static_cast<SimClient*>(aContext);
+
+    OT_UNUSED_VARIABLE(aType);
+
+    if (client.mConnected)
+    {
+        client.mConnected = false;
+        sResult.mConnectedCount--;
+    }
+
+    // Application waits for reconnect delay like the demo application
+    client.mReconnectTime = sNow + client.mClient->NextReconnectDelay();
+    client.mReconnectPending = true;
+}
+
+static void Respond(uint16_t aIndex)
+{
+    SimClient &client = sClients[aIndex];
+    Ip6::MessageInfo messageInfo;
+    uint8_t buffer[SIM_PACKET_SIZE];
+    int32_t length;
+
+    client.mResponsePending = false;
+    if (client.mResponseType == kTypeConnect)
+    {
+        ConnackMessage(kCodeAccepted).Serialize(buffer, sizeof(buffer), &length);
+    }
+    else
+    {
+        PingrespMessage().Serialize(buffer, sizeof(buffer), &length);
+    }
+    messageInfo.SetPeerAddr(sConfig.GetAddress());
+    messageInfo.SetPeerPort(SIM_GATEWAY_PORT);
+    messageInfo.SetSockPort(SIM_CLIENT_PORT + aIndex);
+    Host::Receive(buffer, static_cast<uint16_t>(length), messageInfo);
+}
+
+static uint32_t PeakRate(uint32_t aFrom, uint32_t aTo)
+{
+    uint32_t peak = 0;
+
+    for (uint32_t i = aFrom / SIM_BUCKET; i < aTo / SIM_BUCKET; i++)
+    {
+        peak = OT_MAX(peak, sResult.mBuckets[i]);
+    }
+    return peak * (1000 / SIM_BUCKET);
+}
+
+static uint32_t TotalPackets(uint32_t aFrom, uint32_t aTo)
+{
+    uint32_t total = 0;
+
+    for (uint32_t i = aFrom / SIM_BUCKET; i < aTo / SIM_BUCKET; i++)
+    {
+        total += sResult.mBuckets[i];
+    }
+    return total;
+}
+
+static void Simulate(const char* aName, uint32_t aBackoffBase, uint8_t aKeepAliveJitter)
+{
+    Instance &instance = Instance::Get();
+    Ip6::Address address;
+
+    memset(&sResult, 0, sizeof(sResult));
+    Host::SetRandomSeed(0x2545f491);
+    address.FromString("fd00::1");
+    sConfig.SetAddress(address);
+    sConfig.SetPort(SIM_GATEWAY_PORT);
+    sConfig.SetKeepAlive(SIM_KEEPALIVE);
+    sConfig.SetCleanSession(true);
+    sConfig.SetReconnectBackoffBase(aBackoffBase);
+    sConfig.SetKeepAliveJitter(aKeepAliveJitter);
+
+    // All clients connect at once like after power outage
+    sStart = sNow;
+    for (uint16_t i = 0; i < SIM_CLIENT_COUNT; i++)
+    {
+        SimClient &client = sClients[i];
+        char clientId[16];
+
+        client.mClient = new MqttsnClient(instance);
+        client.mConfig = sConfig;
+        client.mReconnectPending = false;
+        client.mResponsePending = false;
+        client.mConnected = false;
+        client.mClient->SetConnectedCallback(HandleConnected, &client);
+        client.mClient->SetDisconnectedCallback(HandleDisconnected, &client);
+        client.mClient->Start(SIM_CLIENT_PORT + i);
+        snprintf(clientId, sizeof(clientId), "sim%u", i);
+        client.mConfig.SetClientId(clientId);
+        client.mClient->Connect(client.mConfig);
+    }
+
+    for (; sNow - sStart < SIM_END; sNow++)
+    {
+        Host::AdvanceTime(sNow);
+        for (uint16_t i = 0; i < SIM_CLIENT_COUNT; i++)
+        {
+            SimClient &client = sClients[i];
+
+            if (client.mResponsePending && client.mResponseTime == sNow)
+            {
+                Respond(i);
+            }
+            if (client.mReconnectPending && !WaitingMessagesIndex::IsBefore(sNow, client.mReconnectTime))
+            {
+                client.mReconnectPending = false;
+                client.mClient->Connect(client.mConfig);
+            }
+        }
+    }
+
+    fprintf(stderr, "%s\n", aName);
+    fprintf(stderr, "  peak rate while gateway is down   %6lu packets/s\n",
+        static_cast<unsigned long>(PeakRate(SIM_GATEWAY_DOWN, SIM_GATEWAY_UP)));
+    fprintf(stderr, "  peak rate after gateway restart   %6lu packets/s\n",
+        static_cast<unsigned long>(PeakRate(SIM_GATEWAY_UP, SIM_STEADY)));
+    fprintf(stderr, "  peak keepalive rate               %6lu packets/s\n",
+        static_cast<unsigned long>(PeakRate(SIM_STEADY, SIM_END)));
+    fprintf(stderr, "  packets during outage and restart %6lu, %lu dropped over capacity\n",
+        static_cast<unsigned long>(TotalPackets(SIM_GATEWAY_DOWN, SIM_STEADY)),
+        static_cast<unsigned long>(sResult.mDropped));
+    fprintf(stderr, "  all clients connected again after %6lu ms\n",
+        static_cast<unsigned long>(sResult.mReconnectedTime));
+
+    for (uint16_t i = 0; i < SIM_CLIENT_COUNT; i++)
+    {
+        sClients[i].mClient->Stop();
+        delete sClients[i].mClient;
+    }
+}
+
+int main(void)
+{
+    Host::SetUdpSendHandler(HandleUdpSend, nullptr);
+    fprintf(stderr, "%u clients, keepalive %u s, gateway capacity %u packets per %u ms, gateway down %u-%u ms\n",
+        SIM_CLIENT_COUNT, SIM_KEEPALIVE, SIM_GATEWAY_CAPACITY, SIM_BUCKET, SIM_GATEWAY_DOWN, SIM_GATEWAY_UP);
+    Simulate("Without reconnect backoff and keepalive jitter", 0, 0);
+    Simulate("With default reconnect backoff and keepalive jitter", MqttsnConfig().GetReconnectBackoffBase(),
+        MqttsnConfig().GetKeepAliveJitter());
+    return 0;
+}
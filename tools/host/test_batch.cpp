@@ -0,0 +1,177 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "test_util.hpp"
+
+/**
+ * @file
+ *   This file contains test of batch subscription and registration. Requests of all topics are sent
+ *   back-to-back and single callback reports result of each topic in order of topic names.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+enum
+{
+    kLatency = 100,
+    kTopicCount = 4
+};
+
+static const char* const sTopicNames[kTopicCount] =
+{
+    "sensors/0/temperature",
+    "sensors/1/temperature",
+    "sensors/2/temperature",
+    "sensors/3/temperature"
+};
+
+static uint32_t sBatchCount;
+static uint32_t sBatchTime;
+static TopicResult sResults[kTopicCount];
+static uint8_t sResultCount;
+
+static void HandleBatch(const TopicResult* aResults, uint8_t aCount, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    sBatchCount++;
+    sBatchTime = TimerMilli::GetNow();
+    sResultCount = aCount;
+    memcpy(sResults, aResults, aCount * sizeof(aResults[0]));
+}
+
+static void HandleRegistered(ReturnCode aCode, TopicId aTopicId, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aTopicId);
+    OT_UNUSED_VARIABLE(aContext);
+    VerifyOrQuit(aCode == kCodeAccepted, "topic not registered");
+}
+
+static void Connect(MqttsnClient &aClient, MqttsnConfig &aConfig, TestGateway &aGateway)
+{
+    aConfig.SetKeepAlive(600);
+    aConfig.SetCleanSession(true);
+    aConfig.SetRetransmissionTimeout(1);
+    aConfig.SetRetransmissionCount(1);
+    aConfig.SetRetransmissionJitter(0);
+    StartAndConnect(aClient, aConfig, aGateway);
+    aGateway.Clear();
+    aGateway.SetLatency(kLatency);
+    sBatchCount = 0;
+    sResultCount = 0;
+}
+
+// All topics are subscribed in one round trip and reported by single callback
+static void TestSubscribeBatch(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    uint32_t startTime;
+
+    Connect(client, config, gateway);
+
+    startTime = TimerMilli::GetNow();
+    VerifyOrQuit(client.SubscribeBatch(sTopicNames, kTopicCount, kQos1, HandleBatch, nullptr) == OT_ERROR_NONE,
+        "batch subscribe failed");
+    VerifyOrQuit(client.SubscribeBatch(sTopicNames, kTopicCount, kQos1, HandleBatch, nullptr) == OT_ERROR_BUSY,
+        "second batch started");
+    RunFor(10 * kLatency);
+
+    VerifyOrQuit(gateway.GetCount(kTypeSubscribe) == kTopicCount, "wrong SUBSCRIBE count");
+    for (uint16_t i = 0; i < kTopicCount; i++)
+    {
+        VerifyOrQuit(gateway.GetPacket(kTypeSubscribe, i)->mTime == startTime, "SUBSCRIBE waited for acknowledgement");
+    }
+    VerifyOrQuit(sBatchCount == 1 && sBatchTime == startTime + kLatency, "batch not reported after one round trip");
+    VerifyOrQuit(sResultCount == kTopicCount, "wrong result count");
+    for (uint8_t i = 0; i < kTopicCount; i++)
+    {
+        // Test gateway assigns topic IDs in order of first use
+        VerifyOrQuit(sResults[i].mCode == kCodeAccepted && sResults[i].mTopicId == i + 1 && sResults[i].mQos == kQos1,
+            "wrong topic result");
+    }
+
+    // Subscribed topics are reported again without sending messages
+    gateway.Clear();
+    VerifyOrQuit(client.SubscribeBatch(sTopicNames, kTopicCount, kQos1, HandleBatch, nullptr) == OT_ERROR_NONE,
+        "batch subscribe failed");
+    VerifyOrQuit(sBatchCount == 2 && gateway.GetCount(kTypeSubscribe) == 0, "subscribed topics requested again");
+    VerifyOrQuit(sResults[3].mCode == kCodeAccepted && sResults[3].mTopicId == 4, "wrong subscribed topic result");
+
+    client.Stop();
+}
+
+// Registered topic is accepted without message while unanswered topics time out after retransmission
+static void TestRegisterBatchTimeout(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+
+    Connect(client, config, gateway);
+    VerifyOrQuit(client.Register(sTopicNames[2], HandleRegistered, nullptr) == OT_ERROR_NONE, "register failed");
+    RunFor(10 * kLatency);
+    gateway.Clear();
+
+    gateway.SetAnswering(false);
+    VerifyOrQuit(client.RegisterBatch(sTopicNames, kTopicCount, HandleBatch, nullptr) == OT_ERROR_NONE,
+        "batch register failed");
+    RunFor(1000);
+    VerifyOrQuit(gateway.GetCount(kTypeRegister) == 2 * (kTopicCount - 1), "unacknowledged topics not retransmitted");
+    VerifyOrQuit(sBatchCount == 0, "batch reported before timeout");
+    RunFor(2000);
+
+    VerifyOrQuit(sBatchCount == 1 && sResultCount == kTopicCount, "batch timeout not reported");
+    for (uint8_t i = 0; i < kTopicCount; i++)
+    {
+        if (i == 2)
+        {
+            VerifyOrQuit(sResults[i].mCode == kCodeAccepted && sResults[i].mTopicId != 0,
+                "registered topic not accepted");
+        }
+        else
+        {
+            VerifyOrQuit(sResults[i].mCode == kCodeTimeout && sResults[i].mTopicId == 0, "topic not timed out");
+        }
+    }
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestSubscribeBatch();
+    TestRegisterBatchTimeout();
+    printf("All tests passed\n");
+    return 0;
+}
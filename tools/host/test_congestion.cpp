@@ -0,0 +1,133 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "test_util.hpp"
+
+/**
+ * @file
+ *   This file contains test of congestion window. The window grows by one message per window of timely
+ *   acknowledgements and it is halved by retransmission or congestion rejection, once per congestion event.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+static const uint8_t kPayload[] = {0x31};
+
+static ReturnCode sPublishCode;
+
+static void HandlePublished(ReturnCode aCode, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    sPublishCode = aCode;
+}
+
+static otError Publish(MqttsnClient &aClient)
+{
+    return aClient.Publish(kPayload, sizeof(kPayload), kQos1, static_cast<TopicId>(1), HandlePublished, nullptr);
+}
+
+static uint8_t GetWindow(MqttsnClient &aClient)
+{
+    ClientStats stats;
+
+    aClient.GetStats(stats);
+    return stats.mCongestionWindow;
+}
+
+// Additive increase, multiplicative decrease on retransmission and rejection, window limits publishing
+static void TestWindowChanges(void)
+{
+    // Window after each acknowledgement starting from the initial window of two messages
+    static const uint8_t kIncrease[] = {2, 3, 3, 3, 4, 4, 4, 4, 5};
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    ClientStats stats;
+
+    config.SetKeepAlive(600);
+    config.SetRetransmissionJitter(0);
+    StartAndConnect(client, config, gateway);
+    VerifyOrQuit(GetWindow(client) == kCongestionWindowInitial, "wrong initial window");
+
+    for (uint8_t i = 0; i < sizeof(kIncrease); i++)
+    {
+        VerifyOrQuit(Publish(client) == OT_ERROR_NONE, "publish failed");
+        RunFor(50);
+        VerifyOrQuit(sPublishCode == kCodeAccepted, "publish not acknowledged");
+        VerifyOrQuit(GetWindow(client) == kIncrease[i], "window not increased by one per window of acknowledgements");
+    }
+
+    // Retransmission halves the window, late acknowledgement of retransmitted message does not increase it
+    client.GetStats(stats);
+    gateway.SetLatency(stats.mRetransmissionTimeout + 500);
+    VerifyOrQuit(Publish(client) == OT_ERROR_NONE, "publish failed");
+    RunFor(stats.mRetransmissionTimeout);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == sizeof(kIncrease) + 2, "message not retransmitted");
+    VerifyOrQuit(GetWindow(client) == 2, "window not halved by retransmission");
+    gateway.SetLatency(10);
+    RunFor(600);
+    VerifyOrQuit(sPublishCode == kCodeAccepted && GetWindow(client) == 2, "window changed by ambiguous acknowledgement");
+    RunFor(stats.mRetransmissionTimeout);
+
+    // Rejections of messages sent together are single congestion event
+    gateway.SetReturnCode(kCodeRejectedCongestion);
+    VerifyOrQuit(Publish(client) == OT_ERROR_NONE && Publish(client) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(Publish(client) == OT_ERROR_BUSY, "publish beyond congestion window accepted");
+    RunFor(50);
+    client.GetStats(stats);
+    VerifyOrQuit(sPublishCode == kCodeRejectedCongestion, "rejection not reported");
+    VerifyOrQuit(stats.mCongestionWindow == 1 && stats.mCongestionRejections == 2 && stats.mCongestionEvents == 2,
+        "window not halved once for rejections of one event");
+
+    // Window does not drop below one message
+    RunFor(1000);
+    VerifyOrQuit(Publish(client) == OT_ERROR_NONE, "publish failed");
+    RunFor(50);
+    client.GetStats(stats);
+    VerifyOrQuit(stats.mCongestionWindow == 1 && stats.mCongestionEvents == 3, "window dropped below one message");
+    VerifyOrQuit(stats.mRttSamples == sizeof(kIncrease), "rejections or retransmissions measured as round trip");
+
+    gateway.SetReturnCode(kCodeAccepted);
+    VerifyOrQuit(Publish(client) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(Publish(client) == OT_ERROR_BUSY, "publish beyond congestion window accepted");
+    RunFor(50);
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestWindowChanges();
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_util.hpp"
+
+/**
+ * @file
+ *   This file contains test of connection loss, reconnection and stop. Forced timeouts of waiting messages on
+ *   lost connection must not mark the next connection lost, stop times out waiting messages.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+static uint32_t sDisconnectedCount = 0;
+static DisconnectType sDisconnectType = kServer;
+static uint32_t sPublishTimeoutCount = 0;
+
+static void HandleDisconnected(DisconnectType aType, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    sDisconnectedCount++;
+    sDisconnectType = aType;
+}
+
+static void HandlePublished(ReturnCode aCode, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    if (aCode == kCodeTimeout)
+    {
+        sPublishTimeoutCount++;
+    }
+}
+
+static void Publish(MqttsnClient &aClient)
+{
+    static const uint8_t kPayload[] = {0x31};
+
+    VerifyOrQuit(aClient.Publish(kPayload, sizeof(kPayload), kQos1, static_cast<TopicId>(1), HandlePublished,
+        nullptr) == OT_ERROR_NONE, "publish failed");
+}
+
+// Client reconnects after timeout while other messages were waiting for acknowledgement
+static void TestReconnectAfterTimeout(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+
+    sDisconnectedCount = 0;
+    sPublishTimeoutCount = 0;
+    config.SetKeepAlive(600);
+    client.SetDisconnectedCallback(HandleDisconnected, nullptr);
+    StartAndConnect(client, config, gateway);
+
+    // The first message times out while the second one still waits
+    gateway.SetAnswering(false);
+    Publish(client);
+    RunFor(2000);
+    Publish(client);
+    while (client.GetState() == kStateActive)
+    {
+        RunFor(100);
+    }
+    VerifyOrQuit(client.GetState() == kStateLost, "client not lost");
+    VerifyOrQuit(sDisconnectedCount == 1 && sDisconnectType == kTimeout, "timeout not reported once");
+    VerifyOrQuit(sPublishTimeoutCount == 2, "waiting messages not timed out");
+
+    gateway.SetAnswering(true);
+    VerifyOrQuit(client.Connect(config) == OT_ERROR_NONE, "connect failed");
+    // Run over keepalive PINGREQ which is the next process timer event
+    RunFor(config.GetKeepAlive() * 1000);
+    VerifyOrQuit(client.GetState() == kStateActive, "new connection lost by previous timeout");
+    VerifyOrQuit(sDisconnectedCount == 1, "new connection reported lost");
+
+    client.Stop();
+}
+
+// Stop of connected client times out waiting messages and reports disconnection
+static void TestStop(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    uint16_t publishCount;
+
+    sDisconnectedCount = 0;
+    sPublishTimeoutCount = 0;
+    client.SetDisconnectedCallback(HandleDisconnected, nullptr);
+    StartAndConnect(client, config, gateway);
+
+    gateway.SetAnswering(false);
+    Publish(client);
+    VerifyOrQuit(client.Stop() == OT_ERROR_NONE, "stop failed");
+    VerifyOrQuit(client.GetState() == kStateDisconnected, "client not disconnected");
+    VerifyOrQuit(sDisconnectedCount == 1 && sDisconnectType == kClient, "disconnection not reported");
+    VerifyOrQuit(sPublishTimeoutCount == 1, "waiting message not timed out");
+
+    // Nothing is retransmitted after stop
+    publishCount = gateway.GetCount(kTypePublish);
+    RunFor(60000);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == publishCount, "message retransmitted after stop");
+}
+
+int main(void)
+{
+    TestReconnectAfterTimeout();
+    TestStop();
+    printf("All tests passed\n");
+    return 0;
+}
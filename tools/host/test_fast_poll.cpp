@@ -0,0 +1,130 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_util.hpp"
+#include "thread/thread_netif.hpp"
+
+/**
+ * @file
+ *   This file contains test of fast data polling. Sleepy end device polls its parent with fast poll period
+ *   only while the client waits for a response and restores previous poll period afterwards.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+enum
+{
+    kSlowPollPeriod = 30000,
+    kFastPollPeriod = 100,
+    kLatency = 500
+};
+
+static const uint8_t kPayload[] = {0x31};
+
+static void HandlePublished(ReturnCode aCode, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aCode);
+    OT_UNUSED_VARIABLE(aContext);
+}
+
+static DataPollManager &GetPollManager(void)
+{
+    return Instance::Get().GetThreadNetif().GetMeshForwarder().GetDataPollManager();
+}
+
+static void Connect(MqttsnClient &aClient, MqttsnConfig &aConfig, TestGateway &aGateway)
+{
+    aConfig.SetKeepAlive(10);
+    aConfig.SetKeepAliveJitter(0);
+    aConfig.SetFastPollPeriod(kFastPollPeriod);
+    StartAndConnect(aClient, aConfig, aGateway);
+    aGateway.SetLatency(kLatency);
+    GetPollManager().SetExternalPollPeriod(kSlowPollPeriod);
+}
+
+// Sleepy device polls fast only while acknowledgement or PINGRESP is expected
+static void TestSleepyDevice(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+
+    SetRxOnWhenIdle(false);
+    Connect(client, config, gateway);
+
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos1, static_cast<TopicId>(1), HandlePublished,
+        nullptr) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(GetPollManager().GetExternalPollPeriod() == kFastPollPeriod, "fast polling not started");
+    RunFor(kLatency + 10);
+    VerifyOrQuit(GetPollManager().GetExternalPollPeriod() == kSlowPollPeriod, "slow polling not restored");
+
+    // QoS 0 message is not acknowledged
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos0, static_cast<TopicId>(1), nullptr, nullptr)
+        == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(GetPollManager().GetExternalPollPeriod() == kSlowPollPeriod, "fast polling without response");
+
+    // Keepalive PINGREQ waits for PINGRESP
+    gateway.Clear();
+    while (gateway.GetCount(kTypePingreq) == 0)
+    {
+        RunFor(10);
+    }
+    VerifyOrQuit(GetPollManager().GetExternalPollPeriod() == kFastPollPeriod, "fast polling not started by PINGREQ");
+    RunFor(kLatency);
+    VerifyOrQuit(GetPollManager().GetExternalPollPeriod() == kSlowPollPeriod, "slow polling not restored");
+
+    client.Stop();
+    SetRxOnWhenIdle(true);
+}
+
+// Poll period of device with receiver on is not changed
+static void TestRxOnDevice(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+
+    Connect(client, config, gateway);
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos1, static_cast<TopicId>(1), HandlePublished,
+        nullptr) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(GetPollManager().GetExternalPollPeriod() == kSlowPollPeriod, "poll period changed");
+    RunFor(kLatency + 10);
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestSleepyDevice();
+    TestRxOnDevice();
+    printf("All tests passed\n");
+    return 0;
+}
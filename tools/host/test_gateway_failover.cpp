@@ -0,0 +1,134 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_util.hpp"
+#include "common/timer.hpp"
+
+/**
+ * @file
+ *   This file contains test of gateway table. Gateways are ranked by round trip time of probes and the client
+ *   connects to the next gateway once when the active gateway stops answering.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+static uint32_t sDisconnectedCount = 0;
+
+static void HandleDisconnected(DisconnectType aType, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aType);
+    OT_UNUSED_VARIABLE(aContext);
+    sDisconnectedCount++;
+}
+
+static void HandlePublished(ReturnCode aCode, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aCode);
+    OT_UNUSED_VARIABLE(aContext);
+}
+
+// Probes sent at once are ranked by their own round trip times
+static void TestProbeRanking(MqttsnClient &aClient, TestGateway &aNear, TestGateway &aFar)
+{
+    GatewayTable &table = aClient.GetGatewayTable();
+    const GatewayTable::Entry* best;
+
+    VerifyOrQuit(aClient.ProbeGateways() == OT_ERROR_NONE, "probe failed");
+    RunFor(500);
+    best = table.GetBest(TimerMilli::GetNow());
+    VerifyOrQuit(best != nullptr && best->GetAddress() == aNear.GetAddress(), "nearest gateway not preferred");
+    VerifyOrQuit(best->GetRtt() < 100, "round trip time of nearest gateway is wrong");
+    VerifyOrQuit(table.Find(aFar.GetAddress(), aFar.GetPort())->GetRtt() >= 200,
+        "round trip time of far gateway is wrong");
+}
+
+static void TestFailover(void)
+{
+    static const uint8_t kPayload[] = {0x31};
+    TestGateway near("fd00::1", 10000);
+    TestGateway far("fd00::2", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    uint32_t lostTime;
+    const TestPacket* connect;
+
+    sDisconnectedCount = 0;
+    Host::SetRandomSeed(0x1234);
+    near.SetLatency(20);
+    far.SetLatency(200);
+    config.SetClientId("test-client");
+    config.SetKeepAlive(30);
+    client.SetDisconnectedCallback(HandleDisconnected, nullptr);
+    VerifyOrQuit(client.Start(kTestClientPort) == OT_ERROR_NONE, "client not started");
+    // Zero time stamp means no probe
+    RunFor(1000);
+    near.Send(AdvertiseMessage(1, 900));
+    far.Send(AdvertiseMessage(2, 900));
+    VerifyOrQuit(client.GetGatewayTable().GetCount() == 2, "gateways not learned");
+
+    TestProbeRanking(client, near, far);
+    VerifyOrQuit(client.ConnectBestGateway(config) == OT_ERROR_NONE, "connect failed");
+    RunFor(100);
+    VerifyOrQuit(client.GetState() == kStateActive && near.GetCount(kTypeConnect) == 1, "not connected to best");
+
+    // Active gateway stops answering, message waiting for acknowledgement is timed out with the connection
+    near.SetAnswering(false);
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos1, static_cast<TopicId>(1), HandlePublished,
+        nullptr) == OT_ERROR_NONE, "publish failed");
+    while (client.GetState() == kStateActive)
+    {
+        RunFor(10);
+    }
+    lostTime = TimerMilli::GetNow();
+    RunFor(config.GetReconnectBackoffMax());
+
+    // The next gateway is connected once after single reconnect delay
+    connect = far.GetPacket(kTypeConnect, 0);
+    VerifyOrQuit(connect != nullptr && far.GetCount(kTypeConnect) == 1, "next gateway not connected once");
+    VerifyOrQuit(connect->mTime - lostTime <= 3 * config.GetReconnectBackoffBase(), "reconnect delay applied twice");
+    VerifyOrQuit(near.GetCount(kTypeConnect) == 1, "lost gateway connected again");
+    VerifyOrQuit(client.GetState() == kStateActive, "client not connected to next gateway");
+    VerifyOrQuit(sDisconnectedCount == 0, "failover reported as disconnection");
+    for (uint8_t i = 0; i < client.GetGatewayTable().GetCount(); i++)
+    {
+        const GatewayTable::Entry* entry = client.GetGatewayTable().GetEntry(i);
+        VerifyOrQuit(entry->IsFailed() == (entry->GetAddress() == near.GetAddress()), "wrong gateway failed");
+    }
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestFailover();
+    printf("All tests passed\n");
+    return 0;
+}
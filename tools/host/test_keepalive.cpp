@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_util.hpp"
+
+/**
+ * @file
+ *   This file contains test of keepalive PINGREQ suppression. Messages received from connected gateway and
+ *   its advertisements postpone keepalive PINGREQ up to the keepalive period and statistics count PINGREQs
+ *   saved compared to fixed schedule.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+enum
+{
+    kKeepAlive = 10,
+    kLatency = 10,
+    kDuration = 66000
+};
+
+static void Connect(MqttsnClient &aClient, MqttsnConfig &aConfig, TestGateway &aGateway)
+{
+    aConfig.SetKeepAlive(kKeepAlive);
+    aConfig.SetKeepAliveJitter(0);
+    aGateway.SetLatency(kLatency);
+    StartAndConnect(aClient, aConfig, aGateway);
+}
+
+// Idle client sends PINGREQ on fixed schedule and saves nothing
+static void TestIdle(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    ClientStats stats;
+    uint32_t connectTime;
+
+    Connect(client, config, gateway);
+    connectTime = gateway.GetPacket(kTypeConnect, 0)->mTime;
+    RunFor(kDuration - 100);
+
+    client.GetStats(stats);
+    // Keepalive interval starts with CONNACK
+    VerifyOrQuit(gateway.GetPacket(kTypePingreq, 0)->mTime - connectTime
+        == kLatency + kKeepAlive * kKeepAlivePingTime, "first PINGREQ not sent on schedule");
+    VerifyOrQuit(gateway.GetCount(kTypePingreq) == kDuration / (kKeepAlive * kKeepAlivePingTime),
+        "wrong PINGREQ count");
+    VerifyOrQuit(stats.mPingreqSent == gateway.GetCount(kTypePingreq), "sent PINGREQs not counted");
+    VerifyOrQuit(stats.mPingreqSaved == 0 && stats.mPingreqSavedPerHour == 0, "PINGREQ saved without traffic");
+
+    client.Stop();
+}
+
+// Messages received from gateway postpone PINGREQ to the end of keepalive period
+static void TestInboundTraffic(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    ClientStats stats;
+    uint32_t connectTime;
+    uint16_t count;
+
+    Connect(client, config, gateway);
+    connectTime = gateway.GetPacket(kTypeConnect, 0)->mTime;
+    while (TimerMilli::GetNow() - connectTime < kDuration)
+    {
+        static const uint8_t kPayload[] = {0x31};
+
+        VerifyOrQuit(gateway.Send(PublishMessage(false, false, kQos0, 0, kTopicId, 1, nullptr, kPayload,
+            sizeof(kPayload))) == OT_ERROR_NONE, "PUBLISH not delivered");
+        RunFor(2000);
+    }
+
+    client.GetStats(stats);
+    count = gateway.GetCount(kTypePingreq);
+    VerifyOrQuit(count == kDuration / (kKeepAlive * 1000), "wrong PINGREQ count");
+    for (uint16_t i = 0; i < count; i++)
+    {
+        VerifyOrQuit(gateway.GetPacket(kTypePingreq, i)->mTime - connectTime == (i + 1) * kKeepAlive * 1000u,
+            "PINGREQ not postponed to the end of keepalive period");
+    }
+    VerifyOrQuit(stats.mPingreqSent == count, "sent PINGREQs not counted");
+    // Fixed schedule would send PINGREQ every 7 seconds
+    VerifyOrQuit(stats.mPingreqSaved == static_cast<uint32_t>(kDuration / (kKeepAlive * kKeepAlivePingTime) - count),
+        "saved PINGREQs not counted");
+    VerifyOrQuit(stats.mPingreqSavedPerHour > 0, "saved PINGREQ rate not reported");
+
+    client.Stop();
+}
+
+// Advertisement of connected gateway postpones the next PINGREQ too
+static void TestAdvertise(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    uint32_t connectTime;
+
+    Connect(client, config, gateway);
+    connectTime = gateway.GetPacket(kTypeConnect, 0)->mTime;
+    RunFor(1000);
+    VerifyOrQuit(gateway.Send(AdvertiseMessage(1, 60)) == OT_ERROR_NONE, "ADVERTISE not delivered");
+    RunFor(12000);
+
+    VerifyOrQuit(gateway.GetCount(kTypePingreq) == 1, "wrong PINGREQ count");
+    VerifyOrQuit(gateway.GetPacket(kTypePingreq, 0)->mTime - connectTime == kKeepAlive * 1000u,
+        "PINGREQ not postponed by advertisement");
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestIdle();
+    TestInboundTraffic();
+    TestAdvertise();
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "test_util.hpp"
+#include "mqttsn_publish_aggregator.hpp"
+
+/**
+ * @file
+ *   This file contains test of publish aggregator. Batch is published when the threshold is reached and when
+ *   the oldest sample reaches maximal latency.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+static uint32_t sAccepted;
+
+static void HandlePublished(ReturnCode aCode, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    if (aCode == kCodeAccepted)
+    {
+        sAccepted++;
+    }
+}
+
+static void VerifyPayload(const TestPacket* aPacket, const uint8_t* aPayload, int32_t aLength)
+{
+    PublishMessage publish;
+
+    VerifyOrQuit(aPacket != nullptr, "PUBLISH not sent");
+    VerifyOrQuit(publish.Deserialize(aPacket->mData, aPacket->mLength) == OT_ERROR_NONE, "invalid PUBLISH");
+    VerifyOrQuit(publish.GetPayloadLength() == aLength && memcmp(publish.GetPayload(), aPayload, aLength) == 0,
+        "wrong batch payload");
+}
+
+// Batch is published when no other sample fits or before the sample which does not fit
+static void TestThresholdFlush(void)
+{
+    static const uint8_t kFirst[] = {3, 1, 2, 3, 3, 4, 5, 6};
+    static const uint8_t kSecond[] = {1, 7, 3, 1, 2, 3};
+    static const uint8_t kSample1[] = {1, 2, 3};
+    static const uint8_t kSample2[] = {4, 5, 6};
+    static const uint8_t kSample3[] = {7};
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    PublishAggregator aggregator(Instance::Get(), client);
+    AggregatorCounters counters;
+
+    StartAndConnect(client, config, gateway);
+
+    VerifyOrQuit(aggregator.AddTopic(1, kQos1, 1, 10000, nullptr, nullptr) == OT_ERROR_INVALID_ARGS,
+        "threshold without space for sample accepted");
+    // Null callback is allowed also for QoS level 1, acknowledgements are processed without it
+    VerifyOrQuit(aggregator.AddTopic(1, kQos1, 8, 10000, nullptr, nullptr) == OT_ERROR_NONE, "add topic failed");
+    VerifyOrQuit(aggregator.Publish(1, kSample1, 8) == OT_ERROR_INVALID_ARGS, "sample larger than threshold accepted");
+
+    VerifyOrQuit(aggregator.Publish(1, kSample1, sizeof(kSample1)) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 0, "batch published before threshold");
+    VerifyOrQuit(aggregator.Publish(1, kSample2, sizeof(kSample2)) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 1, "full batch not published");
+    VerifyPayload(gateway.GetLast(kTypePublish), kFirst, sizeof(kFirst));
+
+    VerifyOrQuit(aggregator.Publish(1, kSample3, sizeof(kSample3)) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(aggregator.Publish(1, kSample1, sizeof(kSample1)) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 1, "batch with free space published");
+    VerifyOrQuit(aggregator.Publish(1, kSample2, sizeof(kSample2)) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 2, "batch not published before sample which does not fit");
+    VerifyPayload(gateway.GetLast(kTypePublish), kSecond, sizeof(kSecond));
+    RunFor(100);
+
+    VerifyOrQuit(aggregator.GetCounters(1, counters) == OT_ERROR_NONE, "counters not found");
+    VerifyOrQuit(counters.mSamples == 5 && counters.mPublishes == 2 && counters.mFramesSaved == 2
+        && counters.mFailedFlushes == 0, "wrong counters");
+
+    // Removed topic publishes buffered samples and stops the timer
+    VerifyOrQuit(aggregator.RemoveTopic(1) == OT_ERROR_NONE, "remove topic failed");
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 3, "buffered batch not published on removal");
+    VerifyOrQuit(aggregator.RemoveTopic(1) == OT_ERROR_NOT_FOUND, "removed topic found");
+
+    client.Stop();
+}
+
+// Batch is published when the oldest sample reaches maximal latency, later samples do not postpone it
+static void TestLatencyFlush(void)
+{
+    static const uint8_t kBatch[] = {1, 0x31, 1, 0x32};
+    static const uint8_t kSample1[] = {0x31};
+    static const uint8_t kSample2[] = {0x32};
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    PublishAggregator aggregator(Instance::Get(), client);
+
+    StartAndConnect(client, config, gateway);
+    sAccepted = 0;
+
+    VerifyOrQuit(aggregator.AddTopic(2, kQos1, 32, 500, HandlePublished, nullptr) == OT_ERROR_NONE,
+        "add topic failed");
+    VerifyOrQuit(aggregator.Publish(2, kSample1, sizeof(kSample1)) == OT_ERROR_NONE, "publish failed");
+    RunFor(250);
+    VerifyOrQuit(aggregator.Publish(2, kSample2, sizeof(kSample2)) == OT_ERROR_NONE, "publish failed");
+    RunFor(240);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 0, "batch published before maximal latency");
+    RunFor(20);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 1, "batch not published after maximal latency");
+    VerifyPayload(gateway.GetLast(kTypePublish), kBatch, sizeof(kBatch));
+    RunFor(100);
+    VerifyOrQuit(sAccepted == 1, "batch not acknowledged");
+
+    // Timer is not running without buffered samples
+    RunFor(1000);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 1, "empty batch published");
+
+    aggregator.RemoveTopic(2);
+    client.Stop();
+}
+
+int main(void)
+{
+    TestThresholdFlush();
+    TestLatencyFlush();
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "test_util.hpp"
+#include "mqttsn_publish_scheduler.hpp"
+
+/**
+ * @file
+ *   This file contains test of publish scheduler. Samples are published in the node slot of each period, the slot
+ *   follows extended address of the node and moves to other slot when CCA failures reach the threshold.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+static const otExtAddress kExtAddress = {{0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0}};
+static const uint8_t kPayload[] = {0x31};
+
+// Verify that the message was sent in the first half of the slot
+static void VerifySlot(const TestPacket* aPacket, uint32_t aStart, uint32_t aPeriod, uint16_t aSlotCount,
+    uint16_t aSlot)
+{
+    uint32_t slotLength = aPeriod / aSlotCount;
+    uint32_t offset;
+
+    VerifyOrQuit(aPacket != nullptr, "PUBLISH not sent");
+    offset = (aPacket->mTime - aStart) % aPeriod;
+    VerifyOrQuit(offset / slotLength == aSlot, "PUBLISH sent out of the slot");
+    VerifyOrQuit(offset % slotLength < slotLength / 2, "PUBLISH sent in the second half of the slot");
+}
+
+// The latest sample is published once per period in the slot derived from extended address or slot key
+static void TestSlotSchedule(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    PublishScheduler scheduler(Instance::Get(), client);
+    SchedulerCounters counters;
+    otExtAddress extAddress = kExtAddress;
+    uint16_t slot;
+    uint32_t start;
+    const uint8_t key[] = {'n', 'o', 'd', 'e'};
+
+    SetRandomSeed(1);
+    StartAndConnect(client, config, gateway);
+    VerifyOrQuit(scheduler.SetSlotCount(0) == OT_ERROR_INVALID_ARGS, "zero slot count accepted");
+    VerifyOrQuit(scheduler.SetSlotCount(4) == OT_ERROR_NONE, "slot count not set");
+    slot = scheduler.GetSlot();
+    VerifyOrQuit(slot < 4, "slot out of period");
+
+    VerifyOrQuit(scheduler.AddTopic(1, kQos1, 3, nullptr, nullptr) == OT_ERROR_INVALID_ARGS,
+        "period shorter than slot count accepted");
+    // Null callback is allowed also for QoS level 1, acknowledgements are processed without it
+    start = TimerMilli::GetNow();
+    VerifyOrQuit(scheduler.AddTopic(1, kQos1, 4000, nullptr, nullptr) == OT_ERROR_NONE, "add topic failed");
+    VerifyOrQuit(scheduler.Publish(1, kPayload, sizeof(kPayload)) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(scheduler.Publish(1, kPayload, sizeof(kPayload)) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 0, "sample published before its slot");
+    RunFor(4000);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 1, "sample not published once in the period");
+    VerifySlot(gateway.GetLast(kTypePublish), start, 4000, 4, slot);
+
+    // Nothing is published in the period without sample
+    RunFor(4000);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 1, "published without sample");
+    VerifyOrQuit(scheduler.GetCounters(1, counters) == OT_ERROR_NONE, "counters not found");
+    VerifyOrQuit(counters.mPublishes == 1 && counters.mReplacedSamples == 1 && counters.mFailedPublishes == 0,
+        "wrong counters");
+
+    // Slot follows changed extended address
+    do
+    {
+        extAddress.m8[7]++;
+        SetExtendedAddress(extAddress);
+        PublishScheduler probe(Instance::Get(), client);
+        probe.SetSlotCount(4);
+        slot = probe.GetSlot();
+    } while (slot == scheduler.GetSlot());
+    RunFor(4000);
+    VerifyOrQuit(scheduler.GetSlot() == slot, "slot not derived from changed extended address");
+    VerifyOrQuit(scheduler.Publish(1, kPayload, sizeof(kPayload)) == OT_ERROR_NONE, "publish failed");
+    RunFor(4000);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 2, "sample not published in the new slot");
+    VerifySlot(gateway.GetLast(kTypePublish), start, 4000, 4, slot);
+
+    // Slot key takes precedence over extended address
+    scheduler.SetSlotKey(key, sizeof(key));
+    slot = scheduler.GetSlot();
+    SetExtendedAddress(kExtAddress);
+    RunFor(4000);
+    VerifyOrQuit(scheduler.GetSlot() == slot, "slot key replaced by extended address");
+
+    VerifyOrQuit(scheduler.RemoveTopic(1) == OT_ERROR_NONE, "remove topic failed");
+    VerifyOrQuit(scheduler.RemoveTopic(1) == OT_ERROR_NOT_FOUND, "removed topic found");
+    client.Stop();
+}
+
+// CCA failures reaching the threshold between two passes move all topics to the same other slot
+static void TestCcaSlotMove(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    PublishScheduler scheduler(Instance::Get(), client);
+    uint16_t slot;
+    uint32_t start;
+
+    SetRandomSeed(1);
+    StartAndConnect(client, config, gateway);
+    VerifyOrQuit(scheduler.SetSlotCount(16) == OT_ERROR_NONE, "slot count not set");
+    scheduler.SetCcaThreshold(4);
+    slot = scheduler.GetSlot();
+
+    start = TimerMilli::GetNow();
+    VerifyOrQuit(scheduler.AddTopic(1, kQos0, 1600, nullptr, nullptr) == OT_ERROR_NONE, "add topic failed");
+    VerifyOrQuit(scheduler.AddTopic(2, kQos0, 1600, nullptr, nullptr) == OT_ERROR_NONE, "add topic failed");
+
+    // Failures counted by MAC and reported by application are summed
+    AddCcaFailures(2);
+    scheduler.ReportCcaFailures(1);
+    RunFor(1600);
+    VerifyOrQuit(scheduler.GetSlot() == slot && scheduler.GetSlotChanges() == 0, "slot moved below threshold");
+
+    // Failures below the threshold are forgotten in the next pass
+    AddCcaFailures(3);
+    RunFor(1600);
+    VerifyOrQuit(scheduler.GetSlot() == slot && scheduler.GetSlotChanges() == 0, "slot moved below threshold");
+
+    AddCcaFailures(4);
+    RunFor(1600);
+    VerifyOrQuit(scheduler.GetSlot() != slot && scheduler.GetSlotChanges() == 1, "slot not moved once");
+    slot = scheduler.GetSlot();
+
+    VerifyOrQuit(scheduler.Publish(1, kPayload, sizeof(kPayload)) == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(scheduler.Publish(2, kPayload, sizeof(kPayload)) == OT_ERROR_NONE, "publish failed");
+    RunFor(1600);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 2, "samples not published");
+    VerifySlot(gateway.GetPacket(kTypePublish, 0), start, 1600, 16, slot);
+    VerifySlot(gateway.GetPacket(kTypePublish, 1), start, 1600, 16, slot);
+
+    // Zero threshold disables slot changes
+    scheduler.SetCcaThreshold(0);
+    AddCcaFailures(100);
+    RunFor(1600);
+    VerifyOrQuit(scheduler.GetSlot() == slot && scheduler.GetSlotChanges() == 1, "slot moved without threshold");
+
+    scheduler.RemoveTopic(1);
+    scheduler.RemoveTopic(2);
+    client.Stop();
+}
+
+int main(void)
+{
+    TestSlotSchedule();
+    TestCcaSlotMove();
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "test_util.hpp"
+
+/**
+ * @file
+ *   This file contains test of in-flight window of QoS level 1 and 2 publishes. Publishing beyond the window is
+ *   rejected until acknowledgement opens it and publishes waiting for topic registration are sent within the
+ *   window as acknowledgements arrive.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+static const uint8_t kPayload[] = {0x31};
+
+static MqttsnClient* sClient;
+static uint32_t sWindowOpened[3];
+static uint32_t sAccepted;
+
+static void HandlePublished(ReturnCode aCode, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    if (aCode == kCodeAccepted)
+    {
+        sAccepted++;
+    }
+}
+
+static void HandleWindowOpened(Qos aQos, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    sWindowOpened[aQos]++;
+    // Window is open when the callback is invoked
+    VerifyOrQuit(sClient->Publish(kPayload, sizeof(kPayload), aQos, static_cast<TopicId>(1), HandlePublished, nullptr)
+        == OT_ERROR_NONE, "publish from window opened callback failed");
+}
+
+// Each QoS level has its own window, QoS level 0 is never limited
+static void TestWindowLimit(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    const TopicId topicId = 1;
+
+    config.SetMaxInFlightQos1(1);
+    config.SetMaxInFlightQos2(1);
+    StartAndConnect(client, config, gateway);
+    sClient = &client;
+    memset(sWindowOpened, 0, sizeof(sWindowOpened));
+    sAccepted = 0;
+    client.SetPublishWindowOpenedCallback(HandleWindowOpened, nullptr);
+    gateway.SetLatency(100);
+
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos1, topicId, HandlePublished, nullptr) == OT_ERROR_NONE,
+        "publish failed");
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos1, topicId, HandlePublished, nullptr) == OT_ERROR_BUSY,
+        "QoS 1 window exceeded");
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos2, topicId, HandlePublished, nullptr) == OT_ERROR_NONE,
+        "publish failed");
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos2, topicId, HandlePublished, nullptr) == OT_ERROR_BUSY,
+        "QoS 2 window exceeded");
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos0, topicId, nullptr, nullptr) == OT_ERROR_NONE,
+        "QoS 0 publish limited by window");
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 3, "rejected publish sent");
+
+    // PUBACK opens QoS 1 window, QoS 2 window opens with PUBCOMP after PUBREC and PUBREL exchange
+    RunFor(150);
+    VerifyOrQuit(sWindowOpened[kQos1] == 1 && sWindowOpened[kQos2] == 0, "QoS 1 window not opened by PUBACK");
+    RunFor(100);
+    VerifyOrQuit(sWindowOpened[kQos2] == 1, "QoS 2 window not opened by PUBCOMP");
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 5, "publish from callback not sent");
+
+    // Window opened callback is invoked only after rejected publish
+    RunFor(1000);
+    VerifyOrQuit(sWindowOpened[kQos1] == 1 && sWindowOpened[kQos2] == 1, "window opened without rejected publish");
+    VerifyOrQuit(sAccepted == 4, "publishes not acknowledged");
+
+    client.Stop();
+}
+
+// Publishes waiting for REGACK are sent one by one when the window admits only one message
+static void TestPendingDrain(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    PublishMessage publish;
+    uint16_t messageId = 0;
+
+    config.SetMaxInFlightQos1(1);
+    StartAndConnect(client, config, gateway);
+    sAccepted = 0;
+    gateway.SetLatency(100);
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        VerifyOrQuit(client.Publish("sensors/light", kPayload, sizeof(kPayload), kQos1, HandlePublished, nullptr)
+            == OT_ERROR_NONE, "publish by name failed");
+    }
+    VerifyOrQuit(gateway.GetCount(kTypeRegister) == 1 && gateway.GetCount(kTypePublish) == 0,
+        "publishes not waiting for registration");
+
+    // REGACK at 100 ms sends the first publish, each PUBACK 100 ms later sends the next one
+    for (uint8_t i = 1; i <= 3; i++)
+    {
+        RunFor(100);
+        VerifyOrQuit(gateway.GetCount(kTypePublish) == i, "pending publish not sent within window");
+        VerifyOrQuit(sAccepted == i - 1u, "publish sent before previous one was acknowledged");
+        VerifyOrQuit(publish.Deserialize(gateway.GetLast(kTypePublish)->mData, gateway.GetLast(kTypePublish)->mLength)
+            == OT_ERROR_NONE, "invalid PUBLISH");
+        VerifyOrQuit(publish.GetTopicIdType() == kTopicId && publish.GetTopicId() == 1, "topic ID not updated");
+        VerifyOrQuit(i == 1 || publish.GetMessageId() == messageId + 1, "pending publishes sent out of order");
+        messageId = publish.GetMessageId();
+    }
+    RunFor(200);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 3 && sAccepted == 3, "pending publishes not acknowledged");
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestWindowLimit();
+    TestPendingDrain();
+    printf("All tests passed\n");
+    return 0;
+}
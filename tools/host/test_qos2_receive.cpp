@@ -0,0 +1,133 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_util.hpp"
+
+/**
+ * @file
+ *   This file contains test of QoS level 2 PUBLISH reception. Retained PUBREC filters duplicate PUBLISH and it is
+ *   sent again when the gateway retransmits PUBLISH, it is dropped after its lifetime when PUBREL is lost.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+static uint32_t sReceivedCount = 0;
+
+static ReturnCode HandlePublishReceived(const Message &aMessage, uint16_t aPayloadOffset, int32_t aPayloadLength,
+    TopicIdType aTopicIdType, TopicId aTopicId, ShortTopicNameString aShortTopicName, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aMessage);
+    OT_UNUSED_VARIABLE(aPayloadOffset);
+    OT_UNUSED_VARIABLE(aPayloadLength);
+    OT_UNUSED_VARIABLE(aTopicIdType);
+    OT_UNUSED_VARIABLE(aTopicId);
+    OT_UNUSED_VARIABLE(aShortTopicName);
+    OT_UNUSED_VARIABLE(aContext);
+    sReceivedCount++;
+    return kCodeAccepted;
+}
+
+static PublishMessage Qos2Publish(bool aDupFlag, uint16_t aMessageId)
+{
+    static const uint8_t kPayload[] = {0x31};
+
+    return PublishMessage(aDupFlag, false, kQos2, aMessageId, kTopicId, 1, nullptr, kPayload, sizeof(kPayload));
+}
+
+// Lost PUBREC is sent again for retransmitted PUBLISH, publication is delivered to application once
+static void TestDuplicateAnsweredWithPubrec(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    PubrecMessage pubrec;
+
+    sReceivedCount = 0;
+    client.SetPublishReceivedCallback(HandlePublishReceived, nullptr);
+    StartAndConnect(client, config, gateway);
+
+    VerifyOrQuit(gateway.Send(Qos2Publish(false, 7)) == OT_ERROR_NONE, "publish not delivered");
+    VerifyOrQuit(sReceivedCount == 1, "publish not received");
+    VerifyOrQuit(gateway.GetCount(kTypePubrec) == 1, "PUBREC not sent");
+
+    // PUBREC was lost, gateway retransmits PUBLISH with DUP flag
+    gateway.Send(Qos2Publish(true, 7));
+    VerifyOrQuit(sReceivedCount == 1, "duplicate delivered to application");
+    VerifyOrQuit(gateway.GetCount(kTypePubrec) == 2, "PUBREC not sent again");
+    VerifyOrQuit(pubrec.Deserialize(gateway.GetLast(kTypePubrec)->mData, gateway.GetLast(kTypePubrec)->mLength)
+        == OT_ERROR_NONE && pubrec.GetMessageId() == 7, "wrong PUBREC sent again");
+
+    // PUBLISH with the same message ID without DUP flag is not answered before PUBREL
+    gateway.Send(Qos2Publish(false, 7));
+    VerifyOrQuit(sReceivedCount == 1, "duplicate delivered to application");
+    VerifyOrQuit(gateway.GetCount(kTypePubrec) == 2, "PUBREC sent for PUBLISH without DUP flag");
+
+    // PUBREL completes the exchange, the message ID can be used again
+    gateway.Send(PubrelMessage(7));
+    VerifyOrQuit(gateway.GetCount(kTypePubcomp) == 1, "PUBCOMP not sent");
+    gateway.Send(Qos2Publish(false, 7));
+    VerifyOrQuit(sReceivedCount == 2, "new publish not received");
+
+    client.Stop();
+}
+
+// Retained PUBREC is dropped after its lifetime when PUBREL is lost
+static void TestPubrecLifetime(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+
+    sReceivedCount = 0;
+    config.SetKeepAlive(600);
+    client.SetPublishReceivedCallback(HandlePublishReceived, nullptr);
+    StartAndConnect(client, config, gateway);
+
+    gateway.Send(Qos2Publish(false, 9));
+    RunFor(kPubrecLifetime - 100);
+    gateway.Send(Qos2Publish(true, 9));
+    VerifyOrQuit(sReceivedCount == 1, "duplicate delivered before PUBREC lifetime");
+
+    RunFor(200);
+    gateway.Send(Qos2Publish(false, 9));
+    VerifyOrQuit(sReceivedCount == 2, "PUBREC retained after its lifetime");
+    VerifyOrQuit(client.GetState() == kStateActive, "client disconnected by PUBREC lifetime");
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestDuplicateAnsweredWithPubrec();
+    TestPubrecLifetime();
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "test_util.hpp"
+
+/**
+ * @file
+ *   This file contains test of retransmission of unacknowledged messages. Timeout is doubled with each
+ *   retransmission, retransmitted PUBLISH and SUBSCRIBE carry DUP flag and the message times out after the last
+ *   retransmission.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+static const uint8_t kPayload[] = {0x31};
+
+static ReturnCode sPublishCode;
+static uint32_t sPublishCount;
+static ReturnCode sSubscribeCode;
+
+static void HandlePublished(ReturnCode aCode, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    sPublishCode = aCode;
+    sPublishCount++;
+}
+
+static void HandleSubscribed(ReturnCode aCode, TopicId aTopicId, Qos aQos, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aTopicId);
+    OT_UNUSED_VARIABLE(aQos);
+    OT_UNUSED_VARIABLE(aContext);
+    sSubscribeCode = aCode;
+}
+
+// Unacknowledged PUBLISH is sent again with DUP flag after doubled timeouts and then it times out
+static void TestPublishBackoff(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    ClientStats stats;
+    PublishMessage publish;
+    uint16_t messageId = 0;
+    uint32_t timeout;
+    uint32_t start;
+
+    config.SetKeepAlive(600);
+    config.SetRetransmissionJitter(0);
+    config.SetRetransmissionCount(3);
+    StartAndConnect(client, config, gateway);
+    client.GetStats(stats);
+    timeout = stats.mRetransmissionTimeout;
+
+    gateway.SetAnswering(false);
+    sPublishCount = 0;
+    start = TimerMilli::GetNow();
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos1, static_cast<TopicId>(1), HandlePublished, nullptr)
+        == OT_ERROR_NONE, "publish failed");
+    // Retransmissions follow after timeout, 2 * timeout and 4 * timeout, timeout after 8 * timeout
+    RunFor(15 * timeout - 1);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 4, "wrong number of retransmissions");
+    VerifyOrQuit(sPublishCount == 0, "message timed out before the last retransmission timeout");
+    for (uint16_t i = 0; i < 4; i++)
+    {
+        const TestPacket* packet = gateway.GetPacket(kTypePublish, i);
+
+        VerifyOrQuit(packet->mTime - start == ((1u << i) - 1) * timeout, "retransmission timeout not doubled");
+        VerifyOrQuit(publish.Deserialize(packet->mData, packet->mLength) == OT_ERROR_NONE, "invalid PUBLISH");
+        VerifyOrQuit(publish.GetDupFlag() == (i > 0), "wrong DUP flag");
+        if (i == 0)
+        {
+            messageId = publish.GetMessageId();
+        }
+        VerifyOrQuit(publish.GetMessageId() == messageId, "message ID changed in retransmission");
+    }
+    RunFor(1);
+    VerifyOrQuit(sPublishCount == 1 && sPublishCode == kCodeTimeout, "message did not time out");
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 4, "message sent after timeout");
+
+    client.Stop();
+}
+
+// Retransmitted SUBSCRIBE carries DUP flag and acknowledgement of retransmission stops further sending
+static void TestSubscribeAcknowledged(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    ClientStats stats;
+    SubscribeMessage subscribe;
+    uint32_t timeout;
+
+    config.SetKeepAlive(600);
+    config.SetRetransmissionJitter(0);
+    StartAndConnect(client, config, gateway);
+    client.GetStats(stats);
+    timeout = stats.mRetransmissionTimeout;
+
+    gateway.SetAnswering(false);
+    sSubscribeCode = kCodeTimeout;
+    VerifyOrQuit(client.Subscribe("commands", false, kQos1, HandleSubscribed, nullptr) == OT_ERROR_NONE,
+        "subscribe failed");
+    RunFor(timeout);
+    VerifyOrQuit(gateway.GetCount(kTypeSubscribe) == 2, "SUBSCRIBE not retransmitted");
+    VerifyOrQuit(subscribe.Deserialize(gateway.GetPacket(kTypeSubscribe, 0)->mData,
+        gateway.GetPacket(kTypeSubscribe, 0)->mLength) == OT_ERROR_NONE && !subscribe.GetDupFlag(),
+        "DUP flag on first SUBSCRIBE");
+    VerifyOrQuit(subscribe.Deserialize(gateway.GetPacket(kTypeSubscribe, 1)->mData,
+        gateway.GetPacket(kTypeSubscribe, 1)->mLength) == OT_ERROR_NONE && subscribe.GetDupFlag(),
+        "missing DUP flag on retransmitted SUBSCRIBE");
+
+    gateway.SetAnswering(true);
+    RunFor(2 * timeout + 100);
+    VerifyOrQuit(gateway.GetCount(kTypeSubscribe) == 3 && sSubscribeCode == kCodeAccepted,
+        "retransmitted SUBSCRIBE not acknowledged");
+    RunFor(8 * timeout);
+    VerifyOrQuit(gateway.GetCount(kTypeSubscribe) == 3 && client.GetState() == kStateActive,
+        "acknowledged SUBSCRIBE retransmitted");
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestPublishBackoff();
+    TestSubscribeAcknowledged();
+    printf("All tests passed\n");
+    return 0;
+}
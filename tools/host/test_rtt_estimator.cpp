@@ -0,0 +1,143 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "test_util.hpp"
+
+/**
+ * @file
+ *   This file contains test of round trip time estimator. Smoothed RTT and its variation follow Jacobson/Karels
+ *   algorithm, retransmission timeout is derived from them and acknowledgements of retransmitted messages are
+ *   not measured (Karn's algorithm).
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+static const uint8_t kPayload[] = {0x31};
+
+static uint32_t sAccepted;
+
+static void HandlePublished(ReturnCode aCode, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    if (aCode == kCodeAccepted)
+    {
+        sAccepted++;
+    }
+}
+
+// Publish one message with given gateway latency and wait for its acknowledgement
+static void PublishWithLatency(MqttsnClient &aClient, TestGateway &aGateway, uint32_t aLatency)
+{
+    uint32_t accepted = sAccepted;
+
+    aGateway.SetLatency(aLatency);
+    VerifyOrQuit(aClient.Publish(kPayload, sizeof(kPayload), kQos1, static_cast<TopicId>(1), HandlePublished, nullptr)
+        == OT_ERROR_NONE, "publish failed");
+    while (sAccepted == accepted)
+    {
+        RunFor(10);
+    }
+}
+
+// Estimate starts from configured timeout, follows measured samples and ignores retransmitted messages
+static void TestEstimate(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    ClientStats stats;
+
+    config.SetKeepAlive(600);
+    config.SetRetransmissionTimeout(3);
+    config.SetRetransmissionJitter(0);
+    StartAndConnect(client, config, gateway);
+    sAccepted = 0;
+
+    client.GetStats(stats);
+    VerifyOrQuit(stats.mRttSamples == 0 && stats.mSmoothedRtt == 0, "round trip measured before first acknowledgement");
+    VerifyOrQuit(stats.mRetransmissionTimeout == 3000, "configured timeout not used without measurement");
+
+    // First sample replaces the estimate: SRTT = RTT, RTTVAR = RTT / 2, RTO = SRTT + 4 * RTTVAR
+    PublishWithLatency(client, gateway, 1000);
+    client.GetStats(stats);
+    VerifyOrQuit(stats.mRttSamples == 1 && stats.mSmoothedRtt == 1000 && stats.mRttVariation == 500,
+        "wrong first estimate");
+    VerifyOrQuit(stats.mRetransmissionTimeout == 3000, "wrong timeout after first sample");
+
+    // RTTVAR = 3/4 * 500 + 1/4 * |1000 - 2000|, SRTT = 7/8 * 1000 + 1/8 * 2000
+    PublishWithLatency(client, gateway, 2000);
+    client.GetStats(stats);
+    VerifyOrQuit(stats.mRttSamples == 2 && stats.mSmoothedRtt == 1125 && stats.mRttVariation == 625,
+        "wrong smoothed estimate");
+    VerifyOrQuit(stats.mRetransmissionTimeout == 3625, "wrong timeout after second sample");
+
+    // Message is retransmitted after the derived timeout and its acknowledgement is not measured
+    gateway.Clear();
+    PublishWithLatency(client, gateway, 5000);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 2
+        && gateway.GetPacket(kTypePublish, 1)->mTime - gateway.GetPacket(kTypePublish, 0)->mTime == 3625,
+        "message not retransmitted after estimated timeout");
+    client.GetStats(stats);
+    VerifyOrQuit(stats.mRttSamples == 2 && stats.mSmoothedRtt == 1125 && stats.mRttVariation == 625,
+        "acknowledgement of retransmitted message measured");
+    RunFor(10000);
+
+    client.Stop();
+}
+
+// Timeout derived from short round trip is not shorter than minimal retransmission timeout
+static void TestMinimalTimeout(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    ClientStats stats;
+
+    StartAndConnect(client, config, gateway);
+    sAccepted = 0;
+
+    PublishWithLatency(client, gateway, 20);
+    client.GetStats(stats);
+    VerifyOrQuit(stats.mSmoothedRtt == 20 && stats.mRetransmissionTimeout == kRetransmissionTimeoutMin,
+        "timeout below minimum");
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestEstimate();
+    TestMinimalTimeout();
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_util.hpp"
+#include "common/timer.hpp"
+
+/**
+ * @file
+ *   This file contains test of expanding ring gateway search. Hop limit of SEARCHGW messages is doubled while
+ *   no gateway answers and the search ends early when a gateway answers or advertises itself.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+enum
+{
+    kGatewayId = 7,
+    kMaxRadius = 8
+};
+
+static uint32_t sFinishedCount;
+static uint32_t sFinishedTime;
+static const GatewayTable::Entry* sFinishedGateway;
+
+static void HandleFinished(const GatewayTable::Entry* aGateway, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    sFinishedCount++;
+    sFinishedTime = TimerMilli::GetNow();
+    sFinishedGateway = aGateway;
+}
+
+static void StartSearch(MqttsnClient &aClient, TestGateway &aMulticast, uint32_t aMaxJitter)
+{
+    sFinishedCount = 0;
+    sFinishedGateway = nullptr;
+    VerifyOrQuit(aClient.Start(kTestClientPort) == OT_ERROR_NONE, "client not started");
+    VerifyOrQuit(aClient.SearchGatewayRing(aMulticast.GetAddress(), aMulticast.GetPort(), kMaxRadius, aMaxJitter,
+        HandleFinished, nullptr) == OT_ERROR_NONE, "search failed");
+    VerifyOrQuit(aClient.SearchGatewayRing(aMulticast.GetAddress(), aMulticast.GetPort(), kMaxRadius, aMaxJitter,
+        HandleFinished, nullptr) == OT_ERROR_BUSY, "second search started");
+}
+
+// Unanswered search expands the ring up to the maximal radius, each ring waits longer
+static void TestExpandingRing(void)
+{
+    static const uint8_t kRadiuses[] = {1, 2, 4, 8};
+    static const uint32_t kTimes[] = {0, 250, 750, 1750};
+    TestGateway multicast("ff03::1", 10000);
+    MqttsnClient client(Instance::Get());
+    uint32_t startTime = TimerMilli::GetNow();
+
+    multicast.SetAnswering(false);
+    StartSearch(client, multicast, 0);
+    RunFor(10000);
+
+    VerifyOrQuit(multicast.GetCount(kTypeSearchGw) == sizeof(kRadiuses), "wrong SEARCHGW count");
+    for (uint16_t i = 0; i < sizeof(kRadiuses); i++)
+    {
+        const TestPacket* packet = multicast.GetPacket(kTypeSearchGw, i);
+
+        VerifyOrQuit(packet->mHopLimit == kRadiuses[i], "wrong hop limit");
+        VerifyOrQuit(packet->mTime - startTime == kTimes[i], "wrong ring timeout");
+    }
+    VerifyOrQuit(sFinishedCount == 1 && sFinishedGateway == nullptr, "unanswered search not finished");
+    VerifyOrQuit(sFinishedTime - startTime == 3750, "last ring not waited");
+
+    client.Stop();
+}
+
+// Ring is not expanded after a gateway answered
+static void TestAnsweredRing(void)
+{
+    TestGateway multicast("ff03::1", 10000);
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    uint32_t startTime = TimerMilli::GetNow();
+
+    multicast.SetAnswering(false);
+    StartSearch(client, multicast, 0);
+    RunFor(300);
+    VerifyOrQuit(multicast.GetCount(kTypeSearchGw) == 2, "ring not expanded");
+    VerifyOrQuit(gateway.Send(GwInfoMessage(kGatewayId, false, gateway.GetAddress(), 0)) == OT_ERROR_NONE,
+        "GWINFO not delivered");
+    RunFor(10000);
+
+    VerifyOrQuit(multicast.GetCount(kTypeSearchGw) == 2, "ring expanded after answer");
+    VerifyOrQuit(sFinishedCount == 1 && sFinishedTime - startTime == 750, "search not finished with answered ring");
+    VerifyOrQuit(sFinishedGateway != nullptr && sFinishedGateway->GetAddress() == gateway.GetAddress(),
+        "answering gateway not reported");
+
+    client.Stop();
+}
+
+// Advertisement heard during random delay suppresses the search
+static void TestAdvertiseDuringDelay(void)
+{
+    TestGateway multicast("ff03::1", 10000);
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+
+    multicast.SetAnswering(false);
+    StartSearch(client, multicast, 1000);
+    VerifyOrQuit(gateway.Send(AdvertiseMessage(kGatewayId, 900)) == OT_ERROR_NONE, "ADVERTISE not delivered");
+    RunFor(10000);
+
+    VerifyOrQuit(multicast.GetCount(kTypeSearchGw) == 0, "SEARCHGW sent after advertisement");
+    VerifyOrQuit(sFinishedCount == 1 && sFinishedGateway != nullptr
+        && sFinishedGateway->GetAddress() == gateway.GetAddress(), "advertised gateway not reported");
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestExpandingRing();
+    TestAnsweredRing();
+    TestAdvertiseDuringDelay();
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_util.hpp"
+
+/**
+ * @file
+ *   This file contains test of session restore after reconnection. REGISTER and SUBSCRIBE messages of the
+ *   previous session are pipelined right after CONNACK up to the in-flight limit instead of waiting for each
+ *   acknowledgement.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+enum
+{
+    kLatency = 100,
+    kRegisteredTopics = 3,
+    kSubscribedTopics = 2
+};
+
+static uint32_t sRestoredCount;
+static ReturnCode sRestoredCode;
+static uint32_t sRestoredDuration;
+static uint32_t sAckCount;
+
+static void HandleRestored(ReturnCode aCode, uint32_t aDuration, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    sRestoredCount++;
+    sRestoredCode = aCode;
+    sRestoredDuration = aDuration;
+}
+
+static void HandleRegistered(ReturnCode aCode, TopicId aTopicId, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aTopicId);
+    OT_UNUSED_VARIABLE(aContext);
+    VerifyOrQuit(aCode == kCodeAccepted, "topic not registered");
+    sAckCount++;
+}
+
+static void HandleSubscribed(ReturnCode aCode, TopicId aTopicId, Qos aQos, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aTopicId);
+    OT_UNUSED_VARIABLE(aQos);
+    OT_UNUSED_VARIABLE(aContext);
+    VerifyOrQuit(aCode == kCodeAccepted, "topic not subscribed");
+    sAckCount++;
+}
+
+// Connect the client, create session with registered and subscribed topics and reconnect with clean session
+static void ConnectAndReconnect(MqttsnClient &aClient, MqttsnConfig &aConfig, TestGateway &aGateway)
+{
+    char name[kMaxTopicNameLength];
+
+    aConfig.SetKeepAlive(600);
+    aConfig.SetCleanSession(true);
+    aConfig.SetRestoreSession(true);
+    aClient.SetSessionRestoredCallback(HandleRestored, nullptr);
+    StartAndConnect(aClient, aConfig, aGateway);
+    sRestoredCount = 0;
+
+    sAckCount = 0;
+    for (uint8_t i = 0; i < kRegisteredTopics; i++)
+    {
+        snprintf(name, sizeof(name), "sensors/%u/temperature", i);
+        VerifyOrQuit(aClient.Register(name, HandleRegistered, nullptr) == OT_ERROR_NONE, "register failed");
+    }
+    for (uint8_t i = 0; i < kSubscribedTopics; i++)
+    {
+        snprintf(name, sizeof(name), "actuators/%u/state", i);
+        VerifyOrQuit(aClient.Subscribe(name, false, kQos1, HandleSubscribed, nullptr) == OT_ERROR_NONE,
+            "subscribe failed");
+    }
+    RunFor(1000);
+    VerifyOrQuit(sAckCount == kRegisteredTopics + kSubscribedTopics, "session not created");
+
+    VerifyOrQuit(aClient.Disconnect() == OT_ERROR_NONE, "disconnect failed");
+    RunFor(1000);
+    VerifyOrQuit(aClient.GetState() == kStateDisconnected, "client not disconnected");
+
+    aGateway.Clear();
+    aGateway.SetLatency(kLatency);
+    VerifyOrQuit(aClient.Connect(aConfig) == OT_ERROR_NONE, "connect failed");
+    RunFor(10 * kLatency);
+}
+
+// All topics are restored in one round trip after CONNACK
+static void TestPipelinedRestore(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    ClientStats stats;
+    uint32_t connackTime;
+
+    ConnectAndReconnect(client, config, gateway);
+    connackTime = gateway.GetPacket(kTypeConnect, 0)->mTime + kLatency;
+
+    VerifyOrQuit(gateway.GetCount(kTypeRegister) == kRegisteredTopics, "registrations not restored");
+    VerifyOrQuit(gateway.GetCount(kTypeSubscribe) == kSubscribedTopics, "subscriptions not restored");
+    for (uint16_t i = 0; i < kRegisteredTopics; i++)
+    {
+        VerifyOrQuit(gateway.GetPacket(kTypeRegister, i)->mTime == connackTime, "REGISTER waited for acknowledgement");
+    }
+    for (uint16_t i = 0; i < kSubscribedTopics; i++)
+    {
+        VerifyOrQuit(gateway.GetPacket(kTypeSubscribe, i)->mTime == connackTime,
+            "SUBSCRIBE waited for acknowledgement");
+    }
+
+    client.GetStats(stats);
+    VerifyOrQuit(sRestoredCount == 1 && sRestoredCode == kCodeAccepted, "restore not reported");
+    VerifyOrQuit(sRestoredDuration == 2 * kLatency && stats.mSessionRestoreTime == 2 * kLatency,
+        "restore took more than one round trip after CONNACK");
+    VerifyOrQuit(stats.mSessionRestoreMessages == kRegisteredTopics + kSubscribedTopics, "wrong restore message count");
+
+    client.Stop();
+}
+
+// Restore requests do not exceed the in-flight limit, next request is sent with each acknowledgement
+static void TestInFlightLimit(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    ClientStats stats;
+
+    config.SetMaxInFlightQos1(2);
+    ConnectAndReconnect(client, config, gateway);
+
+    // Five requests are sent in three rounds of two, two and one
+    client.GetStats(stats);
+    VerifyOrQuit(sRestoredCount == 1 && sRestoredCode == kCodeAccepted, "restore not reported");
+    VerifyOrQuit(stats.mSessionRestoreMessages == kRegisteredTopics + kSubscribedTopics, "wrong restore message count");
+    VerifyOrQuit(stats.mSessionRestoreTime == 4 * kLatency, "in-flight limit not respected");
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestPipelinedRestore();
+    TestInFlightLimit();
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "test_util.hpp"
+#include "openthread/platform/settings.h"
+
+/**
+ * @file
+ *   This file contains test of persistent session storage on file settings backend. It checks that stored
+ *   topics survive reboot and that the number of settings writes grows linearly with the number of changed
+ *   topics.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Mqttsn;
+
+static const char* sSettingsPath = "test_session_store.settings";
+
+static void SetBinding(SessionStore::Binding &aBinding, uint16_t aPort)
+{
+    memset(&aBinding, 0, sizeof(aBinding));
+    aBinding.mAddress[0] = 0xfd;
+    aBinding.mAddress[15] = 0x01;
+    aBinding.mPort = aPort;
+    strncpy(aBinding.mClientId, "test-client", sizeof(aBinding.mClientId) - 1);
+}
+
+static void AddTopics(TopicRegistry &aRegistry, uint8_t aCount)
+{
+    char name[kMaxTopicNameLength];
+
+    for (uint8_t i = 0; i < aCount; i++)
+    {
+        snprintf(name, sizeof(name), "sensors/node/%u/temperature", i);
+        VerifyOrQuit(aRegistry.Add(name) != nullptr, "topic not added");
+    }
+}
+
+// Topics stored one by one like REGACKs and SUBACKs of batch requests or session restore
+static void TestLinearWrites(void)
+{
+    otInstance* instance = &Instance::Get();
+    SessionStore store(instance);
+    SessionStore::Binding binding;
+    TopicRegistry registry;
+    uint32_t writes;
+
+    SetBinding(binding, 10000);
+    AddTopics(registry, kMaxRegisteredTopics);
+
+    writes = Host::GetSettingsWriteCount();
+    for (uint8_t i = 0; i < registry.GetCount(); i++)
+    {
+        TopicRegistry::Entry* entry = registry.GetEntry(i);
+        entry->SetRegistered(static_cast<TopicId>(i + 1));
+        VerifyOrQuit(store.Save(binding, *entry) == OT_ERROR_NONE, "save failed");
+        entry->SetSubscribed(kQos1);
+        VerifyOrQuit(store.Save(binding, *entry) == OT_ERROR_NONE, "save failed");
+    }
+    writes = Host::GetSettingsWriteCount() - writes;
+    printf("%u topics stored with %u settings writes\n", registry.GetCount(), writes);
+    // Each topic is added once after its registration and replaced once after its subscription
+    VerifyOrQuit(writes <= 1u + 3u * registry.GetCount(), "settings writes are not linear");
+
+    // Storing unchanged topics again does not write
+    writes = Host::GetSettingsWriteCount();
+    for (uint8_t i = 0; i < registry.GetCount(); i++)
+    {
+        VerifyOrQuit(store.Save(binding, *registry.GetEntry(i)) == OT_ERROR_NONE, "save failed");
+    }
+    VerifyOrQuit(Host::GetSettingsWriteCount() == writes, "unchanged topic written");
+}
+
+// Stored session is loaded after reboot from the settings file
+static void TestRestoreAfterReboot(void)
+{
+    otInstance* instance = &Instance::Get();
+    SessionStore store(instance);
+    SessionStore::Binding binding;
+    TopicRegistry registry;
+    uint32_t writes;
+
+    otPlatSettingsInit(instance);
+    SetBinding(binding, 10000);
+    VerifyOrQuit(store.Restore(binding, registry) == OT_ERROR_NONE, "session not restored");
+    VerifyOrQuit(registry.GetCount() == kMaxRegisteredTopics, "topic count differs");
+    for (uint8_t i = 0; i < registry.GetCount(); i++)
+    {
+        TopicRegistry::Entry* entry = registry.Find(static_cast<TopicId>(i + 1));
+        VerifyOrQuit(entry != nullptr && entry->IsRegistered(), "topic ID not restored");
+        VerifyOrQuit(entry->IsSubscribed() && entry->GetSubscribeQos() == kQos1, "subscription not restored");
+    }
+
+    // Changed topic replaces only its own record
+    writes = Host::GetSettingsWriteCount();
+    registry.GetEntry(3)->SetRegistered(100);
+    VerifyOrQuit(store.Save(binding, *registry.GetEntry(3)) == OT_ERROR_NONE, "save failed");
+    registry.GetEntry(4)->SetUnsubscribed();
+    registry.GetEntry(4)->SetUnregistered();
+    VerifyOrQuit(store.Save(binding, *registry.GetEntry(4)) == OT_ERROR_NONE, "save failed");
+    VerifyOrQuit(Host::GetSettingsWriteCount() - writes == 3, "changed topics not written once");
+
+    otPlatSettingsInit(instance);
+    registry.Clear();
+    VerifyOrQuit(store.Restore(binding, registry) == OT_ERROR_NONE, "session not restored");
+    VerifyOrQuit(registry.GetCount() == kMaxRegisteredTopics - 1, "removed topic restored");
+    VerifyOrQuit(registry.Find(100) != nullptr, "changed topic ID not restored");
+}
+
+// Session of another gateway is not restored and its topics are dropped on first store
+static void TestBinding(void)
+{
+    otInstance* instance = &Instance::Get();
+    SessionStore store(instance);
+    SessionStore::Binding binding;
+    TopicRegistry registry;
+
+    SetBinding(binding, 10001);
+    VerifyOrQuit(store.Restore(binding, registry) == OT_ERROR_NOT_FOUND, "session of other gateway restored");
+    VerifyOrQuit(registry.GetCount() == 0, "topics of other gateway restored");
+
+    AddTopics(registry, 1);
+    registry.GetEntry(0)->SetRegistered(7);
+    VerifyOrQuit(store.Save(binding, *registry.GetEntry(0)) == OT_ERROR_NONE, "save failed");
+
+    registry.Clear();
+    VerifyOrQuit(store.Restore(binding, registry) == OT_ERROR_NONE, "session not restored");
+    VerifyOrQuit(registry.GetCount() == 1 && registry.Find(7) != nullptr, "old topics not dropped");
+
+    store.Delete();
+    registry.Clear();
+    VerifyOrQuit(store.Restore(binding, registry) == OT_ERROR_NOT_FOUND, "deleted session restored");
+}
+
+int main(void)
+{
+    remove(sSettingsPath);
+    Host::SetSettingsFile(sSettingsPath);
+    otPlatSettingsInit(&Instance::Get());
+
+    TestLinearWrites();
+    TestRestoreAfterReboot();
+    TestBinding();
+
+    remove(sSettingsPath);
+    printf("All tests passed\n");
+    return 0;
+}
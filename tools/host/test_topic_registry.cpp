@@ -0,0 +1,179 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "test_util.hpp"
+
+/**
+ * @file
+ *   This file contains test of publishing by topic name. Publish waits for automatic REGISTER, topic ID is
+ *   reused by later publishes, short topic name is sent with short topic ID type and messages without callback
+ *   time out without error.
+ *
+ */
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+static const uint8_t kPayload[] = {0x31};
+
+static ReturnCode sPublishCode;
+
+static void HandlePublished(ReturnCode aCode, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aContext);
+    sPublishCode = aCode;
+}
+
+static void HandleBatch(const TopicResult* aResults, uint8_t aCount, void* aContext)
+{
+    OT_UNUSED_VARIABLE(aResults);
+    OT_UNUSED_VARIABLE(aCount);
+    OT_UNUSED_VARIABLE(aContext);
+}
+
+// Name with null terminator must fit kMaxTopicNameLength in all name based requests
+static void TestNameLength(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    char name[kMaxTopicNameLength + 1];
+    const char* names[] = {name};
+
+    StartAndConnect(client, config, gateway);
+
+    memset(name, 'a', kMaxTopicNameLength);
+    name[kMaxTopicNameLength] = '\0';
+    VerifyOrQuit(client.Publish(name, kPayload, sizeof(kPayload), kQos0, nullptr, nullptr) == OT_ERROR_INVALID_ARGS,
+        "too long name published");
+    VerifyOrQuit(client.RegisterBatch(names, 1, HandleBatch, nullptr) == OT_ERROR_INVALID_ARGS,
+        "too long name registered");
+
+    name[kMaxTopicNameLength - 1] = '\0';
+    VerifyOrQuit(client.Publish(name, kPayload, sizeof(kPayload), kQos0, nullptr, nullptr) == OT_ERROR_NONE,
+        "longest name not published");
+    VerifyOrQuit(client.RegisterBatch(names, 1, HandleBatch, nullptr) == OT_ERROR_NONE, "longest name not registered");
+
+    client.Stop();
+}
+
+// Publish by name waits for REGISTER and later publish uses the registered topic ID
+static void TestPublishByName(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    PublishMessage publish;
+
+    StartAndConnect(client, config, gateway);
+
+    VerifyOrQuit(client.Publish("sensors/temperature", kPayload, sizeof(kPayload), kQos1, nullptr, nullptr)
+        == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(gateway.GetCount(kTypeRegister) == 1 && gateway.GetCount(kTypePublish) == 0,
+        "publish not waiting for registration");
+    RunFor(100);
+    VerifyOrQuit(gateway.GetCount(kTypePublish) == 1, "waiting publish not sent after REGACK");
+
+    VerifyOrQuit(client.Publish("sensors/temperature", kPayload, sizeof(kPayload), kQos1, nullptr, nullptr)
+        == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(gateway.GetCount(kTypeRegister) == 1 && gateway.GetCount(kTypePublish) == 2,
+        "registered topic registered again");
+    publish.Deserialize(gateway.GetLast(kTypePublish)->mData, gateway.GetLast(kTypePublish)->mLength);
+    VerifyOrQuit(publish.GetTopicIdType() == kTopicId && publish.GetTopicId() == 1, "wrong topic ID");
+
+    client.Stop();
+}
+
+// Short topic name is sent in the topic ID field as is with short topic ID type
+static void TestPublishShortTopicName(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+    PublishMessage publish;
+    const TestPacket* packet;
+
+    StartAndConnect(client, config, gateway);
+
+    sPublishCode = kCodeRejectedCongestion;
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos1, "ab", HandlePublished, nullptr) == OT_ERROR_NONE,
+        "publish failed");
+    packet = gateway.GetLast(kTypePublish);
+    VerifyOrQuit(packet != nullptr, "PUBLISH not sent");
+    // Length, type, flags with short topic ID type and the name in network order
+    VerifyOrQuit(packet->mData[1] == kTypePublish && (packet->mData[2] & 0x03) == 0x02, "wrong topic ID type");
+    VerifyOrQuit(packet->mData[3] == 'a' && packet->mData[4] == 'b', "wrong short topic name");
+    VerifyOrQuit(publish.Deserialize(packet->mData, packet->mLength) == OT_ERROR_NONE, "invalid PUBLISH");
+    VerifyOrQuit(publish.GetTopicIdType() == kShortTopicName
+        && strcmp(publish.GetShortTopicName().AsCString(), "ab") == 0, "wrong short topic name");
+    RunFor(100);
+    VerifyOrQuit(sPublishCode == kCodeAccepted && gateway.GetCount(kTypePublish) == 1, "PUBLISH not acknowledged");
+
+    client.Stop();
+}
+
+// Messages without callback time out when the gateway stops answering
+static void TestTimeoutWithoutCallback(void)
+{
+    TestGateway gateway("fd00::1", 10000);
+    MqttsnClient client(Instance::Get());
+    MqttsnConfig config;
+
+    config.SetKeepAlive(600);
+    StartAndConnect(client, config, gateway);
+
+    gateway.SetAnswering(false);
+    // Waiting for registration, waiting for acknowledgement of QoS 1 and QoS 2 publish and of subscription
+    VerifyOrQuit(client.Publish("sensors/humidity", kPayload, sizeof(kPayload), kQos1, nullptr, nullptr)
+        == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos1, static_cast<TopicId>(1), nullptr, nullptr)
+        == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(client.Publish(kPayload, sizeof(kPayload), kQos2, static_cast<TopicId>(1), nullptr, nullptr)
+        == OT_ERROR_NONE, "publish failed");
+    VerifyOrQuit(client.Subscribe("commands", false, kQos1, nullptr, nullptr) == OT_ERROR_NONE, "subscribe failed");
+    while (client.GetState() == kStateActive)
+    {
+        RunFor(100);
+    }
+    VerifyOrQuit(client.GetState() == kStateLost, "client not lost");
+
+    client.Stop();
+}
+
+int main(void)
+{
+    TestNameLength();
+    TestPublishByName();
+    TestPublishShortTopicName();
+    TestTimeoutWithoutCallback();
+    printf("All tests passed\n");
+    return 0;
+}
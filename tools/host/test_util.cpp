@@ -0,0 +1,312 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "test_util.hpp"
+#include "common/timer.hpp"
+
+namespace ot {
+namespace Host {
+
+using namespace Mqttsn;
+
+static TestGateway* sGateways = nullptr;
+
+TestGateway::TestGateway(const char* aAddress, uint16_t aPort)
+    : mAddress()
+    , mPort(aPort)
+    , mAnswering(true)
+    , mLatency(10)
+    , mReturnCode(kCodeAccepted)
+    , mCount(0)
+    , mAnswerCount(0)
+    , mTopicCount(0)
+    , mNext(sGateways)
+{
+    mAddress.FromString(aAddress);
+    sGateways = this;
+    SetUdpSendHandler(HandleUdpSend, nullptr);
+}
+
+TestGateway::~TestGateway(void)
+{
+    for (TestGateway** gateway = &sGateways; *gateway != nullptr; gateway = &(*gateway)->mNext)
+    {
+        if (*gateway == this)
+        {
+            *gateway = mNext;
+            break;
+        }
+    }
+}
+
+otError TestGateway::Send(const MessageBase &aMessage, uint16_t aClientPort)
+{
+    otError error = OT_ERROR_NONE;
+    Ip6::MessageInfo messageInfo;
+    uint8_t buffer[kTestPacketSize];
+    int32_t length;
+
+    SuccessOrExit(error = aMessage.Serialize(buffer, sizeof(buffer), &length));
+    messageInfo.SetPeerAddr(mAddress);
+    messageInfo.SetPeerPort(mPort);
+    messageInfo.SetSockPort(aClientPort);
+    error = Receive(buffer, static_cast<uint16_t>(length), messageInfo);
+
+exit:
+    return error;
+}
+
+uint16_t TestGateway::GetCount(MessageType aType) const
+{
+    uint16_t count = 0;
+
+    for (uint16_t i = 0; i < mCount; i++)
+    {
+        if (mPackets[i].mType == aType)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+const TestPacket* TestGateway::GetPacket(MessageType aType, uint16_t aIndex) const
+{
+    for (uint16_t i = 0; i < mCount; i++)
+    {
+        if (mPackets[i].mType == aType && aIndex-- == 0)
+        {
+            return &mPackets[i];
+        }
+    }
+    return nullptr;
+}
+
+const TestPacket* TestGateway::GetLast(MessageType aType) const
+{
+    uint16_t count = GetCount(aType);
+
+    return (count > 0) ? GetPacket(aType, count - 1) : nullptr;
+}
+
+void TestGateway::ProcessAll(uint32_t aNow)
+{
+    for (TestGateway* gateway = sGateways; gateway != nullptr; gateway = gateway->mNext)
+    {
+        gateway->Process(aNow);
+    }
+}
+
+void TestGateway::HandleUdpSend(Ip6::UdpSocket &aSocket, const Message &aMessage,
+    const Ip6::MessageInfo &aMessageInfo, void* aContext)
+{
+    TestPacket packet;
+
+    OT_UNUSED_VARIABLE(aContext);
+
+    packet.mLength = aMessage.Read(aMessage.GetOffset(), sizeof(packet.mData), packet.mData);
+    packet.mClientPort = aSocket.GetPort();
+    packet.mHopLimit = aMessageInfo.GetHopLimit();
+    packet.mTime = TimerMilli::GetNow();
+    if (MessageBase::DeserializeMessageType(packet.mData, packet.mLength, &packet.mType) != OT_ERROR_NONE)
+    {
+        return;
+    }
+
+    for (TestGateway* gateway = sGateways; gateway != nullptr; gateway = gateway->mNext)
+    {
+        if (gateway->mAddress == aMessageInfo.GetPeerAddr() && gateway->mPort == aMessageInfo.GetPeerPort())
+        {
+            gateway->HandleReceive(packet);
+        }
+    }
+}
+
+void TestGateway::HandleReceive(const TestPacket &aPacket)
+{
+    if (mCount < kTestMaxPackets)
+    {
+        mPackets[mCount++] = aPacket;
+    }
+    VerifyOrExit(mAnswering);
+
+    switch (aPacket.mType)
+    {
+    case kTypeConnect:
+        Answer(ConnackMessage(mReturnCode), aPacket.mClientPort);
+        break;
+    case kTypePingreq:
+        Answer(PingrespMessage(), aPacket.mClientPort);
+        break;
+    case kTypeRegister:
+    {
+        RegisterMessage registerMessage;
+        SuccessOrExit(registerMessage.Deserialize(aPacket.mData, aPacket.mLength));
+        Answer(RegackMessage(mReturnCode, GetTopicId(registerMessage.GetTopicName().AsCString()),
+            registerMessage.GetMessageId()), aPacket.mClientPort);
+        break;
+    }
+    case kTypeSubscribe:
+    {
+        SubscribeMessage subscribeMessage;
+        SuccessOrExit(subscribeMessage.Deserialize(aPacket.mData, aPacket.mLength));
+        SubackMessage subackMessage(mReturnCode, (subscribeMessage.GetTopicIdType() == kTopicName)
+            ? GetTopicId(subscribeMessage.GetTopicName().AsCString()) : subscribeMessage.GetTopicId(),
+            subscribeMessage.GetMessageId());
+        subackMessage.SetQos(kQos1);
+        Answer(subackMessage, aPacket.mClientPort);
+        break;
+    }
+    case kTypeUnsubscribe:
+    {
+        UnsubscribeMessage unsubscribeMessage;
+        SuccessOrExit(unsubscribeMessage.Deserialize(aPacket.mData, aPacket.mLength));
+        Answer(UnsubackMessage(kCodeAccepted, unsubscribeMessage.GetMessageId()), aPacket.mClientPort);
+        break;
+    }
+    case kTypePublish:
+    {
+        PublishMessage publishMessage;
+        SuccessOrExit(publishMessage.Deserialize(aPacket.mData, aPacket.mLength));
+        if (publishMessage.GetQos() == kQos1)
+        {
+            Answer(PubackMessage(mReturnCode, publishMessage.GetTopicId(), publishMessage.GetMessageId()),
+                aPacket.mClientPort);
+        }
+        else if (publishMessage.GetQos() == kQos2)
+        {
+            Answer(PubrecMessage(publishMessage.GetMessageId()), aPacket.mClientPort);
+        }
+        break;
+    }
+    case kTypePubrel:
+    {
+        PubrelMessage pubrelMessage;
+        SuccessOrExit(pubrelMessage.Deserialize(aPacket.mData, aPacket.mLength));
+        Answer(PubcompMessage(pubrelMessage.GetMessageId()), aPacket.mClientPort);
+        break;
+    }
+    case kTypeDisconnect:
+        Answer(DisconnectMessage(0), aPacket.mClientPort);
+        break;
+    default:
+        break;
+    }
+
+exit:
+    return;
+}
+
+void TestGateway::Answer(const MessageBase &aMessage, uint16_t aClientPort)
+{
+    TestPacket* answer = &mAnswers[mAnswerCount];
+    int32_t length;
+
+    VerifyOrExit(mAnswerCount < kTestMaxAnswers);
+    SuccessOrExit(aMessage.Serialize(answer->mData, sizeof(answer->mData), &length));
+    answer->mLength = static_cast<uint16_t>(length);
+    answer->mClientPort = aClientPort;
+    answer->mTime = TimerMilli::GetNow() + mLatency;
+    mAnswerCount++;
+
+exit:
+    return;
+}
+
+TopicId TestGateway::GetTopicId(const char* aTopicName)
+{
+    uint8_t i;
+
+    for (i = 0; i < mTopicCount; i++)
+    {
+        if (strcmp(mTopics[i], aTopicName) == 0)
+        {
+            break;
+        }
+    }
+    if (i == mTopicCount && mTopicCount < kTestMaxTopics)
+    {
+        strncpy(mTopics[mTopicCount], aTopicName, sizeof(mTopics[0]) - 1);
+        mTopics[mTopicCount][sizeof(mTopics[0]) - 1] = '\0';
+        mTopicCount++;
+    }
+    return static_cast<TopicId>(i + 1);
+}
+
+void TestGateway::Process(uint32_t aNow)
+{
+    uint16_t i = 0;
+
+    // Answers are delivered in order of their time, delivered answer is removed from the queue
+    while (i < mAnswerCount)
+    {
+        if (static_cast<int32_t>(aNow - mAnswers[i].mTime) >= 0)
+        {
+            TestPacket answer = mAnswers[i];
+            Ip6::MessageInfo messageInfo;
+
+            memmove(&mAnswers[i], &mAnswers[i + 1], (mAnswerCount - i - 1) * sizeof(mAnswers[0]));
+            mAnswerCount--;
+            messageInfo.SetPeerAddr(mAddress);
+            messageInfo.SetPeerPort(mPort);
+            messageInfo.SetSockPort(answer.mClientPort);
+            Receive(answer.mData, answer.mLength, messageInfo);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void StartAndConnect(MqttsnClient &aClient, MqttsnConfig &aConfig, const TestGateway &aGateway)
+{
+    aConfig.SetAddress(aGateway.GetAddress());
+    aConfig.SetPort(aGateway.GetPort());
+    aConfig.SetClientId("test-client");
+    VerifyOrQuit(aClient.Start(kTestClientPort) == OT_ERROR_NONE, "client not started");
+    VerifyOrQuit(aClient.Connect(aConfig) == OT_ERROR_NONE, "connect failed");
+    RunFor(100);
+    VerifyOrQuit(aClient.GetState() == kStateActive, "client not connected");
+}
+
+void RunFor(uint32_t aDuration)
+{
+    uint32_t now = TimerMilli::GetNow();
+
+    for (uint32_t i = 0; i < aDuration; i++)
+    {
+        AdvanceTime(++now);
+        TestGateway::ProcessAll(now);
+    }
+}
+
+}
+}
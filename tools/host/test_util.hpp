@@ -0,0 +1,251 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TEST_UTIL_HPP_
+#define TEST_UTIL_HPP_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host_platform.hpp"
+#include "mqttsn_client.hpp"
+#include "mqttsn_serializer.hpp"
+
+/**
+ * @file
+ *   This file includes helpers of host tests. Test gateway records messages sent by the client and answers
+ *   them after configured latency, virtual time is moved by RunFor.
+ *
+ */
+
+#define VerifyOrQuit(aCondition, aMessage)                                            \
+    do                                                                                \
+    {                                                                                 \
+        if (!(aCondition))                                                            \
+        {                                                                             \
+            fprintf(stderr, "%s:%d: FAILED: %s\n", __FILE__, __LINE__, aMessage);     \
+            exit(1);                                                                  \
+        }                                                                             \
+    } while (false)
+
+namespace ot {
+namespace Host {
+
+enum
+{
+    /**
+     * UDP port of tested client.
+     *
+     */
+    kTestClientPort = 10000,
+    /**
+     * Maximal length of recorded message.
+     *
+     */
+    kTestPacketSize = 128,
+    /**
+     * Number of messages recorded by test gateway.
+     *
+     */
+    kTestMaxPackets = 256,
+    /**
+     * Number of answers which wait for delivery in test gateway.
+     *
+     */
+    kTestMaxAnswers = 64,
+    /**
+     * Number of topic names to which test gateway assigns topic IDs.
+     *
+     */
+    kTestMaxTopics = 32
+};
+
+/**
+ * Message sent or to be sent over simulated network.
+ *
+ */
+struct TestPacket
+{
+    uint8_t mData[kTestPacketSize];
+    uint16_t mLength;
+    Mqttsn::MessageType mType;
+    uint16_t mClientPort;
+    uint8_t mHopLimit;
+    uint32_t mTime;
+};
+
+/**
+ * Simulated MQTT-SN gateway. It records each message sent to its address and port by any client and answers
+ * requests with accepted acknowledgements. Topic IDs are assigned by topic name in order of first use.
+ *
+ */
+class TestGateway
+{
+public:
+    /**
+     * Constructor of the gateway. The gateway receives messages until it is destroyed.
+     *
+     * @param[in]  aAddress  A pointer to gateway IPv6 address string, multicast address is used to record
+     *                       multicast messages.
+     * @param[in]  aPort     Gateway UDP port.
+     *
+     */
+    TestGateway(const char* aAddress, uint16_t aPort);
+
+    ~TestGateway(void);
+
+    const Ip6::Address &GetAddress(void) const { return mAddress; }
+
+    uint16_t GetPort(void) const { return mPort; }
+
+    /**
+     * Set whether the gateway answers received messages. Messages are recorded also when not answered.
+     *
+     * @param[in]  aAnswering  True if the gateway answers.
+     *
+     */
+    void SetAnswering(bool aAnswering) { mAnswering = aAnswering; }
+
+    /**
+     * Set delay between received message and its answer.
+     *
+     * @param[in]  aLatency  Delay in milliseconds.
+     *
+     */
+    void SetLatency(uint32_t aLatency) { mLatency = aLatency; }
+
+    /**
+     * Set return code of CONNACK, REGACK, SUBACK and PUBACK answers.
+     *
+     * @param[in]  aCode  Return code.
+     *
+     */
+    void SetReturnCode(Mqttsn::ReturnCode aCode) { mReturnCode = aCode; }
+
+    /**
+     * Send message to the client immediately.
+     *
+     * @param[in]  aMessage     A reference to message.
+     * @param[in]  aClientPort  Client UDP port.
+     *
+     * @retval OT_ERROR_NONE       The message was delivered.
+     * @retval OT_ERROR_NOT_FOUND  No client socket is bound to the port.
+     *
+     */
+    otError Send(const Mqttsn::MessageBase &aMessage, uint16_t aClientPort = kTestClientPort);
+
+    /**
+     * Get number of recorded messages of the type.
+     *
+     * @param[in]  aType  Message type.
+     *
+     * @returns  Number of messages.
+     *
+     */
+    uint16_t GetCount(Mqttsn::MessageType aType) const;
+
+    /**
+     * Get recorded message of the type.
+     *
+     * @param[in]  aType   Message type.
+     * @param[in]  aIndex  Index of the message among messages of the type in order of reception.
+     *
+     * @returns  A pointer to message or null when there is no such message.
+     *
+     */
+    const TestPacket* GetPacket(Mqttsn::MessageType aType, uint16_t aIndex) const;
+
+    /**
+     * Get the last recorded message of the type.
+     *
+     * @param[in]  aType  Message type.
+     *
+     * @returns  A pointer to message or null when there is no such message.
+     *
+     */
+    const TestPacket* GetLast(Mqttsn::MessageType aType) const;
+
+    /**
+     * Forget recorded messages.
+     *
+     */
+    void Clear(void) { mCount = 0; }
+
+    /**
+     * Deliver answers of all gateways which are due.
+     *
+     * @param[in]  aNow  Current time in milliseconds.
+     *
+     */
+    static void ProcessAll(uint32_t aNow);
+
+private:
+    static void HandleUdpSend(Ip6::UdpSocket &aSocket, const Message &aMessage,
+        const Ip6::MessageInfo &aMessageInfo, void* aContext);
+    void HandleReceive(const TestPacket &aPacket);
+    void Answer(const Mqttsn::MessageBase &aMessage, uint16_t aClientPort);
+    Mqttsn::TopicId GetTopicId(const char* aTopicName);
+    void Process(uint32_t aNow);
+
+    Ip6::Address mAddress;
+    uint16_t mPort;
+    bool mAnswering;
+    uint32_t mLatency;
+    Mqttsn::ReturnCode mReturnCode;
+    TestPacket mPackets[kTestMaxPackets];
+    uint16_t mCount;
+    TestPacket mAnswers[kTestMaxAnswers];
+    uint16_t mAnswerCount;
+    char mTopics[kTestMaxTopics][Mqttsn::kMaxTopicNameLength];
+    uint8_t mTopicCount;
+    TestGateway* mNext;
+};
+
+/**
+ * Start the client on kTestClientPort and connect it to the gateway. Address, port and client ID of the
+ * configuration are set, other parameters are kept. The test quits when the client is not connected.
+ *
+ * @param[in]  aClient   A reference to the client.
+ * @param[in]  aConfig   A reference to client configuration.
+ * @param[in]  aGateway  A reference to the gateway.
+ *
+ */
+void StartAndConnect(Mqttsn::MqttsnClient &aClient, Mqttsn::MqttsnConfig &aConfig, const TestGateway &aGateway);
+
+/**
+ * Move virtual time forward millisecond by millisecond, fire expired timers and deliver gateway answers.
+ *
+ * @param[in]  aDuration  Time in milliseconds.
+ *
+ */
+void RunFor(uint32_t aDuration);
+
+}
+}
+
+#endif /* TEST_UTIL_HPP_ */
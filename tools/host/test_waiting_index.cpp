@@ -0,0 +1,256 @@
+/*
+ *  Copyright (c) 2018, Vit Holasek
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "test_util.hpp"
+#include "openthread/platform/random.h"
+
+/**
+ * @file
+ *   This file contains test of waiting messages index. Deadlines expire in order across timer wrap around and
+ *   message IDs stay reachable after removal of colliding entries from the lookup table.
+ *
+ */
+
+#define TEST_RANDOM_OPERATIONS 20000
+
+using namespace ot;
+using namespace ot::Host;
+using namespace ot::Mqttsn;
+
+class TestQueue : public WaitingMessagesQueueBase
+{
+public:
+    TestQueue(WaitingMessagesIndex &aIndex)
+        : mIndex(aIndex)
+        , mCount(0)
+    {
+        memset(mMessages, 0, sizeof(mMessages));
+    }
+
+    // Add message with ID and deadline and remember its slot
+    void Add(uint16_t aMessageId, uint32_t aDeadline, bool aHasDeadline = true)
+    {
+        Message* message = Message::New(0);
+
+        VerifyOrQuit(message != nullptr, "no message buffers");
+        VerifyOrQuit(mIndex.Add(aDeadline, aHasDeadline, aMessageId, *message, *this, mSlots[mCount])
+            == OT_ERROR_NONE, "add failed");
+        mMessages[mCount] = message;
+        mIds[mCount] = aMessageId;
+        mCount++;
+    }
+
+    // Remove message with the ID, the last added message takes its position
+    void Remove(uint16_t aMessageId)
+    {
+        uint8_t i = IndexOf(aMessageId);
+
+        mIndex.Remove(mSlots[i]);
+        mMessages[i]->Free();
+        mCount--;
+        mMessages[i] = mMessages[mCount];
+        mSlots[i] = mSlots[mCount];
+        mIds[i] = mIds[mCount];
+    }
+
+    bool Contains(uint16_t aMessageId) const
+    {
+        for (uint8_t i = 0; i < mCount; i++)
+        {
+            if (mIds[i] == aMessageId)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Message* GetMessage(uint16_t aMessageId) const { return mMessages[IndexOf(aMessageId)]; }
+
+    uint8_t GetSlot(uint16_t aMessageId) const { return mSlots[IndexOf(aMessageId)]; }
+
+    uint8_t GetCount(void) const { return mCount; }
+
+    void HandleDeadline(Message &aMessage)
+    {
+        for (uint8_t i = 0; i < mCount; i++)
+        {
+            if (mMessages[i] == &aMessage)
+            {
+                mExpired[mExpiredCount++] = mIds[i];
+                Remove(mIds[i]);
+                return;
+            }
+        }
+        VerifyOrQuit(false, "unknown message expired");
+    }
+
+    uint16_t mExpired[kMaxWaitingMessages];
+    uint8_t mExpiredCount;
+
+private:
+    uint8_t IndexOf(uint16_t aMessageId) const
+    {
+        for (uint8_t i = 0; i < mCount; i++)
+        {
+            if (mIds[i] == aMessageId)
+            {
+                return i;
+            }
+        }
+        VerifyOrQuit(false, "message not added");
+        return 0;
+    }
+
+    WaitingMessagesIndex &mIndex;
+    Message* mMessages[kMaxWaitingMessages];
+    uint8_t mSlots[kMaxWaitingMessages];
+    uint16_t mIds[kMaxWaitingMessages];
+    uint8_t mCount;
+};
+
+// Deadlines before and after timer wrap around expire in time order, entries without deadline never expire
+static void TestDeadlineWrapAround(void)
+{
+    WaitingMessagesIndex index;
+    TestQueue queue(index);
+    uint32_t deadline;
+
+    queue.mExpiredCount = 0;
+    queue.Add(1, 0x00000100);
+    queue.Add(2, 0xffffff00);
+    queue.Add(3, 0, false);
+    queue.Add(4, 0xfffffff0);
+    queue.Add(5, 0x00000010);
+    VerifyOrQuit(index.GetNextDeadline(deadline) && deadline == 0xffffff00, "wrong earliest deadline");
+
+    index.HandleExpired(0xffffff80);
+    VerifyOrQuit(queue.mExpiredCount == 1 && queue.mExpired[0] == 2, "wrong entries expired before wrap around");
+    index.HandleExpired(0x00000050);
+    VerifyOrQuit(queue.mExpiredCount == 3 && queue.mExpired[1] == 4 && queue.mExpired[2] == 5,
+        "wrong entries expired across wrap around");
+
+    // Postponed deadline moves the entry behind later deadline
+    queue.Add(6, 0x00000200);
+    index.Update(queue.GetSlot(1), 0x00000300);
+    VerifyOrQuit(index.GetNextDeadline(deadline) && deadline == 0x00000200, "updated deadline not reordered");
+    index.HandleExpired(0x00001000);
+    VerifyOrQuit(queue.mExpiredCount == 5 && queue.mExpired[3] == 6 && queue.mExpired[4] == 1,
+        "updated entries expired out of order");
+    VerifyOrQuit(!index.GetNextDeadline(deadline) && queue.GetCount() == 1, "entry without deadline expired");
+    queue.Remove(3);
+}
+
+// Removal shifts colliding message IDs back, including probe sequences which wrap around the table end
+static void TestCollidingIds(void)
+{
+    WaitingMessagesIndex index;
+    TestQueue queue(index);
+    TestQueue otherQueue(index);
+    const uint16_t size = kWaitingMessagesIdTableSize;
+    // The first three IDs share the last table position, the fourth ID is at home where the chain wraps
+    const uint16_t ids[] = {size - 1, 2 * size - 1, 3 * size - 1, size, 2 * size};
+
+    for (uint8_t i = 0; i < sizeof(ids) / sizeof(ids[0]); i++)
+    {
+        queue.Add(ids[i], 1000);
+    }
+    // The same message ID in other queue is distinct message
+    otherQueue.Add(ids[1], 1000);
+
+    queue.Remove(ids[0]);
+    for (uint8_t i = 1; i < sizeof(ids) / sizeof(ids[0]); i++)
+    {
+        VerifyOrQuit(index.Find(queue, ids[i]) == queue.GetMessage(ids[i]), "colliding message ID lost");
+    }
+    VerifyOrQuit(index.Find(queue, ids[0]) == nullptr, "removed message ID found");
+    VerifyOrQuit(index.Find(otherQueue, ids[1]) == otherQueue.GetMessage(ids[1]), "message of other queue lost");
+
+    queue.Remove(ids[3]);
+    VerifyOrQuit(index.Find(queue, ids[4]) == queue.GetMessage(ids[4]), "message ID behind removed entry lost");
+    VerifyOrQuit(index.Find(queue, ids[2]) == queue.GetMessage(ids[2]), "message ID before removed entry lost");
+
+    queue.Remove(ids[1]);
+    queue.Remove(ids[2]);
+    queue.Remove(ids[4]);
+    otherQueue.Remove(ids[1]);
+}
+
+// Random additions and removals of colliding IDs are checked against plain list of added messages
+static void TestRandomOperations(void)
+{
+    WaitingMessagesIndex index;
+    TestQueue queue(index);
+    uint32_t deadline;
+    uint8_t slot;
+
+    SetRandomSeed(7);
+    for (uint32_t i = 0; i < TEST_RANDOM_OPERATIONS; i++)
+    {
+        // IDs from few home positions make long probe sequences
+        uint16_t messageId = static_cast<uint16_t>((otPlatRandomGet() % 8) * kWaitingMessagesIdTableSize
+            + kWaitingMessagesIdTableSize - 2 + otPlatRandomGet() % 4);
+
+        if (queue.Contains(messageId))
+        {
+            queue.Remove(messageId);
+        }
+        else if (queue.GetCount() < kMaxWaitingMessages)
+        {
+            queue.Add(messageId, otPlatRandomGet());
+        }
+
+        for (uint16_t j = 0; j < 9 * kWaitingMessagesIdTableSize; j++)
+        {
+            Message* message = index.Find(queue, j);
+            VerifyOrQuit(message == (queue.Contains(j) ? queue.GetMessage(j) : nullptr), "wrong lookup result");
+        }
+    }
+    VerifyOrQuit(index.GetNextDeadline(deadline) == (queue.GetCount() > 0), "wrong deadline state");
+
+    // Index has fixed capacity
+    for (uint16_t messageId = 1; queue.GetCount() < kMaxWaitingMessages; messageId++)
+    {
+        if (!queue.Contains(messageId))
+        {
+            queue.Add(messageId, 0);
+        }
+    }
+    VerifyOrQuit(index.Add(0, true, 0, *queue.GetMessage(1), queue, slot) == OT_ERROR_NO_BUFS, "full index extended");
+}
+
+int main(void)
+{
+    TestDeadlineWrapAround();
+    TestCollidingIds();
+    TestRandomOperations();
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+#
+#  Copyright (c) 2018, Vit Holasek
+#  All rights reserved.
+#
+#  Redistribution and use in source and binary forms, with or without
+#  modification, are permitted provided that the following conditions are met:
+#  1. Redistributions of source code must retain the above copyright
+#     notice, this list of conditions and the following disclaimer.
+#  2. Redistributions in binary form must reproduce the above copyright
+#     notice, this list of conditions and the following disclaimer in the
+#     documentation and/or other materials provided with the distribution.
+#  3. Neither the name of the copyright holder nor the
+#     names of its contributors may be used to endorse or promote products
+#     derived from this software without specific prior written permission.
+#
+#  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+#  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+#  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+#  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+#  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+#  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+#  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+#  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+#  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+#  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+#  POSSIBILITY OF SUCH DAMAGE.
+#
+
+"""
+Tokenized log tool. Builds token database from sources and decodes binary log output produced
+with MQTTSN_LOG_TOKENIZED enabled.
+
+    log_tokens.py database -o tokens.csv source
+    log_tokens.py database --all-literals -o ot-tokens.csv openthread/src/core
+    log_tokens.py decode -d tokens.csv -d ot-tokens.csv capture.bin
+
+Format strings passed to otPlatLog are hashed at runtime, so OpenThread sources must be scanned with
+--all-literals. Strings composed by macros (e.g. log region prefixes) cannot be resolved from sources.
+"""
+
+import argparse
+import csv
+import os
+import re
+import sys
+
+LOG_CALL = re.compile(r'MQTTSN_LOG\s*\(\s*((?:"(?:\\.|[^"\\])*"\s*)+)')
+LITERALS = re.compile(r'((?:"(?:\\.|[^"\\\n])*"\s*)+)')
+LITERAL = re.compile(r'"((?:\\.|[^"\\])*)"')
+SPECIFIER = re.compile(r'%([-+ #0-9.*]*)([hlzjtL]*)([diouxXcspfeEgG%])')
+SOURCE_EXTENSIONS = ('.c', '.cpp', '.h', '.hpp')
+
+
+def token_hash(data):
+    """Compute 32-bit FNV-1a hash, the same as LogTokenHash in mqttsn_log.hpp."""
+    value = 2166136261
+    for byte in data:
+        value = ((value ^ byte) * 16777619) & 0xffffffff
+    return value
+
+
+def unescape(literals):
+    """Join adjacent C string literals and resolve escape sequences."""
+    text = ''.join(LITERAL.findall(literals))
+    return text.encode('latin-1').decode('unicode_escape').encode('latin-1')
+
+
+def scan(paths, all_literals):
+    pattern = LITERALS if all_literals else LOG_CALL
+    strings = set()
+    for path in paths:
+        files = [path]
+        if os.path.isdir(path):
+            files = [os.path.join(root, name) for root, _, names in os.walk(path)
+                     for name in names if name.endswith(SOURCE_EXTENSIONS)]
+        for name in files:
+            with open(name, encoding='latin-1') as source:
+                for match in pattern.finditer(source.read()):
+                    strings.add(unescape(match.group(1)))
+    return strings
+
+
+def command_database(args):
+    tokens = {}
+    for string in sorted(scan(args.sources, args.all_literals)):
+        token = token_hash(string)
+        if token in tokens and tokens[token] != string:
+            sys.stderr.write('Token collision 0x%08x: %r %r\n' % (token, tokens[token], string))
+        tokens[token] = string
+    output = open(args.output, 'w', newline='') if args.output else sys.stdout
+    writer = csv.writer(output)
+    for token, string in sorted(tokens.items()):
+        writer.writerow(['%08x' % token, string.decode('latin-1').encode('unicode_escape').decode('ascii')])
+    if args.output:
+        output.close()
+
+
+def load_database(paths):
+    tokens = {}
+    for path in paths:
+        with open(path, newline='') as database:
+            for row in csv.reader(database):
+                tokens[int(row[0], 16)] = row[1].encode('ascii').decode('unicode_escape')
+    return tokens
+
+
+def read_varint(data, offset):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            break
+    # ZigZag decoding
+    return (value >> 1) ^ -(value & 1), offset
+
+
+def format_record(string, data):
+    """Format record arguments with the format string. Arguments are taken in the same order as encoded."""
+    offset = 0
+    result = ''
+    position = 0
+    for match in SPECIFIER.finditer(string):
+        flags, _, conversion = match.groups()
+        result += string[position:match.start()]
+        position = match.end()
+        if conversion == '%':
+            result += '%'
+            continue
+        if '*' in flags:
+            width, offset = read_varint(data, offset)
+            flags = flags.replace('*', str(width), 1)
+        if conversion == 's':
+            length = data[offset]
+            value = data[offset + 1:offset + 1 + length].decode('latin-1')
+            offset += 1 + length
+        else:
+            value, offset = read_varint(data, offset)
+            if conversion in 'uoxX':
+                value &= 0xffffffff
+            elif conversion == 'p':
+                value &= 0xffffffff
+                conversion = 'x'
+                flags = '#' + flags
+            elif conversion in 'feEgG':
+                value = float(value)
+        result += ('%' + flags + conversion) % value
+    return result + string[position:]
+
+
+def command_decode(args):
+    tokens = load_database(args.database)
+    with open(args.input, 'rb') as capture:
+        data = capture.read()
+    offset = 0
+    while offset < len(data):
+        length = data[offset]
+        record = data[offset + 1:offset + 1 + length]
+        offset += 1 + length
+        if len(record) < 4:
+            break
+        token = int.from_bytes(record[:4], 'little')
+        if token not in tokens:
+            sys.stdout.write('<unknown token %08x>\n' % token)
+            continue
+        try:
+            sys.stdout.write(format_record(tokens[token], record[4:]).replace('\r\n', '\n'))
+        except (IndexError, TypeError, ValueError):
+            sys.stdout.write('<malformed record %08x>\n' % token)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Tokenized log database builder and decoder.')
+    commands = parser.add_subparsers(dest='command')
+    database = commands.add_parser('database', help='build token database from sources')
+    database.add_argument('sources', nargs='+', help='source files or directories')
+    database.add_argument('-o', '--output', help='output CSV file, standard output by default')
+    database.add_argument('--all-literals', action='store_true',
+                          help='add all string literals, not only MQTTSN_LOG format strings')
+    decode = commands.add_parser('decode', help='decode captured binary log')
+    decode.add_argument('input', help='captured binary log file')
+    decode.add_argument('-d', '--database', action='append', required=True, help='token database CSV file')
+    args = parser.parse_args()
+    if args.command == 'database':
+        command_database(args)
+    elif args.command == 'decode':
+        command_decode(args)
+    else:
+        parser.print_help()
+
+
+if __name__ == '__main__':
+    main()